@@ -50,7 +50,7 @@ if not exist "%FMOD_LIB%\fmod_vc.lib" (
 echo Compiling source files (64-bit)...
 cl /std:c++17 /EHsc /O2 /nologo /DFMOD_AVAILABLE %DISCORD_FLAGS% ^
    /I"headers" /I"%FMOD_INC%" ^
-   /c src\audioPlayer.cpp src\main.cpp src\musicPlayer.cpp src\playlist.cpp src\songScanner.cpp src\discordPresence.cpp ^
+   /c src\audioPlayer.cpp src\main.cpp src\musicPlayer.cpp src\playlist.cpp src\songScanner.cpp src\discordPresence.cpp src\shuffleEngine.cpp src\smartShuffle.cpp src\playQueue.cpp src\sessionSnapshot.cpp src\playStats.cpp src\audioBackend.cpp src\audioSink.cpp src\wavDecoder.cpp src\mp3Decoder.cpp src\layer3Decoder.cpp src\playbackEngine.cpp src\streamBuffer.cpp src\crossfade.cpp src\wakeSignal.cpp src\renderStatus.cpp src\audioEvents.cpp src\mp3SeekIndex.cpp src\trackCache.cpp src\loudnessMeter.cpp src\loudnessLibrary.cpp src\rateSource.cpp src\resampleSource.cpp src\equalizer.cpp src\analysisTap.cpp src\realFft.cpp src\visualizer.cpp src\osuBeatmap.cpp src\featureAnalyzer.cpp src\featureLibrary.cpp src\fingerprint.cpp src\duplicateIndex.cpp src\similarityIndex.cpp src\waveform.cpp src\mappedFile.cpp src\playlistExport.cpp src\previewClip.cpp ^
    /Fo:build\ ^
    /favor:AMD64
 
@@ -64,13 +64,13 @@ if errorlevel 1 (
 echo Linking (64-bit)...
 if defined DISCORD_LIBS (
     link /nologo /MACHINE:X64 ^
-         build\audioPlayer.obj build\main.obj build\musicPlayer.obj build\playlist.obj build\songScanner.obj build\discordPresence.obj ^
+         build\audioPlayer.obj build\main.obj build\musicPlayer.obj build\playlist.obj build\songScanner.obj build\discordPresence.obj build\shuffleEngine.obj build\smartShuffle.obj build\playQueue.obj build\sessionSnapshot.obj build\playStats.obj build\audioBackend.obj build\audioSink.obj build\wavDecoder.obj build\mp3Decoder.obj build\playbackEngine.obj build\streamBuffer.obj build\crossfade.obj build\wakeSignal.obj build\renderStatus.obj build\audioEvents.obj build\mp3SeekIndex.obj build\trackCache.obj build\loudnessMeter.obj build\loudnessLibrary.obj build\rateSource.obj build\resampleSource.obj build\equalizer.obj build\analysisTap.obj build\realFft.obj build\visualizer.obj build\osuBeatmap.obj build\featureAnalyzer.obj build\featureLibrary.obj build\fingerprint.obj build\duplicateIndex.obj build\similarityIndex.obj build\waveform.obj build\mappedFile.obj build\playlistExport.obj build\previewClip.obj ^
          /LIBPATH:"%FMOD_LIB%" fmod_vc.lib ^
          /LIBPATH:"%DISCORD_LIB%" %DISCORD_LIBS% ^
          /OUT:bin\Stardust.exe
 ) else (
     link /nologo /MACHINE:X64 ^
-         build\audioPlayer.obj build\main.obj build\musicPlayer.obj build\playlist.obj build\songScanner.obj build\discordPresence.obj ^
+         build\audioPlayer.obj build\main.obj build\musicPlayer.obj build\playlist.obj build\songScanner.obj build\discordPresence.obj build\shuffleEngine.obj build\smartShuffle.obj build\playQueue.obj build\sessionSnapshot.obj build\playStats.obj build\audioBackend.obj build\audioSink.obj build\wavDecoder.obj build\mp3Decoder.obj build\playbackEngine.obj build\streamBuffer.obj build\crossfade.obj build\wakeSignal.obj build\renderStatus.obj build\audioEvents.obj build\mp3SeekIndex.obj build\trackCache.obj build\loudnessMeter.obj build\loudnessLibrary.obj build\rateSource.obj build\resampleSource.obj build\equalizer.obj build\analysisTap.obj build\realFft.obj build\visualizer.obj build\osuBeatmap.obj build\featureAnalyzer.obj build\featureLibrary.obj build\fingerprint.obj build\duplicateIndex.obj build\similarityIndex.obj build\waveform.obj build\mappedFile.obj build\playlistExport.obj build\previewClip.obj ^
          /LIBPATH:"%FMOD_LIB%" fmod_vc.lib ^
          /OUT:bin\Stardust.exe
 )
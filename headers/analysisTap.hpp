@@ -0,0 +1,44 @@
+#ifndef ANALYSISTAP_HPP
+#define ANALYSISTAP_HPP
+
+#include <vector>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+// Copy of the last CAPACITY frames that went to the output, for meters and
+// the spectrum display. Mono is kept as two equal channels, more than two
+// channels keep the first two.
+//
+// The audio thread writes without ever waiting or failing: old frames are
+// simply overwritten. Readers copy the window they want and check afterwards
+// that the writer didn't get to it meanwhile (the same idea as a seqlock), so
+// a slow reader only ever loses a frame of the display, never audio.
+class AnalysisTap {
+public:
+    static const size_t CAPACITY = 32768;
+
+    AnalysisTap();
+
+    // Audio thread
+    void write(const float* frames, size_t frameCount, unsigned int channels);
+    // Frames written but not heard yet (the device latency), reads end this far back
+    void setDelay(size_t frames);
+    void setSampleRate(unsigned int sampleRate);
+
+    // Reader: the last 'frameCount' frames heard, one plane per channel.
+    // Returns false if the writer overwrote them while they were copied
+    bool read(float* left, float* right, size_t frameCount) const;
+    // Frames written so far, unchanged while nothing plays
+    uint64_t getWritten() const;
+    unsigned int getSampleRate() const;
+
+private:
+    std::vector<std::atomic<float>> samples;    // Interleaved pairs, ring index is the frame modulo CAPACITY
+    std::atomic<uint64_t> writing;              // Where the write in progress ends
+    std::atomic<uint64_t> written;
+    std::atomic<size_t> delay;
+    std::atomic<unsigned int> sampleRate;
+};
+
+#endif
\ No newline at end of file
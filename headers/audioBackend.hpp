@@ -0,0 +1,94 @@
+#ifndef AUDIOBACKEND_HPP
+#define AUDIOBACKEND_HPP
+
+#include <string>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+
+struct AudioFormat {
+    unsigned int sampleRate;
+    unsigned int channels;
+
+    AudioFormat() : sampleRate(44100), channels(2) {}
+    AudioFormat(unsigned int rate, unsigned int channelCount) : sampleRate(rate), channels(channelCount) {}
+
+    bool operator==(const AudioFormat& other) const {
+        return sampleRate == other.sampleRate && channels == other.channels;
+    }
+    bool operator!=(const AudioFormat& other) const {
+        return !(*this == other);
+    }
+};
+
+// Source side of the built-in playback path: turns a file into interleaved float frames
+class AudioBackend {
+public:
+    virtual ~AudioBackend() = default;
+
+    virtual bool open(const std::string& path) = 0;
+    // Decode up to frameCount frames into buffer (frameCount * channels floats).
+    // Returns the number of frames written, 0 at end of stream
+    virtual size_t decode(float* buffer, size_t frameCount) = 0;
+    virtual bool seek(uint64_t frame) = 0;
+    // Seek without first doing the prepareSeeking() work: a decoder that would
+    // have to read the whole file for an exact seek lands near 'frame' from
+    // what it already knows instead
+    virtual bool seekNear(uint64_t frame) { return seek(frame); }
+    virtual void close() = 0;
+
+    virtual AudioFormat getFormat() const = 0;
+    virtual uint64_t getLengthFrames() const = 0;
+    virtual uint64_t getPositionFrames() const = 0;
+
+    // Optional work that makes later seeks fast and exact, called by the decode
+    // thread while it has nothing else to do
+    virtual void prepareSeeking() {}
+
+    // Picks the decoder from the file contents and opens it, nullptr if unsupported
+    static std::unique_ptr<AudioBackend> openFile(const std::string& path);
+    // Whether openFile has a decoder for the file, from its first bytes
+    static bool canDecode(const std::string& path);
+};
+
+// Silence of a fixed length, used when no decoder handles a file
+class SilenceSource : public AudioBackend {
+public:
+    SilenceSource(const AudioFormat& format, uint64_t lengthFrames);
+
+    bool open(const std::string& path) override;
+    size_t decode(float* buffer, size_t frameCount) override;
+    bool seek(uint64_t frame) override;
+    void close() override;
+
+    AudioFormat getFormat() const override;
+    uint64_t getLengthFrames() const override;
+    uint64_t getPositionFrames() const override;
+
+private:
+    AudioFormat format;
+    uint64_t lengthFrames;
+    uint64_t positionFrames;
+};
+
+// Output side: consumes interleaved float frames at the device rate
+class AudioSink {
+public:
+    virtual ~AudioSink() = default;
+
+    virtual bool open(const AudioFormat& format) = 0;
+    // Blocks the way a device would; unthrottled sinks return immediately
+    virtual bool write(const float* buffer, size_t frameCount) = 0;
+    virtual void close() = 0;
+
+    virtual unsigned int getLatencyFrames() const { return 0; }
+    virtual std::string getName() const = 0;
+    // Rate a sink has to stay at once it is open, 0 when any rate will do
+    virtual unsigned int getRequiredRate() const { return 0; }
+
+    // "alsa", "null", "fast" (unthrottled null) or "wav" (needs a file path)
+    static std::unique_ptr<AudioSink> create(const std::string& kind, const std::string& path = "");
+    static std::string defaultKind();
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,45 @@
+#ifndef AUDIOEVENTS_HPP
+#define AUDIOEVENTS_HPP
+
+#include <atomic>
+#include <cstdint>
+
+// Lets the audio side wake the console loop instead of being polled.
+// Producers (the render thread, FMOD channel callbacks) set event bits and
+// signal a kernel object; notify never blocks or allocates. The main thread
+// waits on that object and on the console input together, so it sleeps until
+// a command is typed, a track ends or the timeout it asked for runs out.
+class AudioEvents {
+public:
+    enum : uint32_t {
+        TRACK_END = 1,      // The last song ran out with nothing after it
+        TRACK_CHANGE = 2,   // Switched to the preloaded song
+        AUDIO_ERROR = 4,    // The output device stopped taking audio
+        MILESTONE = 8       // Playback passed the position set with setMilestone
+    };
+
+    AudioEvents();
+    ~AudioEvents();
+    AudioEvents(const AudioEvents&) = delete;
+    AudioEvents& operator=(const AudioEvents&) = delete;
+
+    // Any thread
+    void notify(uint32_t events);
+
+    // Main thread. Returns and clears everything notified so far
+    uint32_t take();
+    // Blocks until something was notified, stdin is readable or timeoutMs
+    // passed (-1 waits without a timeout). Can return early.
+    void wait(int timeoutMs);
+
+private:
+    std::atomic<uint32_t> pending;
+#ifdef _WIN32
+    void* handle;       // Auto-reset event
+#else
+    int readFd;         // eventfd on Linux (both ends the same), a self-pipe elsewhere
+    int writeFd;
+#endif
+};
+
+#endif
\ No newline at end of file
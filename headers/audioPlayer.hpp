@@ -4,16 +4,25 @@
 #include <string>
 #include <memory>
 #include <chrono>
+#include <future>
 #include "song.hpp"
+#include "playbackEngine.hpp"
+#include "crossfade.hpp"
+#include "audioEvents.hpp"
+#include "trackCache.hpp"
+#include "analysisTap.hpp"
+#include "previewClip.hpp"
 
 // Forward declaration for FMOD types
 #ifdef FMOD_AVAILABLE
 struct FMOD_SYSTEM;
 struct FMOD_SOUND;
 struct FMOD_CHANNEL;
+struct FMOD_DSP;
 typedef struct FMOD_SYSTEM FMOD_SYSTEM;
 typedef struct FMOD_SOUND FMOD_SOUND;
 typedef struct FMOD_CHANNEL FMOD_CHANNEL;
+typedef struct FMOD_DSP FMOD_DSP;
 #endif
 
 enum class PlaybackState {
@@ -30,7 +39,8 @@ public:
     bool initialize();
     void cleanup();
     
-    bool loadSong(const Song& song);
+    // 'gain' is the song's loudness normalization, applied on top of the volume
+    bool loadSong(const Song& song, float gain = 1.0f);
     void play();
     void pause();
     void resume();
@@ -43,45 +53,158 @@ public:
     
     void setVolume(float volume); // 0.0 to 1.0
     float getVolume() const;
+    // Change the normalization of the current and the preloaded song
+    void setTrackGains(float current, float next);
+    float getTrackGain() const;
     
-    // Position in milliseconds
+    // Position in milliseconds, of what is being heard: samples the output
+    // consumed, less the device latency. Song time, whatever the rate
     unsigned int getPosition() const;
     unsigned int getLength() const;
     void setPosition(unsigned int positionMs);
     
     // New timer-related methods
     unsigned int getCurrentPlaybackPosition() const;
-    unsigned int getRemainingTime() const;
+    unsigned int getRemainingTime() const; // Wall-clock time, so it follows the rate
     std::string formatTime(unsigned int milliseconds) const;
     std::string getProgressString() const;
     
     std::string getCurrentSongName() const;
     
+    // Gapless pre-roll: open the next song ahead and switch to it at end of stream
+    bool preloadSong(const Song& song, float gain = 1.0f);
+    void cancelPreload();
+    std::string getPreloadedPath() const;
+    bool hasAdvancedToPreloaded() const; // Set together with hasFinished() on a gapless switch
+    void acceptPreloaded();              // Make the preloaded song the current one
+    
+    // Whether loadPreview can play 'song': FMOD previews anything it plays, the
+    // built-in path only what its decoders read (WAV and MP3)
+    bool canPreview(const Song& song) const;
+    // Load the PreviewClip of a song instead of the whole song. Until the next
+    // load, positions, seeks and the length are those of the clip
+    bool loadPreview(const Song& song, unsigned int clipMs, float gain = 1.0f);
+    // Open the clip of 'song' in the background and place it on its start, so
+    // a loadPreview of it starts at once. The built-in path decodes its first
+    // moments too; FMOD opens the stream without blocking and update() parks
+    // a paused channel at the start once it is ready
+    void prefetchPreview(const Song& song, unsigned int clipMs);
+    // Where the loaded clip starts in its song, and whether a beatmap's PreviewTime put it there
+    unsigned int getPreviewStartMs() const;
+    bool isPreviewFromBeatmap() const;
+    
+    // Overlap the end of a song with the start of the preloaded one, 0 for gapless
+    void setCrossfade(unsigned int milliseconds, FadeCurve curve);
+    unsigned int getCrossfadeMs() const;
+    FadeCurve getFadeCurve() const;
+    
+    // Playback speed, osu! style: STRETCH keeps the pitch (DT 1.5, HT 0.75),
+    // VARISPEED lets it follow (NC 1.5). Clamped to RateSource::MIN_RATE..MAX_RATE
+    void setRate(double rate, RateMode mode);
+    double getRate() const;
+    RateMode getRateMode() const;
+    
+    // Output device of the built-in playback path ("alsa", "null", "fast", "wav <file>")
+    bool setOutput(const std::string& kind, const std::string& path = "");
+    std::string getOutputInfo() const;
+    // Sample rate the built-in path converts songs to, 0 opens the device at the
+    // rate of each song. FMOD always resamples to its own mixer rate
+    bool setOutputRate(unsigned int sampleRate);
+    unsigned int getOutputRate() const;
+    
+    // Parametric EQ on everything that plays, up to Equalizer::MAX_BANDS bands
+    void setEqualizer(const std::vector<EqBand>& bands);
+    const std::vector<EqBand>& getEqualizer() const;
+    // Time the built-in path spends per channel, band and frame, in nanoseconds.
+    // 0 with FMOD, which runs its own EQ
+    double getEqualizerCost() const;
+    
+    // Copy of what is being heard, for the visualizer
+    const AnalysisTap& getAnalysisTap() const;
+    
     void update(); // Call this regularly to update FMOD and check timing
     
+    // Block until the audio side reports something, console input arrives or
+    // timeoutMs passes (-1 for no timeout). Call update() afterwards
+    void waitForActivity(int timeoutMs);
+    // Wake waitForActivity once the current song plays past this position
+    void setMilestone(unsigned int positionMs);
+    
 private:
 #ifdef FMOD_AVAILABLE
     FMOD_SYSTEM* fmodSystem;
     FMOD_SOUND* currentSound;
     FMOD_CHANNEL* currentChannel;
+    FMOD_SOUND* nextSound;
+    FMOD_CHANNEL* nextChannel;       // Scheduled on the DSP clock to start as currentChannel ends
+    std::shared_ptr<CachedTrack> currentCached; // Owns currentSound when it came from the track cache
+    std::shared_ptr<CachedTrack> nextCached;
+    FMOD_SOUND* pendingSample;       // Whole-file sample loading in the background for the cache
+    std::string pendingSamplePath;
+    size_t pendingSampleBytes;
+    FMOD_DSP* pitchShift;            // On the master group, undoes the pitch change of a stretched rate
+    FMOD_DSP* equalizerUnits[2];     // Multiband EQs of five bands each, on the master group
+    FMOD_DSP* tapUnit;               // Head of the master group, feeds analysisTap
+    FMOD_SOUND* prefetchSound;       // Stream of the next preview, opening on FMOD's loader thread
+    FMOD_CHANNEL* prefetchChannel;   // Paused at the clip start once the stream is ready
+    unsigned int prefetchStartMs;
+    bool prefetchFromBeatmap;
+    FMOD_CHANNEL* primedChannel;     // The prefetched channel loadPreview took over, play() unpauses it
 #else
     void* fmodSystem;
     void* currentSound;
     void* currentChannel;
+    void* nextSound;
+    void* nextChannel;
 #endif
     
     Song currentSong;
     PlaybackState state;
     float volume;
     bool songFinished;
+    Song nextSong;
+    bool hasNextSong;
+    bool advancedToNext;
+    unsigned int crossfadeMs;
+    FadeCurve fadeCurve;
+    unsigned int milestoneMs;        // 0 when none is set
+    unsigned int previewStartMs;
+    bool previewFromBeatmap;
+    float currentGain;               // Loudness normalization of currentSong
+    float nextGain;                  // and of nextSong
+    double rate;
+    RateMode rateMode;
+    std::vector<EqBand> eqBands;
+    
+    AudioEvents events;
+    AnalysisTap analysisTap;
+#ifdef FMOD_AVAILABLE
+    unsigned int previewEndMs;       // Song time the loaded clip stops at, 0 for a whole song
+#else
+    PlaybackEngine engine;
+    std::future<std::unique_ptr<PreviewClip>> prefetchedClip;
+#endif
+    std::string prefetchPath;        // Song and clip length of the prefetched preview
+    unsigned int prefetchClipMs;
     
-    // Timer-related members
-    std::chrono::steady_clock::time_point songStartTime;
-    std::chrono::steady_clock::time_point pauseStartTime;
-    std::chrono::milliseconds pausedDuration;
     unsigned int songLengthMs;
+    unsigned int outputLatencyMs;    // FMOD mixer buffers between the channel position and the speakers
     
     bool initializeFMOD();
+    void beginLoad(const Song& song, float gain);
+#ifdef FMOD_AVAILABLE
+    void scheduleNext();
+    void unscheduleNext();
+    void watchChannel(FMOD_CHANNEL* channel);
+    void applyRate(FMOD_CHANNEL* channel, FMOD_SOUND* sound);
+    void applyEqualizer();
+    bool openSound(const std::string& path, FMOD_SOUND*& sound, std::shared_ptr<CachedTrack>& cached);
+    void releaseSound(FMOD_SOUND*& sound, std::shared_ptr<CachedTrack>& cached);
+    void cacheInBackground(const std::string& path, FMOD_SOUND* stream);
+    void updatePendingSample();
+    void updatePrefetch();
+    void releasePrefetch();
+#endif
 };
 
 #endif
\ No newline at end of file
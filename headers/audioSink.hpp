@@ -0,0 +1,83 @@
+#ifndef AUDIOSINK_HPP
+#define AUDIOSINK_HPP
+
+#include <fstream>
+#include <chrono>
+#include <vector>
+#include "audioBackend.hpp"
+
+#ifdef ALSA_AVAILABLE
+struct _snd_pcm;
+typedef struct _snd_pcm snd_pcm_t;
+#endif
+
+// Discards audio. Real-time mode paces writes to the wall clock like a
+// device would, unthrottled mode returns at once for throughput runs
+class NullSink : public AudioSink {
+public:
+    explicit NullSink(bool realtime);
+
+    bool open(const AudioFormat& format) override;
+    bool write(const float* buffer, size_t frameCount) override;
+    void close() override;
+    unsigned int getLatencyFrames() const override; // The block still "playing" in real-time mode
+    std::string getName() const override;
+
+private:
+    bool realtime;
+    AudioFormat format;
+    uint64_t framesWritten;
+    std::chrono::steady_clock::time_point startTime;
+};
+
+// Captures everything written to a 32-bit float WAV file. Reopening keeps
+// appending, so track transitions land in one file: the file stays at the
+// format it was first opened with, songs are converted to its rate before
+// they get here and other channel counts are mixed to its channels. A
+// different rate is refused rather than losing what was captured.
+// With a data alignment, a JUNK chunk pads the header so the samples start
+// at a multiple of it, and writes of whole multiples stay aligned on disk
+class WavFileSink : public AudioSink {
+public:
+    explicit WavFileSink(const std::string& path, size_t dataAlignment = 0);
+    ~WavFileSink() override;
+
+    bool open(const AudioFormat& format) override;
+    bool write(const float* buffer, size_t frameCount) override;
+    void close() override;
+    std::string getName() const override;
+    unsigned int getRequiredRate() const override;
+
+    void finish(); // Patch the header sizes and close the file
+
+private:
+    std::string path;
+    std::ofstream file;
+    AudioFormat format;
+    unsigned int inputChannels;     // Of what is being written, mixed to format.channels
+    std::vector<float> mixed;
+    uint64_t dataBytes;
+    uint32_t junkBytes;     // Size of the JUNK chunk body, 0 for none
+
+    void writeHeader();
+};
+
+#ifdef ALSA_AVAILABLE
+class AlsaSink : public AudioSink {
+public:
+    AlsaSink();
+    ~AlsaSink() override;
+
+    bool open(const AudioFormat& format) override;
+    bool write(const float* buffer, size_t frameCount) override;
+    void close() override;
+    unsigned int getLatencyFrames() const override;
+    std::string getName() const override;
+
+private:
+    snd_pcm_t* pcm;
+    AudioFormat format;
+};
+#endif
+
+#endif
\ No newline at end of file
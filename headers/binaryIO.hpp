@@ -0,0 +1,37 @@
+#ifndef BINARYIO_HPP
+#define BINARYIO_HPP
+
+#include <istream>
+#include <ostream>
+#include <string>
+#include <cstdint>
+
+// Little helpers for the compact binary files (session, stats, caches).
+// Values are written in native byte order, the files never leave the machine.
+namespace BinaryIO {
+    template <typename T>
+    inline void writeValue(std::ostream& out, const T& value) {
+        out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    template <typename T>
+    inline bool readValue(std::istream& in, T& value) {
+        return static_cast<bool>(in.read(reinterpret_cast<char*>(&value), sizeof(T)));
+    }
+
+    inline void writeString(std::ostream& out, const std::string& value) {
+        writeValue(out, static_cast<uint32_t>(value.size()));
+        out.write(value.data(), static_cast<std::streamsize>(value.size()));
+    }
+
+    inline bool readString(std::istream& in, std::string& value, uint32_t maxLength = 1 << 16) {
+        uint32_t length = 0;
+        if (!readValue(in, length) || length > maxLength) {
+            return false;
+        }
+        value.resize(length);
+        return length == 0 || static_cast<bool>(in.read(&value[0], length));
+    }
+}
+
+#endif
\ No newline at end of file
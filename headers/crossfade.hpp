@@ -0,0 +1,34 @@
+#ifndef CROSSFADE_HPP
+#define CROSSFADE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+enum class FadeCurve {
+    LINEAR,
+    EQUAL_POWER
+};
+
+// Gain ramps and the overlap mix kernel used by crossfades.
+// Both work on caller-owned buffers and never allocate, so they can run on
+// the audio threads. SSE2 is used where the target has it, with a scalar
+// path for the tails and other platforms.
+namespace Crossfade {
+    // Gains for frames [start, start + count) of a fade 'length' frames long.
+    // gainIn rises from 0 to 1, gainOut falls from 1 to 0
+    void computeGains(FadeCurve curve, uint64_t start, uint64_t length, size_t count, float* gainIn, float* gainOut);
+
+    // dst = outgoing * gainOut + incoming * gainIn, per frame of interleaved audio.
+    // dst may alias either input
+    void mix(const float* outgoing, const float* incoming, const float* gainOut, const float* gainIn,
+             float* dst, size_t frames, unsigned int channels);
+
+    // Single point of the curve, for schedulers that work with breakpoints
+    float gainAt(FadeCurve curve, float t, bool incoming);
+
+    std::string curveName(FadeCurve curve);
+    bool parseCurve(const std::string& name, FadeCurve& curve);
+}
+
+#endif
\ No newline at end of file
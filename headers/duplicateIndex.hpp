@@ -0,0 +1,49 @@
+#ifndef DUPLICATEINDEX_HPP
+#define DUPLICATEINDEX_HPP
+
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include <cstddef>
+
+// Finds songs with near-identical fingerprints without comparing every pair.
+//
+// Every other code of each fingerprint goes into a hash table. A code that
+// survives intact is the locality-sensitive part: copies of a song share a
+// good number of exact codes even at a bit error rate around 10%, unrelated
+// songs rarely more than one. A lookup collects votes for (song, time offset)
+// from the query's codes and only checks the bit error rate at the offsets
+// that got enough, so copies with a longer or shorter intro are found too.
+class DuplicateIndex {
+public:
+    static constexpr double MAX_BIT_ERROR_RATE = 0.25;
+
+    void clear();
+    // Empty fingerprints (silence, undecodable files) are left out
+    void add(int songId, const std::vector<uint32_t>& codes);
+    size_t size() const;
+
+    // Songs that sound like 'codes', without 'excludeId'
+    std::vector<int> findMatches(const std::vector<uint32_t>& codes, int excludeId) const;
+    // Groups of two or more songs that sound the same, each ordered by ID,
+    // the groups by their first ID
+    std::vector<std::vector<int>> findClusters() const;
+
+private:
+    static const int MIN_VOTES = 3;
+    // Codes shared by this many frames say nothing, typically near-silence
+    static const size_t MAX_POSTINGS = 512;
+
+    struct Posting {
+        uint32_t track;
+        uint32_t frame;
+    };
+
+    std::vector<int> ids;
+    std::vector<std::vector<uint32_t>> fingerprints;
+    std::unordered_map<uint32_t, std::vector<Posting>> postings;
+
+    std::vector<size_t> matchTracks(const std::vector<uint32_t>& codes, size_t excludeTrack) const;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,105 @@
+#ifndef EQUALIZER_HPP
+#define EQUALIZER_HPP
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+enum class EqFilter {
+    PEAK,
+    LOW_SHELF,
+    HIGH_SHELF,
+    LOW_PASS,
+    HIGH_PASS
+};
+
+struct EqBand {
+    EqFilter type;
+    float frequency;    // Centre, shelf midpoint or cut-off, in Hz
+    float gainDb;       // Unused by the passes
+    float q;
+
+    EqBand() : type(EqFilter::PEAK), frequency(1000.0f), gainDb(0.0f), q(0.707f) {}
+    EqBand(EqFilter filter, float hz, float db, float quality) : type(filter), frequency(hz), gainDb(db), q(quality) {}
+};
+
+// Parametric equalizer: a cascade of up to MAX_BANDS biquads (RBJ cookbook
+// designs) run on the render thread after the volume.
+//
+// Channels are the SIMD lanes: each frame is loaded as one vector per group of
+// four channels and pushed through every band, with the filter state of all
+// lanes of a band in one register. New settings come from the UI through a
+// triple buffer, so neither side ever waits or fails to hand over the latest
+// ones. The coefficients then glide there over RAMP_FRAMES in STEP_FRAMES
+// steps; a straight line between two stable biquads stays stable, and the
+// glide keeps band changes from clicking. Boosts are offset by lowering the
+// level by the largest one, so a boosted band can't clip what was at full scale.
+class Equalizer {
+public:
+    static const size_t MAX_BANDS = 10;
+    static const size_t MAX_CHANNELS = 8;
+
+    Equalizer();
+
+    // UI thread: filter with 'bands' from now on, for audio at 'sampleRate'
+    void setBands(const std::vector<EqBand>& bands, unsigned int sampleRate);
+
+    // Render thread: filter interleaved frames in place
+    void process(float* samples, size_t frames, unsigned int channels);
+
+    // Measured time the filters take per channel, band and frame, in nanoseconds. 0 until measured
+    double getCostNanos() const;
+
+    static std::string filterName(EqFilter type);
+    static bool parseFilter(const std::string& text, EqFilter& type);
+    // "peak:1000:3:0.7,lowshelf:100:6:0.7", the format presets are saved in
+    static std::string formatBands(const std::vector<EqBand>& bands);
+    static bool parseBands(const std::string& text, std::vector<EqBand>& bands);
+
+private:
+    static const size_t RAMP_FRAMES = 1024;     // About 20 ms at common rates
+    static const size_t STEP_FRAMES = 32;
+
+    struct Coefficients {
+        size_t bands;                           // Bands past this are identity
+        float b0[MAX_BANDS];
+        float b1[MAX_BANDS];
+        float b2[MAX_BANDS];
+        float a1[MAX_BANDS];
+        float a2[MAX_BANDS];
+    };
+
+    // Triple buffer: the UI fills slots[back] and swaps it into 'middle', the
+    // render thread swaps its front slot out whenever FRESH is set
+    static const int FRESH = 4;
+    Coefficients slots[3];
+    std::atomic<int> middle;
+    int back;                                   // UI thread
+    int front;                                  // Render thread
+
+    // Render thread
+    Coefficients current;
+    Coefficients rampFrom;
+    Coefficients target;
+    size_t rampStep;                            // Steps into the glide, rampSteps when done
+    size_t rampSteps;
+    size_t activeBands;
+    unsigned int lastChannels;
+    float z1[MAX_BANDS][MAX_CHANNELS];          // Transposed direct form II state
+    float z2[MAX_BANDS][MAX_CHANNELS];
+
+    std::atomic<uint64_t> costNanos;
+    std::atomic<uint64_t> costUnits;            // Channel-band-frames the time was spent on
+
+    static Coefficients design(const std::vector<EqBand>& bands, unsigned int sampleRate);
+    static void setIdentity(Coefficients& coefficients);
+
+    void takeUpdate();
+    void glide();
+    void filter(float* samples, size_t frames, unsigned int channels);
+    void resetState();
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,87 @@
+#ifndef FEATUREANALYZER_HPP
+#define FEATUREANALYZER_HPP
+
+#include <vector>
+#include <cstddef>
+#include "audioBackend.hpp"
+#include "realFft.hpp"
+
+// Tempo and key of one stream, fed chunk by chunk like LoudnessMeter.
+//
+// Tempo: the onset envelope is the spectral flux of a short-time FFT
+// (log-compressed magnitudes, rises only), about 86 values a second. Once the
+// stream is done, its local mean is taken off and its autocorrelation scored
+// over MIN_BPM..MAX_BPM, together with the correlation at twice and half the
+// lag and a broad preference for tempos near 140 BPM against octave errors.
+//
+// Key: spectral peaks of longer FFT frames between C2 and C7 are summed into
+// a 12-bin chroma vector, which is correlated with the Krumhansl-Kessler
+// major and minor profiles in every transposition; the best match wins.
+//
+// Timbre: the same frames give the spectral centroid, the 85% rolloff and
+// MFCCs 1-12 (26 mel bands), averaged over the frames that aren't silent.
+//
+// Only the first MAX_SECONDS are analyzed, that is plenty for both.
+class FeatureAnalyzer {
+public:
+    static constexpr double MIN_BPM = 60.0;
+    static constexpr double MAX_BPM = 220.0;
+    static const unsigned int MAX_SECONDS = 300;
+    static const size_t TIMBRE_SIZE = 14;   // Centroid, rolloff, 12 MFCCs
+
+    // Leave 'tempo' off when the tempo is known already, it saves the short FFTs
+    FeatureAnalyzer(const AudioFormat& format, bool tempo);
+
+    // Interleaved frames, as the decoders produce them
+    void process(const float* frames, size_t frameCount);
+    // True once MAX_SECONDS went in, more input is ignored
+    bool isFull() const;
+
+    // False for silence, which has neither
+    bool hasAudio() const;
+    // 0 when the tempo was left off or no beat stands out
+    double getBpm() const;
+    // 0-11 major on that tonic (C = 0), 12-23 minor, -1 unknown
+    int getKey() const;
+    // Centroid and rolloff in log2 Hz, then the MFCC means. False for silence
+    bool getTimbre(float* timbre) const;
+
+private:
+    AudioFormat format;
+    bool tempo;
+    size_t frameLimit;
+    size_t framesIn;
+    double energy;
+
+    std::vector<float> mono;            // Mixed down, not yet taken by both FFTs
+    size_t onsetPosition;               // Next frame start of each, into 'mono'
+    size_t chromaPosition;
+
+    size_t onsetSize;
+    RealFft onsetFft;
+    std::vector<float> onsetWindow;
+    std::vector<float> onsetFrame;
+    std::vector<float> onsetPower;
+    std::vector<float> lastMagnitudes;
+    size_t fluxBins;                    // Bins up to about 8 kHz
+    std::vector<float> envelope;
+
+    size_t chromaSize;
+    RealFft chromaFft;
+    std::vector<float> chromaWindow;
+    std::vector<float> chromaFrame;
+    std::vector<float> chromaPower;
+    std::vector<int> pitchClass;        // Of every bin, -1 outside C2..C7
+    double chroma[12];
+
+    static const size_t MEL_BANDS = 26;
+    std::vector<double> melEdges;       // Bin positions of the band edges, MEL_BANDS + 2
+    double timbreSums[TIMBRE_SIZE];
+    size_t timbreFrames;
+
+    void onsetStep();
+    void chromaStep();
+    void timbreStep();
+};
+
+#endif
\ No newline at end of file
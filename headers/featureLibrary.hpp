@@ -0,0 +1,123 @@
+#ifndef FEATURELIBRARY_HPP
+#define FEATURELIBRARY_HPP
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <unordered_map>
+#include <cstdint>
+#include "featureAnalyzer.hpp"
+#include "waveform.hpp"
+#include "mappedFile.hpp"
+
+struct TrackFeatures {
+    float bpm;              // 0 when unknown
+    int8_t key;             // As FeatureAnalyzer::getKey, -1 unknown
+    bool bpmFromBeatmap;    // Taken from the timing points of a .osu file
+    bool analyzed;          // False when no built-in decoder reads the file or it decodes to silence
+    bool hasTimbre;         // False for silence and files that weren't decoded
+    float timbre[FeatureAnalyzer::TIMBRE_SIZE];
+
+    TrackFeatures() : bpm(0.0f), key(-1), bpmFromBeatmap(false), analyzed(false), hasTimbre(false), timbre() {}
+};
+
+// Tempo, key, timbre and acoustic fingerprint of the library, kept in
+// features.bin and keyed and stamped like LoudnessLibrary.
+//
+// The waveform overviews would make that file large, so they go to a
+// second one of fixed-size records that stays memory-mapped; features.bin
+// only keeps the record number. A lookup is a single copy out of the
+// mapping. Records of files that changed stay behind as garbage until they
+// outnumber the live ones and save() compacts the file.
+//
+// A feeder thread takes the queued paths, skips the ones that are current,
+// looks for a beatmap with the tempo and hands the rest to low-priority
+// workers through a queue of a few jobs per worker; when that is full the
+// feeder waits, so the backlog stays a list of paths however large the
+// library is. Workers stream each file through FeatureAnalyzer, the tempo
+// detection is skipped when the beatmap had it. Results are saved with the
+// session, an interrupted run picks up where it stopped.
+class FeatureLibrary {
+public:
+    FeatureLibrary();
+    ~FeatureLibrary();
+
+    bool load(const std::string& filename, const std::string& waveformFilename);
+    bool save(const std::string& filename, const std::string& waveformFilename);
+
+    // Queue the files that have no current entry. Threads start on the first call
+    void analyze(const std::vector<std::string>& paths);
+    void stop();
+
+    // Progress of everything queued since startup
+    size_t getAnalyzedCount() const;
+    size_t getQueuedCount() const;
+    bool isBusy() const;
+
+    bool find(const std::string& path, TrackFeatures& features) const;
+    // Fingerprinter codes, false when there are none (not analyzed, silent)
+    bool findFingerprint(const std::string& path, std::vector<uint32_t>& codes) const;
+    // WaveformSummary buckets, false when the file wasn't decoded (yet) or had no audio
+    bool findWaveform(const std::string& path, std::vector<WaveformSummary::Bucket>& buckets) const;
+
+    // "A minor", "?" when unknown
+    static std::string keyName(int key);
+    // Takes "Am", "A minor", "F#", "Eb major" and the like
+    static bool parseKey(const std::string& name, int& key);
+
+private:
+    static const unsigned int MAX_WORKERS = 4;
+    static const size_t JOBS_PER_WORKER = 2;
+    static const uint32_t NO_WAVEFORM = 0xFFFFFFFFu;
+
+    struct Entry {
+        uint64_t fileSize;
+        int64_t modified;
+        TrackFeatures features;
+        std::vector<uint32_t> fingerprint;
+        uint32_t waveformRecord;                        // NO_WAVEFORM when not written yet
+        std::vector<WaveformSummary::Bucket> waveform;  // Until save() writes it
+
+        Entry() : fileSize(0), modified(0), waveformRecord(NO_WAVEFORM) {}
+    };
+
+    struct Job {
+        std::string path;
+        uint64_t fileSize;
+        int64_t modified;
+        double beatmapBpm;  // 0 when the tempo has to be detected
+    };
+
+    mutable std::mutex mutex;
+    std::unordered_map<std::string, Entry> entries;
+    bool dirty;
+    MappedFile waveformFile;
+    size_t waveformRecords;             // In the mapped file
+    uint64_t waveformFileId;            // New with every rewrite, features.bin names the one it goes with
+
+    std::deque<std::string> pending;    // Paths for the feeder
+    std::deque<Job> jobs;               // Bounded, for the workers
+    size_t jobLimit;
+    std::condition_variable pendingChanged;
+    std::condition_variable jobsChanged;
+    std::thread feeder;
+    std::vector<std::thread> workers;
+    std::atomic<bool> stopping;
+    std::atomic<size_t> analyzedCount;
+    std::atomic<size_t> queuedCount;
+
+    void feederLoop();
+    void workerLoop();
+    static bool fileStamp(const std::string& path, uint64_t& fileSize, int64_t& modified);
+    static uint64_t recordCheck(const std::string& path, const Entry& entry);
+    bool mapWaveforms(const std::string& waveformFilename);
+    bool writeWaveforms(const std::string& waveformFilename);
+    const uint8_t* waveformRecord(const std::string& path, const Entry& entry) const;
+    void measure(const Job& job, Entry& entry) const;
+};
+
+#endif
\ No newline at end of file
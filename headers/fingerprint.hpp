@@ -0,0 +1,62 @@
+#ifndef FINGERPRINT_HPP
+#define FINGERPRINT_HPP
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include "audioBackend.hpp"
+#include "realFft.hpp"
+
+// Acoustic fingerprint of the start of a stream, in the manner of Haitsma and
+// Kalker: the energy of BANDS log-spaced bands between 300 Hz and 3 kHz is
+// taken every HOP_SECONDS over frames about 0.37 s long, and every frame
+// gives a 32-bit code whose bits say whether the energy difference of two
+// neighbouring bands grew or shrank since the frame before. The codes survive
+// re-encoding, resampling and level changes with most of their bits intact,
+// so copies of a song have a low bit error rate against each other while
+// different songs sit near one half.
+// Timing is in seconds, not frames, so sample rates don't matter.
+class Fingerprinter {
+public:
+    static const unsigned int MAX_SECONDS = 30;
+    static constexpr double HOP_SECONDS = 0.0464;   // About 650 codes for MAX_SECONDS
+
+    explicit Fingerprinter(const AudioFormat& format);
+
+    // Interleaved frames, as the decoders produce them
+    void process(const float* frames, size_t frameCount);
+    // True once MAX_SECONDS went in, more input is ignored
+    bool isFull() const;
+
+    // Empty when the stream was (nearly) silent, there is nothing to tell apart
+    std::vector<uint32_t> getCodes() const;
+
+    // Share of differing bits with b[i + offset] compared to a[i], 1 when
+    // fewer than MIN_OVERLAP codes line up
+    static double bitErrorRate(const std::vector<uint32_t>& a, const std::vector<uint32_t>& b, int offset);
+
+    static const size_t MIN_OVERLAP = 128;          // About 6 seconds
+
+private:
+    static const size_t BANDS = 33;
+
+    AudioFormat format;
+    size_t frameLimit;
+    size_t framesIn;
+    size_t hop;
+    size_t frameLength;
+
+    RealFft fft;
+    std::vector<float> window;
+    std::vector<float> mono;            // Mixed down, not yet taken by a frame
+    std::vector<float> frame;
+    std::vector<float> power;
+    size_t bandBins[BANDS + 1];         // Band b covers bins bandBins[b] to bandBins[b + 1]
+    float lastEnergies[BANDS];
+    bool hasLast;
+    std::vector<uint32_t> codes;
+
+    void step();
+};
+
+#endif
\ No newline at end of file
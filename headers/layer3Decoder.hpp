@@ -0,0 +1,47 @@
+#ifndef LAYER3DECODER_HPP
+#define LAYER3DECODER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct Mp3FrameHeader;
+
+// MPEG-1, 2 and 2.5 Layer III sample reconstruction for Mp3Decoder, which
+// finds the frames and hands them over in order: side info, scalefactors and
+// Huffman data, requantization, M/S and intensity stereo, alias reduction,
+// IMDCT and the polyphase synthesis filterbank. A frame's main data can start
+// in earlier frames (the bit reservoir), so those bytes are kept between
+// calls, as are the IMDCT overlap and the filterbank history.
+class Layer3Decoder {
+public:
+    Layer3Decoder();
+
+    // Decodes a whole frame, header included, into header.samplesPerFrame
+    // interleaved frames of header.channels. A frame that is damaged or
+    // reaches back further than what was fed before it comes out silent and
+    // returns false
+    bool decodeFrame(const unsigned char* frame, size_t size, const Mp3FrameHeader& header, float* output);
+    // Only keeps the frame's main data for the frames after it, so a seek can
+    // start a few frames early without decoding them
+    void feedFrame(const unsigned char* frame, size_t size, const Mp3FrameHeader& header);
+    // Forgets the reservoir, the overlap and the filterbank history
+    void reset();
+
+private:
+    std::vector<unsigned char> reservoir;  // Main data of earlier frames, at most what a frame can reach back
+    std::vector<unsigned char> mainData;   // The part of the reservoir this frame uses, then its own main data
+    uint8_t scalefactors[2][39];           // The first granule's are reused by the second (scfsi)
+    int quantized[576];
+    float spectrum[2][576];
+    float overlap[2][576];                 // Second IMDCT halves, added to the next granule
+    float synthesis[2][16][64];            // Filterbank history (V), newest at synthesisSlot
+    unsigned int synthesisSlot[2];
+
+    void keepMainData(const unsigned char* data, size_t size);
+    // IMDCT and polyphase synthesis of one granule's spectrum into every channels-th sample of output
+    void synthesize(unsigned int channel, unsigned int blockType, bool mixed, size_t nonzero,
+                    float* output, unsigned int channels);
+};
+
+#endif
\ No newline at end of file
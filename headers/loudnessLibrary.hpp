@@ -0,0 +1,92 @@
+#ifndef LOUDNESSLIBRARY_HPP
+#define LOUDNESSLIBRARY_HPP
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <unordered_map>
+#include <cstdint>
+
+enum class GainMode {
+    OFF,
+    TRACK,
+    ALBUM
+};
+
+struct LoudnessInfo {
+    float integratedLufs;
+    float truePeak;         // Linear, 1.0 is full scale
+    uint32_t gatedBlocks;   // How much of the track counts towards its album
+    bool measured;          // False when no built-in decoder reads the file or nothing in it passes the gate
+
+    LoudnessInfo() : integratedLufs(0.0f), truePeak(0.0f), gatedBlocks(0), measured(false) {}
+};
+
+// ReplayGain-style normalization data for the library, kept in loudness.bin.
+// Files are decoded with the built-in decoders on low-priority worker threads
+// and measured with LoudnessMeter; entries are keyed by path and checked
+// against the file size and modification time like the seek indexes.
+// An album is a beatmap set, i.e. the folder a file is in. Its loudness is the
+// energy mean of its tracks weighted by their gated blocks, its peak the
+// highest track peak.
+class LoudnessLibrary {
+public:
+    static constexpr double REFERENCE_LUFS = -18.0;   // ReplayGain 2.0 reference level
+    static constexpr double MAX_GAIN_DB = 12.0;
+
+    LoudnessLibrary();
+    ~LoudnessLibrary();
+
+    bool load(const std::string& filename);
+    bool save(const std::string& filename);
+
+    // Queue the files that have no current measurement. Workers start on the first call
+    void analyze(const std::vector<std::string>& paths);
+    void stop();
+
+    // Progress of everything queued since startup
+    size_t getAnalyzedCount() const;
+    size_t getQueuedCount() const;
+    bool isBusy() const;
+
+    bool find(const std::string& path, LoudnessInfo& info) const;
+    // True once the file was looked at, whether or not it could be measured
+    bool isAnalyzed(const std::string& path) const;
+    // Linear gain bringing the file to the reference level without pushing its
+    // true peak over full scale, 1.0 when off or not measured yet
+    float gainFor(const std::string& path, GainMode mode) const;
+
+    static std::string modeName(GainMode mode);
+    static bool parseMode(const std::string& name, GainMode& mode);
+
+private:
+    static const unsigned int MAX_WORKERS = 4;
+
+    struct Entry {
+        uint64_t fileSize;
+        int64_t modified;
+        LoudnessInfo info;
+    };
+
+    mutable std::mutex mutex;
+    std::unordered_map<std::string, Entry> entries;
+    bool dirty;
+
+    std::deque<std::string> pending;
+    std::condition_variable pendingChanged;
+    std::vector<std::thread> workers;
+    std::atomic<bool> stopping;
+    std::atomic<size_t> analyzedCount;
+    std::atomic<size_t> queuedCount;
+
+    void workerLoop();
+    static bool fileStamp(const std::string& path, uint64_t& fileSize, int64_t& modified);
+    LoudnessInfo measure(const std::string& path) const;
+    static std::string albumOf(const std::string& path);
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,66 @@
+#ifndef LOUDNESSMETER_HPP
+#define LOUDNESSMETER_HPP
+
+#include <vector>
+#include <cstddef>
+#include "audioBackend.hpp"
+
+// Integrated loudness and true peak of one stream, after ITU-R BS.1770-4 /
+// EBU R128. Samples go through the two-stage K-weighting filter, their mean
+// square is taken over 400 ms blocks overlapping by 75%, and the blocks are
+// gated twice (absolute at -70 LUFS, relative 10 LU below the mean of what
+// passed). True peak is the highest sample of a 4x oversampled copy.
+//
+// SSE2 is used where the target has it: the oversampling FIR computes all
+// four phases in one register, and for stereo the K-weighting runs both
+// channels through the filter side by side. Other layouts take the scalar path.
+class LoudnessMeter {
+public:
+    explicit LoudnessMeter(const AudioFormat& format);
+
+    // Interleaved frames, as the decoders produce them
+    void process(const float* frames, size_t frameCount);
+
+    // -70 (the absolute gate) when nothing passed the gates
+    double getIntegratedLufs() const;
+    // Linear, 1.0 is full scale
+    double getTruePeak() const;
+    // Blocks that passed both gates, how much of the track carries the loudness
+    size_t getGatedBlocks() const;
+
+private:
+    static const size_t OVERSAMPLE = 4;
+    static const size_t TAPS_PER_PHASE = 12;
+
+    struct Biquad {
+        double b0, b1, b2, a1, a2;
+    };
+
+    struct ChannelState {
+        double z1[2];                   // Direct form II transposed state of both stages
+        double z2[2];
+        std::vector<float> history;     // Last TAPS_PER_PHASE - 1 samples for the oversampler
+    };
+
+    AudioFormat format;
+    Biquad stages[2];
+    std::vector<ChannelState> channels;
+    std::vector<float> phases;          // TAPS_PER_PHASE x OVERSAMPLE polyphase coefficients
+    std::vector<float> planar;          // One channel of the current chunk, plus history
+    std::vector<double> weighted;       // K-weighted square of each frame, summed over channels
+
+    size_t subBlockFrames;              // 100 ms
+    size_t subBlockFill;
+    double subBlockSum;
+    std::vector<double> subBlocks;      // Mean square of every 100 ms step
+    double peak;
+
+    void finishSubBlock();
+    // Mean energy and count of the blocks that pass both gates
+    void applyGates(double& energy, size_t& count) const;
+    void kWeightChannel(size_t channel, const float* frames, size_t frameCount);
+    void kWeightStereo(const float* frames, size_t frameCount);
+    float oversampledPeak(const float* samples, size_t count) const;
+};
+
+#endif
\ No newline at end of file
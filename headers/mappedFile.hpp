@@ -0,0 +1,39 @@
+#ifndef MAPPEDFILE_HPP
+#define MAPPEDFILE_HPP
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+// A whole file mapped read-only into memory. Reading a record is a copy out
+// of the page cache, without a seek or a read call, and only the pages that
+// get touched are ever loaded. Close it before the file is rewritten or
+// renamed over, Windows refuses both while a view is open.
+class MappedFile {
+public:
+    MappedFile();
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // False for a missing or empty file
+    bool open(const std::string& path);
+    void close();
+
+    bool isOpen() const;
+    const uint8_t* data() const;
+    size_t size() const;
+
+private:
+#ifdef _WIN32
+    void* file;
+    void* mapping;
+#else
+    int descriptor;
+#endif
+    const uint8_t* view;
+    size_t length;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,115 @@
+#ifndef MP3DECODER_HPP
+#define MP3DECODER_HPP
+
+#include <fstream>
+#include <memory>
+#include <vector>
+#include "audioBackend.hpp"
+#include "mp3SeekIndex.hpp"
+
+class Layer3Decoder;
+
+struct Mp3FrameHeader {
+    int version;                 // 1 = MPEG-1, 2 = MPEG-2, 25 = MPEG-2.5
+    int layer;                   // 1, 2 or 3
+    unsigned int bitrate;        // Bits per second
+    unsigned int sampleRate;
+    unsigned int channels;
+    unsigned int channelMode;    // 0 stereo, 1 joint stereo, 2 dual channel, 3 mono
+    unsigned int modeExtension;  // Joint stereo: 1 intensity, 2 M/S
+    bool hasCrc;
+    unsigned int samplesPerFrame;
+    unsigned int frameBytes;     // Including the 4 header bytes
+
+    Mp3FrameHeader() : version(0), layer(0), bitrate(0), sampleRate(0), channels(0), channelMode(0), modeExtension(0),
+                       hasCrc(false), samplesPerFrame(0), frameBytes(0) {}
+
+    // False for anything that isn't a valid fixed-bitrate frame header
+    bool parse(const unsigned char* bytes);
+};
+
+// MPEG audio Layer III decoder.
+// Frames are located and timed exactly (ID3v2 skipping, Xing/Info/VBRI
+// headers, LAME encoder delay and padding) and decoded by Layer3Decoder.
+// With a LAME tag the encoder delay and the decoder's own 529 samples are
+// dropped from the start and the padding from the end, so songs join
+// gaplessly. Seeks are frame-exact once the file has a seek index (from
+// the cache, or built by prepareSeeking); until then, and always for
+// seekNear, they estimate from the Xing table or the average bitrate. A
+// seek starts decoding a few frames early to refill the bit reservoir and
+// the filterbank, and drops what those frames produce.
+class Mp3Decoder : public AudioBackend {
+public:
+    Mp3Decoder();
+    ~Mp3Decoder() override;
+
+    bool open(const std::string& path) override;
+    size_t decode(float* buffer, size_t frameCount) override;
+    bool seek(uint64_t frame) override;
+    bool seekNear(uint64_t frame) override;
+    void close() override;
+    void prepareSeeking() override;
+
+    AudioFormat getFormat() const override;
+    uint64_t getLengthFrames() const override;
+    uint64_t getPositionFrames() const override;
+
+    static bool probe(const unsigned char* header, size_t size);
+    static uint64_t skipId3v2(const unsigned char* header, size_t size);
+
+    uint64_t getFirstFrameOffset() const;
+    uint64_t getAudioEndOffset() const;
+    unsigned int getSamplesPerFrame() const;
+    unsigned int getEncoderDelay() const;
+    bool hasToc() const;
+    bool hasSeekIndex() const;
+
+    // Position the reader on the frame starting at byteOffset, whose first sample is frame.
+    // Decoding restarts there with an empty bit reservoir
+    bool seekToFrameStart(uint64_t byteOffset, uint64_t frame);
+
+private:
+    std::ifstream file;
+    AudioFormat format;
+    uint64_t fileSize;
+    uint64_t firstFrameOffset;   // First audio frame, after ID3v2 and the Xing/Info frame
+    uint64_t audioEndOffset;     // Before a trailing ID3v1 tag
+    uint64_t nextFrameOffset;
+    uint64_t lengthFrames;
+    uint64_t positionFrames;
+    unsigned int samplesPerFrame;
+    unsigned int frameRemaining; // Samples of the current frame not handed out yet
+    unsigned int frameRead;      // First of them in framePcm
+    unsigned int encoderDelay;
+    unsigned int encoderPadding;
+    unsigned int startSkip;      // Decoded samples before the song starts: encoder delay plus decoder delay
+
+    std::unique_ptr<Layer3Decoder> layer3;
+    std::vector<unsigned char> frameData;
+    std::vector<float> framePcm;       // The current frame in the output channel count
+    std::vector<float> decodedPcm;     // The current frame in its own channel count
+    unsigned int preRollFrames;        // Frames a seek starts early, for the reservoir and the overlap
+    uint64_t feedFrames;               // Frames still to go only into the reservoir
+    uint64_t discardFrames;            // Decoded samples still to drop
+
+    double averageFrameBytes;    // For CBR seeking and length estimates
+
+    bool tocPresent;
+    unsigned char toc[100];      // Xing seek table, byte positions in 1/256 of tocBytes
+    uint64_t tocBase;
+    uint64_t tocBytes;
+    bool lengthEstimated;        // No VBR header frame count, until the seek index counted the frames
+
+    std::string filePath;
+    int64_t modifiedTime;
+    std::shared_ptr<const Mp3SeekIndex> seekIndex;
+
+    bool readHeaderAt(uint64_t offset, Mp3FrameHeader& header);
+    bool resync(uint64_t fromOffset, uint64_t& frameOffset, Mp3FrameHeader& header);
+    void parseVbrHeader(const unsigned char* frame, size_t size, const Mp3FrameHeader& header, uint64_t& totalFrames);
+    bool findFrame(uint64_t mpegFrame, uint64_t& frameOffset, Mp3FrameHeader& header);
+    bool decodeNextFrame();
+    void setLengthFromFrames(uint64_t totalFrames);
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,58 @@
+#ifndef MP3SEEKINDEX_HPP
+#define MP3SEEKINDEX_HPP
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <cstdint>
+
+// Byte position of every FRAMES_PER_ENTRY-th MPEG frame, relative to the
+// first audio frame. VBR files without a Xing table (or with its 1% steps)
+// can only be positioned exactly by walking the frame headers, so that walk
+// is done once and a seek then starts at the nearest entry and steps over
+// fewer than FRAMES_PER_ENTRY headers. About 4 bytes per second of audio.
+struct Mp3SeekIndex {
+    static const unsigned int FRAMES_PER_ENTRY = 32;
+
+    std::vector<uint32_t> offsets;  // offsets[i]: start of frame i * FRAMES_PER_ENTRY
+    uint64_t frameCount;            // MPEG frames seen by the walk
+
+    Mp3SeekIndex() : frameCount(0) {}
+};
+
+// Seek indexes of files played before, stored in one binary file so each
+// file is only walked once. Entries are keyed by path and checked against
+// the file size and modification time; the least recently used ones are
+// dropped beyond MAX_FILES. Shared by the decode threads and the UI.
+class SeekIndexCache {
+public:
+    static SeekIndexCache& getInstance();
+
+    bool load(const std::string& filename);
+    bool save(const std::string& filename);
+
+    std::shared_ptr<const Mp3SeekIndex> find(const std::string& path, uint64_t fileSize, int64_t modified);
+    void store(const std::string& path, uint64_t fileSize, int64_t modified, std::shared_ptr<const Mp3SeekIndex> index);
+
+private:
+    static const size_t MAX_FILES = 2000;
+
+    struct Entry {
+        uint64_t fileSize;
+        int64_t modified;
+        uint64_t lastUsed;
+        std::shared_ptr<const Mp3SeekIndex> index;
+    };
+
+    std::mutex mutex;
+    std::unordered_map<std::string, Entry> entries;
+    uint64_t useCounter;
+    bool dirty;
+
+    SeekIndexCache();
+    void evict();
+};
+
+#endif
\ No newline at end of file
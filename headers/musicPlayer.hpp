@@ -4,10 +4,25 @@
 
 #include <vector>
 #include <string>
+#include <unordered_map>
+#include <map>
+#include <chrono>
+#include <memory>
+#include <future>
 #include "song.hpp"
 #include "audioPlayer.hpp"
 #include "playlist.hpp"
 #include "discordPresence.hpp"
+#include "shuffleEngine.hpp"
+#include "smartShuffle.hpp"
+#include "playQueue.hpp"
+#include "sessionSnapshot.hpp"
+#include "playStats.hpp"
+#include "loudnessLibrary.hpp"
+#include "featureLibrary.hpp"
+#include "duplicateIndex.hpp"
+#include "similarityIndex.hpp"
+#include "visualizer.hpp"
 
 // Platform-specific includes for input detection
 #ifdef _WIN32
@@ -17,12 +32,6 @@
 #include <unistd.h>
 #endif
 
-enum class QueueMode {
-    ALL_SONGS,      // Playing all songs
-    PLAYLIST,       // Playing from a specific playlist
-    RANDOM          // Random mode
-};
-
 class MusicPlayer {
 public:
     MusicPlayer();
@@ -33,18 +42,49 @@ public:
     
 private:
     AudioPlayer audioPlayer;
+    Visualizer visualizer;           // 'viz', draws from audioPlayer's analysis tap
     RichPresence richPresence;
+    PlayStats playStats;
+    LoudnessLibrary loudness;
+    FeatureLibrary features;         // Tempo and key, for 'bpm' and search
     std::vector<Song> allSongs;
     std::vector<Song> currentQueue;
-    std::vector<int> randomIndices;  // For random mode
+    ShuffleEngine shuffleOrder;      // For random mode
+    SmartShuffle smartOrder;         // For random mode with smart shuffle
     int currentSongIndex;
-    int randomPosition;              // Current position in random indices
+    int randomPosition;              // Current position in shuffle order
+    PlayQueue playQueue;             // Up-next and history on top of the base queue
+    Song nowPlaying;
+    QueueEntry nowPlayingEntry;
+    bool hasNowPlaying;
+    std::unordered_map<std::string, int> libraryIdByPath;
+    std::unordered_map<uint64_t, int> libraryIdByKey;  // PlayStats song key -> library ID
     
     QueueMode queueMode;
     std::string currentPlaylistName;
     float savedVolume;               // Persistent volume
     bool showProgressTimer;          // Show progress timer
     bool loopCurrentSong;            // Loop current song
+    bool smartShuffle;               // Spread artists apart in random mode
+    bool hideDuplicates;             // List and search show one song of each 'dupes' group
+    std::vector<std::vector<int>> duplicateGroups;  // Library IDs of songs that sound the same
+    std::unordered_map<int, size_t> duplicateGroupOf;  // Library ID -> its group in duplicateGroups
+    size_t duplicatesCheckedAt;      // Analysis progress the groups were found at
+    size_t unfingerprinted;          // Songs analyzed without a fingerprint, left out of the groups
+    std::shared_ptr<const std::vector<std::string>> libraryPaths;  // Path of every library ID - 1, as of the last scan
+    std::shared_ptr<const SimilarityIndex> similarity;  // For radio mode, replaced whole when a build finishes
+    size_t similarityBuiltAt;        // Analysis progress the index was built at
+    std::future<std::shared_ptr<const SimilarityIndex>> similarityBuild;  // Running on its own thread
+    std::shared_ptr<const std::vector<std::string>> similarityBuildPaths;  // Library the build was started for
+    size_t similarityBuildAt;        // Analysis progress the build was started at
+    int radioNext;                   // Base queue index radio mode plays next, -1 undecided
+    std::vector<int> listedSongs;    // Library IDs the last 'list' or 'search' showed, in order
+    std::vector<int> previewList;    // What 'preview' steps through, taken from listedSongs
+    int previewIndex;                // Position in previewList of the clip playing, -1 when not previewing
+    GainMode gainMode;               // Loudness normalization
+    std::map<std::string, std::vector<EqBand>> eqPresets;  // Saved with 'eq save', kept in eq_presets.txt
+    std::string eqPresetName;        // Preset the current bands came from, empty once edited
+    std::chrono::steady_clock::time_point lastSessionSave;
     
     void displayMenu();
     void processCommand(const std::string& command);
@@ -54,8 +94,16 @@ private:
     void displayAllSongs();
     void searchSongs(const std::string& query);
     
+    // Play statistics
+    void showStats(const std::vector<std::string>& args);
+    const Song* findSongByKey(uint64_t key) const;
+    
     // Playback controls
-    void playCurrentSong();
+    void playCurrentSong(bool addToHistory = true);
+    void playSong(const Song& song, const QueueEntry& entry, bool addToHistory = true);
+    void setNowPlaying(const Song& song, const QueueEntry& entry, bool addToHistory);
+    void songStarted();
+    bool advanceQueue(Song& song, QueueEntry& entry);
     void playNext();
     void playPrevious();
     void pauseResume();
@@ -63,20 +111,52 @@ private:
     void setVolume(float volume);
     void showCurrentSong();
     void toggleLoop();
+    void outputCommand(const std::vector<std::string>& args);
+    void crossfadeCommand(const std::vector<std::string>& args);
+    void cacheCommand(const std::vector<std::string>& args);
+    void gainCommand(const std::vector<std::string>& args);
+    void bpmCommand(const std::vector<std::string>& args);
+    void dupesCommand(const std::vector<std::string>& args);
+    void refreshDuplicates();
+    bool isDuplicateCopy(int songId) const;
+    void radioCommand(const std::vector<std::string>& args);
+    void exportCommand(const std::vector<std::string>& args);
+    void previewCommand(const std::vector<std::string>& args);
+    void previewStep(int direction);
+    void endPreview();
+    void refreshSimilarity();
+    void takeSimilarityBuild();
+    static std::shared_ptr<const SimilarityIndex> buildSimilarity(const std::vector<std::string>& paths,
+                                                                  const FeatureLibrary& features,
+                                                                  const LoudnessLibrary& loudness);
+    void pickRadioNext();
+    void rateCommand(const std::string& cmd, const std::vector<std::string>& args);
+    void eqCommand(const std::vector<std::string>& args);
+    void loadEqPresets();
+    void saveEqPresets();
+    float songGain(const Song& song) const;
+    void seekCommand(const std::string& target);
     void checkCurrentSongInPlaylist(const std::string& playlistName);
     
     // Display functions
     void displayPlayingMessage();
     void displayCurrentProgress();
+    void displayWaveform(bool withPlayhead);
+    void updateVisualizerTitle();
     int getSongDisplayIndex(const Song& song);
     
     // Queue management
     void playFromQueue(int index);
     void setQueueFromAllSongs();
     void setQueueFromPlaylist(const std::string& playlistName);
-    void setRandomMode();
+    void setRandomMode(const std::string& seedArg = "");
     void clearQueue();
     void displayQueue();
+    void displayHistory();
+    void enqueueCommand(int songId, bool playNextFirst);
+    const Song* findSongById(int songId) const;
+    void resolveSongIds(std::vector<Song>& songs) const;
+    bool isCurrentBaseEntry(const QueueEntry& entry) const;
     void updateDiscordPresence();
     
     // Playlist commands
@@ -89,7 +169,12 @@ private:
     void playPlaylist(const std::string& name);
     
     // Random mode
-    void generateRandomIndices();
+    void generateRandomIndices(uint64_t seed);
+    void toggleSmartShuffle();
+    int shuffleIndexAt(int position) const;
+    int shufflePositionOf(int index) const;
+    int shuffleSize() const;
+    uint64_t shuffleSeed() const;
     void playRandomSong();
     
     // Utility functions
@@ -99,9 +184,20 @@ private:
     void showHelp();
     void saveSettings();
     void loadSettings();
+    
+    // Session resume
+    void saveSession();
+    void resumeSessionPlayback(const SessionState& session);
+    void restoreSessionQueue(const SessionState& session);
     bool hasInput(); // Check for keyboard input without blocking
     
-    void update(); // Called regularly to update audio and check for song end
+    // Gapless transitions
+    bool peekNext(Song& song, QueueEntry& entry) const;
+    void updatePreroll();
+    void continueWithPreloaded();
+    
+    void update(); // Called on every pass of the loop to update audio and check for song end
+    int nextWakeDelay() const; // Milliseconds until update() has timed work to do, -1 for none
 };
 
 #endif
\ No newline at end of file
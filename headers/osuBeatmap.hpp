@@ -0,0 +1,23 @@
+#ifndef OSUBEATMAP_HPP
+#define OSUBEATMAP_HPP
+
+#include <string>
+
+// What the player takes from a .osu difficulty file: the audio it plays, the
+// preview point and the tempo from its timing points. Only [General],
+// [TimingPoints] and the times of [HitObjects] are read.
+struct OsuBeatmap {
+    std::string audioFilename;
+    int previewTimeMs;      // -1 when the map doesn't set one
+    double mainBpm;         // Tempo held the longest, 0 without timing points
+    double minBpm;
+    double maxBpm;
+
+    OsuBeatmap() : previewTimeMs(-1), mainBpm(0.0), minBpm(0.0), maxBpm(0.0) {}
+
+    bool load(const std::string& osuPath);
+    // Finds a difficulty next to 'audioPath' that plays it
+    static bool findFor(const std::string& audioPath, OsuBeatmap& beatmap);
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,76 @@
+#ifndef PLAYQUEUE_HPP
+#define PLAYQUEUE_HPP
+
+#include <deque>
+#include <vector>
+#include <iosfwd>
+#include <cstdint>
+
+enum class QueueMode {
+    ALL_SONGS,      // Playing all songs
+    PLAYLIST,       // Playing from a specific playlist
+    RANDOM,         // Random mode
+    RADIO           // Songs that sound like the one playing, from all songs
+};
+
+// One played (or playable) song. songId is the library id shown by 'list',
+// baseIndex is the song's index in the base queue, or -1 when it came from up-next
+struct QueueEntry {
+    int songId;
+    int baseIndex;
+
+    QueueEntry() : songId(0), baseIndex(-1) {}
+    QueueEntry(int id, int index) : songId(id), baseIndex(index) {}
+};
+
+// Fixed-capacity history of played songs, the oldest entry is overwritten first
+class HistoryRing {
+public:
+    HistoryRing(size_t capacity = 100);
+
+    void push(const QueueEntry& entry);
+    QueueEntry popLatest();
+    const QueueEntry& at(size_t age) const; // 0 = most recent
+
+    size_t size() const;
+    size_t capacity() const;
+    bool isEmpty() const;
+    void clear();
+
+private:
+    std::vector<QueueEntry> slots;
+    size_t head;  // Next slot to write
+    size_t count;
+};
+
+// Layered queue on top of the base queue (library, playlist or shuffle order):
+// songs queued with 'playnext'/'enqueue' are played first, and every song
+// that gets replaced is remembered in the history ring for 'prev'. Stepping
+// back puts the song being left at the front of up-next, so 'next' retraces
+class PlayQueue {
+public:
+    PlayQueue(size_t historyCapacity = 100);
+
+    void enqueue(const QueueEntry& entry);   // Back of up-next
+    void playNext(const QueueEntry& entry);  // Front of up-next
+    bool hasUpNext() const;
+    QueueEntry popUpNext();
+    const std::deque<QueueEntry>& getUpNext() const;
+
+    void pushHistory(const QueueEntry& entry);
+    bool hasHistory() const;
+    QueueEntry popHistory();
+    const HistoryRing& getHistory() const;
+
+    void clear();
+
+    // Binary persistence for session resume
+    void save(std::ostream& out) const;
+    bool load(std::istream& in);
+
+private:
+    std::deque<QueueEntry> upNext;
+    HistoryRing history;
+};
+
+#endif
\ No newline at end of file
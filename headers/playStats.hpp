@@ -0,0 +1,92 @@
+#ifndef PLAYSTATS_HPP
+#define PLAYSTATS_HPP
+
+#include <string>
+#include <vector>
+#include <set>
+#include <unordered_map>
+#include <fstream>
+#include <cstdint>
+#include "song.hpp"
+
+enum class PlayEventType : uint8_t {
+    START = 0,
+    FINISH = 1,
+    SKIP = 2
+};
+
+// Fixed-size record of the append-only event log (play_events.bin)
+struct PlayEvent {
+    uint64_t timestampMs;  // Unix time
+    uint64_t songKey;
+    uint32_t positionMs;   // Where the song was left (finish/skip)
+    uint8_t type;
+    uint8_t reserved[3];
+};
+static_assert(sizeof(PlayEvent) == 24, "PlayEvent must stay 24 bytes on disk");
+
+struct SongStats {
+    uint32_t plays;
+    uint32_t finishes;
+    uint32_t skips;
+    uint64_t lastPlayedMs;
+    uint64_t listenedMs;
+
+    SongStats() : plays(0), finishes(0), skips(0), lastPlayedMs(0), listenedMs(0) {}
+};
+
+// Play statistics built from the event log.
+// Events older than the retention window are folded into play_stats.bin on
+// startup, newer ones stay in the log so time-window queries can replay them.
+// Sorted indexes over the aggregates keep top-N and recent queries O(N).
+class PlayStats {
+public:
+    PlayStats();
+    ~PlayStats();
+
+    bool open(const std::string& logFile, const std::string& summaryFile);
+    void close();
+
+    void recordStart(const Song& song);
+    void recordFinish(const Song& song, unsigned int positionMs);
+    void recordSkip(const Song& song, unsigned int positionMs);
+
+    // Songs are identified by artist/title, which is also what the scanner deduplicates on
+    static uint64_t songKey(const Song& song);
+    static uint64_t nowMs();
+
+    const SongStats* getStats(uint64_t key) const;
+    double getSkipRate(uint64_t key) const;
+
+    // (key, count) pairs, most played first. sinceMs > 0 limits to the retained window
+    std::vector<std::pair<uint64_t, uint32_t>> topPlayed(size_t count, uint64_t sinceMs = 0) const;
+    std::vector<uint64_t> recentlyPlayed(size_t count) const;
+    std::vector<std::pair<uint64_t, double>> mostSkipped(size_t count, uint32_t minPlays = 3) const;
+
+    size_t songCount() const;
+    uint64_t totalPlays() const;
+    uint64_t totalSkips() const;
+    uint64_t retainedSinceMs() const;
+
+private:
+    std::string logPath;
+    std::string summaryPath;
+    std::ofstream logFile;
+
+    std::unordered_map<uint64_t, SongStats> aggregates;
+    std::set<std::pair<uint32_t, uint64_t>> byPlays;       // (plays, key)
+    std::set<std::pair<uint64_t, uint64_t>> byLastPlayed;  // (lastPlayedMs, key)
+    std::vector<PlayEvent> recentEvents;                   // Time ordered, retention window only
+    uint64_t foldedUntilMs;
+    uint64_t playCount;
+    uint64_t skipCount;
+
+    void record(PlayEventType type, const Song& song, unsigned int positionMs);
+    void apply(const PlayEvent& event, bool updateIndexes);
+    void rebuildIndexes();
+    bool loadSummary();
+    bool writeSummary() const;
+    bool rewriteLog(const std::vector<PlayEvent>& events) const;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,264 @@
+#ifndef PLAYBACKENGINE_HPP
+#define PLAYBACKENGINE_HPP
+
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include <string>
+#include "audioBackend.hpp"
+#include "streamBuffer.hpp"
+#include "crossfade.hpp"
+#include "rateSource.hpp"
+#include "resampleSource.hpp"
+#include "equalizer.hpp"
+#include "analysisTap.hpp"
+#include "spscQueue.hpp"
+#include "wakeSignal.hpp"
+#include "renderStatus.hpp"
+#include "audioEvents.hpp"
+
+// Built-in playback path used when FMOD isn't available.
+//
+// Threads: the UI calls the methods below, a decode thread streams the
+// source (and a preloaded next one, appended gaplessly or crossfaded) into
+// a bounded ring, and a render thread drains the ring through the volume
+// and equalizer into the sink. They share no locks: commands go out
+// through SPSC queues, the render state comes back as a seqlock snapshot,
+// and track switches, the end and output errors are raised on AudioEvents.
+//
+// Ownership: load() wraps the source for the rate and the device sample
+// rate and hands it to the decode thread, which owns it from then on;
+// preloadFile() has the decode thread open the file itself. The sink
+// belongs to the render thread while it runs, the UI only touches it with
+// the render thread halted.
+class PlaybackEngine {
+public:
+    explicit PlaybackEngine(AudioEvents* events = nullptr, AnalysisTap* tap = nullptr);
+    ~PlaybackEngine();
+
+    bool setOutput(const std::string& kind, const std::string& path = "");
+    std::string getOutputName() const;
+    // Sample rate songs are converted to on load, 0 opens the device at the
+    // rate of each loaded song. Takes effect with the next load
+    void setOutputRate(unsigned int sampleRate);
+    unsigned int getOutputRate() const;
+    // Rate the device runs at, 0 before the first load
+    unsigned int getDeviceRate() const;
+    void shutdown();
+
+    // Takes ownership of an opened source and starts buffering it, playback
+    // starts paused at frame 0. 'gain' scales the source before the volume
+    bool load(std::unique_ptr<AudioBackend> source, float gain = 1.0f);
+    void unload();
+
+    // Open 'path' in the background and continue into it when the current source ends
+    void preloadFile(const std::string& path, float gain = 1.0f);
+    void cancelPreload();
+    // True once per sample-accurate switch to the preloaded track
+    bool takeTrackChange();
+
+    // 0 ms switches gaplessly at the end of the track
+    void setCrossfade(unsigned int milliseconds, FadeCurve curve);
+    // Raise AudioEvents::MILESTONE once when the current track plays past this
+    // position. Cleared by load and by a track switch
+    void setMilestone(unsigned int positionMs);
+    void clearMilestone();
+
+    void play();
+    void pause();
+    void resume();
+    void stop();
+    bool seek(unsigned int positionMs);
+    void setVolume(float volume);
+    // Replace the gains given to load and preloadFile. Applies to what gets
+    // decoded from now on, so it is heard once the buffered audio played out
+    void setTrackGains(float current, float next);
+    // Play faster or slower, carrying on from what is heard now. Flushes the
+    // ring like a seek does
+    void setRate(double rate, RateMode mode);
+    // Equalize the output from the next render block on, gliding into the new bands
+    void setEqualizer(const std::vector<EqBand>& bands);
+
+    // Position being heard, in track time: frames the sink consumed minus its
+    // latency, which is measured with every block and assumed to drain at the
+    // device rate in between. Good to one render block.
+    unsigned int getPositionMs() const;
+    unsigned int getLengthMs() const;
+    unsigned int getLatencyMs() const;
+    // True once the source ended and the device played out what it held
+    bool hasFinished() const;
+    // Wall-clock time left until hasFinished() once the source ended, 0 otherwise
+    unsigned int getDrainMs() const;
+
+    // Decode throughput as a multiple of real time, 0 until something was decoded
+    double getDecodeSpeed() const;
+    // Time from the last play or seek to its first block reaching the sink
+    double getFirstAudioMs() const;
+    size_t getBufferBytes() const;
+    unsigned int getUnderruns() const;
+    // Wall-clock time between the last block of a track and the first block of the next
+    double getLastGapMs() const;
+    // Render thread time per channel, band and frame spent equalizing, in nanoseconds
+    double getEqualizerCost() const;
+
+private:
+    static const size_t BLOCK_FRAMES = 1024;    // Render granularity
+    static const size_t CHUNK_FRAMES = 4096;    // Decode granularity
+    static const size_t BUFFER_CHUNKS = 16;     // About 1.5 s at 44.1 kHz
+
+    enum class RenderState { IDLE, RUNNING, PAUSED };
+
+    // What the render thread has to do when its read position reaches stopFrame
+    enum StopKind { STOP_NONE, STOP_BOUNDARY, STOP_JUMP, STOP_END };
+
+    static const uint64_t NO_MILESTONE = ~uint64_t(0);
+
+    struct RenderCommand {
+        enum class Type { PLAY, PAUSE, RESUME, STOP, VOLUME, MILESTONE, FLUSH, HALT, RELEASE, QUIT };
+        Type type;
+        float volume;
+        uint64_t frame;
+        uint32_t epoch;
+
+        RenderCommand() : type(Type::QUIT), volume(0.0f), frame(0), epoch(0) {}
+    };
+
+    struct DecodeCommand {
+        enum class Type { LOAD, UNLOAD, SEEK, REWIND, PRELOAD, CANCEL_PRELOAD, CROSSFADE, GAIN, RATE, QUIT };
+        Type type;
+        RateSource* source;         // LOAD hands over ownership
+        uint64_t frame;
+        uint32_t epoch;
+        unsigned int milliseconds;
+        FadeCurve curve;
+        std::string path;
+        float gain;
+        float nextGain;
+        double rate;
+        RateMode rateMode;
+
+        DecodeCommand()
+            : type(Type::QUIT), source(nullptr), frame(0), epoch(0), milliseconds(0), curve(FadeCurve::EQUAL_POWER),
+              gain(1.0f), nextGain(1.0f), rate(1.0), rateMode(RateMode::STRETCH) {}
+    };
+
+    // Posted by the decode thread once a flush is done: the ring restarts at ringFrame
+    struct StartMark {
+        uint32_t epoch;
+        uint64_t ringFrame;
+        uint64_t trackFrame;
+        uint64_t lengthFrames;
+        float rate;
+
+        StartMark() : epoch(0), ringFrame(0), trackFrame(0), lengthFrames(0), rate(1.0f) {}
+    };
+
+    std::thread renderThread;
+    std::thread decodeThread;
+    SpscQueue<RenderCommand, 64> renderCommands;
+    SpscQueue<DecodeCommand, 64> decodeCommands;
+    SpscQueue<StartMark, 16> startMarks;
+    WakeSignal renderWake;
+    WakeSignal decodeWake;
+    RenderStatus status;
+    Equalizer equalizer;                // Bands come from the UI, the render thread filters
+    StreamBuffer buffer;
+    AudioEvents* events;
+    AnalysisTap* tap;                   // Written by the render thread
+
+    std::atomic<int> stopKind;
+    std::atomic<uint64_t> stopFrame;
+    std::atomic<uint64_t> nextLength;   // Length of the track behind a boundary
+    std::atomic<uint64_t> jumpTarget;   // Where reading continues after an undone switch
+    std::atomic<bool> playing;          // Set by the UI, lets the decode thread sleep while paused
+    std::atomic<uint64_t> framesDecoded;
+    std::atomic<uint64_t> decodeNanos;
+    std::atomic<size_t> bufferBytes;
+
+    // UI thread. The sink and format are handed to the render thread, the UI
+    // only touches them again while it holds the render thread halted
+    std::unique_ptr<AudioSink> sink;
+    AudioFormat format;
+    bool loaded;
+    uint32_t epoch;
+    uint32_t seenTrackChanges;
+    unsigned int outputRate;
+    std::vector<EqBand> eqBands;        // Designed again for the device rate on every load
+    double rate;
+    RateMode rateMode;
+
+    // Render thread
+    std::vector<float> block;           // Sized by load() while halted
+    PlaybackStatus published;
+    RenderState state;
+    float volume;
+    uint64_t milestoneFrame;
+    bool halted;
+    bool flushing;                      // Waiting for the start mark of flushEpoch
+    uint32_t flushEpoch;
+    StartMark heldMark;                 // Arrived before its flush command did
+    bool hasHeldMark;
+    bool awaitingFirstAudio;
+    bool transitionPending;
+    std::chrono::steady_clock::time_point startRequest;
+    std::chrono::steady_clock::time_point lastWriteEnd;
+    std::chrono::steady_clock::time_point transitionStart;
+
+    // Decode thread
+    std::unique_ptr<RateSource> source;
+    AudioFormat sourceFormat;
+    float sourceGain;                   // Per-track normalization, follows its source through switches
+    float nextGain;
+    float outgoingGain;
+    bool sourceEnded;                   // Decoder hit the end, the ring holds the rest
+    bool endPublished;                  // STOP_END was posted for it
+    std::string preloadPath;
+    std::unique_ptr<RateSource> nextSource;
+    std::vector<float> preroll;         // First chunk of nextSource, decoded ahead
+    size_t prerollFrames;
+    size_t prerollOffset;
+    bool prerollPending;                // Switched to nextSource, its primed chunk goes out first
+    bool seekPrepared;                  // prepareSeeking() ran for the current source
+    std::unique_ptr<RateSource> outgoingSource;    // Kept until the boundary is played and the fade is done
+    bool hasBoundary;                   // STOP_BOUNDARY posted and not yet claimed
+    uint64_t switchFrame;               // Outgoing source position at the switch, to undo it
+    unsigned int crossfadeMs;
+    FadeCurve fadeCurve;
+    double decodeRate;                  // Given to every source the decode thread opens
+    RateMode decodeRateMode;
+    bool fading;
+    uint64_t fadeLength;
+    uint64_t fadeDone;
+    std::vector<float> chunk;           // Scratch, sized on load so the fade mix never allocates
+    std::vector<float> fadeChunk;
+    std::vector<float> gainIn;
+    std::vector<float> gainOut;
+
+    void sendRender(RenderCommand::Type type, float value = 0.0f, uint64_t frame = 0);
+    bool sendDecode(DecodeCommand& command);
+    uint32_t flush();
+    void haltRender();
+    void waitForAck(uint32_t ackEpoch) const;
+    uint64_t queuedFrames(const PlaybackStatus& snapshot) const;
+    uint64_t toOutputFrames(unsigned int trackMs) const;
+
+    void renderLoop();
+    void applyRenderCommand(const RenderCommand& command);
+    bool takeStartMark();
+    void reachStop(int kind);
+    void publishStatus();
+    void raise(uint32_t event);
+
+    void decodeLoop();
+    void applyDecodeCommand(DecodeCommand& command);
+    void postStart(uint32_t markEpoch);
+    void resolveSwitch(bool keepRing);
+    void restoreOutgoing();
+    void endFade();
+    void trySwitch();
+    size_t readIncoming(float* frames, size_t frameCount);
+};
+
+#endif
\ No newline at end of file
@@ -4,7 +4,7 @@
 #include <vector>
 #include <string>
 #include <map>
-#include "Song.hpp"
+#include "song.hpp"
 
 class Playlist {
 public:
@@ -0,0 +1,117 @@
+#ifndef PLAYLISTEXPORT_HPP
+#define PLAYLISTEXPORT_HPP
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <cstdint>
+#include "audioBackend.hpp"
+#include "crossfade.hpp"
+#include "rateSource.hpp"
+#include "equalizer.hpp"
+
+// Renders songs one after the other into a single WAV file, as fast as the
+// machine goes, through the chain the built-in playback uses: decoder,
+// ResampleSource to one rate, RateSource, the song's gain, the crossfade
+// into the next song and the equalizer.
+//
+// Decode workers take the songs in order, each streaming its song into a
+// list of chunks. Songs further ahead share MEMORY_BUDGET_MB between them;
+// the song being mixed and the one after it only keep a few chunks each and
+// never wait for the budget, so the mix can't stall behind songs further
+// ahead. The calling thread mixes the chunks in order and fills large
+// buffers that a single writer thread writes in one call each. The WAV
+// header is padded so those writes start and end on WRITE_ALIGNMENT.
+//
+// Every song has to decode: one the built-in decoders can't read would go
+// missing from the file, so it fails the whole export instead.
+class PlaylistExporter {
+public:
+    struct Track {
+        std::string path;
+        float gain;
+    };
+
+    struct Settings {
+        unsigned int sampleRate;        // 0 takes the highest rate among the songs
+        unsigned int crossfadeMs;
+        FadeCurve curve;
+        double rate;
+        RateMode rateMode;
+        std::vector<EqBand> eqBands;
+
+        Settings() : sampleRate(0), crossfadeMs(0), curve(FadeCurve::EQUAL_POWER), rate(1.0), rateMode(RateMode::STRETCH) {}
+    };
+
+    struct Report {
+        size_t tracks;                  // Rendered
+        std::vector<size_t> undecodable; // Indexes of the songs no decoder opened
+        unsigned int workers;
+        AudioFormat format;
+        uint64_t frames;
+        uint64_t bytes;
+        double seconds;                 // Wall-clock time of the whole export
+
+        Report() : tracks(0), workers(0), frames(0), bytes(0), seconds(0.0) {}
+    };
+
+    PlaylistExporter(const std::vector<Track>& tracks, const Settings& settings);
+    ~PlaylistExporter();
+
+    // Blocks until the file is written. 'onTrack' is called from this thread
+    // as each song starts going into the mix, with its index. False when a
+    // song can't be decoded (see Report::undecodable, nothing is left at
+    // 'path' then) or writing failed
+    bool run(const std::string& path, Report& report, const std::function<void(size_t)>& onTrack = nullptr);
+
+private:
+    static const size_t CHUNK_FRAMES = 16384;
+    static const size_t NEAR_CHUNKS = 8;            // Queued for the song being mixed and the next
+    static const size_t MEMORY_BUDGET_MB = 256;     // For the songs further ahead
+    static const unsigned int MAX_WORKERS = 8;
+    static const size_t WRITE_BYTES = 4 << 20;
+    static const size_t WRITE_ALIGNMENT = 4096;
+    static const size_t WRITE_BUFFERS = 3;
+
+    struct Job {
+        std::deque<std::vector<float>> chunks;      // Interleaved at the output format, gain applied
+        bool done;
+        bool failed;
+
+        Job() : done(false), failed(false) {}
+    };
+
+    std::vector<Track> tracks;
+    Settings settings;
+    AudioFormat format;
+
+    std::mutex mutex;
+    std::condition_variable chunksChanged;
+    std::vector<Job> jobs;
+    size_t nextJob;
+    size_t mixing;                                  // Index of the song being mixed
+    size_t bufferedBytes;                           // Chunks of songs after mixing + 1
+    bool stopping;
+    std::vector<std::thread> workers;
+
+    // Writer: full buffers go one way, emptied ones come back
+    std::mutex writeMutex;
+    std::condition_variable writeChanged;
+    std::deque<std::vector<float>> fullBuffers;
+    std::deque<std::vector<float>> freeBuffers;
+    bool writeFailed;
+    bool writerDone;
+
+    void workerLoop();
+    void decodeTrack(size_t index);
+    // Next chunk of a song, false once it has no more
+    bool takeChunk(size_t index, std::vector<float>& chunk);
+    void writerLoop(const std::string& path, uint64_t& bytes);
+};
+
+#endif
\ No newline at end of file
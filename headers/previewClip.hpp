@@ -0,0 +1,67 @@
+#ifndef PREVIEWCLIP_HPP
+#define PREVIEWCLIP_HPP
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include "audioBackend.hpp"
+
+// A few seconds of a song from its preview point, the part osu! plays in
+// song select, as a source of its own: frame 0 is the preview point and the
+// clip ends lengthMs later, faded in and out. The point is the PreviewTime of
+// a .osu next to the file, or FALLBACK_POSITION into the song without one.
+//
+// Opening never decodes what comes before the point: the file is placed
+// there with seekNear, so a decoder that would have to read the whole file
+// for an exact seek lands near it from what it knows. A clip opened ahead of
+// time can afford that read and asks for an exact start instead, which also
+// leaves the MP3 seek index in its cache. The first PRIME_FRAMES are
+// decoded by open, so such a clip starts without touching the file. Only
+// files AudioBackend::openFile has a decoder for open; the FMOD build
+// previews the rest itself.
+class PreviewClip : public AudioBackend {
+public:
+    static const unsigned int DEFAULT_LENGTH_MS = 15000;
+    static constexpr double FALLBACK_POSITION = 0.4;
+
+    explicit PreviewClip(unsigned int lengthMs = DEFAULT_LENGTH_MS, bool exactStart = false);
+
+    // Where the clip of a song of songLengthMs starts. A point too close to the
+    // end moves back so the clip still gets its length where the song allows
+    static unsigned int findStartMs(const std::string& path, unsigned int songLengthMs, unsigned int lengthMs,
+                                    bool& fromBeatmap);
+
+    bool open(const std::string& path) override;
+    size_t decode(float* buffer, size_t frameCount) override;
+    bool seek(uint64_t frame) override;
+    void close() override;
+
+    AudioFormat getFormat() const override;
+    uint64_t getLengthFrames() const override;
+    uint64_t getPositionFrames() const override;
+
+    unsigned int getStartMs() const;
+    bool isFromBeatmap() const;
+
+private:
+    static const size_t PRIME_FRAMES = 8192;
+    static const unsigned int FADE_IN_MS = 250;
+    static const unsigned int FADE_OUT_MS = 1000;
+
+    std::unique_ptr<AudioBackend> source;
+    AudioFormat format;
+    unsigned int lengthMs;
+    bool exactStart;                // seek rather than seekNear to the point
+    unsigned int startMs;
+    bool fromBeatmap;
+    uint64_t startFrame;            // In the song
+    uint64_t lengthFrames;
+    uint64_t positionFrames;
+    uint64_t fadeInFrames;
+    uint64_t fadeOutFrames;
+    std::vector<float> primed;      // The first frames of the clip, decoded by open
+    size_t primedFrames;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,96 @@
+#ifndef RATESOURCE_HPP
+#define RATESOURCE_HPP
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include "audioBackend.hpp"
+
+enum class RateMode {
+    STRETCH,    // Tempo changes, pitch stays (osu! DT / HT)
+    VARISPEED   // Tempo and pitch change together, like a faster tape (NC)
+};
+
+// Plays another source faster or slower. Its timeline is the one being heard:
+// frame n at rate 1.5 is frame 1.5n of the wrapped source, and the length
+// shrinks to match. At rate 1 frames pass straight through.
+//
+// VARISPEED reads the wrapped source 'rate' frames per output frame through a
+// 4-point Hermite interpolator. STRETCH is WSOLA: each step cross-fades from
+// the natural continuation of the last segment into a new one taken where the
+// rate says the input should be, shifted by up to SEARCH_MS to where its
+// waveform lines up best with that continuation. The search correlates a mono
+// mix, coarse then fine. The interpolator, the search and the cross-fade use
+// SSE2 where the target has it, with scalar paths for the rest.
+class RateSource : public AudioBackend {
+public:
+    static constexpr double MIN_RATE = 0.5;
+    static constexpr double MAX_RATE = 2.0;
+
+    RateSource(std::unique_ptr<AudioBackend> source, double rate, RateMode mode);
+
+    // Takes effect with the next seek, which places the position on the new timeline
+    void setRate(double rate, RateMode mode);
+    double getRate() const;
+    RateMode getMode() const;
+
+    bool open(const std::string& path) override;
+    size_t decode(float* buffer, size_t frameCount) override;
+    bool seek(uint64_t frame) override;
+    void close() override;
+    void prepareSeeking() override;
+
+    AudioFormat getFormat() const override;
+    uint64_t getLengthFrames() const override;
+    uint64_t getPositionFrames() const override;
+
+    static std::string modeName(RateMode mode);
+
+private:
+    static const unsigned int SEGMENT_MS = 25;  // Output per WSOLA step, also the cross-fade length
+    static const unsigned int SEARCH_MS = 12;   // How far a segment may move to line up
+    static const size_t READ_FRAMES = 4096;
+
+    std::unique_ptr<AudioBackend> source;
+    AudioFormat format;
+    double rate;
+    RateMode mode;
+    uint64_t positionFrames;
+
+    // Wrapped frames read ahead; input[0] is source frame inputStart. Past the
+    // end of the source the buffer is padded with silence
+    std::vector<float> input;
+    std::vector<float> mono;            // Channel average of input, for the search
+    size_t inputFrames;
+    int64_t inputStart;
+    bool sourceEnded;
+    int64_t endFrame;                   // Source frame the wrapped stream ended at
+
+    // VARISPEED: read position in input frames
+    double readPosition;
+    std::vector<float> weights;         // Hermite coefficients of a run of output frames
+
+    // STRETCH, all positions are source frames
+    size_t segmentFrames;
+    size_t searchFrames;
+    double nominalPosition;             // Where the next segment belongs at this rate
+    int64_t previousSegment;            // Start of the last segment used
+    std::vector<float> fadeIn;          // Per sample rising weight of the cross-fade
+    std::vector<double> energy;         // Prefix sums of the squared mono mix over the search range
+    std::vector<float> pending;         // Output of the last step not handed out yet
+    size_t pendingOffset;
+    size_t pendingFrames;
+
+    void reset(int64_t sourceFrame);
+    // Make input reach source frame 'end', padding with silence after the end
+    void fill(int64_t end);
+    void discardBefore(int64_t frame);
+
+    size_t decodeVarispeed(float* buffer, size_t frameCount);
+    size_t decodeStretch(float* buffer, size_t frameCount);
+    bool stretchStep();
+    int64_t bestSegment(int64_t target, int64_t from, int64_t to);
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,50 @@
+#ifndef REALFFT_HPP
+#define REALFFT_HPP
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// Fast Fourier transform of a block of real samples, for spectrum displays.
+//
+// The N real samples are packed as N/2 complex ones (even samples real, odd
+// ones imaginary) and transformed with an iterative decimation-in-time FFT:
+// the bit-reversed copy is made while packing, then radix-4 passes (each one
+// two radix-2 stages done in a single sweep over memory) run over split real
+// and imaginary arrays, with one radix-2 pass first when log2(N/2) is odd.
+// Passes with four or more butterflies per group do four of them at a time
+// with SSE2 when the target has it. A final split step turns the half-size
+// result into the spectrum of the real input. Every twiddle and the bit
+// reversal are computed once, in the constructor, so a transform never
+// allocates or calls a trig function.
+class RealFft {
+public:
+    // 'size' is rounded up to a power of two, 16 at least
+    explicit RealFft(size_t size);
+
+    size_t size() const;
+    // |X[k]|^2 of the size() samples in 'input', for k = 0 .. size()/2
+    void powerSpectrum(const float* input, float* power);
+
+private:
+    size_t n;
+    size_t half;                    // Complex points actually transformed
+    bool radix2First;
+
+    struct Pass {
+        size_t span;                // Distance between the four inputs of a butterfly
+        size_t twiddles;            // Offset of its w, w^2 and w^3 tables (span each)
+    };
+    std::vector<Pass> passes;
+    std::vector<uint32_t> bitReverse;
+    std::vector<float> twiddleRe;
+    std::vector<float> twiddleIm;
+    std::vector<float> splitRe;     // e^(-2*pi*i*k/n), k < half
+    std::vector<float> splitIm;
+    std::vector<float> re;          // Work arrays
+    std::vector<float> im;
+
+    void radix4(const Pass& pass);
+};
+
+#endif
\ No newline at end of file
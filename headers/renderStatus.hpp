@@ -0,0 +1,46 @@
+#ifndef RENDERSTATUS_HPP
+#define RENDERSTATUS_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+// Everything the UI thread gets to see of the render thread
+struct PlaybackStatus {
+    uint64_t positionFrames;    // Into the current track, handed to the sink so far
+    uint64_t segmentFrames;     // Track position the current run of audio started at (load, seek, switch)
+    uint64_t lengthFrames;
+    uint64_t writeMicros;       // steady_clock time latencyFrames was measured at
+    uint64_t firstAudioMicros;  // From the last play or seek to its first block
+    uint64_t lastGapMicros;     // Between the last block of a track and the first of the next
+    uint32_t state;             // PlaybackEngine::RenderState
+    uint32_t underruns;
+    uint32_t trackChanges;      // Bumped on every switch to a preloaded track
+    uint32_t ackEpoch;          // Last halt or flush the render thread has taken
+    uint32_t latencyFrames;
+    uint32_t finished;
+    uint32_t atStart;           // Nothing heard since the last load, seek or rewind
+    float rate;                 // Track frames per frame heard, for the current run of audio
+
+    PlaybackStatus()
+        : positionFrames(0), segmentFrames(0), lengthFrames(0), writeMicros(0), firstAudioMicros(0), lastGapMicros(0), state(0), underruns(0),
+          trackChanges(0), ackEpoch(0), latencyFrames(0), finished(0), atStart(1), rate(1.0f) {}
+};
+
+// Single-writer snapshot of PlaybackStatus (a seqlock). The render thread
+// publishes without ever waiting; a reader that overlaps a publish retries.
+class RenderStatus {
+public:
+    RenderStatus();
+
+    void publish(const PlaybackStatus& status);
+    PlaybackStatus read() const;
+
+private:
+    static const size_t WORDS = (sizeof(PlaybackStatus) + 7) / 8;
+
+    std::atomic<uint32_t> sequence;     // Odd while a publish is in progress
+    std::atomic<uint64_t> words[WORDS];
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,82 @@
+#ifndef RESAMPLESOURCE_HPP
+#define RESAMPLESOURCE_HPP
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include "audioBackend.hpp"
+
+// Converts another source to a different sample rate, so songs at 22.05, 44.1
+// and 48 kHz can share one open device. Its timeline is at the output rate.
+//
+// Polyphase windowed-sinc: for a ratio reduced to L/M, output frame k sits at
+// input time k*M/L, and phase (k*M mod L) of the filter bank holds the TAPS
+// Kaiser-windowed sinc weights for that fractional offset. The cut-off sits
+// below the lower of the two Nyquist frequencies by half the transition band,
+// so the stopband (about -80 dB) starts where aliasing would. Banks are built
+// once per rate pair and shared by every source using it. Input is kept one
+// plane per channel, and the per-tap sums use AVX, SSE2 or NEON when the
+// target has them, with a scalar path for the rest.
+class ResampleSource : public AudioBackend {
+public:
+    ResampleSource(std::unique_ptr<AudioBackend> source, unsigned int outputRate);
+
+    // Returns 'source' itself when it already runs at 'outputRate'
+    static std::unique_ptr<AudioBackend> wrap(std::unique_ptr<AudioBackend> source, unsigned int outputRate);
+
+    bool open(const std::string& path) override;
+    size_t decode(float* buffer, size_t frameCount) override;
+    bool seek(uint64_t frame) override;
+    void close() override;
+    void prepareSeeking() override;
+
+    AudioFormat getFormat() const override;
+    uint64_t getLengthFrames() const override;
+    uint64_t getPositionFrames() const override;
+
+    unsigned int getInputRate() const;
+
+private:
+    static const size_t TAPS = 64;              // Per phase at the lower of the two rates
+    static const unsigned int MAX_PHASES = 1024; // Odd ratios past this use the nearest phase
+    static const size_t READ_FRAMES = 4096;
+
+    struct Bank {
+        unsigned int phases;
+        size_t taps;                            // Multiple of 8, so the sums never need a tail
+        std::vector<float> weights;             // phases * taps, phase by phase
+    };
+    static std::shared_ptr<const Bank> bankFor(unsigned int inputRate, unsigned int outputRate);
+
+    std::unique_ptr<AudioBackend> source;
+    AudioFormat inputFormat;
+    AudioFormat format;
+    std::shared_ptr<const Bank> bank;
+    uint64_t up;                                // L: output frames per 'down' input frames
+    uint64_t down;                              // M
+    uint64_t positionFrames;
+
+    // Output frame positionFrames is at input frame inputIndex plus phase/up
+    int64_t inputIndex;
+    uint64_t phase;
+
+    // Input frames read ahead, one plane of 'capacity' floats per channel;
+    // frame inputStart comes first. Padded with silence before the start and
+    // after the end of the source
+    std::vector<float> planes;
+    size_t capacity;
+    size_t inputFrames;
+    int64_t inputStart;
+    bool sourceEnded;
+    int64_t endFrame;                           // Input frame the wrapped stream ended at
+    std::vector<float> scratch;                 // Interleaved read from the source
+
+    // Restart the input at 'first', silent up to 'sourceFrame' where the source is
+    void reset(int64_t first, int64_t sourceFrame);
+    // Make the planes reach input frame 'end'
+    void fill(int64_t end);
+    void discardBefore(int64_t frame);
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,37 @@
+#ifndef SESSIONSNAPSHOT_HPP
+#define SESSIONSNAPSHOT_HPP
+
+#include <string>
+#include <cstdint>
+#include "song.hpp"
+#include "playQueue.hpp"
+
+// Everything needed to pick up where the last session stopped
+struct SessionState {
+    QueueMode queueMode;
+    std::string playlistName;
+    uint64_t shuffleSeed;
+    bool smartShuffle;
+    int randomPosition;
+    int currentSongIndex;
+    uint32_t librarySize;      // Up-next/history IDs are only valid for the same library
+
+    bool hasCurrentSong;
+    Song currentSong;          // Stored with its path so it can play before the scan
+    uint32_t positionMs;
+    bool wasPlaying;
+
+    SessionState() : queueMode(QueueMode::ALL_SONGS), shuffleSeed(0), smartShuffle(false),
+                     randomPosition(-1), currentSongIndex(-1), librarySize(0),
+                     hasCurrentSong(false), positionMs(0), wasPlaying(false) {}
+};
+
+// Compact binary snapshot (session.bin), written through a temp file so a
+// crash mid-write never leaves a truncated snapshot behind
+class SessionSnapshot {
+public:
+    static bool save(const std::string& filename, const SessionState& state, const PlayQueue& queue);
+    static bool load(const std::string& filename, SessionState& state, PlayQueue& queue);
+};
+
+#endif
\ No newline at end of file
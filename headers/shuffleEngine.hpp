@@ -0,0 +1,44 @@
+#ifndef SHUFFLEENGINE_HPP
+#define SHUFFLEENGINE_HPP
+
+#include <cstdint>
+#include <cstddef>
+
+// Keyed bijective permutation over [0, n) used for random mode.
+// A small balanced Feistel network is run over the next power-of-four domain
+// and cycle-walked back into range, so the shuffle order never has to be
+// materialized: lookups in both directions are O(1) and the whole order is
+// reproducible from (size, seed).
+class ShuffleEngine {
+public:
+    ShuffleEngine();
+
+    void reset(size_t size, uint64_t seed);
+    void reshuffle(); // Same size, fresh random seed
+
+    size_t size() const;
+    bool isEmpty() const;
+    uint64_t getSeed() const;
+
+    // Shuffle position -> queue index
+    int indexAt(int position) const;
+    // Queue index -> shuffle position
+    int positionOf(int index) const;
+
+    static uint64_t randomSeed();
+
+private:
+    static const int ROUNDS = 4;
+
+    uint64_t seed;
+    uint32_t count;
+    unsigned int halfBits;
+    uint32_t halfMask;
+    uint32_t roundKeys[ROUNDS];
+
+    uint32_t roundFunction(uint32_t value, uint32_t key) const;
+    uint32_t encrypt(uint32_t value) const;
+    uint32_t decrypt(uint32_t value) const;
+};
+
+#endif
\ No newline at end of file
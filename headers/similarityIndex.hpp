@@ -0,0 +1,51 @@
+#ifndef SIMILARITYINDEX_HPP
+#define SIMILARITYINDEX_HPP
+
+#include <vector>
+#include <array>
+#include <unordered_map>
+#include <cstdint>
+#include <cstddef>
+#include "featureAnalyzer.hpp"
+
+// Songs that sound alike, for radio mode.
+//
+// Every song is a point of its timbre (see FeatureAnalyzer), its tempo in
+// log2 BPM and its integrated loudness. Each dimension is standardized over
+// the library and weighted, so neither Hz nor LUFS nor the number of MFCCs
+// decides alone. Lookups go through an inverted file index: k-means splits
+// the points into about sqrt(n) lists stored one after the other, and a
+// query only scans the PROBES lists with the closest centres. At 100k songs
+// that is a few thousand distances instead of 100k. Approximate, a close
+// song in a list that wasn't probed is missed.
+class SimilarityIndex {
+public:
+    static const size_t DIMENSIONS = FeatureAnalyzer::TIMBRE_SIZE + 2;
+    typedef std::array<float, DIMENSIONS> Vector;
+
+    // Raw values, NaN where one is unknown (counts as the library average).
+    // Replaces what was there; the seed makes the lists reproducible
+    void build(const std::vector<int>& songIds, const std::vector<Vector>& vectors, uint64_t seed);
+    size_t size() const;
+    bool contains(int songId) const;
+    // Every song in the index, in no particular order
+    const std::vector<int>& getSongIds() const;
+
+    // Up to 'count' songs closest to 'songId', closest first, without itself
+    std::vector<int> nearest(int songId, size_t count) const;
+
+private:
+    static const size_t PROBES = 8;
+    static const int KMEANS_ROUNDS = 10;
+    static const size_t TRAINING_PER_LIST = 64;   // Sample k-means is trained on
+
+    std::vector<float> points;          // Scaled, grouped by list, DIMENSIONS each
+    std::vector<int> ids;               // Song of each point
+    std::unordered_map<int, size_t> rowOf;
+    std::vector<float> centres;         // DIMENSIONS each
+    std::vector<size_t> listStart;      // List l holds points listStart[l] to listStart[l + 1]
+
+    static float distance(const float* a, const float* b);
+};
+
+#endif
\ No newline at end of file
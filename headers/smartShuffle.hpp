@@ -0,0 +1,51 @@
+#ifndef SMARTSHUFFLE_HPP
+#define SMARTSHUFFLE_HPP
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include "song.hpp"
+
+// Artist-spread shuffle for random mode.
+// Songs are bucketed by normalized artist, each bucket is shuffled and given
+// evenly spaced, jittered slots, then the buckets are k-way merged with a heap
+// (O(n log k)). A final linear pass breaks up neighbours that share a
+// normalized title (the same song mapped by different artists).
+class SmartShuffle {
+public:
+    SmartShuffle();
+
+    void build(const std::vector<Song>& songs, uint64_t seed);
+
+    // Spread songs[firstNew..] into the part of the order after 'afterPosition',
+    // leaving everything already played untouched
+    void extend(const std::vector<Song>& songs, size_t firstNew, int afterPosition);
+
+    size_t size() const;
+    bool isEmpty() const;
+    uint64_t getSeed() const;
+
+    int indexAt(int position) const;
+    int positionOf(int index) const;
+
+    static std::string artistKey(const Song& song);
+    static std::string titleKey(const Song& song);
+
+private:
+    std::vector<int> order;     // Shuffle position -> queue index
+    std::vector<int> positions; // Queue index -> shuffle position
+    uint64_t seed;
+    uint64_t extendCount;
+
+    struct SlotEntry {
+        double key;
+        int index;
+    };
+
+    static std::vector<SlotEntry> interleave(const std::vector<Song>& songs, const std::vector<int>& indices, uint64_t seed);
+    static void separateTitles(const std::vector<Song>& songs, std::vector<int>& sequence, size_t begin);
+    static std::string normalize(const std::string& input);
+    void rebuildPositions(size_t begin);
+};
+
+#endif
\ No newline at end of file
@@ -3,7 +3,7 @@
 
 #include <vector>
 #include <string>
-#include "Song.hpp"
+#include "song.hpp"
 
 class SongScanner {
 public:
@@ -0,0 +1,44 @@
+#ifndef STREAMBUFFER_HPP
+#define STREAMBUFFER_HPP
+
+#include <vector>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+// Fixed-capacity ring of interleaved float frames between the decoder and
+// the render thread. Capacity is set once per format, so memory per track
+// doesn't depend on the track length.
+// One thread writes and one reads, each only advancing its own counter, so
+// neither side takes a lock. reset() and clear() need both sides stopped.
+class StreamBuffer {
+public:
+    StreamBuffer();
+
+    void reset(size_t capacityFrames, unsigned int channels);
+    void clear();
+
+    // Both return the number of frames actually copied
+    size_t write(const float* frames, size_t frameCount);
+    size_t read(float* frames, size_t frameCount);
+
+    size_t available() const;   // Frames ready to read
+    size_t space() const;       // Frames that can still be written
+    size_t capacity() const;
+    size_t memoryBytes() const;
+
+    // Running frame counts since the last clear, for marking track boundaries
+    uint64_t readPosition() const;
+    uint64_t writePosition() const;
+    // Reader side: drop everything before 'position' unread
+    void skipTo(uint64_t position);
+
+private:
+    std::vector<float> samples;
+    size_t capacityFrames;
+    unsigned int channels;
+    std::atomic<uint64_t> readFrame;    // Total frames read, the ring index is this modulo capacity
+    std::atomic<uint64_t> writeFrame;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,118 @@
+#ifndef TRACKCACHE_HPP
+#define TRACKCACHE_HPP
+
+#include <string>
+#include <vector>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <cstdint>
+#include "audioBackend.hpp"
+
+// Something a played track left in memory that makes the next play of it
+// start without opening or decoding the file. Released with its last
+// reference, so evicting one that is still playing is safe.
+class CachedTrack {
+public:
+    virtual ~CachedTrack() = default;
+    virtual size_t memoryBytes() const = 0;
+};
+
+// Whole track as the interleaved float frames the decoders produce, so a
+// replay from memory is the same to the bit as decoding the file again
+class DecodedTrack : public CachedTrack {
+public:
+    AudioFormat format;
+    std::vector<float> samples;
+
+    uint64_t getLengthFrames() const { return format.channels ? samples.size() / format.channels : 0; }
+    size_t memoryBytes() const override { return samples.capacity() * sizeof(float); }
+};
+
+// Recently played tracks, keyed by file path, within a memory budget. Adding
+// a track drops the least recently used ones until the total fits again.
+// Shared by the UI and the decode thread.
+class TrackCache {
+public:
+    static const unsigned int DEFAULT_BUDGET_MB = 256;
+    static const unsigned int MAX_BUDGET_MB = 4096;
+
+    static TrackCache& getInstance();
+
+    void setBudgetMB(unsigned int megabytes);
+    unsigned int getBudgetMB() const;
+    bool fits(uint64_t bytes) const;
+
+    // Counts a hit or a miss
+    std::shared_ptr<CachedTrack> find(const std::string& path);
+    void store(const std::string& path, std::shared_ptr<CachedTrack> track);
+    void clear();
+
+    uint64_t getHits() const;
+    uint64_t getMisses() const;
+    size_t getUsedBytes() const;
+    size_t getTrackCount() const;
+
+    // Built-in playback: plays a cached copy, or opens the file and keeps
+    // what gets decoded from start to end. nullptr if no decoder handles it
+    std::unique_ptr<AudioBackend> openSource(const std::string& path);
+
+private:
+    typedef std::list<std::pair<std::string, std::shared_ptr<CachedTrack>>> UseList;
+
+    mutable std::mutex mutex;
+    UseList useOrder;                                       // Most recently used first
+    std::unordered_map<std::string, UseList::iterator> entries;
+    size_t budgetBytes;
+    size_t usedBytes;
+    uint64_t hits;
+    uint64_t misses;
+
+    TrackCache();
+    void evict();
+};
+
+// Plays a DecodedTrack from memory: opening and seeking are instant
+class MemorySource : public AudioBackend {
+public:
+    explicit MemorySource(std::shared_ptr<const DecodedTrack> track);
+
+    bool open(const std::string& path) override;
+    size_t decode(float* buffer, size_t frameCount) override;
+    bool seek(uint64_t frame) override;
+    void close() override;
+
+    AudioFormat getFormat() const override;
+    uint64_t getLengthFrames() const override;
+    uint64_t getPositionFrames() const override;
+
+private:
+    std::shared_ptr<const DecodedTrack> track;
+    uint64_t positionFrames;
+};
+
+// Wraps a decoder and keeps a copy of everything it decodes. Once the track
+// was decoded from start to end without a seek in between, the copy goes
+// into the cache; a seek anywhere but the start drops it.
+class CapturingSource : public AudioBackend {
+public:
+    CapturingSource(const std::string& path, std::unique_ptr<AudioBackend> decoder);
+
+    bool open(const std::string& path) override;
+    size_t decode(float* buffer, size_t frameCount) override;
+    bool seek(uint64_t frame) override;
+    void close() override;
+    void prepareSeeking() override;
+
+    AudioFormat getFormat() const override;
+    uint64_t getLengthFrames() const override;
+    uint64_t getPositionFrames() const override;
+
+private:
+    std::string path;
+    std::unique_ptr<AudioBackend> decoder;
+    std::shared_ptr<DecodedTrack> capture;  // nullptr once abandoned or stored
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,76 @@
+#ifndef VISUALIZER_HPP
+#define VISUALIZER_HPP
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include "analysisTap.hpp"
+#include "realFft.hpp"
+
+// Live spectrum and level meters in the console, drawn by a thread of its own.
+//
+// Each frame takes the last FFT_SIZE frames heard from the AnalysisTap,
+// applies a Hann window to their mono mix and bins the FFT into BARS
+// log-spaced bars, next to RMS meters of both channels. Bars rise at once and
+// fall at a fixed rate. Frames are capped at FRAMES_PER_SECOND, drop to
+// IDLE_FRAME_MS once nothing plays and the bars are down, and only the cells
+// that changed since the last frame are sent to the terminal. The display
+// sits on the alternate screen above a scroll region, so anything the player
+// prints meanwhile scrolls under it instead of through it.
+class Visualizer {
+public:
+    explicit Visualizer(const AnalysisTap& tap);
+    ~Visualizer();
+
+    void start();
+    // Gives the console its normal screen back
+    void stop();
+    bool isRunning() const;
+    // Shown above the bars
+    void setTitle(const std::string& title);
+
+private:
+    static const size_t FFT_SIZE = 4096;
+    static const size_t BARS = 32;
+    static const size_t WIDTH = BARS * 2;       // Every bar is a column and a gap
+    static const size_t HEIGHT = 12;            // Rows of bars, eight steps each
+    static const size_t ROWS = HEIGHT + 7;      // Under the title: bars, labels, meters and status
+    static const int FRAMES_PER_SECOND = 30;
+    static const int IDLE_FRAME_MS = 200;
+
+    const AnalysisTap& tap;
+    RealFft fft;
+    std::vector<float> window;
+    std::vector<float> left;
+    std::vector<float> right;
+    std::vector<float> mono;
+    std::vector<float> power;
+
+    // Bins bar b takes the loudest of, from barBins[b] to barBins[b + 1]
+    unsigned int layoutRate;
+    std::vector<size_t> barBins;
+    std::u32string labels;
+
+    // Shown levels in dB
+    float bars[BARS];
+    float meters[2];
+    double cpuPercent;
+
+    std::thread thread;
+    std::atomic<bool> running;
+    std::mutex titleMutex;
+    std::string title;
+    std::string shownTitle;                     // Visualizer thread
+    std::vector<std::u32string> shown;          // What the terminal holds under the title
+
+    void run();
+    void layout(unsigned int sampleRate);
+    // Returns false once nothing new came in and everything has fallen
+    bool analyze(bool fresh, float seconds);
+    std::vector<std::u32string> compose() const;
+    std::string diff(const std::vector<std::u32string>& frame);
+};
+
+#endif
\ No newline at end of file
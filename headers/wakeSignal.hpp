@@ -0,0 +1,25 @@
+#ifndef WAKESIGNAL_HPP
+#define WAKESIGNAL_HPP
+
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+
+// Auto-reset event for parking a worker thread until there is something to
+// do. A notify that arrives before the wait isn't lost.
+class WakeSignal {
+public:
+    WakeSignal();
+
+    void notify();
+    void wait();
+    // False if the timeout passed without a notify
+    bool waitFor(std::chrono::milliseconds timeout);
+
+private:
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool signaled;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,37 @@
+#ifndef WAVDECODER_HPP
+#define WAVDECODER_HPP
+
+#include <fstream>
+#include <vector>
+#include "audioBackend.hpp"
+
+// RIFF/WAVE reader: 8/16/24/32-bit PCM and 32/64-bit float, including WAVE_FORMAT_EXTENSIBLE
+class WavDecoder : public AudioBackend {
+public:
+    WavDecoder();
+    ~WavDecoder() override;
+
+    bool open(const std::string& path) override;
+    size_t decode(float* buffer, size_t frameCount) override;
+    bool seek(uint64_t frame) override;
+    void close() override;
+
+    AudioFormat getFormat() const override;
+    uint64_t getLengthFrames() const override;
+    uint64_t getPositionFrames() const override;
+
+    static bool probe(const unsigned char* header, size_t size);
+
+private:
+    std::ifstream file;
+    AudioFormat format;
+    uint16_t formatTag;
+    uint16_t bitsPerSample;
+    uint16_t blockAlign;
+    uint64_t dataOffset;
+    uint64_t lengthFrames;
+    uint64_t positionFrames;
+    std::vector<unsigned char> scratch;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,54 @@
+#ifndef WAVEFORM_HPP
+#define WAVEFORM_HPP
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+#include "audioBackend.hpp"
+
+// Overview of a whole stream for thumbnails and seek bars: BUCKETS equal
+// slices, each with its lowest and highest sample and its RMS over all
+// channels. The stream is first summed in slices of FINE_SECONDS and those
+// are merged at the end, so the length doesn't have to be known up front.
+class WaveformSummary {
+public:
+    static const size_t BUCKETS = 256;
+
+    // Quantized for the cache: the peaks in 1/127 and the RMS in 1/255 of full scale
+    struct Bucket {
+        int8_t min;
+        int8_t max;
+        uint8_t rms;
+    };
+
+    explicit WaveformSummary(const AudioFormat& format);
+
+    // Interleaved frames, as the decoders produce them
+    void process(const float* frames, size_t frameCount);
+
+    // BUCKETS buckets, empty when nothing went in
+    std::vector<Bucket> getBuckets() const;
+
+    // One lower block character per column, as high as the RMS against the
+    // loudest column of the song. 'played' (0 to 1) puts a bar where the
+    // playhead is, negative for none. UTF-8
+    static std::string render(const std::vector<Bucket>& buckets, size_t width, double played);
+
+private:
+    static constexpr double FINE_SECONDS = 0.02;
+
+    struct Slice {
+        float min;
+        float max;
+        double squares;
+        size_t samples;
+    };
+
+    AudioFormat format;
+    size_t sliceFrames;
+    std::vector<Slice> slices;  // The last one may still be filling
+    size_t framesInSlice;
+};
+
+#endif
\ No newline at end of file
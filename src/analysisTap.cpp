@@ -0,0 +1,69 @@
+#include "../headers/analysisTap.hpp"
+#include <algorithm>
+
+AnalysisTap::AnalysisTap() : samples(CAPACITY * 2), writing(0), written(0), delay(0), sampleRate(44100) {
+    for (std::atomic<float>& sample : samples) {
+        sample.store(0.0f, std::memory_order_relaxed);
+    }
+}
+
+void AnalysisTap::write(const float* frames, size_t frameCount, unsigned int channels) {
+    if (channels == 0) {
+        return;
+    }
+    uint64_t position = written.load(std::memory_order_relaxed);
+
+    // Claim the range before touching it, so a reader that sees any of the new
+    // samples also sees the claim
+    writing.store(position + frameCount, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    unsigned int second = channels > 1 ? 1 : 0;
+    for (size_t i = 0; i < frameCount; ++i) {
+        size_t slot = static_cast<size_t>((position + i) % CAPACITY) * 2;
+        samples[slot].store(frames[i * channels], std::memory_order_relaxed);
+        samples[slot + 1].store(frames[i * channels + second], std::memory_order_relaxed);
+    }
+    written.store(position + frameCount, std::memory_order_release);
+}
+
+void AnalysisTap::setDelay(size_t frames) {
+    delay.store(frames, std::memory_order_relaxed);
+}
+
+void AnalysisTap::setSampleRate(unsigned int rate) {
+    sampleRate.store(rate, std::memory_order_relaxed);
+}
+
+bool AnalysisTap::read(float* left, float* right, size_t frameCount) const {
+    frameCount = (std::min)(frameCount, CAPACITY / 2);
+    uint64_t end = written.load(std::memory_order_acquire);
+    // Never reach back so far that the writer could be on the same frames
+    uint64_t back = (std::min)(delay.load(std::memory_order_relaxed), CAPACITY / 2 - frameCount);
+    end = end > back ? end - back : 0;
+
+    for (size_t i = 0; i < frameCount; ++i) {
+        // Frame end - frameCount + i, silence before the first one
+        if (end + i < frameCount) {
+            left[i] = 0.0f;
+            right[i] = 0.0f;
+            continue;
+        }
+        size_t slot = static_cast<size_t>((end + i - frameCount) % CAPACITY) * 2;
+        left[i] = samples[slot].load(std::memory_order_relaxed);
+        right[i] = samples[slot + 1].load(std::memory_order_relaxed);
+    }
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    uint64_t claimed = writing.load(std::memory_order_relaxed);
+    uint64_t start = end > frameCount ? end - frameCount : 0;
+    return claimed <= start + CAPACITY;
+}
+
+uint64_t AnalysisTap::getWritten() const {
+    return written.load(std::memory_order_acquire);
+}
+
+unsigned int AnalysisTap::getSampleRate() const {
+    return sampleRate.load(std::memory_order_relaxed);
+}
\ No newline at end of file
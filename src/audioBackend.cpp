@@ -0,0 +1,82 @@
+#include "../headers/audioBackend.hpp"
+#include "../headers/wavDecoder.hpp"
+#include "../headers/mp3Decoder.hpp"
+#include <fstream>
+#include <cstring>
+#include <algorithm>
+
+namespace {
+    bool readHeader(const std::string& path, unsigned char (&header)[16]) {
+        std::ifstream file(path, std::ios::binary);
+        if (!file.is_open()) {
+            return false;
+        }
+        file.read(reinterpret_cast<char*>(header), sizeof(header));
+        return file.gcount() >= 4;
+    }
+}
+
+bool AudioBackend::canDecode(const std::string& path) {
+    // Sniff the contents rather than trusting the extension, osu! maps ship
+    // plenty of mislabelled audio files
+    unsigned char header[16] = {};
+    return readHeader(path, header) &&
+           (WavDecoder::probe(header, sizeof(header)) || Mp3Decoder::probe(header, sizeof(header)));
+}
+
+std::unique_ptr<AudioBackend> AudioBackend::openFile(const std::string& path) {
+    unsigned char header[16] = {};
+    if (!readHeader(path, header)) {
+        return nullptr;
+    }
+
+    std::unique_ptr<AudioBackend> backend;
+    if (WavDecoder::probe(header, sizeof(header))) {
+        backend.reset(new WavDecoder());
+    } else if (Mp3Decoder::probe(header, sizeof(header))) {
+        backend.reset(new Mp3Decoder());
+    } else {
+        return nullptr;
+    }
+
+    if (!backend->open(path)) {
+        return nullptr;
+    }
+    return backend;
+}
+
+SilenceSource::SilenceSource(const AudioFormat& sourceFormat, uint64_t length)
+    : format(sourceFormat), lengthFrames(length), positionFrames(0) {}
+
+bool SilenceSource::open(const std::string&) {
+    positionFrames = 0;
+    return true;
+}
+
+size_t SilenceSource::decode(float* buffer, size_t frameCount) {
+    size_t frames = static_cast<size_t>((std::min)(static_cast<uint64_t>(frameCount), lengthFrames - positionFrames));
+    std::memset(buffer, 0, frames * format.channels * sizeof(float));
+    positionFrames += frames;
+    return frames;
+}
+
+bool SilenceSource::seek(uint64_t frame) {
+    positionFrames = (std::min)(frame, lengthFrames);
+    return true;
+}
+
+void SilenceSource::close() {
+    positionFrames = 0;
+}
+
+AudioFormat SilenceSource::getFormat() const {
+    return format;
+}
+
+uint64_t SilenceSource::getLengthFrames() const {
+    return lengthFrames;
+}
+
+uint64_t SilenceSource::getPositionFrames() const {
+    return positionFrames;
+}
\ No newline at end of file
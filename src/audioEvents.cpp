@@ -0,0 +1,126 @@
+#include "../headers/audioEvents.hpp"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <poll.h>
+#include <unistd.h>
+#include <fcntl.h>
+#ifdef __linux__
+#include <sys/eventfd.h>
+#endif
+#endif
+
+AudioEvents::AudioEvents() : pending(0) {
+#ifdef _WIN32
+    handle = CreateEventA(nullptr, FALSE, FALSE, nullptr);
+#elif defined(__linux__)
+    readFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    writeFd = readFd;
+#else
+    int fds[2] = { -1, -1 };
+    if (pipe(fds) == 0) {
+        for (int fd : fds) {
+            fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+            fcntl(fd, F_SETFD, FD_CLOEXEC);
+        }
+    }
+    readFd = fds[0];
+    writeFd = fds[1];
+#endif
+}
+
+AudioEvents::~AudioEvents() {
+#ifdef _WIN32
+    if (handle) {
+        CloseHandle(handle);
+    }
+#else
+    if (writeFd >= 0 && writeFd != readFd) {
+        close(writeFd);
+    }
+    if (readFd >= 0) {
+        close(readFd);
+    }
+#endif
+}
+
+void AudioEvents::notify(uint32_t events) {
+    // Only the first event since the last take has to signal, the waiter
+    // collects the rest along with it
+    if (pending.fetch_or(events, std::memory_order_acq_rel) != 0) {
+        return;
+    }
+#ifdef _WIN32
+    if (handle) {
+        SetEvent(handle);
+    }
+#else
+    if (writeFd >= 0) {
+        uint64_t one = 1;
+        // Full pipe or counter means the waiter is already due to wake
+        ssize_t written = write(writeFd, &one, writeFd == readFd ? sizeof(one) : 1);
+        (void)written;
+    }
+#endif
+}
+
+uint32_t AudioEvents::take() {
+    return pending.exchange(0, std::memory_order_acq_rel);
+}
+
+void AudioEvents::wait(int timeoutMs) {
+    if (pending.load(std::memory_order_acquire) != 0 || timeoutMs == 0) {
+        return;
+    }
+
+#ifdef _WIN32
+    DWORD timeout = timeoutMs < 0 ? INFINITE : static_cast<DWORD>(timeoutMs);
+    HANDLE input = GetStdHandle(STD_INPUT_HANDLE);
+    DWORD mode = 0;
+    if (input == INVALID_HANDLE_VALUE || !GetConsoleMode(input, &mode)) {
+        // Redirected input can't be waited on, check it again every so often
+        WaitForSingleObject(handle, timeout < 100 ? timeout : 100);
+        return;
+    }
+
+    HANDLE handles[2] = { handle, input };
+    if (WaitForMultipleObjects(2, handles, FALSE, timeout) != WAIT_OBJECT_0 + 1) {
+        return;
+    }
+
+    // The console handle stays signaled while it holds any record, drop the ones
+    // that aren't key presses (focus, mouse, resize) so they don't keep waking us
+    INPUT_RECORD record;
+    DWORD count = 0;
+    while (PeekConsoleInputA(input, &record, 1, &count) && count == 1) {
+        if (record.EventType == KEY_EVENT && record.Event.KeyEvent.bKeyDown) {
+            break;
+        }
+        ReadConsoleInputA(input, &record, 1, &count);
+    }
+#else
+    pollfd fds[2];
+    fds[0].fd = readFd;
+    fds[0].events = POLLIN;
+    fds[0].revents = 0;
+    fds[1].fd = STDIN_FILENO;
+    fds[1].events = POLLIN;
+    fds[1].revents = 0;
+
+    int result = poll(fds, 2, timeoutMs);
+    if (result > 0 && (fds[0].revents & POLLIN)) {
+        // Reset the signal, the bits themselves are collected by take()
+        if (readFd == writeFd) {
+            uint64_t count = 0;
+            ssize_t drained = read(readFd, &count, sizeof(count));
+            (void)drained;
+        } else {
+            char bytes[64];
+            while (read(readFd, bytes, sizeof(bytes)) > 0) {
+            }
+        }
+    }
+#endif
+}
\ No newline at end of file
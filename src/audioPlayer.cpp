@@ -2,17 +2,73 @@
 #include "../headers/audioPlayer.hpp"
 #include <iostream>
 #include <chrono>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <cstring>
 
 // Include FMOD headers - you'll need to download and include these
 #ifdef FMOD_AVAILABLE
 #include "fmod.h"
 #include "fmod_errors.h"
+
+namespace {
+    // FMOD calls this from System_Update, i.e. on the thread running AudioPlayer::update
+    FMOD_RESULT F_CALLBACK channelCallback(FMOD_CHANNELCONTROL* control, FMOD_CHANNELCONTROL_TYPE type,
+                                           FMOD_CHANNELCONTROL_CALLBACK_TYPE callbackType, void*, void*) {
+        if (type == FMOD_CHANNELCONTROL_CHANNEL && callbackType == FMOD_CHANNELCONTROL_CALLBACK_END) {
+            void* userData = nullptr;
+            FMOD_Channel_GetUserData(reinterpret_cast<FMOD_CHANNEL*>(control), &userData);
+            if (userData) {
+                static_cast<AudioEvents*>(userData)->notify(AudioEvents::TRACK_END);
+            }
+        }
+        return FMOD_OK;
+    }
+
+    // FMOD's mixer thread: pass the master mix through and copy it into the tap
+    FMOD_RESULT F_CALLBACK tapRead(FMOD_DSP_STATE* dspState, float* inBuffer, float* outBuffer, unsigned int length,
+                                   int inChannels, int* outChannels) {
+        std::memcpy(outBuffer, inBuffer, sizeof(float) * length * inChannels);
+        *outChannels = inChannels;
+        void* userData = nullptr;
+        FMOD_DSP_GetUserData(static_cast<FMOD_DSP*>(dspState->instance), &userData);
+        if (userData && inChannels > 0) {
+            static_cast<AnalysisTap*>(userData)->write(inBuffer, length, static_cast<unsigned int>(inChannels));
+        }
+        return FMOD_OK;
+    }
+
+    // Decoded copy of a whole file, played again without touching the disk
+    class FmodSample : public CachedTrack {
+    public:
+        FmodSample(FMOD_SOUND* sampleSound, size_t bytes) : sound(sampleSound), sampleBytes(bytes) {}
+        ~FmodSample() override { FMOD_Sound_Release(sound); }
+        size_t memoryBytes() const override { return sampleBytes; }
+
+        FMOD_SOUND* sound;
+
+    private:
+        size_t sampleBytes;
+    };
+}
 #endif
 
 AudioPlayer::AudioPlayer() 
-    : fmodSystem(nullptr), currentSound(nullptr), currentChannel(nullptr),
-      state(PlaybackState::STOPPED), volume(1.0f), songFinished(false),
-      songStartTime(std::chrono::steady_clock::now()), songLengthMs(0) {
+    : fmodSystem(nullptr), currentSound(nullptr), currentChannel(nullptr), nextSound(nullptr), nextChannel(nullptr),
+#ifdef FMOD_AVAILABLE
+      pendingSample(nullptr), pendingSampleBytes(0), pitchShift(nullptr), equalizerUnits{ nullptr, nullptr }, tapUnit(nullptr),
+      prefetchSound(nullptr), prefetchChannel(nullptr), prefetchStartMs(0), prefetchFromBeatmap(false), primedChannel(nullptr),
+#endif
+      state(PlaybackState::STOPPED), volume(1.0f), songFinished(false), hasNextSong(false), advancedToNext(false),
+      crossfadeMs(0), fadeCurve(FadeCurve::EQUAL_POWER), milestoneMs(0), previewStartMs(0), previewFromBeatmap(false),
+      currentGain(1.0f), nextGain(1.0f), rate(1.0), rateMode(RateMode::STRETCH),
+#ifdef FMOD_AVAILABLE
+      previewEndMs(0),
+#else
+      engine(&events, &analysisTap),
+#endif
+      prefetchClipMs(0), songLengthMs(0), outputLatencyMs(0) {
 }
 
 AudioPlayer::~AudioPlayer() {
@@ -23,29 +79,68 @@ bool AudioPlayer::initialize() {
 #ifdef FMOD_AVAILABLE
     return initializeFMOD();
 #else
-    std::cout << "FMOD not available. Audio playback will be simulated." << std::endl;
+    if (!engine.setOutput(AudioSink::defaultKind()) && !engine.setOutput("null")) {
+        std::cout << "Failed to open an audio output!" << std::endl;
+        return false;
+    }
+    std::cout << "FMOD not available. Using built-in playback (output: " << engine.getOutputName() << ")." << std::endl;
     return true;
 #endif
 }
 
 void AudioPlayer::cleanup() {
 #ifdef FMOD_AVAILABLE
-    if (currentSound) {
-        FMOD_Sound_Release(currentSound);
-        currentSound = nullptr;
+    cancelPreload();
+    releasePrefetch();
+    releaseSound(currentSound, currentCached);
+    if (pendingSample) {
+        FMOD_Sound_Release(pendingSample);
+        pendingSample = nullptr;
+    }
+    // Cached samples belong to this FMOD system
+    TrackCache::getInstance().clear();
+    if (pitchShift) {
+        FMOD_DSP_Release(pitchShift);
+        pitchShift = nullptr;
+    }
+    for (FMOD_DSP*& unit : equalizerUnits) {
+        if (unit) {
+            FMOD_DSP_Release(unit);
+            unit = nullptr;
+        }
+    }
+    if (tapUnit) {
+        FMOD_DSP_Release(tapUnit);
+        tapUnit = nullptr;
     }
     
     if (fmodSystem) {
         FMOD_System_Release(fmodSystem);
         fmodSystem = nullptr;
     }
+#else
+    engine.shutdown();
 #endif
 }
 
-bool AudioPlayer::loadSong(const Song& song) {
+void AudioPlayer::beginLoad(const Song& song, float gain) {
+    cancelPreload();
     currentSong = song;
+    currentGain = gain;
     songFinished = false;
+    advancedToNext = false;
     songLengthMs = 0;
+    milestoneMs = 0;
+    previewStartMs = 0;
+    previewFromBeatmap = false;
+#ifdef FMOD_AVAILABLE
+    previewEndMs = 0;
+    primedChannel = nullptr;
+#endif
+}
+
+bool AudioPlayer::loadSong(const Song& song, float gain) {
+    beginLoad(song, gain);
     
 #ifdef FMOD_AVAILABLE
     if (!fmodSystem) {
@@ -54,14 +149,9 @@ bool AudioPlayer::loadSong(const Song& song) {
     }
     
     // Release previous sound
-    if (currentSound) {
-        FMOD_Sound_Release(currentSound);
-        currentSound = nullptr;
-    }
+    releaseSound(currentSound, currentCached);
     
-    // Load new sound
-    FMOD_RESULT result = FMOD_System_CreateSound(fmodSystem, song.filePath.c_str(), FMOD_DEFAULT, 0, &currentSound);
-    if (result != FMOD_OK) {
+    if (!openSound(song.filePath, currentSound, currentCached)) {
         std::cout << "Failed to load song: " << song.filePath << std::endl;
         return false;
     }
@@ -74,13 +164,144 @@ bool AudioPlayer::loadSong(const Song& song) {
     std::cout << "Loading . . ." << std::endl;
     return true;
 #else
-    // Simulate different song lengths for testing
-    songLengthMs = 30000 + (song.id % 5) * 15000; // 30-90 seconds based on song ID
-    std::cout << "Simulated loading: " << song.getDisplayName() << " (Length: " << formatTime(songLengthMs) << ")" << std::endl;
+    std::unique_ptr<AudioBackend> source = TrackCache::getInstance().openSource(song.filePath);
+    if (!source) {
+        // No built-in decoder for this file, play silence of a simulated length instead
+        unsigned int simulatedMs = 30000 + (song.id % 5) * 15000; // 30-90 seconds based on song ID
+        AudioFormat silentFormat;
+        source.reset(new SilenceSource(silentFormat, static_cast<uint64_t>(simulatedMs) * silentFormat.sampleRate / 1000));
+        std::cout << "No built-in decoder for this file, simulating: " << song.getDisplayName()
+                  << " (Length: " << formatTime(simulatedMs) << ")" << std::endl;
+    } else {
+        std::cout << "Loading . . ." << std::endl;
+    }
+    
+    if (!engine.load(std::move(source), currentGain)) {
+        std::cout << "Failed to open audio output for: " << song.filePath << std::endl;
+        return false;
+    }
+    engine.setVolume(volume);
+    songLengthMs = engine.getLengthMs();
+    return true;
+#endif
+}
+
+bool AudioPlayer::canPreview(const Song& song) const {
+#ifdef FMOD_AVAILABLE
+    (void)song;
     return true;
+#else
+    // No simulated silence here, a clip of it would pass for the song
+    return AudioBackend::canDecode(song.filePath);
 #endif
 }
 
+bool AudioPlayer::loadPreview(const Song& song, unsigned int clipMs, float gain) {
+#ifdef FMOD_AVAILABLE
+    if (prefetchChannel && prefetchPath == song.filePath && prefetchClipMs == clipMs) {
+        // The stream is open and its channel waits, paused, at the clip start
+        beginLoad(song, gain);
+        releaseSound(currentSound, currentCached);
+        currentSound = prefetchSound;
+        primedChannel = prefetchChannel;
+        previewStartMs = prefetchStartMs;
+        previewFromBeatmap = prefetchFromBeatmap;
+        prefetchSound = nullptr;
+        prefetchChannel = nullptr;
+        prefetchPath.clear();
+        
+        unsigned int length = 0;
+        FMOD_Sound_GetLength(currentSound, &length, FMOD_TIMEUNIT_MS);
+        songLengthMs = length;
+        previewEndMs = (std::min)(songLengthMs, previewStartMs + clipMs);
+        std::cout << "Loading . . ." << std::endl;
+        return true;
+    }
+    releasePrefetch();
+    
+    // FMOD seeks its MP3 streams from the byte offset unless asked for accurate time
+    if (!loadSong(song, gain)) {
+        return false;
+    }
+    previewStartMs = PreviewClip::findStartMs(song.filePath, songLengthMs, clipMs, previewFromBeatmap);
+    previewEndMs = (std::min)(songLengthMs, previewStartMs + clipMs);
+    return true;
+#else
+    beginLoad(song, gain);
+    
+    std::unique_ptr<PreviewClip> clip;
+    if (prefetchedClip.valid() && prefetchPath == song.filePath && prefetchClipMs == clipMs) {
+        clip = prefetchedClip.get();
+    } else {
+        prefetchedClip = std::future<std::unique_ptr<PreviewClip>>();
+        clip.reset(new PreviewClip(clipMs));
+        if (!clip->open(song.filePath)) {
+            clip.reset();
+        }
+    }
+    prefetchPath.clear();
+    if (!clip) {
+        std::cout << "Failed to load song: " << song.filePath << std::endl;
+        return false;
+    }
+    
+    previewStartMs = clip->getStartMs();
+    previewFromBeatmap = clip->isFromBeatmap();
+    if (!engine.load(std::move(clip), currentGain)) {
+        std::cout << "Failed to open audio output for: " << song.filePath << std::endl;
+        return false;
+    }
+    engine.setVolume(volume);
+    songLengthMs = engine.getLengthMs();
+    return true;
+#endif
+}
+
+void AudioPlayer::prefetchPreview(const Song& song, unsigned int clipMs) {
+#ifdef FMOD_AVAILABLE
+    if (!fmodSystem || (prefetchSound && prefetchPath == song.filePath && prefetchClipMs == clipMs)) {
+        return;
+    }
+    releasePrefetch();
+    if (TrackCache::getInstance().find(song.filePath)) {
+        return; // A cached sample starts at once anyway
+    }
+    
+    // Opens on FMOD's loader thread, updatePrefetch() takes it from there
+    if (FMOD_System_CreateSound(fmodSystem, song.filePath.c_str(), FMOD_DEFAULT | FMOD_CREATESTREAM | FMOD_NONBLOCKING,
+                                0, &prefetchSound) != FMOD_OK) {
+        prefetchSound = nullptr;
+        return;
+    }
+    prefetchPath = song.filePath;
+    prefetchClipMs = clipMs;
+#else
+    if (prefetchedClip.valid() && prefetchPath == song.filePath && prefetchClipMs == clipMs) {
+        return;
+    }
+    // Replacing the future waits for a clip still being opened
+    prefetchPath = song.filePath;
+    prefetchClipMs = clipMs;
+    std::string path = song.filePath;
+    prefetchedClip = std::async(std::launch::async, [path, clipMs]() {
+        // Off the console thread an exact start is affordable, whatever the decoder has to read for it
+        std::unique_ptr<PreviewClip> clip(new PreviewClip(clipMs, true));
+        if (!clip->open(path)) {
+            clip.reset();
+        }
+        return clip;
+    });
+#endif
+}
+
+unsigned int AudioPlayer::getPreviewStartMs() const {
+    return previewStartMs;
+}
+
+bool AudioPlayer::isPreviewFromBeatmap() const {
+    return previewFromBeatmap;
+}
+
 void AudioPlayer::play() {
 #ifdef FMOD_AVAILABLE
     if (!currentSound || !fmodSystem) {
@@ -88,38 +309,52 @@ void AudioPlayer::play() {
         return;
     }
     
-    FMOD_RESULT result = FMOD_System_PlaySound(fmodSystem, currentSound, 0, 0, &currentChannel);
+    // A clip starts paused, so nothing before its start point is heard. A
+    // prefetched one is already paused there
+    bool primed = primedChannel != nullptr;
+    FMOD_RESULT result = FMOD_OK;
+    if (primed) {
+        currentChannel = primedChannel;
+        primedChannel = nullptr;
+    } else {
+        result = FMOD_System_PlaySound(fmodSystem, currentSound, 0, previewEndMs > 0, &currentChannel);
+    }
     if (result == FMOD_OK) {
         state = PlaybackState::PLAYING;
         songFinished = false;
-        songStartTime = std::chrono::steady_clock::now();
-        pausedDuration = std::chrono::milliseconds(0);
-        FMOD_Channel_SetVolume(currentChannel, volume);
+        FMOD_Channel_SetVolume(currentChannel, volume * currentGain);
+        applyRate(currentChannel, currentSound);
+        watchChannel(currentChannel);
+        if (previewEndMs > 0) {
+            if (!primed) {
+                FMOD_Channel_SetPosition(currentChannel, previewStartMs, FMOD_TIMEUNIT_MS);
+            }
+            FMOD_Channel_SetPaused(currentChannel, 0);
+        }
     } else {
         std::cout << "Failed to play song!" << std::endl;
     }
 #else
+    engine.play();
     state = PlaybackState::PLAYING;
     songFinished = false;
-    songStartTime = std::chrono::steady_clock::now();
-    pausedDuration = std::chrono::milliseconds(0);
-    std::cout << "Simulated playing: " << currentSong.getDisplayName() << " | Length: " << formatTime(songLengthMs) << std::endl;
 #endif
 }
 
 void AudioPlayer::pause() {
 #ifdef FMOD_AVAILABLE
     if (currentChannel && state == PlaybackState::PLAYING) {
+        // The scheduled start of the next song is rescheduled on resume
+        unscheduleNext();
         FMOD_Channel_SetPaused(currentChannel, 1);
         state = PlaybackState::PAUSED;
-        pauseStartTime = std::chrono::steady_clock::now();
         std::cout << "Paused" << std::endl;
     }
 #else
     if (state == PlaybackState::PLAYING) {
+        engine.pause();
         state = PlaybackState::PAUSED;
-        pauseStartTime = std::chrono::steady_clock::now();
-        std::cout << "Simulated pause" << std::endl;
+        std::cout << "Paused" << std::endl;
     }
 #endif
 }
@@ -129,28 +364,22 @@ void AudioPlayer::resume() {
     if (currentChannel && state == PlaybackState::PAUSED) {
         FMOD_Channel_SetPaused(currentChannel, 0);
         state = PlaybackState::PLAYING;
-        
-        // Add the paused duration to total paused time
-        auto pauseDuration = std::chrono::steady_clock::now() - pauseStartTime;
-        pausedDuration += std::chrono::duration_cast<std::chrono::milliseconds>(pauseDuration);
-        
         std::cout << "Resumed" << std::endl;
     }
 #else
     if (state == PlaybackState::PAUSED) {
+        engine.resume();
         state = PlaybackState::PLAYING;
-        
-        // Add the paused duration to total paused time
-        auto pauseDuration = std::chrono::steady_clock::now() - pauseStartTime;
-        pausedDuration += std::chrono::duration_cast<std::chrono::milliseconds>(pauseDuration);
-        
-        std::cout << "Simulated resume" << std::endl;
+        std::cout << "Resumed" << std::endl;
     }
 #endif
 }
 
 void AudioPlayer::stop() {
+    cancelPreload();
+    advancedToNext = false;
 #ifdef FMOD_AVAILABLE
+    releasePrefetch();
     if (currentChannel) {
         FMOD_Channel_Stop(currentChannel);
         currentChannel = nullptr;
@@ -159,9 +388,10 @@ void AudioPlayer::stop() {
         std::cout << "Stopped" << std::endl;
     }
 #else
+    engine.stop();
     state = PlaybackState::STOPPED;
     songFinished = false;
-    std::cout << "Simulated stop" << std::endl;
+    std::cout << "Stopped" << std::endl;
 #endif
 }
 
@@ -188,8 +418,13 @@ void AudioPlayer::setVolume(float vol) {
     
 #ifdef FMOD_AVAILABLE
     if (currentChannel) {
-        FMOD_Channel_SetVolume(currentChannel, volume);
+        FMOD_Channel_SetVolume(currentChannel, volume * currentGain);
+    }
+    if (nextChannel) {
+        FMOD_Channel_SetVolume(nextChannel, volume * nextGain);
     }
+#else
+    engine.setVolume(volume);
 #endif
 }
 
@@ -197,25 +432,50 @@ float AudioPlayer::getVolume() const {
     return volume;
 }
 
-unsigned int AudioPlayer::getPosition() const {
+void AudioPlayer::setTrackGains(float current, float next) {
+    currentGain = current;
+    nextGain = next;
 #ifdef FMOD_AVAILABLE
-    if (currentChannel) {
-        unsigned int position = 0;
-        FMOD_Channel_GetPosition(currentChannel, &position, FMOD_TIMEUNIT_MS);
-        return position;
-    }
+    setVolume(volume);
+#else
+    engine.setTrackGains(current, next);
 #endif
+}
+
+float AudioPlayer::getTrackGain() const {
+    return currentGain;
+}
+
+unsigned int AudioPlayer::getPosition() const {
     return getCurrentPlaybackPosition();
 }
 
 unsigned int AudioPlayer::getLength() const {
+#ifdef FMOD_AVAILABLE
+    if (previewEndMs > 0) {
+        return previewEndMs - previewStartMs;
+    }
+#else
+    // The engine corrects estimated lengths once the seek index has counted the frames
+    unsigned int engineLength = engine.getLengthMs();
+    if (engineLength > 0) {
+        return engineLength;
+    }
+#endif
     return songLengthMs;
 }
 
 void AudioPlayer::setPosition(unsigned int positionMs) {
+    // The player re-arms the milestone for wherever we land
+    milestoneMs = 0;
 #ifdef FMOD_AVAILABLE
     if (currentChannel) {
-        FMOD_Channel_SetPosition(currentChannel, positionMs, FMOD_TIMEUNIT_MS);
+        FMOD_Channel_SetPosition(currentChannel, previewStartMs + positionMs, FMOD_TIMEUNIT_MS);
+        unscheduleNext();
+    }
+#else
+    if (state != PlaybackState::STOPPED) {
+        engine.seek(positionMs);
     }
 #endif
 }
@@ -224,33 +484,228 @@ std::string AudioPlayer::getCurrentSongName() const {
     return currentSong.getDisplayName();
 }
 
+bool AudioPlayer::preloadSong(const Song& song, float gain) {
+    cancelPreload();
+    nextGain = gain;
+    
+#ifdef FMOD_AVAILABLE
+    if (!fmodSystem || !currentSound) {
+        return false;
+    }
+    
+    if (!openSound(song.filePath, nextSound, nextCached)) {
+        return false;
+    }
+    nextSong = song;
+    hasNextSong = true;
+    scheduleNext();
+    return true;
+#else
+    engine.preloadFile(song.filePath, nextGain);
+    nextSong = song;
+    hasNextSong = true;
+    return true;
+#endif
+}
+
+void AudioPlayer::cancelPreload() {
+#ifdef FMOD_AVAILABLE
+    unscheduleNext();
+    releaseSound(nextSound, nextCached);
+#else
+    if (hasNextSong) {
+        engine.cancelPreload();
+    }
+#endif
+    hasNextSong = false;
+}
+
+std::string AudioPlayer::getPreloadedPath() const {
+    return hasNextSong ? nextSong.filePath : "";
+}
+
+bool AudioPlayer::hasAdvancedToPreloaded() const {
+    return advancedToNext;
+}
+
+void AudioPlayer::setCrossfade(unsigned int milliseconds, FadeCurve curve) {
+    crossfadeMs = milliseconds;
+    fadeCurve = curve;
+#ifndef FMOD_AVAILABLE
+    engine.setCrossfade(milliseconds, curve);
+#endif
+}
+
+unsigned int AudioPlayer::getCrossfadeMs() const {
+    return crossfadeMs;
+}
+
+FadeCurve AudioPlayer::getFadeCurve() const {
+    return fadeCurve;
+}
+
+void AudioPlayer::setRate(double newRate, RateMode mode) {
+    rate = (std::max)(RateSource::MIN_RATE, (std::min)(RateSource::MAX_RATE, newRate));
+    rateMode = mode;
+    // The player re-arms the milestone on the new timeline
+    milestoneMs = 0;
+#ifdef FMOD_AVAILABLE
+    // A faster channel plays higher, the pitch shifter takes that back out when stretching
+    if (pitchShift) {
+        bool stretch = rateMode == RateMode::STRETCH && rate != 1.0;
+        if (stretch) {
+            FMOD_DSP_SetParameterFloat(pitchShift, FMOD_DSP_PITCHSHIFT_PITCH, static_cast<float>(1.0 / rate));
+        }
+        FMOD_DSP_SetBypass(pitchShift, stretch ? 0 : 1);
+    }
+    if (currentChannel) {
+        applyRate(currentChannel, currentSound);
+        // The next song was scheduled for the old rate, update() schedules it again
+        unscheduleNext();
+    }
+#else
+    engine.setRate(rate, rateMode);
+#endif
+}
+
+double AudioPlayer::getRate() const {
+    return rate;
+}
+
+RateMode AudioPlayer::getRateMode() const {
+    return rateMode;
+}
+
+void AudioPlayer::acceptPreloaded() {
+    if (!advancedToNext) {
+        return;
+    }
+    
+    currentSong = nextSong;
+    currentGain = nextGain;
+    hasNextSong = false;
+    advancedToNext = false;
+    songFinished = false;
+    milestoneMs = 0;
+    
+#ifdef FMOD_AVAILABLE
+    unsigned int length = 0;
+    FMOD_Sound_GetLength(currentSound, &length, FMOD_TIMEUNIT_MS);
+    songLengthMs = length;
+#else
+    songLengthMs = engine.getLengthMs();
+#endif
+}
+
+bool AudioPlayer::setOutput(const std::string& kind, const std::string& path) {
+#ifdef FMOD_AVAILABLE
+    (void)kind;
+    (void)path;
+    return false;
+#else
+    return engine.setOutput(kind, path);
+#endif
+}
+
+bool AudioPlayer::setOutputRate(unsigned int sampleRate) {
+#ifdef FMOD_AVAILABLE
+    (void)sampleRate;
+    return false;
+#else
+    engine.setOutputRate(sampleRate);
+    return true;
+#endif
+}
+
+unsigned int AudioPlayer::getOutputRate() const {
+#ifdef FMOD_AVAILABLE
+    return 0;
+#else
+    return engine.getOutputRate();
+#endif
+}
+
+void AudioPlayer::setEqualizer(const std::vector<EqBand>& bands) {
+    eqBands.assign(bands.begin(), bands.begin() + (std::min)(bands.size(), Equalizer::MAX_BANDS));
+#ifdef FMOD_AVAILABLE
+    applyEqualizer();
+#else
+    engine.setEqualizer(eqBands);
+#endif
+}
+
+const std::vector<EqBand>& AudioPlayer::getEqualizer() const {
+    return eqBands;
+}
+
+double AudioPlayer::getEqualizerCost() const {
+#ifdef FMOD_AVAILABLE
+    return 0.0;
+#else
+    return engine.getEqualizerCost();
+#endif
+}
+
+const AnalysisTap& AudioPlayer::getAnalysisTap() const {
+    return analysisTap;
+}
+
+std::string AudioPlayer::getOutputInfo() const {
+#ifdef FMOD_AVAILABLE
+    return "FMOD (output selection is only available in the built-in playback path)";
+#else
+    std::ostringstream info;
+    info << engine.getOutputName() << " | latency " << engine.getLatencyMs() << " ms";
+    info << " | buffer " << engine.getBufferBytes() / 1024 << " KB";
+    if (engine.getDeviceRate() > 0) {
+        info << " | " << engine.getDeviceRate() << " Hz";
+    }
+    info << (engine.getOutputRate() > 0 ? " (songs converted)" : " (follows the song)");
+    double speed = engine.getDecodeSpeed();
+    if (speed > 0.0) {
+        info << " | decoding at " << std::fixed << std::setprecision(0) << speed << "x real time";
+        info << " | first audio after " << std::setprecision(1) << engine.getFirstAudioMs() << " ms";
+        info << " | " << engine.getUnderruns() << " underruns";
+        info << " | last track gap " << engine.getLastGapMs() << " ms";
+    }
+    return info.str();
+#endif
+}
+
 unsigned int AudioPlayer::getCurrentPlaybackPosition() const {
     if (state == PlaybackState::STOPPED) {
         return 0;
     }
     
-    auto now = std::chrono::steady_clock::now();
-    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - songStartTime);
-    
-    // Subtract paused duration
-    auto actualElapsed = elapsed - pausedDuration;
-    
-    // If currently paused, don't add current pause time
-    if (state == PlaybackState::PAUSED) {
-        auto currentPauseDuration = std::chrono::duration_cast<std::chrono::milliseconds>(now - pauseStartTime);
-        actualElapsed -= currentPauseDuration;
+#ifdef FMOD_AVAILABLE
+    if (!currentChannel || !currentSound) {
+        return 0;
     }
     
-    return static_cast<unsigned int>(std::max(0LL, actualElapsed.count()));
+    // The channel position is where the mixer reads, the speakers are its buffers behind
+    unsigned int positionPcm = 0;
+    float soundRate = 0.0f;
+    FMOD_Channel_GetPosition(currentChannel, &positionPcm, FMOD_TIMEUNIT_PCM);
+    FMOD_Sound_GetDefaults(currentSound, &soundRate, 0);
+    if (soundRate <= 0.0f) {
+        return 0;
+    }
+    unsigned int positionMs = static_cast<unsigned int>(positionPcm * 1000.0 / soundRate);
+    unsigned int latencyMs = static_cast<unsigned int>(outputLatencyMs * rate) + previewStartMs;
+    return positionMs > latencyMs ? positionMs - latencyMs : 0;
+#else
+    return engine.getPositionMs();
+#endif
 }
 
 unsigned int AudioPlayer::getRemainingTime() const {
-    if (songLengthMs == 0) return 0;
+    unsigned int length = getLength();
+    if (length == 0) return 0;
     
     unsigned int currentPos = getCurrentPlaybackPosition();
-    if (currentPos >= songLengthMs) return 0;
+    if (currentPos >= length) return 0;
     
-    return songLengthMs - currentPos;
+    return static_cast<unsigned int>((length - currentPos) / rate);
 }
 
 std::string AudioPlayer::formatTime(unsigned int milliseconds) const {
@@ -271,38 +726,110 @@ std::string AudioPlayer::getProgressString() const {
     unsigned int currentPos = getCurrentPlaybackPosition();
     unsigned int remaining = getRemainingTime();
     
-    return formatTime(currentPos) + " / " + formatTime(songLengthMs) + " (Remaining: " + formatTime(remaining) + ")";
+    std::string progress = formatTime(currentPos) + " / " + formatTime(getLength());
+    if (rate != 1.0) {
+        std::ostringstream speed;
+        speed << " at " << std::setprecision(3) << rate << "x";
+        progress += speed.str();
+    }
+    return progress + " (Remaining: " + formatTime(remaining) + ")";
 }
 
 void AudioPlayer::update() {
 #ifdef FMOD_AVAILABLE
     if (fmodSystem) {
         FMOD_System_Update(fmodSystem);
+        // The end callbacks only wake the loop, the channel state below is what counts
+        events.take();
+        updatePendingSample();
+        updatePrefetch();
         
         // Check if song finished playing
         if (currentChannel && state == PlaybackState::PLAYING) {
             FMOD_BOOL isPlaying = 0;
             FMOD_Channel_IsPlaying(currentChannel, &isPlaying);
-            if (!isPlaying) {
+            if (!isPlaying && nextChannel) {
+                // The mixer already started the preloaded song on the sample the old one ended
+                releaseSound(currentSound, currentCached);
+                currentSound = nextSound;
+                currentCached = std::move(nextCached);
+                currentChannel = nextChannel;
+                nextSound = nullptr;
+                nextChannel = nullptr;
+                songFinished = true;
+                advancedToNext = true;
+                std::cout << "Song finished naturally" << std::endl;
+            } else if (!isPlaying || (previewEndMs > 0 && getCurrentPlaybackPosition() >= getLength())) {
+                // FMOD plays a clip on to the end of its song, it stops here
+                if (isPlaying) {
+                    FMOD_Channel_Stop(currentChannel);
+                }
                 state = PlaybackState::STOPPED;
                 songFinished = true;
                 currentChannel = nullptr;
                 std::cout << "Song finished naturally" << std::endl;
+            } else if (nextSound && !nextChannel) {
+                scheduleNext();
             }
         }
     }
 #else
-    // Simulate song finishing based on our timer
-    if (state == PlaybackState::PLAYING && songLengthMs > 0) {
-        unsigned int currentPos = getCurrentPlaybackPosition();
-        
-        // Add 1 second buffer as requested
-        if (currentPos >= songLengthMs + 1000) {
-            state = PlaybackState::STOPPED;
-            songFinished = true;
-            std::cout << "Simulated song finished naturally" << std::endl;
+    if (events.take() & AudioEvents::AUDIO_ERROR) {
+        std::cout << "Audio output stopped accepting data!" << std::endl;
+    }
+    
+    // The render thread flags a gapless switch, or the end of the source once its last block went out
+    if (state == PlaybackState::PLAYING && engine.takeTrackChange()) {
+        songFinished = true;
+        advancedToNext = true;
+        std::cout << "Song finished naturally" << std::endl;
+    } else if (state == PlaybackState::PLAYING && engine.hasFinished()) {
+        state = PlaybackState::STOPPED;
+        songFinished = true;
+        std::cout << "Song finished naturally" << std::endl;
+    }
+#endif
+}
+
+void AudioPlayer::waitForActivity(int timeoutMs) {
+#ifdef FMOD_AVAILABLE
+    // FMOD only runs channel callbacks from System_Update, so while a song plays
+    // come back around when it is due to end or to reach the milestone
+    if (state == PlaybackState::PLAYING) {
+        unsigned int position = getPosition();
+        unsigned int length = getLength();
+        unsigned int due = length > position ? length - position : 0;
+        if (milestoneMs > position) {
+            due = (std::min)(due, milestoneMs - position);
+        }
+        due = static_cast<unsigned int>(due / rate);
+        int limit = static_cast<int>((std::min)(due + 20, 1000u));
+        if (timeoutMs < 0 || timeoutMs > limit) {
+            timeoutMs = limit;
         }
     }
+#else
+    // The end of the source is reported as soon as its last block went out,
+    // the song only counts as finished once the device played that too
+    unsigned int drainMs = engine.getDrainMs();
+    if (drainMs > 0 && (timeoutMs < 0 || timeoutMs > static_cast<int>(drainMs))) {
+        timeoutMs = static_cast<int>(drainMs);
+    }
+#endif
+    events.wait(timeoutMs);
+}
+
+void AudioPlayer::setMilestone(unsigned int positionMs) {
+    if (positionMs == milestoneMs) {
+        return;
+    }
+    milestoneMs = positionMs;
+#ifndef FMOD_AVAILABLE
+    if (positionMs == 0) {
+        engine.clearMilestone();
+    } else {
+        engine.setMilestone(positionMs);
+    }
 #endif
 }
 
@@ -320,9 +847,270 @@ bool AudioPlayer::initializeFMOD() {
         return false;
     }
     
+    // Streams read through a fixed 64 KB file buffer each
+    FMOD_System_SetStreamBufferSize(fmodSystem, 64 * 1024, FMOD_TIMEUNIT_RAWBYTES);
+    
+    // Everything the mixer produced sits in its ring of DSP buffers before it is heard
+    unsigned int bufferLength = 0;
+    int bufferCount = 0;
+    int outputRate = 0;
+    FMOD_System_GetDSPBufferSize(fmodSystem, &bufferLength, &bufferCount);
+    FMOD_System_GetSoftwareFormat(fmodSystem, &outputRate, 0, 0);
+    if (outputRate > 0) {
+        outputLatencyMs = static_cast<unsigned int>(static_cast<uint64_t>(bufferLength) * bufferCount * 1000 / outputRate);
+    }
+    
+    // Stays bypassed unless a rate is set that should keep the pitch
+    FMOD_CHANNELGROUP* master = nullptr;
+    if (FMOD_System_CreateDSPByType(fmodSystem, FMOD_DSP_TYPE_PITCHSHIFT, &pitchShift) == FMOD_OK &&
+        FMOD_System_GetMasterChannelGroup(fmodSystem, &master) == FMOD_OK) {
+        FMOD_DSP_SetBypass(pitchShift, 1);
+        FMOD_ChannelGroup_AddDSP(master, 0, pitchShift);
+    }
+    for (FMOD_DSP*& unit : equalizerUnits) {
+        if (master && FMOD_System_CreateDSPByType(fmodSystem, FMOD_DSP_TYPE_MULTIBAND_EQ, &unit) == FMOD_OK) {
+            FMOD_ChannelGroup_AddDSP(master, 0, unit);
+        }
+    }
+    applyEqualizer();
+    
+    // Added last at the head, so it gets what goes to the output
+    FMOD_DSP_DESCRIPTION tapDescription;
+    std::memset(&tapDescription, 0, sizeof(tapDescription));
+    std::strncpy(tapDescription.name, "Stardust tap", sizeof(tapDescription.name) - 1);
+    tapDescription.pluginsdkversion = FMOD_PLUGIN_SDK_VERSION;
+    tapDescription.numinputbuffers = 1;
+    tapDescription.numoutputbuffers = 1;
+    tapDescription.read = tapRead;
+    tapDescription.userdata = &analysisTap;
+    if (master && FMOD_System_CreateDSP(fmodSystem, &tapDescription, &tapUnit) == FMOD_OK) {
+        FMOD_ChannelGroup_AddDSP(master, 0, tapUnit);
+    }
+    if (outputRate > 0) {
+        analysisTap.setSampleRate(static_cast<unsigned int>(outputRate));
+        analysisTap.setDelay(static_cast<size_t>(bufferLength) * bufferCount);
+    }
+    
     std::cout << "FMOD initialized successfully!" << std::endl;
     return true;
 }
+
+void AudioPlayer::scheduleNext() {
+    if (!nextSound || nextChannel || !currentChannel || state != PlaybackState::PLAYING) {
+        return;
+    }
+    
+    // Convert what is left of the current song into output samples and start the
+    // next one on exactly that DSP clock, or a crossfade length before it
+    unsigned int positionPcm = 0;
+    unsigned int lengthPcm = 0;
+    float soundRate = 0.0f;
+    int outputRate = 0;
+    FMOD_UINT64 parentClock = 0;
+    FMOD_Channel_GetPosition(currentChannel, &positionPcm, FMOD_TIMEUNIT_PCM);
+    FMOD_Sound_GetLength(currentSound, &lengthPcm, FMOD_TIMEUNIT_PCM);
+    FMOD_Sound_GetDefaults(currentSound, &soundRate, 0);
+    FMOD_System_GetSoftwareFormat(fmodSystem, &outputRate, 0, 0);
+    FMOD_Channel_GetDSPClock(currentChannel, 0, &parentClock);
+    if (soundRate <= 0.0f || outputRate <= 0 || lengthPcm <= positionPcm) {
+        return;
+    }
+    
+    FMOD_UINT64 remaining = static_cast<FMOD_UINT64>((lengthPcm - positionPcm) * static_cast<double>(outputRate) / (soundRate * rate));
+    FMOD_UINT64 fadeClocks = (std::min)(static_cast<FMOD_UINT64>(crossfadeMs) * outputRate / 1000, remaining);
+    FMOD_UINT64 startClock = parentClock + remaining - fadeClocks;
+    if (FMOD_System_PlaySound(fmodSystem, nextSound, 0, 1, &nextChannel) != FMOD_OK) {
+        nextChannel = nullptr;
+        return;
+    }
+    FMOD_Channel_SetDelay(nextChannel, startClock, 0, 0);
+    FMOD_Channel_SetVolume(nextChannel, volume * nextGain);
+    applyRate(nextChannel, nextSound);
+    watchChannel(nextChannel);
+    
+    if (fadeClocks > 0) {
+        // Fade points are joined linearly, so the equal-power curve goes down as short segments
+        const int segments = fadeCurve == FadeCurve::LINEAR ? 1 : 16;
+        for (int i = 0; i <= segments; ++i) {
+            float t = static_cast<float>(i) / segments;
+            FMOD_UINT64 clock = startClock + fadeClocks * i / segments;
+            FMOD_Channel_AddFadePoint(nextChannel, clock, Crossfade::gainAt(fadeCurve, t, true));
+            FMOD_Channel_AddFadePoint(currentChannel, clock, Crossfade::gainAt(fadeCurve, t, false));
+        }
+    }
+    FMOD_Channel_SetPaused(nextChannel, 0);
+}
+
+bool AudioPlayer::openSound(const std::string& path, FMOD_SOUND*& sound, std::shared_ptr<CachedTrack>& cached) {
+    // A sample can play on several channels at once, so replays and loops share it
+    cached = TrackCache::getInstance().find(path);
+    FmodSample* sample = dynamic_cast<FmodSample*>(cached.get());
+    if (sample) {
+        sound = sample->sound;
+        return true;
+    }
+    cached.reset();
+    
+    // Stream the file instead of decoding it all up front, so memory and load time
+    // stay the same for a 2 minute GD song and a 10 minute marathon map
+    FMOD_RESULT result = FMOD_System_CreateSound(fmodSystem, path.c_str(), FMOD_DEFAULT | FMOD_CREATESTREAM, 0, &sound);
+    if (result != FMOD_OK) {
+        sound = nullptr;
+        return false;
+    }
+    cacheInBackground(path, sound);
+    return true;
+}
+
+void AudioPlayer::releaseSound(FMOD_SOUND*& sound, std::shared_ptr<CachedTrack>& cached) {
+    if (cached) {
+        cached.reset();
+    } else if (sound) {
+        FMOD_Sound_Release(sound);
+    }
+    sound = nullptr;
+}
+
+void AudioPlayer::cacheInBackground(const std::string& path, FMOD_SOUND* stream) {
+    if (pendingSample) {
+        return; // One file at a time, the stream keeps playing meanwhile
+    }
+    
+    unsigned int lengthPcm = 0;
+    int channels = 0;
+    FMOD_Sound_GetLength(stream, &lengthPcm, FMOD_TIMEUNIT_PCM);
+    FMOD_Sound_GetFormat(stream, 0, 0, &channels, 0);
+    size_t bytes = static_cast<size_t>(lengthPcm) * channels * sizeof(int16_t);
+    if (!TrackCache::getInstance().fits(bytes)) {
+        return;
+    }
+    
+    // FMOD decodes the sample on its own loader thread, update() picks it up when ready
+    if (FMOD_System_CreateSound(fmodSystem, path.c_str(), FMOD_DEFAULT | FMOD_CREATESAMPLE | FMOD_NONBLOCKING, 0, &pendingSample) != FMOD_OK) {
+        pendingSample = nullptr;
+        return;
+    }
+    pendingSamplePath = path;
+    pendingSampleBytes = bytes;
+}
+
+void AudioPlayer::updatePendingSample() {
+    if (!pendingSample) {
+        return;
+    }
+    
+    FMOD_OPENSTATE openState = FMOD_OPENSTATE_READY;
+    FMOD_Sound_GetOpenState(pendingSample, &openState, 0, 0, 0);
+    if (openState == FMOD_OPENSTATE_READY) {
+        TrackCache::getInstance().store(pendingSamplePath, std::make_shared<FmodSample>(pendingSample, pendingSampleBytes));
+    } else if (openState == FMOD_OPENSTATE_ERROR) {
+        FMOD_Sound_Release(pendingSample);
+    } else {
+        return;
+    }
+    pendingSample = nullptr;
+}
+
+void AudioPlayer::updatePrefetch() {
+    if (!prefetchSound || prefetchChannel) {
+        return;
+    }
+    
+    FMOD_OPENSTATE openState = FMOD_OPENSTATE_READY;
+    FMOD_Sound_GetOpenState(prefetchSound, &openState, 0, 0, 0);
+    if (openState == FMOD_OPENSTATE_ERROR) {
+        releasePrefetch();
+        return;
+    } else if (openState != FMOD_OPENSTATE_READY) {
+        return;
+    }
+    
+    // Seeking a paused channel has the stream refill its buffer from the clip
+    // start in the background, while the current clip plays on
+    unsigned int length = 0;
+    FMOD_Sound_GetLength(prefetchSound, &length, FMOD_TIMEUNIT_MS);
+    prefetchStartMs = PreviewClip::findStartMs(prefetchPath, length, prefetchClipMs, prefetchFromBeatmap);
+    if (FMOD_System_PlaySound(fmodSystem, prefetchSound, 0, 1, &prefetchChannel) != FMOD_OK) {
+        releasePrefetch();
+        return;
+    }
+    FMOD_Channel_SetPosition(prefetchChannel, prefetchStartMs, FMOD_TIMEUNIT_MS);
+}
+
+void AudioPlayer::releasePrefetch() {
+    if (prefetchSound) {
+        // Also stops its channel
+        FMOD_Sound_Release(prefetchSound);
+        prefetchSound = nullptr;
+    }
+    prefetchChannel = nullptr;
+    prefetchPath.clear();
+}
+
+void AudioPlayer::unscheduleNext() {
+    if (nextChannel) {
+        FMOD_Channel_Stop(nextChannel);
+        nextChannel = nullptr;
+        if (currentChannel) {
+            FMOD_Channel_RemoveFadePoints(currentChannel, 0, ~FMOD_UINT64(0));
+        }
+    }
+}
+
+void AudioPlayer::watchChannel(FMOD_CHANNEL* channel) {
+    FMOD_Channel_SetUserData(channel, &events);
+    FMOD_Channel_SetCallback(channel, channelCallback);
+}
+
+void AudioPlayer::applyRate(FMOD_CHANNEL* channel, FMOD_SOUND* sound) {
+    float soundRate = 0.0f;
+    FMOD_Sound_GetDefaults(sound, &soundRate, 0);
+    if (soundRate > 0.0f) {
+        FMOD_Channel_SetFrequency(channel, static_cast<float>(soundRate * rate));
+    }
+}
+
+void AudioPlayer::applyEqualizer() {
+    // Each unit holds bands A to E, four parameters apart
+    const int bandsPerUnit = 5;
+    for (int u = 0; u < 2; ++u) {
+        FMOD_DSP* unit = equalizerUnits[u];
+        if (!unit) {
+            continue;
+        }
+        bool used = false;
+        for (int k = 0; k < bandsPerUnit; ++k) {
+            size_t index = static_cast<size_t>(u * bandsPerUnit + k);
+            int filter = FMOD_DSP_MULTIBAND_EQ_FILTER_DISABLED;
+            if (index < eqBands.size()) {
+                const EqBand& band = eqBands[index];
+                switch (band.type) {
+                case EqFilter::PEAK:
+                    filter = FMOD_DSP_MULTIBAND_EQ_FILTER_PEAKING;
+                    break;
+                case EqFilter::LOW_SHELF:
+                    filter = FMOD_DSP_MULTIBAND_EQ_FILTER_LOWSHELF;
+                    break;
+                case EqFilter::HIGH_SHELF:
+                    filter = FMOD_DSP_MULTIBAND_EQ_FILTER_HIGHSHELF;
+                    break;
+                case EqFilter::LOW_PASS:
+                    filter = FMOD_DSP_MULTIBAND_EQ_FILTER_LOWPASS_12DB;
+                    break;
+                case EqFilter::HIGH_PASS:
+                    filter = FMOD_DSP_MULTIBAND_EQ_FILTER_HIGHPASS_12DB;
+                    break;
+                }
+                FMOD_DSP_SetParameterFloat(unit, FMOD_DSP_MULTIBAND_EQ_A_FREQUENCY + k * 4, band.frequency);
+                FMOD_DSP_SetParameterFloat(unit, FMOD_DSP_MULTIBAND_EQ_A_Q + k * 4, band.q);
+                FMOD_DSP_SetParameterFloat(unit, FMOD_DSP_MULTIBAND_EQ_A_GAIN + k * 4, band.gainDb);
+                used = true;
+            }
+            FMOD_DSP_SetParameterInt(unit, FMOD_DSP_MULTIBAND_EQ_A_FILTER + k * 4, filter);
+        }
+        FMOD_DSP_SetBypass(unit, used ? 0 : 1);
+    }
+}
 #else
 bool AudioPlayer::initializeFMOD() {
     return true;
@@ -0,0 +1,299 @@
+#include "../headers/audioSink.hpp"
+#include <thread>
+#include <iostream>
+#include <cstring>
+#include <algorithm>
+
+#ifdef ALSA_AVAILABLE
+#include <alsa/asoundlib.h>
+#endif
+
+namespace {
+    void writeLE16(std::ofstream& out, uint16_t value) {
+        unsigned char bytes[2] = { static_cast<unsigned char>(value), static_cast<unsigned char>(value >> 8) };
+        out.write(reinterpret_cast<const char*>(bytes), 2);
+    }
+
+    void writeLE32(std::ofstream& out, uint32_t value) {
+        unsigned char bytes[4] = { static_cast<unsigned char>(value), static_cast<unsigned char>(value >> 8),
+                                   static_cast<unsigned char>(value >> 16), static_cast<unsigned char>(value >> 24) };
+        out.write(reinterpret_cast<const char*>(bytes), 4);
+    }
+}
+
+std::unique_ptr<AudioSink> AudioSink::create(const std::string& kind, const std::string& path) {
+    if (kind == "null") {
+        return std::unique_ptr<AudioSink>(new NullSink(true));
+    }
+    if (kind == "fast") {
+        return std::unique_ptr<AudioSink>(new NullSink(false));
+    }
+    if (kind == "wav" && !path.empty()) {
+        return std::unique_ptr<AudioSink>(new WavFileSink(path));
+    }
+#ifdef ALSA_AVAILABLE
+    if (kind == "alsa") {
+        return std::unique_ptr<AudioSink>(new AlsaSink());
+    }
+#endif
+    return nullptr;
+}
+
+std::string AudioSink::defaultKind() {
+#ifdef ALSA_AVAILABLE
+    return "alsa";
+#else
+    return "null";
+#endif
+}
+
+// NullSink
+
+NullSink::NullSink(bool isRealtime) : realtime(isRealtime), framesWritten(0) {}
+
+bool NullSink::open(const AudioFormat& newFormat) {
+    format = newFormat;
+    framesWritten = 0;
+    startTime = std::chrono::steady_clock::now();
+    return true;
+}
+
+bool NullSink::write(const float*, size_t frameCount) {
+    if (!realtime || format.sampleRate == 0) {
+        return true;
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    auto due = startTime + std::chrono::microseconds(framesWritten * 1000000 / format.sampleRate);
+
+    // More than a quarter second behind means we were paused or starved, restart the clock
+    if (now - due > std::chrono::milliseconds(250)) {
+        startTime = now;
+        framesWritten = 0;
+        due = now;
+    }
+
+    framesWritten += frameCount;
+    std::this_thread::sleep_until(due);
+    return true;
+}
+
+void NullSink::close() {
+    framesWritten = 0;
+}
+
+unsigned int NullSink::getLatencyFrames() const {
+    if (!realtime || format.sampleRate == 0) {
+        return 0;
+    }
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTime);
+    uint64_t played = elapsed.count() > 0 ? static_cast<uint64_t>(elapsed.count()) * format.sampleRate / 1000000 : 0;
+    return played >= framesWritten ? 0 : static_cast<unsigned int>(framesWritten - played);
+}
+
+std::string NullSink::getName() const {
+    return realtime ? "null" : "fast";
+}
+
+// WavFileSink
+
+WavFileSink::WavFileSink(const std::string& outputPath, size_t dataAlignment)
+    : path(outputPath), inputChannels(0), dataBytes(0), junkBytes(0) {
+    // 58 header bytes and the JUNK chunk's own 8; chunk bodies have an even length
+    const size_t headerBytes = 58 + 8;
+    if (dataAlignment > 1 && dataAlignment % 2 == 0) {
+        junkBytes = static_cast<uint32_t>((dataAlignment - headerBytes % dataAlignment) % dataAlignment);
+    }
+}
+
+WavFileSink::~WavFileSink() {
+    finish();
+}
+
+bool WavFileSink::open(const AudioFormat& newFormat) {
+    if (file.is_open()) {
+        if (newFormat.sampleRate != format.sampleRate) {
+            std::cout << "The capture in " << path << " is at " << format.sampleRate << " Hz, can't add "
+                      << newFormat.sampleRate << " Hz audio to it" << std::endl;
+            return false;
+        }
+        inputChannels = newFormat.channels;
+        return newFormat.channels > 0;
+    }
+
+    format = newFormat;
+    inputChannels = newFormat.channels;
+    dataBytes = 0;
+    file.open(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        std::cout << "Could not open " << path << " for writing" << std::endl;
+        return false;
+    }
+    writeHeader();
+    return static_cast<bool>(file);
+}
+
+bool WavFileSink::write(const float* buffer, size_t frameCount) {
+    if (!file.is_open()) {
+        return false;
+    }
+    if (inputChannels != format.channels) {
+        // Mono goes to every channel, more channels than the file has fold down
+        // to mono or drop the extra ones
+        mixed.resize(frameCount * format.channels);
+        for (size_t i = 0; i < frameCount; ++i) {
+            const float* in = buffer + i * inputChannels;
+            float* out = mixed.data() + i * format.channels;
+            if (format.channels == 1) {
+                float sum = 0.0f;
+                for (unsigned int c = 0; c < inputChannels; ++c) {
+                    sum += in[c];
+                }
+                out[0] = sum / inputChannels;
+            } else {
+                for (unsigned int c = 0; c < format.channels; ++c) {
+                    out[c] = c < inputChannels ? in[c] : in[inputChannels == 1 ? 0 : c % inputChannels];
+                }
+            }
+        }
+        buffer = mixed.data();
+    }
+    size_t bytes = frameCount * format.channels * sizeof(float);
+    file.write(reinterpret_cast<const char*>(buffer), static_cast<std::streamsize>(bytes));
+    dataBytes += bytes;
+    return static_cast<bool>(file);
+}
+
+void WavFileSink::close() {
+    // Kept open across tracks, the file is finalized by finish() or on destruction
+    file.flush();
+}
+
+std::string WavFileSink::getName() const {
+    return "wav (" + path + ")";
+}
+
+unsigned int WavFileSink::getRequiredRate() const {
+    return file.is_open() ? format.sampleRate : 0;
+}
+
+void WavFileSink::finish() {
+    if (!file.is_open()) {
+        return;
+    }
+    file.seekp(0);
+    writeHeader();
+    file.close();
+}
+
+void WavFileSink::writeHeader() {
+    // WAVE_FORMAT_IEEE_FLOAT with a fact chunk, as the spec asks for non-PCM data
+    uint32_t padding = junkBytes > 0 ? 8 + junkBytes : 0;
+    uint32_t dataSize = static_cast<uint32_t>((std::min)(dataBytes, uint64_t(0xFFFFFFFF - 50 - padding)));
+    uint16_t blockAlign = static_cast<uint16_t>(format.channels * sizeof(float));
+
+    file.write("RIFF", 4);
+    writeLE32(file, 50 + padding + dataSize);
+    file.write("WAVE", 4);
+
+    file.write("fmt ", 4);
+    writeLE32(file, 18);
+    writeLE16(file, 0x0003);
+    writeLE16(file, static_cast<uint16_t>(format.channels));
+    writeLE32(file, format.sampleRate);
+    writeLE32(file, format.sampleRate * blockAlign);
+    writeLE16(file, blockAlign);
+    writeLE16(file, 32);
+    writeLE16(file, 0);
+
+    file.write("fact", 4);
+    writeLE32(file, 4);
+    writeLE32(file, blockAlign > 0 ? dataSize / blockAlign : 0);
+
+    if (junkBytes > 0) {
+        file.write("JUNK", 4);
+        writeLE32(file, junkBytes);
+        const std::string zeros(junkBytes, '\0');
+        file.write(zeros.data(), static_cast<std::streamsize>(zeros.size()));
+    }
+
+    file.write("data", 4);
+    writeLE32(file, dataSize);
+}
+
+// AlsaSink
+
+#ifdef ALSA_AVAILABLE
+AlsaSink::AlsaSink() : pcm(nullptr) {}
+
+AlsaSink::~AlsaSink() {
+    close();
+}
+
+bool AlsaSink::open(const AudioFormat& newFormat) {
+    if (pcm && newFormat == format) {
+        return true;
+    }
+    close();
+
+    if (snd_pcm_open(&pcm, "default", SND_PCM_STREAM_PLAYBACK, 0) < 0) {
+        std::cout << "Failed to open ALSA device!" << std::endl;
+        pcm = nullptr;
+        return false;
+    }
+
+    // 100 ms of device buffer, resampled by ALSA if the hardware rate differs
+    int result = snd_pcm_set_params(pcm, SND_PCM_FORMAT_FLOAT_LE, SND_PCM_ACCESS_RW_INTERLEAVED,
+                                    newFormat.channels, newFormat.sampleRate, 1, 100000);
+    if (result < 0) {
+        std::cout << "Failed to configure ALSA device: " << snd_strerror(result) << std::endl;
+        snd_pcm_close(pcm);
+        pcm = nullptr;
+        return false;
+    }
+
+    format = newFormat;
+    return true;
+}
+
+bool AlsaSink::write(const float* buffer, size_t frameCount) {
+    if (!pcm) {
+        return false;
+    }
+
+    while (frameCount > 0) {
+        snd_pcm_sframes_t written = snd_pcm_writei(pcm, buffer, frameCount);
+        if (written < 0) {
+            // Underruns and suspends are recoverable, anything else drops the device
+            if (snd_pcm_recover(pcm, static_cast<int>(written), 1) < 0) {
+                return false;
+            }
+            continue;
+        }
+        buffer += written * format.channels;
+        frameCount -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+void AlsaSink::close() {
+    if (pcm) {
+        snd_pcm_drop(pcm);
+        snd_pcm_close(pcm);
+        pcm = nullptr;
+    }
+}
+
+unsigned int AlsaSink::getLatencyFrames() const {
+    snd_pcm_sframes_t delay = 0;
+    if (!pcm || snd_pcm_delay(pcm, &delay) < 0 || delay < 0) {
+        return 0;
+    }
+    return static_cast<unsigned int>(delay);
+}
+
+std::string AlsaSink::getName() const {
+    return "alsa";
+}
+#endif
\ No newline at end of file
@@ -0,0 +1,117 @@
+#include "../headers/duplicateIndex.hpp"
+#include "../headers/fingerprint.hpp"
+#include <algorithm>
+#include <map>
+
+void DuplicateIndex::clear() {
+    ids.clear();
+    fingerprints.clear();
+    postings.clear();
+}
+
+void DuplicateIndex::add(int songId, const std::vector<uint32_t>& codes) {
+    if (codes.empty()) {
+        return;
+    }
+    uint32_t track = static_cast<uint32_t>(ids.size());
+    ids.push_back(songId);
+    fingerprints.push_back(codes);
+
+    // Half the codes are plenty, a lookup tries all of its own against them
+    for (size_t i = 0; i < codes.size(); i += 2) {
+        if (codes[i] != 0 && codes[i] != 0xFFFFFFFFu) {
+            postings[codes[i]].push_back({ track, static_cast<uint32_t>(i) });
+        }
+    }
+}
+
+size_t DuplicateIndex::size() const {
+    return ids.size();
+}
+
+std::vector<int> DuplicateIndex::findMatches(const std::vector<uint32_t>& codes, int excludeId) const {
+    size_t exclude = ids.size();
+    for (size_t t = 0; t < ids.size(); ++t) {
+        if (ids[t] == excludeId) {
+            exclude = t;
+        }
+    }
+
+    std::vector<int> matches;
+    for (size_t track : matchTracks(codes, exclude)) {
+        matches.push_back(ids[track]);
+    }
+    std::sort(matches.begin(), matches.end());
+    return matches;
+}
+
+std::vector<std::vector<int>> DuplicateIndex::findClusters() const {
+    // Union-find over the matches of every song
+    std::vector<size_t> parent(ids.size());
+    for (size_t t = 0; t < parent.size(); ++t) {
+        parent[t] = t;
+    }
+    auto root = [&parent](size_t t) {
+        while (parent[t] != t) {
+            parent[t] = parent[parent[t]];
+            t = parent[t];
+        }
+        return t;
+    };
+
+    for (size_t t = 0; t < ids.size(); ++t) {
+        for (size_t match : matchTracks(fingerprints[t], t)) {
+            size_t a = root(t);
+            size_t b = root(match);
+            if (a != b) {
+                parent[(std::max)(a, b)] = (std::min)(a, b);
+            }
+        }
+    }
+
+    std::map<size_t, std::vector<int>> groups;
+    for (size_t t = 0; t < ids.size(); ++t) {
+        groups[root(t)].push_back(ids[t]);
+    }
+    std::vector<std::vector<int>> clusters;
+    for (auto& group : groups) {
+        if (group.second.size() > 1) {
+            std::sort(group.second.begin(), group.second.end());
+            clusters.push_back(group.second);
+        }
+    }
+    std::sort(clusters.begin(), clusters.end());
+    return clusters;
+}
+
+std::vector<size_t> DuplicateIndex::matchTracks(const std::vector<uint32_t>& codes, size_t excludeTrack) const {
+    // Votes per track and offset, the offset is where the query starts in the other
+    std::unordered_map<uint64_t, int> votes;
+    for (size_t i = 0; i < codes.size(); ++i) {
+        auto it = postings.find(codes[i]);
+        if (it == postings.end() || it->second.size() > MAX_POSTINGS) {
+            continue;
+        }
+        for (const Posting& posting : it->second) {
+            if (posting.track == excludeTrack) {
+                continue;
+            }
+            int64_t offset = static_cast<int64_t>(posting.frame) - static_cast<int64_t>(i);
+            votes[(static_cast<uint64_t>(posting.track) << 32) | static_cast<uint32_t>(offset)]++;
+        }
+    }
+
+    std::vector<size_t> matches;
+    for (const auto& vote : votes) {
+        if (vote.second < MIN_VOTES) {
+            continue;
+        }
+        size_t track = static_cast<size_t>(vote.first >> 32);
+        int offset = static_cast<int32_t>(static_cast<uint32_t>(vote.first));
+        if (std::find(matches.begin(), matches.end(), track) == matches.end() &&
+            Fingerprinter::bitErrorRate(codes, fingerprints[track], offset) <= MAX_BIT_ERROR_RATE) {
+            matches.push_back(track);
+        }
+    }
+    return matches;
+}
\ No newline at end of file
@@ -0,0 +1,329 @@
+#include "../headers/equalizer.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <sstream>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#include <emmintrin.h>
+#define EQUALIZER_SSE2
+#endif
+
+namespace {
+    const double PI = 3.14159265358979323846;
+    // Keeps the filter state out of denormals while the input is silent
+    const float ANTI_DENORMAL = 1e-20f;
+}
+
+Equalizer::Equalizer()
+    : middle(0), back(1), front(2), rampStep(0), rampSteps(0), activeBands(0), lastChannels(0), costNanos(0), costUnits(0) {
+    for (Coefficients& slot : slots) {
+        setIdentity(slot);
+    }
+    setIdentity(current);
+    rampFrom = current;
+    target = current;
+    resetState();
+}
+
+void Equalizer::setBands(const std::vector<EqBand>& bands, unsigned int sampleRate) {
+    if (sampleRate == 0) {
+        return;
+    }
+    slots[back] = design(bands, sampleRate);
+    back = middle.exchange(back | FRESH, std::memory_order_acq_rel) & 3;
+}
+
+void Equalizer::process(float* samples, size_t frames, unsigned int channels) {
+    takeUpdate();
+    if (channels != lastChannels) {
+        resetState();
+        lastChannels = channels;
+    }
+    if (activeBands == 0 || channels == 0 || channels > MAX_CHANNELS) {
+        return;
+    }
+
+    auto started = std::chrono::steady_clock::now();
+    size_t units = frames * channels * activeBands;
+    for (size_t done = 0; done < frames; done += STEP_FRAMES) {
+        if (rampStep < rampSteps) {
+            glide();
+        }
+        filter(samples + done * channels, (std::min)(STEP_FRAMES, frames - done), channels);
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - started);
+    costNanos.fetch_add(static_cast<uint64_t>(elapsed.count()), std::memory_order_relaxed);
+    costUnits.fetch_add(units, std::memory_order_relaxed);
+}
+
+double Equalizer::getCostNanos() const {
+    uint64_t units = costUnits.load(std::memory_order_relaxed);
+    return units == 0 ? 0.0 : static_cast<double>(costNanos.load(std::memory_order_relaxed)) / units;
+}
+
+std::string Equalizer::filterName(EqFilter type) {
+    switch (type) {
+    case EqFilter::LOW_SHELF:
+        return "lowshelf";
+    case EqFilter::HIGH_SHELF:
+        return "highshelf";
+    case EqFilter::LOW_PASS:
+        return "lowpass";
+    case EqFilter::HIGH_PASS:
+        return "highpass";
+    case EqFilter::PEAK:
+        break;
+    }
+    return "peak";
+}
+
+bool Equalizer::parseFilter(const std::string& text, EqFilter& type) {
+    const EqFilter all[] = { EqFilter::PEAK, EqFilter::LOW_SHELF, EqFilter::HIGH_SHELF, EqFilter::LOW_PASS, EqFilter::HIGH_PASS };
+    for (EqFilter filter : all) {
+        if (text == filterName(filter)) {
+            type = filter;
+            return true;
+        }
+    }
+    return false;
+}
+
+std::string Equalizer::formatBands(const std::vector<EqBand>& bands) {
+    std::ostringstream text;
+    for (size_t i = 0; i < bands.size(); ++i) {
+        if (i > 0) {
+            text << ",";
+        }
+        text << filterName(bands[i].type) << ":" << bands[i].frequency << ":" << bands[i].gainDb << ":" << bands[i].q;
+    }
+    return text.str();
+}
+
+bool Equalizer::parseBands(const std::string& text, std::vector<EqBand>& bands) {
+    std::vector<EqBand> parsed;
+    std::istringstream list(text);
+    std::string item;
+    while (std::getline(list, item, ',')) {
+        if (item.empty()) {
+            continue;
+        }
+        std::istringstream fields(item);
+        std::string name, frequency, gain, q;
+        if (!std::getline(fields, name, ':') || !std::getline(fields, frequency, ':') || !std::getline(fields, gain, ':') ||
+            !std::getline(fields, q)) {
+            return false;
+        }
+        EqBand band;
+        if (!parseFilter(name, band.type)) {
+            return false;
+        }
+        try {
+            band.frequency = std::stof(frequency);
+            band.gainDb = std::stof(gain);
+            band.q = std::stof(q);
+        } catch (...) {
+            return false;
+        }
+        if (parsed.size() < MAX_BANDS) {
+            parsed.push_back(band);
+        }
+    }
+    bands.swap(parsed);
+    return true;
+}
+
+Equalizer::Coefficients Equalizer::design(const std::vector<EqBand>& bands, unsigned int sampleRate) {
+    Coefficients c;
+    setIdentity(c);
+    c.bands = (std::min)(bands.size(), MAX_BANDS);
+
+    double boost = 0.0;
+    for (size_t i = 0; i < c.bands; ++i) {
+        const EqBand& band = bands[i];
+        double frequency = (std::max)(10.0, (std::min)(static_cast<double>(band.frequency), 0.45 * sampleRate));
+        double q = (std::max)(0.1, (std::min)(static_cast<double>(band.q), 18.0));
+        double gain = (std::max)(-24.0, (std::min)(static_cast<double>(band.gainDb), 24.0));
+
+        double w0 = 2.0 * PI * frequency / sampleRate;
+        double cosW = std::cos(w0);
+        double alpha = std::sin(w0) / (2.0 * q);
+        double a = std::pow(10.0, gain / 40.0);
+        double shelf = 2.0 * std::sqrt(a) * alpha;
+
+        double b0 = 1.0, b1 = 0.0, b2 = 0.0, a0 = 1.0, a1 = 0.0, a2 = 0.0;
+        switch (band.type) {
+        case EqFilter::PEAK:
+            b0 = 1.0 + alpha * a;
+            b1 = -2.0 * cosW;
+            b2 = 1.0 - alpha * a;
+            a0 = 1.0 + alpha / a;
+            a1 = -2.0 * cosW;
+            a2 = 1.0 - alpha / a;
+            boost = (std::max)(boost, gain);
+            break;
+        case EqFilter::LOW_SHELF:
+            b0 = a * ((a + 1.0) - (a - 1.0) * cosW + shelf);
+            b1 = 2.0 * a * ((a - 1.0) - (a + 1.0) * cosW);
+            b2 = a * ((a + 1.0) - (a - 1.0) * cosW - shelf);
+            a0 = (a + 1.0) + (a - 1.0) * cosW + shelf;
+            a1 = -2.0 * ((a - 1.0) + (a + 1.0) * cosW);
+            a2 = (a + 1.0) + (a - 1.0) * cosW - shelf;
+            boost = (std::max)(boost, gain);
+            break;
+        case EqFilter::HIGH_SHELF:
+            b0 = a * ((a + 1.0) + (a - 1.0) * cosW + shelf);
+            b1 = -2.0 * a * ((a - 1.0) + (a + 1.0) * cosW);
+            b2 = a * ((a + 1.0) + (a - 1.0) * cosW - shelf);
+            a0 = (a + 1.0) - (a - 1.0) * cosW + shelf;
+            a1 = 2.0 * ((a - 1.0) - (a + 1.0) * cosW);
+            a2 = (a + 1.0) - (a - 1.0) * cosW - shelf;
+            boost = (std::max)(boost, gain);
+            break;
+        case EqFilter::LOW_PASS:
+            b0 = (1.0 - cosW) / 2.0;
+            b1 = 1.0 - cosW;
+            b2 = (1.0 - cosW) / 2.0;
+            a0 = 1.0 + alpha;
+            a1 = -2.0 * cosW;
+            a2 = 1.0 - alpha;
+            break;
+        case EqFilter::HIGH_PASS:
+            b0 = (1.0 + cosW) / 2.0;
+            b1 = -(1.0 + cosW);
+            b2 = (1.0 + cosW) / 2.0;
+            a0 = 1.0 + alpha;
+            a1 = -2.0 * cosW;
+            a2 = 1.0 - alpha;
+            break;
+        }
+
+        c.b0[i] = static_cast<float>(b0 / a0);
+        c.b1[i] = static_cast<float>(b1 / a0);
+        c.b2[i] = static_cast<float>(b2 / a0);
+        c.a1[i] = static_cast<float>(a1 / a0);
+        c.a2[i] = static_cast<float>(a2 / a0);
+    }
+
+    // Headroom for the largest boost goes into the first band
+    if (c.bands > 0 && boost > 0.0) {
+        float level = static_cast<float>(std::pow(10.0, -boost / 20.0));
+        c.b0[0] *= level;
+        c.b1[0] *= level;
+        c.b2[0] *= level;
+    }
+    return c;
+}
+
+void Equalizer::setIdentity(Coefficients& coefficients) {
+    coefficients.bands = 0;
+    for (size_t i = 0; i < MAX_BANDS; ++i) {
+        coefficients.b0[i] = 1.0f;
+        coefficients.b1[i] = 0.0f;
+        coefficients.b2[i] = 0.0f;
+        coefficients.a1[i] = 0.0f;
+        coefficients.a2[i] = 0.0f;
+    }
+}
+
+void Equalizer::takeUpdate() {
+    if ((middle.load(std::memory_order_acquire) & FRESH) == 0) {
+        return;
+    }
+    front = middle.exchange(front, std::memory_order_acq_rel) & 3;
+    target = slots[front];
+
+    // Glide from wherever the last glide got to; bands on either side stay in until it ends
+    rampFrom = current;
+    activeBands = (std::max)(activeBands, target.bands);
+    rampStep = 0;
+    rampSteps = RAMP_FRAMES / STEP_FRAMES;
+}
+
+void Equalizer::glide() {
+    rampStep++;
+    if (rampStep >= rampSteps) {
+        // Bands the glide took out are identity by now, clear them for when they come back
+        for (size_t b = target.bands; b < activeBands; ++b) {
+            std::fill(z1[b], z1[b] + MAX_CHANNELS, 0.0f);
+            std::fill(z2[b], z2[b] + MAX_CHANNELS, 0.0f);
+        }
+        current = target;
+        activeBands = target.bands;
+        return;
+    }
+    float t = static_cast<float>(rampStep) / rampSteps;
+    for (size_t i = 0; i < activeBands; ++i) {
+        current.b0[i] = rampFrom.b0[i] + (target.b0[i] - rampFrom.b0[i]) * t;
+        current.b1[i] = rampFrom.b1[i] + (target.b1[i] - rampFrom.b1[i]) * t;
+        current.b2[i] = rampFrom.b2[i] + (target.b2[i] - rampFrom.b2[i]) * t;
+        current.a1[i] = rampFrom.a1[i] + (target.a1[i] - rampFrom.a1[i]) * t;
+        current.a2[i] = rampFrom.a2[i] + (target.a2[i] - rampFrom.a2[i]) * t;
+    }
+}
+
+void Equalizer::filter(float* samples, size_t frames, unsigned int channels) {
+    size_t bands = activeBands;
+    for (unsigned int group = 0; group < channels; group += 4) {
+        unsigned int lanes = (std::min)(4u, channels - group);
+#ifdef EQUALIZER_SSE2
+        __m128 b0[MAX_BANDS], b1[MAX_BANDS], b2[MAX_BANDS], a1[MAX_BANDS], a2[MAX_BANDS];
+        __m128 s1[MAX_BANDS], s2[MAX_BANDS];
+        for (size_t b = 0; b < bands; ++b) {
+            b0[b] = _mm_set1_ps(current.b0[b]);
+            b1[b] = _mm_set1_ps(current.b1[b]);
+            b2[b] = _mm_set1_ps(current.b2[b]);
+            a1[b] = _mm_set1_ps(current.a1[b]);
+            a2[b] = _mm_set1_ps(current.a2[b]);
+            s1[b] = _mm_loadu_ps(&z1[b][group]);
+            s2[b] = _mm_loadu_ps(&z2[b][group]);
+        }
+        __m128 offset = _mm_set1_ps(ANTI_DENORMAL);
+
+        for (size_t f = 0; f < frames; ++f) {
+            float* frame = samples + f * channels + group;
+            float lane[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+            for (unsigned int l = 0; l < lanes; ++l) {
+                lane[l] = frame[l];
+            }
+            __m128 x = _mm_add_ps(_mm_loadu_ps(lane), offset);
+            for (size_t b = 0; b < bands; ++b) {
+                __m128 y = _mm_add_ps(_mm_mul_ps(b0[b], x), s1[b]);
+                s1[b] = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(b1[b], x), _mm_mul_ps(a1[b], y)), s2[b]);
+                s2[b] = _mm_sub_ps(_mm_mul_ps(b2[b], x), _mm_mul_ps(a2[b], y));
+                x = y;
+            }
+            _mm_storeu_ps(lane, x);
+            for (unsigned int l = 0; l < lanes; ++l) {
+                frame[l] = lane[l];
+            }
+        }
+
+        for (size_t b = 0; b < bands; ++b) {
+            _mm_storeu_ps(&z1[b][group], s1[b]);
+            _mm_storeu_ps(&z2[b][group], s2[b]);
+        }
+#else
+        for (unsigned int l = 0; l < lanes; ++l) {
+            unsigned int channel = group + l;
+            for (size_t f = 0; f < frames; ++f) {
+                float x = samples[f * channels + channel] + ANTI_DENORMAL;
+                for (size_t b = 0; b < bands; ++b) {
+                    float y = current.b0[b] * x + z1[b][channel];
+                    z1[b][channel] = current.b1[b] * x - current.a1[b] * y + z2[b][channel];
+                    z2[b][channel] = current.b2[b] * x - current.a2[b] * y;
+                    x = y;
+                }
+                samples[f * channels + channel] = x;
+            }
+        }
+#endif
+    }
+}
+
+void Equalizer::resetState() {
+    for (size_t b = 0; b < MAX_BANDS; ++b) {
+        std::fill(z1[b], z1[b] + MAX_CHANNELS, 0.0f);
+        std::fill(z2[b], z2[b] + MAX_CHANNELS, 0.0f);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,354 @@
+#include "../headers/featureAnalyzer.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    const double PI = 3.14159265358979323846;
+    // Mean square below this (-70 dBFS) is silence
+    const double SILENCE = 1e-7;
+    // Onset envelope needs this much to say anything about the tempo
+    const double MIN_TEMPO_SECONDS = 8.0;
+    // Tempos the prior leans towards, osu! libraries run fast, and how far it
+    // reaches in octaves
+    const double PREFERRED_BPM = 140.0;
+    const double PRIOR_OCTAVES = 1.5;
+    // Beat strength, relative to the envelope energy, a tempo needs
+    const double MIN_BEAT_STRENGTH = 0.02;
+    // Chroma range, C2 to C7
+    const double CHROMA_LOW_HZ = 65.4;
+    const double CHROMA_HIGH_HZ = 2093.0;
+    const double FLUX_HIGH_HZ = 8000.0;
+    // Mel bands for the MFCCs, and the share of the energy below the rolloff
+    const double MEL_LOW_HZ = 30.0;
+    const double MEL_HIGH_HZ = 8000.0;
+    const double ROLLOFF_SHARE = 0.85;
+    // Keep this much mixed-down input before dropping what was used
+    const size_t COMPACT_FRAMES = 65536;
+
+    // Krumhansl-Kessler probe tone ratings, tonic first
+    const double MAJOR_PROFILE[12] = { 6.35, 2.23, 3.48, 2.33, 4.38, 4.09, 2.52, 5.19, 2.39, 3.66, 2.29, 2.88 };
+    const double MINOR_PROFILE[12] = { 6.33, 2.68, 3.52, 5.38, 2.60, 3.53, 2.54, 4.75, 3.98, 2.69, 3.34, 3.17 };
+
+    std::vector<float> hann(size_t size) {
+        std::vector<float> window(size);
+        for (size_t i = 0; i < size; ++i) {
+            window[i] = static_cast<float>(0.5 - 0.5 * std::cos(2.0 * PI * static_cast<double>(i) / static_cast<double>(size)));
+        }
+        return window;
+    }
+
+    double correlation(const double* a, const double* b) {
+        double meanA = 0.0;
+        double meanB = 0.0;
+        for (int i = 0; i < 12; ++i) {
+            meanA += a[i] / 12.0;
+            meanB += b[i] / 12.0;
+        }
+        double cross = 0.0;
+        double varA = 0.0;
+        double varB = 0.0;
+        for (int i = 0; i < 12; ++i) {
+            cross += (a[i] - meanA) * (b[i] - meanB);
+            varA += (a[i] - meanA) * (a[i] - meanA);
+            varB += (b[i] - meanB) * (b[i] - meanB);
+        }
+        return varA > 0.0 && varB > 0.0 ? cross / std::sqrt(varA * varB) : 0.0;
+    }
+
+    double hzToMel(double hz) {
+        return 2595.0 * std::log10(1.0 + hz / 700.0);
+    }
+
+    double melToHz(double mel) {
+        return 700.0 * (std::pow(10.0, mel / 2595.0) - 1.0);
+    }
+}
+
+FeatureAnalyzer::FeatureAnalyzer(const AudioFormat& audioFormat, bool withTempo)
+    : format(audioFormat), tempo(withTempo), frameLimit(static_cast<size_t>(audioFormat.sampleRate) * MAX_SECONDS), framesIn(0), energy(0.0),
+      onsetPosition(0), chromaPosition(0),
+      onsetSize(audioFormat.sampleRate > 48000 ? 2048 : 1024), onsetFft(onsetSize), fluxBins(0),
+      chromaSize(audioFormat.sampleRate > 48000 ? 16384 : 8192), chromaFft(chromaSize), timbreFrames(0) {
+    onsetWindow = hann(onsetSize);
+    onsetFrame.resize(onsetSize);
+    onsetPower.resize(onsetSize / 2 + 1);
+    lastMagnitudes.assign(onsetSize / 2 + 1, 0.0f);
+    double rate = (std::max)(1u, format.sampleRate);
+    fluxBins = (std::min)(onsetSize / 2, static_cast<size_t>(FLUX_HIGH_HZ * onsetSize / rate));
+
+    chromaWindow = hann(chromaSize);
+    chromaFrame.resize(chromaSize);
+    chromaPower.resize(chromaSize / 2 + 1);
+    pitchClass.assign(chromaSize / 2 + 1, -1);
+    for (size_t k = 1; k < chromaSize / 2; ++k) {
+        double hz = static_cast<double>(k) * rate / static_cast<double>(chromaSize);
+        if (hz >= CHROMA_LOW_HZ && hz <= CHROMA_HIGH_HZ) {
+            int midi = static_cast<int>(std::lround(69.0 + 12.0 * std::log2(hz / 440.0)));
+            pitchClass[k] = midi % 12;
+        }
+    }
+    std::fill(chroma, chroma + 12, 0.0);
+
+    double melHigh = hzToMel((std::min)(MEL_HIGH_HZ, rate * 0.45));
+    double melLow = hzToMel(MEL_LOW_HZ);
+    for (size_t m = 0; m < MEL_BANDS + 2; ++m) {
+        double hz = melToHz(melLow + (melHigh - melLow) * static_cast<double>(m) / (MEL_BANDS + 1));
+        melEdges.push_back(hz * static_cast<double>(chromaSize) / rate);
+    }
+    std::fill(timbreSums, timbreSums + TIMBRE_SIZE, 0.0);
+}
+
+void FeatureAnalyzer::process(const float* frames, size_t frameCount) {
+    if (format.channels == 0 || framesIn >= frameLimit) {
+        return;
+    }
+    frameCount = (std::min)(frameCount, frameLimit - framesIn);
+    framesIn += frameCount;
+
+    float scale = 1.0f / static_cast<float>(format.channels);
+    for (size_t i = 0; i < frameCount; ++i) {
+        float sum = 0.0f;
+        for (unsigned int c = 0; c < format.channels; ++c) {
+            sum += frames[i * format.channels + c];
+        }
+        float sample = sum * scale;
+        mono.push_back(sample);
+        energy += static_cast<double>(sample) * sample;
+    }
+
+    // Both run at half-overlapping frames
+    if (tempo) {
+        while (onsetPosition + onsetSize <= mono.size()) {
+            onsetStep();
+            onsetPosition += onsetSize / 2;
+        }
+    }
+    while (chromaPosition + chromaSize <= mono.size()) {
+        chromaStep();
+        chromaPosition += chromaSize / 2;
+    }
+
+    size_t used = tempo ? (std::min)(onsetPosition, chromaPosition) : chromaPosition;
+    if (used >= COMPACT_FRAMES) {
+        mono.erase(mono.begin(), mono.begin() + used);
+        if (tempo) {
+            onsetPosition -= used;
+        }
+        chromaPosition -= used;
+    }
+}
+
+bool FeatureAnalyzer::isFull() const {
+    return framesIn >= frameLimit;
+}
+
+bool FeatureAnalyzer::hasAudio() const {
+    return framesIn > 0 && energy / static_cast<double>(framesIn) > SILENCE;
+}
+
+double FeatureAnalyzer::getBpm() const {
+    double envelopeRate = static_cast<double>(format.sampleRate) / static_cast<double>(onsetSize / 2);
+    size_t count = envelope.size();
+    if (!tempo || !hasAudio() || count < envelopeRate * MIN_TEMPO_SECONDS) {
+        return 0.0;
+    }
+
+    // Take off the local mean (half a second each way), keep what rises above it
+    size_t reach = static_cast<size_t>(envelopeRate * 0.5);
+    std::vector<double> prefix(count + 1, 0.0);
+    for (size_t i = 0; i < count; ++i) {
+        prefix[i + 1] = prefix[i] + envelope[i];
+    }
+    std::vector<double> rectified(count);
+    for (size_t i = 0; i < count; ++i) {
+        size_t from = i > reach ? i - reach : 0;
+        size_t to = (std::min)(count, i + reach + 1);
+        double mean = (prefix[to] - prefix[from]) / static_cast<double>(to - from);
+        rectified[i] = (std::max)(0.0, envelope[i] - mean);
+    }
+    // Beats fall between envelope frames, a little smoothing keeps them from
+    // missing each other at lags that aren't whole frames
+    std::vector<double> onsets(count, 0.0);
+    const double SMOOTHING[5] = { 1.0 / 9.0, 2.0 / 9.0, 3.0 / 9.0, 2.0 / 9.0, 1.0 / 9.0 };
+    for (size_t i = 2; i + 2 < count; ++i) {
+        for (size_t t = 0; t < 5; ++t) {
+            onsets[i] += SMOOTHING[t] * rectified[i + t - 2];
+        }
+    }
+
+    size_t minLag = (std::max)(static_cast<size_t>(1), static_cast<size_t>(std::floor(envelopeRate * 60.0 / MAX_BPM)));
+    size_t maxLag = static_cast<size_t>(std::ceil(envelopeRate * 60.0 / MIN_BPM));
+    size_t lastLag = (std::min)(2 * maxLag + 2, count - 1);
+    std::vector<double> autocorrelation(lastLag + 1, 0.0);
+    for (size_t lag = 0; lag <= lastLag; ++lag) {
+        double sum = 0.0;
+        for (size_t i = 0; i + lag < count; ++i) {
+            sum += onsets[i] * onsets[i + lag];
+        }
+        autocorrelation[lag] = sum / static_cast<double>(count - lag);
+    }
+    if (autocorrelation[0] <= 0.0) {
+        return 0.0;
+    }
+
+    // A beat also repeats at twice its lag and is usually split in half;
+    // counting both keeps a 3:2 relative of the tempo from winning
+    auto score = [&](size_t lag) {
+        double value = autocorrelation[lag] + 0.25 * (autocorrelation[lag / 2] + autocorrelation[(lag + 1) / 2]);
+        if (2 * lag <= lastLag) {
+            value += 0.5 * autocorrelation[2 * lag];
+        }
+        double octaves = std::log2(60.0 * envelopeRate / static_cast<double>(lag) / PREFERRED_BPM) / PRIOR_OCTAVES;
+        return value * std::exp(-0.5 * octaves * octaves);
+    };
+
+    size_t best = 0;
+    double bestScore = 0.0;
+    for (size_t lag = minLag; lag <= maxLag && lag <= lastLag; ++lag) {
+        double value = score(lag);
+        if (value > bestScore) {
+            bestScore = value;
+            best = lag;
+        }
+    }
+    if (best == 0 || autocorrelation[best] < MIN_BEAT_STRENGTH * autocorrelation[0]) {
+        return 0.0;
+    }
+
+    // Parabola through the peak and its neighbours, for a lag between frames
+    double lag = static_cast<double>(best);
+    if (best > minLag && best < maxLag && best + 1 <= lastLag) {
+        double before = score(best - 1);
+        double after = score(best + 1);
+        double curvature = before - 2.0 * bestScore + after;
+        if (curvature < 0.0) {
+            lag += 0.5 * (before - after) / curvature;
+        }
+    }
+    return 60.0 * envelopeRate / lag;
+}
+
+bool FeatureAnalyzer::getTimbre(float* timbre) const {
+    if (!hasAudio() || timbreFrames == 0) {
+        return false;
+    }
+    for (size_t i = 0; i < TIMBRE_SIZE; ++i) {
+        timbre[i] = static_cast<float>(timbreSums[i] / static_cast<double>(timbreFrames));
+    }
+    return true;
+}
+
+int FeatureAnalyzer::getKey() const {
+    if (!hasAudio()) {
+        return -1;
+    }
+
+    int best = -1;
+    double bestCorrelation = 0.0;
+    for (int tonic = 0; tonic < 12; ++tonic) {
+        double rotated[12];
+        for (int i = 0; i < 12; ++i) {
+            rotated[i] = chroma[(tonic + i) % 12];
+        }
+        double major = correlation(rotated, MAJOR_PROFILE);
+        double minor = correlation(rotated, MINOR_PROFILE);
+        if (major > bestCorrelation) {
+            bestCorrelation = major;
+            best = tonic;
+        }
+        if (minor > bestCorrelation) {
+            bestCorrelation = minor;
+            best = 12 + tonic;
+        }
+    }
+    return best;
+}
+
+void FeatureAnalyzer::onsetStep() {
+    const float* samples = mono.data() + onsetPosition;
+    for (size_t i = 0; i < onsetSize; ++i) {
+        onsetFrame[i] = samples[i] * onsetWindow[i];
+    }
+    onsetFft.powerSpectrum(onsetFrame.data(), onsetPower.data());
+
+    // Magnitudes relative to a full-scale sine, log-compressed so quiet onsets count too
+    float scale = 4.0f / static_cast<float>(onsetSize);
+    float flux = 0.0f;
+    for (size_t k = 1; k <= fluxBins; ++k) {
+        float magnitude = std::log1p(1000.0f * std::sqrt(onsetPower[k]) * scale);
+        flux += (std::max)(0.0f, magnitude - lastMagnitudes[k]);
+        lastMagnitudes[k] = magnitude;
+    }
+    envelope.push_back(flux);
+}
+
+void FeatureAnalyzer::chromaStep() {
+    const float* samples = mono.data() + chromaPosition;
+    for (size_t i = 0; i < chromaSize; ++i) {
+        chromaFrame[i] = samples[i] * chromaWindow[i];
+    }
+    chromaFft.powerSpectrum(chromaFrame.data(), chromaPower.data());
+
+    // Spectral peaks only, the skirts of a loud note would smear into its neighbours
+    for (size_t k = 1; k < chromaSize / 2; ++k) {
+        if (pitchClass[k] >= 0 && chromaPower[k] > chromaPower[k - 1] && chromaPower[k] >= chromaPower[k + 1]) {
+            chroma[pitchClass[k]] += std::sqrt(chromaPower[k]);
+        }
+    }
+    timbreStep();
+}
+
+void FeatureAnalyzer::timbreStep() {
+    size_t bins = chromaSize / 2;
+    double rate = static_cast<double>(format.sampleRate);
+    double total = 0.0;
+    double weighted = 0.0;
+    for (size_t k = 1; k <= bins; ++k) {
+        total += chromaPower[k];
+        weighted += chromaPower[k] * static_cast<double>(k);
+    }
+    // Silent frames (-70 dBFS and below) would drag every mean towards noise
+    double fullScale = static_cast<double>(chromaSize) * static_cast<double>(chromaSize) / 16.0;
+    if (total <= fullScale * SILENCE) {
+        return;
+    }
+
+    double binHz = rate / static_cast<double>(chromaSize);
+    double rolloffBin = static_cast<double>(bins);
+    double running = 0.0;
+    for (size_t k = 1; k <= bins; ++k) {
+        running += chromaPower[k];
+        if (running >= ROLLOFF_SHARE * total) {
+            rolloffBin = static_cast<double>(k);
+            break;
+        }
+    }
+    timbreSums[0] += std::log2((std::max)(weighted / total * binHz, 1.0));
+    timbreSums[1] += std::log2((std::max)(rolloffBin * binHz, 1.0));
+
+    // Triangular mel bands, log energies, DCT-II; c0 is only the level and left out
+    double energies[MEL_BANDS];
+    for (size_t m = 0; m < MEL_BANDS; ++m) {
+        double low = melEdges[m];
+        double centre = melEdges[m + 1];
+        double high = melEdges[m + 2];
+        double sum = 0.0;
+        size_t first = static_cast<size_t>(std::ceil(low));
+        size_t last = (std::min)(bins, static_cast<size_t>(std::floor(high)));
+        for (size_t k = first; k <= last; ++k) {
+            double position = static_cast<double>(k);
+            double weight = position <= centre ? (position - low) / (std::max)(centre - low, 1e-9)
+                                               : (high - position) / (std::max)(high - centre, 1e-9);
+            sum += (std::max)(0.0, weight) * chromaPower[k];
+        }
+        energies[m] = std::log10(sum / fullScale + 1e-10);
+    }
+    for (size_t c = 1; c <= TIMBRE_SIZE - 2; ++c) {
+        double coefficient = 0.0;
+        for (size_t m = 0; m < MEL_BANDS; ++m) {
+            coefficient += energies[m] * std::cos(PI * static_cast<double>(c) * (static_cast<double>(m) + 0.5) / MEL_BANDS);
+        }
+        timbreSums[1 + c] += coefficient;
+    }
+    timbreFrames++;
+}
\ No newline at end of file
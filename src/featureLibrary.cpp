@@ -0,0 +1,557 @@
+#include "../headers/featureLibrary.hpp"
+#include "../headers/fingerprint.hpp"
+#include "../headers/osuBeatmap.hpp"
+#include "../headers/audioBackend.hpp"
+#include "../headers/binaryIO.hpp"
+#include <fstream>
+#include <filesystem>
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <random>
+#include <chrono>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace fs = std::filesystem;
+using namespace BinaryIO;
+
+namespace {
+    const uint32_t FEATURES_MAGIC = 0x54414546; // "FEAT"
+    const uint32_t FEATURES_VERSION = 4;
+    // Longest fingerprint load() accepts, a few times what Fingerprinter makes
+    const uint32_t MAX_FINGERPRINT_CODES = 4096;
+    const size_t ANALYSIS_CHUNK_FRAMES = 16384;
+
+    // waveforms.bin: magic, version, buckets per record and file id, then the
+    // records. A record is a check of the file it belongs to and the buckets
+    // as they are in memory
+    const uint32_t WAVEFORM_MAGIC = 0x4D524657; // "WFRM"
+    const uint32_t WAVEFORM_VERSION = 1;
+    const size_t WAVEFORM_HEADER_BYTES = 3 * sizeof(uint32_t) + sizeof(uint64_t);
+    const size_t WAVEFORM_BYTES = WaveformSummary::BUCKETS * sizeof(WaveformSummary::Bucket);
+    const size_t WAVEFORM_RECORD_BYTES = sizeof(uint64_t) + WAVEFORM_BYTES;
+    static_assert(sizeof(WaveformSummary::Bucket) == 3, "Buckets are stored as three bytes");
+
+    const char* const KEY_NAMES[12] = { "C", "C#", "D", "Eb", "E", "F", "F#", "G", "Ab", "A", "Bb", "B" };
+}
+
+FeatureLibrary::FeatureLibrary()
+    : dirty(false), waveformRecords(0), waveformFileId(0), jobLimit(0), stopping(false), analyzedCount(0), queuedCount(0) {}
+
+FeatureLibrary::~FeatureLibrary() {
+    stop();
+}
+
+bool FeatureLibrary::load(const std::string& filename, const std::string& waveformFilename) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        mapWaveforms(waveformFilename);
+    }
+
+    std::ifstream file(filename, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    uint32_t magic = 0;
+    uint32_t version = 0;
+    uint32_t count = 0;
+    uint64_t fileId = 0;
+    if (!readValue(file, magic) || !readValue(file, version) || !readValue(file, count) || !readValue(file, fileId) ||
+        magic != FEATURES_MAGIC || version != FEATURES_VERSION) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    for (uint32_t i = 0; i < count; ++i) {
+        std::string path;
+        Entry entry;
+        uint8_t flags = 0;
+        uint32_t codeCount = 0;
+        if (!readString(file, path) || !readValue(file, entry.fileSize) || !readValue(file, entry.modified) ||
+            !readValue(file, entry.features.bpm) || !readValue(file, entry.features.key) || !readValue(file, flags) ||
+            !readValue(file, entry.features.timbre) || !readValue(file, entry.waveformRecord) ||
+            !readValue(file, codeCount) || codeCount > MAX_FINGERPRINT_CODES) {
+            break;
+        }
+        entry.fingerprint.resize(codeCount);
+        if (codeCount > 0 && !file.read(reinterpret_cast<char*>(entry.fingerprint.data()), codeCount * sizeof(uint32_t))) {
+            break;
+        }
+        entry.features.bpmFromBeatmap = (flags & 1) != 0;
+        entry.features.analyzed = (flags & 2) != 0;
+        entry.features.hasTimbre = (flags & 4) != 0;
+        if (fileId != waveformFileId || entry.waveformRecord >= waveformRecords) {
+            entry.waveformRecord = NO_WAVEFORM; // The waveform file is gone or another one, measured again
+        }
+        entries[path] = entry;
+    }
+    dirty = false;
+    return true;
+}
+
+bool FeatureLibrary::save(const std::string& filename, const std::string& waveformFilename) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!dirty) {
+        return true;
+    }
+
+    // First, so the record numbers written below exist
+    if (!writeWaveforms(waveformFilename)) {
+        return false;
+    }
+
+    std::string tempName = filename + ".tmp";
+    {
+        std::ofstream file(tempName, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            return false;
+        }
+
+        writeValue(file, FEATURES_MAGIC);
+        writeValue(file, FEATURES_VERSION);
+        writeValue(file, static_cast<uint32_t>(entries.size()));
+        writeValue(file, waveformFileId);
+        for (const auto& pair : entries) {
+            const Entry& entry = pair.second;
+            uint8_t flags = (entry.features.bpmFromBeatmap ? 1 : 0) | (entry.features.analyzed ? 2 : 0) |
+                            (entry.features.hasTimbre ? 4 : 0);
+            writeString(file, pair.first);
+            writeValue(file, entry.fileSize);
+            writeValue(file, entry.modified);
+            writeValue(file, entry.features.bpm);
+            writeValue(file, entry.features.key);
+            writeValue(file, flags);
+            writeValue(file, entry.features.timbre);
+            writeValue(file, entry.waveformRecord);
+            writeValue(file, static_cast<uint32_t>(entry.fingerprint.size()));
+            file.write(reinterpret_cast<const char*>(entry.fingerprint.data()),
+                       static_cast<std::streamsize>(entry.fingerprint.size() * sizeof(uint32_t)));
+        }
+
+        if (!file.good()) {
+            return false;
+        }
+    }
+
+    std::error_code error;
+    fs::rename(tempName, filename, error);
+    if (!error) {
+        dirty = false;
+    }
+    return !error;
+}
+
+void FeatureLibrary::analyze(const std::vector<std::string>& paths) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (stopping || paths.empty()) {
+        return;
+    }
+
+    // The feeder does the stat calls, the library can be large
+    pending.insert(pending.end(), paths.begin(), paths.end());
+    queuedCount += paths.size();
+
+    if (workers.empty()) {
+        unsigned int cores = std::thread::hardware_concurrency();
+        unsigned int count = (std::max)(1u, (std::min)(MAX_WORKERS, cores / 2));
+        jobLimit = count * JOBS_PER_WORKER;
+        for (unsigned int i = 0; i < count; ++i) {
+            workers.emplace_back(&FeatureLibrary::workerLoop, this);
+        }
+        feeder = std::thread(&FeatureLibrary::feederLoop, this);
+    }
+    pendingChanged.notify_all();
+}
+
+void FeatureLibrary::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        pending.clear();
+        jobs.clear();
+    }
+    pendingChanged.notify_all();
+    jobsChanged.notify_all();
+    if (feeder.joinable()) {
+        feeder.join();
+    }
+    for (auto& worker : workers) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+    workers.clear();
+}
+
+size_t FeatureLibrary::getAnalyzedCount() const {
+    return analyzedCount.load();
+}
+
+size_t FeatureLibrary::getQueuedCount() const {
+    return queuedCount.load();
+}
+
+bool FeatureLibrary::isBusy() const {
+    return analyzedCount.load() < queuedCount.load();
+}
+
+bool FeatureLibrary::find(const std::string& path, TrackFeatures& features) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = entries.find(path);
+    if (it == entries.end()) {
+        return false;
+    }
+    features = it->second.features;
+    return true;
+}
+
+bool FeatureLibrary::findFingerprint(const std::string& path, std::vector<uint32_t>& codes) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = entries.find(path);
+    if (it == entries.end() || it->second.fingerprint.empty()) {
+        return false;
+    }
+    codes = it->second.fingerprint;
+    return true;
+}
+
+bool FeatureLibrary::findWaveform(const std::string& path, std::vector<WaveformSummary::Bucket>& buckets) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = entries.find(path);
+    if (it == entries.end()) {
+        return false;
+    }
+    if (!it->second.waveform.empty()) {
+        buckets = it->second.waveform;
+        return true;
+    }
+    const uint8_t* record = waveformRecord(it->first, it->second);
+    if (!record) {
+        return false;
+    }
+    buckets.resize(WaveformSummary::BUCKETS);
+    std::memcpy(buckets.data(), record, WAVEFORM_BYTES);
+    return true;
+}
+
+std::string FeatureLibrary::keyName(int key) {
+    if (key < 0 || key >= 24) {
+        return "?";
+    }
+    return std::string(KEY_NAMES[key % 12]) + (key < 12 ? " major" : " minor");
+}
+
+bool FeatureLibrary::parseKey(const std::string& name, int& key) {
+    std::string text;
+    for (char c : name) {
+        if (!std::isspace(static_cast<unsigned char>(c))) {
+            text += static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        }
+    }
+    if (text.empty() || text[0] < 'a' || text[0] > 'g') {
+        return false;
+    }
+
+    // Pitch classes of A to G
+    const int LETTERS[7] = { 9, 11, 0, 2, 4, 5, 7 };
+    int tonic = LETTERS[text[0] - 'a'];
+    size_t position = 1;
+    if (position < text.size() && text[position] == '#') {
+        tonic++;
+        position++;
+    } else if (position < text.size() && text[position] == 'b') {
+        tonic--;
+        position++;
+    }
+
+    std::string mode = text.substr(position);
+    if (mode.empty() || mode == "maj" || mode == "major") {
+        key = (tonic + 12) % 12;
+    } else if (mode == "m" || mode == "min" || mode == "minor") {
+        key = 12 + (tonic + 12) % 12;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+void FeatureLibrary::feederLoop() {
+    while (true) {
+        std::string path;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            pendingChanged.wait(lock, [this] { return stopping || !pending.empty(); });
+            if (stopping) {
+                return;
+            }
+            path = pending.front();
+            pending.pop_front();
+        }
+
+        Job job;
+        job.path = path;
+        job.beatmapBpm = 0.0;
+        bool current = false;
+        if (fileStamp(path, job.fileSize, job.modified)) {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto it = entries.find(path);
+            current = it != entries.end() && it->second.fileSize == job.fileSize && it->second.modified == job.modified &&
+                      (!it->second.features.analyzed || it->second.waveformRecord != NO_WAVEFORM || !it->second.waveform.empty());
+        } else {
+            current = true; // Gone, nothing to analyze
+        }
+        if (current) {
+            analyzedCount++;
+            continue;
+        }
+
+        OsuBeatmap beatmap;
+        if (OsuBeatmap::findFor(path, beatmap)) {
+            job.beatmapBpm = beatmap.mainBpm;
+        }
+
+        // Wait for room, this is what keeps the queue from growing with the library
+        std::unique_lock<std::mutex> lock(mutex);
+        jobsChanged.wait(lock, [this] { return stopping || jobs.size() < jobLimit; });
+        if (stopping) {
+            return;
+        }
+        jobs.push_back(job);
+        jobsChanged.notify_all();
+    }
+}
+
+void FeatureLibrary::workerLoop() {
+    // Analysis only gets the CPU time playback and the UI leave over
+#ifdef _WIN32
+    SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_IDLE);
+#elif defined(__linux__)
+    sched_param param = {};
+    pthread_setschedparam(pthread_self(), SCHED_IDLE, &param);
+#endif
+
+    while (true) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            jobsChanged.wait(lock, [this] { return stopping || !jobs.empty(); });
+            if (stopping) {
+                return;
+            }
+            job = jobs.front();
+            jobs.pop_front();
+        }
+        jobsChanged.notify_all(); // Room for the feeder
+
+        Entry entry;
+        entry.fileSize = job.fileSize;
+        entry.modified = job.modified;
+        measure(job, entry);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (stopping) {
+                return;
+            }
+            entries[job.path] = entry;
+            dirty = true;
+        }
+        analyzedCount++;
+    }
+}
+
+bool FeatureLibrary::fileStamp(const std::string& path, uint64_t& fileSize, int64_t& modified) {
+    std::error_code error;
+    fileSize = static_cast<uint64_t>(fs::file_size(path, error));
+    if (error) {
+        return false;
+    }
+    auto time = fs::last_write_time(path, error);
+    modified = error ? 0 : static_cast<int64_t>(time.time_since_epoch().count());
+    return true;
+}
+
+void FeatureLibrary::measure(const Job& job, Entry& entry) const {
+    TrackFeatures& features = entry.features;
+    if (job.beatmapBpm > 0.0) {
+        features.bpm = static_cast<float>(job.beatmapBpm);
+        features.bpmFromBeatmap = true;
+    }
+
+    std::unique_ptr<AudioBackend> decoder = AudioBackend::openFile(job.path);
+    if (!decoder) {
+        return;
+    }
+
+    // One decode feeds all three. The waveform takes the whole file, the
+    // other two ignore what comes after the part they need
+    AudioFormat format = decoder->getFormat();
+    FeatureAnalyzer analyzer(format, !features.bpmFromBeatmap);
+    Fingerprinter fingerprinter(format);
+    WaveformSummary waveform(format);
+    std::vector<float> chunk(ANALYSIS_CHUNK_FRAMES * format.channels);
+    size_t frames = 0;
+    while ((frames = decoder->decode(chunk.data(), ANALYSIS_CHUNK_FRAMES)) > 0) {
+        if (stopping) {
+            return; // Quitting, the worker drops this
+        }
+        analyzer.process(chunk.data(), frames);
+        fingerprinter.process(chunk.data(), frames);
+        waveform.process(chunk.data(), frames);
+    }
+
+    // Tempo, key and timbre of silence (or of nothing at all) would only
+    // mislead the filters and the radio, the file stays unanalyzed
+    if (analyzer.hasAudio()) {
+        if (!features.bpmFromBeatmap) {
+            features.bpm = static_cast<float>(analyzer.getBpm());
+        }
+        features.key = static_cast<int8_t>(analyzer.getKey());
+        features.analyzed = true;
+        features.hasTimbre = analyzer.getTimbre(features.timbre);
+    }
+    // Only audio gets a fingerprint, anything else would match every other
+    // file that failed the same way
+    if (features.analyzed) {
+        entry.fingerprint = fingerprinter.getCodes();
+    }
+    // Nor a waveform: a flat line would pass for a song that was looked at
+    if (features.analyzed) {
+        entry.waveform = waveform.getBuckets();
+    }
+}
+
+uint64_t FeatureLibrary::recordCheck(const std::string& path, const Entry& entry) {
+    // FNV-1a over the path and the stamp
+    uint64_t hash = 14695981039346656037ull;
+    auto add = [&hash](const void* data, size_t size) {
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        for (size_t i = 0; i < size; ++i) {
+            hash = (hash ^ bytes[i]) * 1099511628211ull;
+        }
+    };
+    add(path.data(), path.size());
+    add(&entry.fileSize, sizeof(entry.fileSize));
+    add(&entry.modified, sizeof(entry.modified));
+    return hash;
+}
+
+bool FeatureLibrary::mapWaveforms(const std::string& waveformFilename) {
+    waveformRecords = 0;
+    waveformFileId = 0;
+    if (!waveformFile.open(waveformFilename)) {
+        return false;
+    }
+
+    uint32_t header[3] = {};
+    if (waveformFile.size() >= WAVEFORM_HEADER_BYTES) {
+        std::memcpy(header, waveformFile.data(), sizeof(header));
+        std::memcpy(&waveformFileId, waveformFile.data() + sizeof(header), sizeof(waveformFileId));
+    }
+    if (header[0] != WAVEFORM_MAGIC || header[1] != WAVEFORM_VERSION || header[2] != WaveformSummary::BUCKETS) {
+        waveformFile.close();
+        waveformFileId = 0;
+        return false;
+    }
+    waveformRecords = (waveformFile.size() - WAVEFORM_HEADER_BYTES) / WAVEFORM_RECORD_BYTES;
+    return true;
+}
+
+const uint8_t* FeatureLibrary::waveformRecord(const std::string& path, const Entry& entry) const {
+    if (entry.waveformRecord >= waveformRecords || !waveformFile.isOpen()) {
+        return nullptr;
+    }
+    const uint8_t* record = waveformFile.data() + WAVEFORM_HEADER_BYTES + entry.waveformRecord * WAVEFORM_RECORD_BYTES;
+
+    // A record left over from another file means the two files got out of step
+    uint64_t check = 0;
+    std::memcpy(&check, record, sizeof(check));
+    return check == recordCheck(path, entry) ? record + sizeof(check) : nullptr;
+}
+
+bool FeatureLibrary::writeWaveforms(const std::string& waveformFilename) {
+    size_t live = 0;
+    size_t fresh = 0;
+    for (const auto& pair : entries) {
+        if (!pair.second.waveform.empty()) {
+            fresh++;
+        } else if (waveformRecord(pair.first, pair.second)) {
+            live++;
+        }
+    }
+    if (fresh == 0) {
+        return true;
+    }
+
+    // Appending is the usual case. The file is rewritten when it is new or
+    // damaged, or when it holds more garbage than live records
+    bool rewrite = !waveformFile.isOpen() || waveformRecords - live > live ||
+                   (waveformFile.size() - WAVEFORM_HEADER_BYTES) % WAVEFORM_RECORD_BYTES != 0;
+    std::string targetName = rewrite ? waveformFilename + ".tmp" : waveformFilename;
+
+    std::vector<std::pair<Entry*, uint32_t>> numbers;
+    {
+        std::ofstream file;
+        uint32_t next = 0;
+        if (rewrite) {
+            file.open(targetName, std::ios::binary | std::ios::trunc);
+            writeValue(file, WAVEFORM_MAGIC);
+            writeValue(file, WAVEFORM_VERSION);
+            writeValue(file, static_cast<uint32_t>(WaveformSummary::BUCKETS));
+            std::mt19937_64 random(std::random_device{}() ^ static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count()));
+            writeValue(file, random() | 1);
+        } else {
+            next = static_cast<uint32_t>(waveformRecords);
+            waveformFile.close(); // Windows doesn't let a mapped file grow
+            file.open(targetName, std::ios::binary | std::ios::app);
+        }
+        if (!file.is_open()) {
+            mapWaveforms(waveformFilename);
+            return false;
+        }
+
+        for (auto& pair : entries) {
+            Entry& entry = pair.second;
+            const uint8_t* buckets = reinterpret_cast<const uint8_t*>(entry.waveform.data());
+            if (entry.waveform.empty()) {
+                // Live records move along when rewriting, otherwise they stay
+                buckets = rewrite ? waveformRecord(pair.first, entry) : nullptr;
+            }
+            if (!buckets) {
+                continue;
+            }
+            writeValue(file, recordCheck(pair.first, entry));
+            file.write(reinterpret_cast<const char*>(buckets), static_cast<std::streamsize>(WAVEFORM_BYTES));
+            numbers.push_back(std::make_pair(&entry, next++));
+        }
+
+        if (!file.good()) {
+            mapWaveforms(waveformFilename);
+            return false;
+        }
+    }
+
+    if (rewrite) {
+        waveformFile.close();
+        std::error_code error;
+        fs::rename(targetName, waveformFilename, error);
+        if (error) {
+            mapWaveforms(waveformFilename);
+            return false;
+        }
+    }
+
+    for (auto& number : numbers) {
+        number.first->waveformRecord = number.second;
+        std::vector<WaveformSummary::Bucket>().swap(number.first->waveform);
+    }
+    mapWaveforms(waveformFilename);
+    return true;
+}
\ No newline at end of file
@@ -0,0 +1,136 @@
+#include "../headers/fingerprint.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    const double PI = 3.14159265358979323846;
+    const double LOW_HZ = 300.0;
+    const double HIGH_HZ = 3000.0;
+    // Frames overlap a lot so a copy that starts between two hops still
+    // gives nearly the same energies
+    const size_t FRAME_HOPS = 8;
+    // Fewer codes with any bit set than this is silence
+    const size_t MIN_AUDIBLE_CODES = 64;
+
+    size_t fftSizeFor(size_t length) {
+        size_t size = 256;
+        while (size < length) {
+            size *= 2;
+        }
+        return size;
+    }
+
+    unsigned int countBits(uint32_t value) {
+        value = value - ((value >> 1) & 0x55555555u);
+        value = (value & 0x33333333u) + ((value >> 2) & 0x33333333u);
+        value = (value + (value >> 4)) & 0x0F0F0F0Fu;
+        return (value * 0x01010101u) >> 24;
+    }
+}
+
+Fingerprinter::Fingerprinter(const AudioFormat& audioFormat)
+    : format(audioFormat), frameLimit(static_cast<size_t>(audioFormat.sampleRate) * MAX_SECONDS), framesIn(0),
+      hop((std::max)(static_cast<size_t>(1), static_cast<size_t>(std::lround(audioFormat.sampleRate * HOP_SECONDS)))),
+      frameLength(hop * FRAME_HOPS), fft(fftSizeFor(hop * FRAME_HOPS)), hasLast(false) {
+    // Frames are a fixed time long and zero-padded up to the FFT size
+    window.resize(frameLength);
+    for (size_t i = 0; i < frameLength; ++i) {
+        window[i] = static_cast<float>(0.5 - 0.5 * std::cos(2.0 * PI * static_cast<double>(i) / static_cast<double>(frameLength)));
+    }
+    frame.assign(fft.size(), 0.0f);
+    power.resize(fft.size() / 2 + 1);
+
+    double binHz = static_cast<double>((std::max)(1u, format.sampleRate)) / static_cast<double>(fft.size());
+    for (size_t b = 0; b <= BANDS; ++b) {
+        double hz = LOW_HZ * std::pow(HIGH_HZ / LOW_HZ, static_cast<double>(b) / BANDS);
+        bandBins[b] = (std::min)(power.size() - 1, static_cast<size_t>(std::lround(hz / binHz)));
+        if (b > 0 && bandBins[b] <= bandBins[b - 1]) {
+            bandBins[b] = (std::min)(power.size() - 1, bandBins[b - 1] + 1);
+        }
+    }
+    std::fill(lastEnergies, lastEnergies + BANDS, 0.0f);
+}
+
+void Fingerprinter::process(const float* frames, size_t frameCount) {
+    if (format.channels == 0 || framesIn >= frameLimit) {
+        return;
+    }
+    frameCount = (std::min)(frameCount, frameLimit - framesIn);
+    framesIn += frameCount;
+
+    float scale = 1.0f / static_cast<float>(format.channels);
+    for (size_t i = 0; i < frameCount; ++i) {
+        float sum = 0.0f;
+        for (unsigned int c = 0; c < format.channels; ++c) {
+            sum += frames[i * format.channels + c];
+        }
+        mono.push_back(sum * scale);
+    }
+
+    size_t position = 0;
+    while (position + frameLength <= mono.size()) {
+        std::copy(mono.begin() + position, mono.begin() + position + frameLength, frame.begin());
+        step();
+        position += hop;
+    }
+    mono.erase(mono.begin(), mono.begin() + position);
+}
+
+bool Fingerprinter::isFull() const {
+    return framesIn >= frameLimit;
+}
+
+std::vector<uint32_t> Fingerprinter::getCodes() const {
+    size_t audible = 0;
+    for (uint32_t code : codes) {
+        if (code != 0) {
+            audible++;
+        }
+    }
+    return audible >= MIN_AUDIBLE_CODES ? codes : std::vector<uint32_t>();
+}
+
+double Fingerprinter::bitErrorRate(const std::vector<uint32_t>& a, const std::vector<uint32_t>& b, int offset) {
+    // a[i] lines up with b[i + offset]
+    long long first = (std::max)(0LL, -static_cast<long long>(offset));
+    long long last = (std::min)(static_cast<long long>(a.size()), static_cast<long long>(b.size()) - offset);
+    if (last - first < static_cast<long long>(MIN_OVERLAP)) {
+        return 1.0;
+    }
+
+    uint64_t errors = 0;
+    for (long long i = first; i < last; ++i) {
+        errors += countBits(a[i] ^ b[i + offset]);
+    }
+    return static_cast<double>(errors) / (32.0 * static_cast<double>(last - first));
+}
+
+void Fingerprinter::step() {
+    for (size_t i = 0; i < frameLength; ++i) {
+        frame[i] *= window[i];
+    }
+    fft.powerSpectrum(frame.data(), power.data());
+
+    float energies[BANDS];
+    for (size_t b = 0; b < BANDS; ++b) {
+        float sum = 0.0f;
+        for (size_t k = bandBins[b]; k < bandBins[b + 1]; ++k) {
+            sum += power[k];
+        }
+        energies[b] = sum;
+    }
+
+    // Bit b: did band b gain on band b + 1 since the last frame
+    if (hasLast) {
+        uint32_t code = 0;
+        for (size_t b = 0; b + 1 < BANDS; ++b) {
+            float change = (energies[b] - energies[b + 1]) - (lastEnergies[b] - lastEnergies[b + 1]);
+            if (change > 0.0f) {
+                code |= 1u << b;
+            }
+        }
+        codes.push_back(code);
+    }
+    std::copy(energies, energies + BANDS, lastEnergies);
+    hasLast = true;
+}
\ No newline at end of file
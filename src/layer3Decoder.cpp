@@ -0,0 +1,1307 @@
+#include "../headers/layer3Decoder.hpp"
+#include "../headers/mp3Decoder.hpp"
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+namespace {
+    const double PI = 3.14159265358979323846;
+
+    // Main data can start up to 511 bytes before its frame (255 in MPEG-2)
+    const size_t MAX_RESERVOIR_BYTES = 511;
+    // Bits taken from the front of the stream by one lookup in a Huffman table
+    const unsigned int LOOKUP_BITS = 8;
+
+    // Huffman tables of ISO/IEC 11172-3 Annex B, codes and lengths in x * size + y
+    // order (v, w, x and y bits for count1 table A). Tables 16-23 and 24-31 share
+    // the codes of 16 and 24 and only differ in their linbits
+    const uint16_t CODES_1[4] = {
+        1, 1, 1, 0
+    };
+    const uint8_t LENGTHS_1[4] = {
+        1, 3, 2, 3
+    };
+    const uint16_t CODES_2[9] = {
+        1, 2, 1, 3, 1, 1, 3, 2, 0
+    };
+    const uint8_t LENGTHS_2[9] = {
+        1, 3, 6, 3, 3, 5, 5, 5, 6
+    };
+    const uint16_t CODES_3[9] = {
+        3, 2, 1, 1, 1, 1, 3, 2, 0
+    };
+    const uint8_t LENGTHS_3[9] = {
+        2, 2, 6, 3, 2, 5, 5, 5, 6
+    };
+    const uint16_t CODES_5[16] = {
+        1, 2, 6, 5, 3, 1, 4, 4, 7, 5, 7, 1, 6, 1, 1, 0
+    };
+    const uint8_t LENGTHS_5[16] = {
+        1, 3, 6, 7, 3, 3, 6, 7, 6, 6, 7, 8, 7, 6, 7, 8
+    };
+    const uint16_t CODES_6[16] = {
+        7, 3, 5, 1, 6, 2, 3, 2, 5, 4, 4, 1, 3, 3, 2, 0
+    };
+    const uint8_t LENGTHS_6[16] = {
+        3, 3, 5, 7, 3, 2, 4, 5, 4, 4, 5, 6, 6, 5, 6, 7
+    };
+    const uint16_t CODES_7[36] = {
+        1, 2, 10, 19, 16, 10, 3, 3, 7, 10, 5, 3, 11, 4, 13, 17,
+        8, 4, 12, 11, 18, 15, 11, 2, 7, 6, 9, 14, 3, 1, 6, 4,
+        5, 3, 2, 0
+    };
+    const uint8_t LENGTHS_7[36] = {
+        1, 3, 6, 8, 8, 9, 3, 4, 6, 7, 7, 8, 6, 5, 7, 8,
+        8, 9, 7, 7, 8, 9, 9, 9, 7, 7, 8, 9, 9, 10, 8, 8,
+        9, 10, 10, 10
+    };
+    const uint16_t CODES_8[36] = {
+        3, 4, 6, 18, 12, 5, 5, 1, 2, 16, 9, 3, 7, 3, 5, 14,
+        7, 3, 19, 17, 15, 13, 10, 4, 13, 5, 8, 11, 5, 1, 12, 4,
+        4, 1, 1, 0
+    };
+    const uint8_t LENGTHS_8[36] = {
+        2, 3, 6, 8, 8, 9, 3, 2, 4, 8, 8, 8, 6, 4, 6, 8,
+        8, 9, 8, 8, 8, 9, 9, 10, 8, 7, 8, 9, 10, 10, 9, 8,
+        9, 9, 11, 11
+    };
+    const uint16_t CODES_9[36] = {
+        7, 5, 9, 14, 15, 7, 6, 4, 5, 5, 6, 7, 7, 6, 8, 8,
+        8, 5, 15, 6, 9, 10, 5, 1, 11, 7, 9, 6, 4, 1, 14, 4,
+        6, 2, 6, 0
+    };
+    const uint8_t LENGTHS_9[36] = {
+        3, 3, 5, 6, 8, 9, 3, 3, 4, 5, 6, 8, 4, 4, 5, 6,
+        7, 8, 6, 5, 6, 7, 7, 8, 7, 6, 7, 7, 8, 9, 8, 7,
+        8, 8, 9, 9
+    };
+    const uint16_t CODES_10[64] = {
+        1, 2, 10, 23, 35, 30, 12, 17, 3, 3, 8, 12, 18, 21, 12, 7,
+        11, 9, 15, 21, 32, 40, 19, 6, 14, 13, 22, 34, 46, 23, 18, 7,
+        20, 19, 33, 47, 27, 22, 9, 3, 31, 22, 41, 26, 21, 20, 5, 3,
+        14, 13, 10, 11, 16, 6, 5, 1, 9, 8, 7, 8, 4, 4, 2, 0
+    };
+    const uint8_t LENGTHS_10[64] = {
+        1, 3, 6, 8, 9, 9, 9, 10, 3, 4, 6, 7, 8, 9, 8, 8,
+        6, 6, 7, 8, 9, 10, 9, 9, 7, 7, 8, 9, 10, 10, 9, 10,
+        8, 8, 9, 10, 10, 10, 10, 10, 9, 9, 10, 10, 11, 11, 10, 11,
+        8, 8, 9, 10, 10, 10, 11, 11, 9, 8, 9, 10, 10, 11, 11, 11
+    };
+    const uint16_t CODES_11[64] = {
+        3, 4, 10, 24, 34, 33, 21, 15, 5, 3, 4, 10, 32, 17, 11, 10,
+        11, 7, 13, 18, 30, 31, 20, 5, 25, 11, 19, 59, 27, 18, 12, 5,
+        35, 33, 31, 58, 30, 16, 7, 5, 28, 26, 32, 19, 17, 15, 8, 14,
+        14, 12, 9, 13, 14, 9, 4, 1, 11, 4, 6, 6, 6, 3, 2, 0
+    };
+    const uint8_t LENGTHS_11[64] = {
+        2, 3, 5, 7, 8, 9, 8, 9, 3, 3, 4, 6, 8, 8, 7, 8,
+        5, 5, 6, 7, 8, 9, 8, 8, 7, 6, 7, 9, 8, 10, 8, 9,
+        8, 8, 8, 9, 9, 10, 9, 10, 8, 8, 9, 10, 10, 11, 10, 11,
+        8, 7, 7, 8, 9, 10, 10, 10, 8, 7, 8, 9, 10, 10, 10, 10
+    };
+    const uint16_t CODES_12[64] = {
+        9, 6, 16, 33, 41, 39, 38, 26, 7, 5, 6, 9, 23, 16, 26, 11,
+        17, 7, 11, 14, 21, 30, 10, 7, 17, 10, 15, 12, 18, 28, 14, 5,
+        32, 13, 22, 19, 18, 16, 9, 5, 40, 17, 31, 29, 17, 13, 4, 2,
+        27, 12, 11, 15, 10, 7, 4, 1, 27, 12, 8, 12, 6, 3, 1, 0
+    };
+    const uint8_t LENGTHS_12[64] = {
+        4, 3, 5, 7, 8, 9, 9, 9, 3, 3, 4, 5, 7, 7, 8, 8,
+        5, 4, 5, 6, 7, 8, 7, 8, 6, 5, 6, 6, 7, 8, 8, 8,
+        7, 6, 7, 7, 8, 8, 8, 9, 8, 7, 8, 8, 8, 9, 8, 9,
+        8, 7, 7, 8, 8, 9, 9, 10, 9, 8, 8, 9, 9, 9, 9, 10
+    };
+    const uint16_t CODES_13[256] = {
+        1, 5, 14, 21, 34, 51, 46, 71, 42, 52, 68, 52, 67, 44, 43, 19,
+        3, 4, 12, 19, 31, 26, 44, 33, 31, 24, 32, 24, 31, 35, 22, 14,
+        15, 13, 23, 36, 59, 49, 77, 65, 29, 40, 30, 40, 27, 33, 42, 16,
+        22, 20, 37, 61, 56, 79, 73, 64, 43, 76, 56, 37, 26, 31, 25, 14,
+        35, 16, 60, 57, 97, 75, 114, 91, 54, 73, 55, 41, 48, 53, 23, 24,
+        58, 27, 50, 96, 76, 70, 93, 84, 77, 58, 79, 29, 74, 49, 41, 17,
+        47, 45, 78, 74, 115, 94, 90, 79, 69, 83, 71, 50, 59, 38, 36, 15,
+        72, 34, 56, 95, 92, 85, 91, 90, 86, 73, 77, 65, 51, 44, 43, 42,
+        43, 20, 30, 44, 55, 78, 72, 87, 78, 61, 46, 54, 37, 30, 20, 16,
+        53, 25, 41, 37, 44, 59, 54, 81, 66, 76, 57, 54, 37, 18, 39, 11,
+        35, 33, 31, 57, 42, 82, 72, 80, 47, 58, 55, 21, 22, 26, 38, 22,
+        53, 25, 23, 38, 70, 60, 51, 36, 55, 26, 34, 23, 27, 14, 9, 7,
+        34, 32, 28, 39, 49, 75, 30, 52, 48, 40, 52, 28, 18, 17, 9, 5,
+        45, 21, 34, 64, 56, 50, 49, 45, 31, 19, 12, 15, 10, 7, 6, 3,
+        48, 23, 20, 39, 36, 35, 53, 21, 16, 23, 13, 10, 6, 1, 4, 2,
+        16, 15, 17, 27, 25, 20, 29, 11, 17, 12, 16, 8, 1, 1, 0, 1
+    };
+    const uint8_t LENGTHS_13[256] = {
+        1, 4, 6, 7, 8, 9, 9, 10, 9, 10, 11, 11, 12, 12, 13, 13,
+        3, 4, 6, 7, 8, 8, 9, 9, 9, 9, 10, 10, 11, 12, 12, 12,
+        6, 6, 7, 8, 9, 9, 10, 10, 9, 10, 10, 11, 11, 12, 13, 13,
+        7, 7, 8, 9, 9, 10, 10, 10, 10, 11, 11, 11, 11, 12, 13, 13,
+        8, 7, 9, 9, 10, 10, 11, 11, 10, 11, 11, 12, 12, 13, 13, 14,
+        9, 8, 9, 10, 10, 10, 11, 11, 11, 11, 12, 11, 13, 13, 14, 14,
+        9, 9, 10, 10, 11, 11, 11, 11, 11, 12, 12, 12, 13, 13, 14, 14,
+        10, 9, 10, 11, 11, 11, 12, 12, 12, 12, 13, 13, 13, 14, 16, 16,
+        9, 8, 9, 10, 10, 11, 11, 12, 12, 12, 12, 13, 13, 14, 15, 15,
+        10, 9, 10, 10, 11, 11, 11, 13, 12, 13, 13, 14, 14, 14, 16, 15,
+        10, 10, 10, 11, 11, 12, 12, 13, 12, 13, 14, 13, 14, 15, 16, 17,
+        11, 10, 10, 11, 12, 12, 12, 12, 13, 13, 13, 14, 15, 15, 15, 16,
+        11, 11, 11, 12, 12, 13, 12, 13, 14, 14, 15, 15, 15, 16, 16, 16,
+        12, 11, 12, 13, 13, 13, 14, 14, 14, 14, 14, 15, 16, 15, 16, 16,
+        13, 12, 12, 13, 13, 13, 15, 14, 14, 17, 15, 15, 15, 17, 16, 16,
+        12, 12, 13, 14, 14, 14, 15, 14, 15, 15, 16, 16, 19, 18, 19, 16
+    };
+    const uint16_t CODES_15[256] = {
+        7, 12, 18, 53, 47, 76, 124, 108, 89, 123, 108, 119, 107, 81, 122, 63,
+        13, 5, 16, 27, 46, 36, 61, 51, 42, 70, 52, 83, 65, 41, 59, 36,
+        19, 17, 15, 24, 41, 34, 59, 48, 40, 64, 50, 78, 62, 80, 56, 33,
+        29, 28, 25, 43, 39, 63, 55, 93, 76, 59, 93, 72, 54, 75, 50, 29,
+        52, 22, 42, 40, 67, 57, 95, 79, 72, 57, 89, 69, 49, 66, 46, 27,
+        77, 37, 35, 66, 58, 52, 91, 74, 62, 48, 79, 63, 90, 62, 40, 38,
+        125, 32, 60, 56, 50, 92, 78, 65, 55, 87, 71, 51, 73, 51, 70, 30,
+        109, 53, 49, 94, 88, 75, 66, 122, 91, 73, 56, 42, 64, 44, 21, 25,
+        90, 43, 41, 77, 73, 63, 56, 92, 77, 66, 47, 67, 48, 53, 36, 20,
+        71, 34, 67, 60, 58, 49, 88, 76, 67, 106, 71, 54, 38, 39, 23, 15,
+        109, 53, 51, 47, 90, 82, 58, 57, 48, 72, 57, 41, 23, 27, 62, 9,
+        86, 42, 40, 37, 70, 64, 52, 43, 70, 55, 42, 25, 29, 18, 11, 11,
+        118, 68, 30, 55, 50, 46, 74, 65, 49, 39, 24, 16, 22, 13, 14, 7,
+        91, 44, 39, 38, 34, 63, 52, 45, 31, 52, 28, 19, 14, 8, 9, 3,
+        123, 60, 58, 53, 47, 43, 32, 22, 37, 24, 17, 12, 15, 10, 2, 1,
+        71, 37, 34, 30, 28, 20, 17, 26, 21, 16, 10, 6, 8, 6, 2, 0
+    };
+    const uint8_t LENGTHS_15[256] = {
+        3, 4, 5, 7, 7, 8, 9, 9, 9, 10, 10, 11, 11, 11, 12, 13,
+        4, 3, 5, 6, 7, 7, 8, 8, 8, 9, 9, 10, 10, 10, 11, 11,
+        5, 5, 5, 6, 7, 7, 8, 8, 8, 9, 9, 10, 10, 11, 11, 11,
+        6, 6, 6, 7, 7, 8, 8, 9, 9, 9, 10, 10, 10, 11, 11, 11,
+        7, 6, 7, 7, 8, 8, 9, 9, 9, 9, 10, 10, 10, 11, 11, 11,
+        8, 7, 7, 8, 8, 8, 9, 9, 9, 9, 10, 10, 11, 11, 11, 12,
+        9, 7, 8, 8, 8, 9, 9, 9, 9, 10, 10, 10, 11, 11, 12, 12,
+        9, 8, 8, 9, 9, 9, 9, 10, 10, 10, 10, 10, 11, 11, 11, 12,
+        9, 8, 8, 9, 9, 9, 9, 10, 10, 10, 10, 11, 11, 12, 12, 12,
+        9, 8, 9, 9, 9, 9, 10, 10, 10, 11, 11, 11, 11, 12, 12, 12,
+        10, 9, 9, 9, 10, 10, 10, 10, 10, 11, 11, 11, 11, 12, 13, 12,
+        10, 9, 9, 9, 10, 10, 10, 10, 11, 11, 11, 11, 12, 12, 12, 13,
+        11, 10, 9, 10, 10, 10, 11, 11, 11, 11, 11, 11, 12, 12, 13, 13,
+        11, 10, 10, 10, 10, 11, 11, 11, 11, 12, 12, 12, 12, 12, 13, 13,
+        12, 11, 11, 11, 11, 11, 11, 11, 12, 12, 12, 12, 13, 13, 12, 13,
+        12, 11, 11, 11, 11, 11, 11, 12, 12, 12, 12, 12, 13, 13, 13, 13
+    };
+    const uint16_t CODES_16[256] = {
+        1, 5, 14, 44, 74, 63, 110, 93, 172, 149, 138, 242, 225, 195, 376, 17,
+        3, 4, 12, 20, 35, 62, 53, 47, 83, 75, 68, 119, 201, 107, 207, 9,
+        15, 13, 23, 38, 67, 58, 103, 90, 161, 72, 127, 117, 110, 209, 206, 16,
+        45, 21, 39, 69, 64, 114, 99, 87, 158, 140, 252, 212, 199, 387, 365, 26,
+        75, 36, 68, 65, 115, 101, 179, 164, 155, 264, 246, 226, 395, 382, 362, 9,
+        66, 30, 59, 56, 102, 185, 173, 265, 142, 253, 232, 400, 388, 378, 445, 16,
+        111, 54, 52, 100, 184, 178, 160, 133, 257, 244, 228, 217, 385, 366, 715, 10,
+        98, 48, 91, 88, 165, 157, 148, 261, 248, 407, 397, 372, 380, 889, 884, 8,
+        85, 84, 81, 159, 156, 143, 260, 249, 427, 401, 392, 383, 727, 713, 708, 7,
+        154, 76, 73, 141, 131, 256, 245, 426, 406, 394, 384, 735, 359, 710, 352, 11,
+        139, 129, 67, 125, 247, 233, 229, 219, 393, 743, 737, 720, 885, 882, 439, 4,
+        243, 120, 118, 115, 227, 223, 396, 746, 742, 736, 721, 712, 706, 223, 436, 6,
+        202, 224, 222, 218, 216, 389, 386, 381, 364, 888, 443, 707, 440, 437, 1728, 4,
+        747, 211, 210, 208, 370, 379, 734, 723, 714, 1735, 883, 877, 876, 3459, 865, 2,
+        377, 369, 102, 187, 726, 722, 358, 711, 709, 866, 1734, 871, 3458, 870, 434, 0,
+        12, 10, 7, 11, 10, 17, 11, 9, 13, 12, 10, 7, 5, 3, 1, 3
+    };
+    const uint8_t LENGTHS_16[256] = {
+        1, 4, 6, 8, 9, 9, 10, 10, 11, 11, 11, 12, 12, 12, 13, 9,
+        3, 4, 6, 7, 8, 9, 9, 9, 10, 10, 10, 11, 12, 11, 12, 8,
+        6, 6, 7, 8, 9, 9, 10, 10, 11, 10, 11, 11, 11, 12, 12, 9,
+        8, 7, 8, 9, 9, 10, 10, 10, 11, 11, 12, 12, 12, 13, 13, 10,
+        9, 8, 9, 9, 10, 10, 11, 11, 11, 12, 12, 12, 13, 13, 13, 9,
+        9, 8, 9, 9, 10, 11, 11, 12, 11, 12, 12, 13, 13, 13, 14, 10,
+        10, 9, 9, 10, 11, 11, 11, 11, 12, 12, 12, 12, 13, 13, 14, 10,
+        10, 9, 10, 10, 11, 11, 11, 12, 12, 13, 13, 13, 13, 15, 15, 10,
+        10, 10, 10, 11, 11, 11, 12, 12, 13, 13, 13, 13, 14, 14, 14, 10,
+        11, 10, 10, 11, 11, 12, 12, 13, 13, 13, 13, 14, 13, 14, 13, 11,
+        11, 11, 10, 11, 12, 12, 12, 12, 13, 14, 14, 14, 15, 15, 14, 10,
+        12, 11, 11, 11, 12, 12, 13, 14, 14, 14, 14, 14, 14, 13, 14, 11,
+        12, 12, 12, 12, 12, 13, 13, 13, 13, 15, 14, 14, 14, 14, 16, 11,
+        14, 12, 12, 12, 13, 13, 14, 14, 14, 16, 15, 15, 15, 17, 15, 11,
+        13, 13, 11, 12, 14, 14, 13, 14, 14, 15, 16, 15, 17, 15, 14, 11,
+        9, 8, 8, 9, 9, 10, 10, 10, 11, 11, 11, 11, 11, 11, 11, 8
+    };
+    const uint16_t CODES_24[256] = {
+        15, 13, 46, 80, 146, 262, 248, 434, 426, 669, 653, 649, 621, 517, 1032, 88,
+        14, 12, 21, 38, 71, 130, 122, 216, 209, 198, 327, 345, 319, 297, 279, 42,
+        47, 22, 41, 74, 68, 128, 120, 221, 207, 194, 182, 340, 315, 295, 541, 18,
+        81, 39, 75, 70, 134, 125, 116, 220, 204, 190, 178, 325, 311, 293, 271, 16,
+        147, 72, 69, 135, 127, 118, 112, 210, 200, 188, 352, 323, 306, 285, 540, 14,
+        263, 66, 129, 126, 119, 114, 214, 202, 192, 180, 341, 317, 301, 281, 262, 12,
+        249, 123, 121, 117, 113, 215, 206, 195, 185, 347, 330, 308, 291, 272, 520, 10,
+        435, 115, 111, 109, 211, 203, 196, 187, 353, 332, 313, 298, 283, 531, 381, 17,
+        427, 212, 208, 205, 201, 193, 186, 177, 169, 320, 303, 286, 268, 514, 377, 16,
+        335, 199, 197, 191, 189, 181, 174, 333, 321, 305, 289, 275, 521, 379, 371, 11,
+        668, 184, 183, 179, 175, 344, 331, 314, 304, 290, 277, 530, 383, 373, 366, 10,
+        652, 346, 171, 168, 164, 318, 309, 299, 287, 276, 263, 513, 375, 368, 362, 6,
+        648, 322, 316, 312, 307, 302, 292, 284, 269, 261, 512, 376, 370, 364, 359, 4,
+        620, 300, 296, 294, 288, 282, 273, 266, 515, 380, 374, 369, 365, 361, 357, 2,
+        1033, 280, 278, 274, 267, 264, 259, 382, 378, 372, 367, 363, 360, 358, 356, 0,
+        43, 20, 19, 17, 15, 13, 11, 9, 7, 6, 4, 7, 5, 3, 1, 3
+    };
+    const uint8_t LENGTHS_24[256] = {
+        4, 4, 6, 7, 8, 9, 9, 10, 10, 11, 11, 11, 11, 11, 12, 9,
+        4, 4, 5, 6, 7, 8, 8, 9, 9, 9, 10, 10, 10, 10, 10, 8,
+        6, 5, 6, 7, 7, 8, 8, 9, 9, 9, 9, 10, 10, 10, 11, 7,
+        7, 6, 7, 7, 8, 8, 8, 9, 9, 9, 9, 10, 10, 10, 10, 7,
+        8, 7, 7, 8, 8, 8, 8, 9, 9, 9, 10, 10, 10, 10, 11, 7,
+        9, 7, 8, 8, 8, 8, 9, 9, 9, 9, 10, 10, 10, 10, 10, 7,
+        9, 8, 8, 8, 8, 9, 9, 9, 9, 10, 10, 10, 10, 10, 11, 7,
+        10, 8, 8, 8, 9, 9, 9, 9, 10, 10, 10, 10, 10, 11, 11, 8,
+        10, 9, 9, 9, 9, 9, 9, 9, 9, 10, 10, 10, 10, 11, 11, 8,
+        10, 9, 9, 9, 9, 9, 9, 10, 10, 10, 10, 10, 11, 11, 11, 8,
+        11, 9, 9, 9, 9, 10, 10, 10, 10, 10, 10, 11, 11, 11, 11, 8,
+        11, 10, 9, 9, 9, 10, 10, 10, 10, 10, 10, 11, 11, 11, 11, 8,
+        11, 10, 10, 10, 10, 10, 10, 10, 10, 10, 11, 11, 11, 11, 11, 8,
+        11, 10, 10, 10, 10, 10, 10, 10, 11, 11, 11, 11, 11, 11, 11, 8,
+        12, 10, 10, 10, 10, 10, 10, 11, 11, 11, 11, 11, 11, 11, 11, 8,
+        8, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 8, 8, 8, 8, 4
+    };
+    const uint16_t CODES_COUNT1_A[16] = {
+        1, 5, 4, 5, 6, 5, 4, 4, 7, 3, 6, 0, 7, 2, 3, 1
+    };
+    const uint8_t LENGTHS_COUNT1_A[16] = {
+        1, 4, 4, 5, 4, 6, 5, 6, 4, 5, 5, 6, 5, 6, 6, 6
+    };
+    const unsigned int LINBITS[32] = {
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        1, 2, 3, 4, 6, 8, 10, 13, 4, 5, 6, 7, 8, 9, 11, 13
+    };
+
+    // Synthesis window D[0..256] of Annex B in 1/65536, the rest of it mirrors
+    const int32_t SYNTHESIS_WINDOW[257] = {
+        0, -1, -1, -1, -1, -1, -1, -2, -2, -2,
+        -2, -3, -3, -4, -4, -5, -5, -6, -7, -7,
+        -8, -9, -10, -11, -13, -14, -16, -17, -19, -21,
+        -24, -26, -29, -31, -35, -38, -41, -45, -49, -53,
+        -58, -63, -68, -73, -79, -85, -91, -97, -104, -111,
+        -117, -125, -132, -139, -147, -154, -161, -169, -176, -183,
+        -190, -196, -202, -208, 213, 218, 222, 225, 227, 228,
+        228, 227, 224, 221, 215, 208, 200, 189, 177, 163,
+        146, 127, 106, 83, 57, 29, -2, -36, -72, -111,
+        -153, -197, -244, -294, -347, -401, -459, -519, -581, -645,
+        -711, -779, -848, -919, -991, -1064, -1137, -1210, -1283, -1356,
+        -1428, -1498, -1567, -1634, -1698, -1759, -1817, -1870, -1919, -1962,
+        -2001, -2032, -2057, -2075, -2085, -2087, -2080, -2063, 2037, 2000,
+        1952, 1893, 1822, 1739, 1644, 1535, 1414, 1280, 1131, 970,
+        794, 605, 402, 185, -45, -288, -545, -814, -1095, -1388,
+        -1692, -2006, -2330, -2663, -3004, -3351, -3705, -4063, -4425, -4788,
+        -5153, -5517, -5879, -6237, -6589, -6935, -7271, -7597, -7910, -8209,
+        -8491, -8755, -8998, -9219, -9416, -9585, -9727, -9838, -9916, -9959,
+        -9966, -9935, -9863, -9750, -9592, -9389, -9139, -8840, -8492, -8092,
+        -7640, -7134, 6574, 5959, 5288, 4561, 3776, 2935, 2037, 1082,
+        70, -998, -2122, -3300, -4533, -5818, -7154, -8540, -9975, -11455,
+        -12980, -14548, -16155, -17799, -19478, -21189, -22929, -24694, -26482, -28289,
+        -30112, -31947, -33791, -35640, -37489, -39336, -41176, -43006, -44821, -46617,
+        -48390, -50137, -51853, -53534, -55178, -56778, -58333, -59838, -61289, -62684,
+        -64019, -65290, -66494, -67629, -68692, -69679, -70590, -71420, -72169, -72835,
+        -73415, -73908, -74313, -74630, -74856, -74992, 75038
+    };
+
+    // Scalefactor band boundaries at 44.1, 48, 32, 22.05, 24, 16, 11.025, 12 and 8 kHz
+    const uint16_t LONG_BANDS[9][23] = {
+        { 0, 4, 8, 12, 16, 20, 24, 30, 36, 44, 52, 62, 74, 90, 110, 134, 162, 196, 238, 288, 342, 418, 576 },
+        { 0, 4, 8, 12, 16, 20, 24, 30, 36, 42, 50, 60, 72, 88, 106, 128, 156, 190, 230, 276, 330, 384, 576 },
+        { 0, 4, 8, 12, 16, 20, 24, 30, 36, 44, 54, 66, 82, 102, 126, 156, 194, 240, 296, 364, 448, 550, 576 },
+        { 0, 6, 12, 18, 24, 30, 36, 44, 54, 66, 80, 96, 116, 140, 168, 200, 238, 284, 336, 396, 464, 522, 576 },
+        { 0, 6, 12, 18, 24, 30, 36, 44, 54, 66, 80, 96, 114, 136, 162, 194, 232, 278, 332, 394, 464, 540, 576 },
+        { 0, 6, 12, 18, 24, 30, 36, 44, 54, 66, 80, 96, 116, 140, 168, 200, 238, 284, 336, 396, 464, 522, 576 },
+        { 0, 6, 12, 18, 24, 30, 36, 44, 54, 66, 80, 96, 116, 140, 168, 200, 238, 284, 336, 396, 464, 522, 576 },
+        { 0, 6, 12, 18, 24, 30, 36, 44, 54, 66, 80, 96, 116, 140, 168, 200, 238, 284, 336, 396, 464, 522, 576 },
+        { 0, 12, 24, 36, 48, 60, 72, 88, 108, 132, 160, 192, 232, 280, 336, 400, 476, 566, 568, 570, 572, 574, 576 }
+    };
+    const uint8_t SHORT_BANDS[9][14] = {
+        { 0, 4, 8, 12, 16, 22, 30, 40, 52, 66, 84, 106, 136, 192 },
+        { 0, 4, 8, 12, 16, 22, 28, 38, 50, 64, 80, 100, 126, 192 },
+        { 0, 4, 8, 12, 16, 22, 30, 42, 58, 78, 104, 138, 180, 192 },
+        { 0, 4, 8, 12, 18, 24, 32, 42, 56, 74, 100, 132, 174, 192 },
+        { 0, 4, 8, 12, 18, 26, 36, 48, 62, 80, 104, 136, 180, 192 },
+        { 0, 4, 8, 12, 18, 26, 36, 48, 62, 80, 104, 134, 174, 192 },
+        { 0, 4, 8, 12, 18, 26, 36, 48, 62, 80, 104, 134, 174, 192 },
+        { 0, 4, 8, 12, 18, 26, 36, 48, 62, 80, 104, 134, 174, 192 },
+        { 0, 8, 16, 24, 36, 52, 72, 96, 124, 160, 162, 164, 166, 192 }
+    };
+
+    const uint8_t PRETAB[22] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 3, 3, 3, 2, 0 };
+    // MPEG-1 scalefactor bits of the lower and upper bands, by scalefac_compress
+    const uint8_t SLEN[2][16] = {
+        { 0, 0, 0, 0, 3, 1, 1, 1, 2, 2, 2, 3, 3, 3, 4, 4 },
+        { 0, 1, 2, 3, 0, 1, 2, 3, 1, 2, 3, 1, 2, 3, 2, 3 }
+    };
+    // MPEG-2 scalefactors per slen group, by scalefac_compress range (the last
+    // three for the intensity stereo channel) and long, short or mixed blocks
+    const uint8_t LSF_SCALEFACTORS[6][3][4] = {
+        { { 6, 5, 5, 5 }, { 9, 9, 9, 9 }, { 6, 9, 9, 9 } },
+        { { 6, 5, 7, 3 }, { 9, 9, 12, 6 }, { 6, 9, 12, 6 } },
+        { { 11, 10, 0, 0 }, { 18, 18, 0, 0 }, { 15, 18, 0, 0 } },
+        { { 7, 7, 7, 0 }, { 12, 12, 12, 0 }, { 6, 15, 12, 0 } },
+        { { 6, 6, 6, 3 }, { 12, 9, 9, 6 }, { 6, 12, 9, 6 } },
+        { { 8, 8, 5, 0 }, { 15, 12, 9, 0 }, { 6, 18, 9, 0 } }
+    };
+    const double ALIAS_COEFFICIENTS[8] = { -0.6, -0.535, -0.33, -0.185, -0.095, -0.041, -0.0142, -0.0037 };
+
+    const unsigned int SHORT_BLOCK = 2;
+    const unsigned int LONG_LAYOUT = 0;
+    const unsigned int SHORT_LAYOUT = 1;
+    const unsigned int MIXED_LAYOUT = 2;
+
+    uint32_t readBE32(const unsigned char* p) {
+        return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+               (static_cast<uint32_t>(p[2]) << 8) | static_cast<uint32_t>(p[3]);
+    }
+
+    // MSB-first reader; reads past the end give zero bits
+    class BitReader {
+    public:
+        BitReader(const unsigned char* data, size_t size) : bytes(data), byteCount(size), position(0) {}
+
+        // Up to 24 bits
+        unsigned int peek(unsigned int count) const {
+            size_t byte = position >> 3;
+            uint32_t word = 0;
+            if (byte + 4 <= byteCount) {
+                word = readBE32(bytes + byte);
+            } else {
+                for (size_t i = 0; i < 4; ++i) {
+                    word = (word << 8) | (byte + i < byteCount ? bytes[byte + i] : 0u);
+                }
+            }
+            return (word << (position & 7)) >> (32 - count);
+        }
+        unsigned int read(unsigned int count) {
+            if (count == 0) {
+                return 0;
+            }
+            unsigned int value = peek(count);
+            position += count;
+            return value;
+        }
+        void skip(unsigned int count) { position += count; }
+        size_t tell() const { return position; }
+        void seek(size_t bit) { position = bit; }
+
+    private:
+        const unsigned char* bytes;
+        size_t byteCount;
+        size_t position;
+    };
+
+    // Multi-level lookup: LOOKUP_BITS at a time, codes that are longer continue
+    // in a sub-table. Symbols are x << 4 | y (or the v, w, x, y bits)
+    class HuffmanLookup {
+    public:
+        HuffmanLookup() : rootBits(0) {}
+
+        void build(const uint16_t* codes, const uint8_t* lengths, unsigned int count, unsigned int size) {
+            std::vector<Code> list;
+            for (unsigned int i = 0; i < count; ++i) {
+                Code code = { codes[i], lengths[i], ((i / size) << 4) | (i % size) };
+                list.push_back(code);
+            }
+            buildLevel(list, 0, rootBits);
+        }
+
+        bool empty() const {
+            return entries.empty();
+        }
+
+        unsigned int decode(BitReader& bits) const {
+            unsigned int levelBits = rootBits;
+            size_t base = 0;
+            for (;;) {
+                uint32_t entry = entries[base + bits.peek(levelBits)];
+                if (!(entry & SUBTABLE)) {
+                    bits.skip((entry >> 8) & 0xFF);
+                    return entry & 0xFF;
+                }
+                bits.skip(levelBits);
+                levelBits = (entry >> 24) & 0x1F;
+                base = entry & 0xFFFFFF;
+            }
+        }
+
+    private:
+        struct Code {
+            uint32_t code;
+            unsigned int length;
+            unsigned int symbol;
+        };
+        static const uint32_t SUBTABLE = 0x80000000u;
+
+        // Entries are a symbol and the bits it takes at this level, or a sub-table
+        std::vector<uint32_t> entries;
+        unsigned int rootBits;
+
+        size_t buildLevel(const std::vector<Code>& codes, unsigned int depth, unsigned int& levelBits) {
+            unsigned int longest = 0;
+            for (const Code& code : codes) {
+                longest = (std::max)(longest, code.length);
+            }
+            unsigned int bits = (std::min)(LOOKUP_BITS, longest - depth);
+            size_t base = entries.size();
+            // Bit patterns no code starts with only occur in damaged data, they skip ahead
+            entries.resize(base + (static_cast<size_t>(1) << bits), bits << 8);
+
+            std::vector<std::vector<Code>> longer(static_cast<size_t>(1) << bits);
+            for (const Code& code : codes) {
+                unsigned int rest = code.length - depth;
+                if (rest <= bits) {
+                    uint32_t prefix = (code.code & ((1u << rest) - 1)) << (bits - rest);
+                    for (uint32_t fill = 0; fill < (1u << (bits - rest)); ++fill) {
+                        entries[base + prefix + fill] = (rest << 8) | code.symbol;
+                    }
+                } else {
+                    longer[(code.code >> (rest - bits)) & ((1u << bits) - 1)].push_back(code);
+                }
+            }
+            for (size_t prefix = 0; prefix < longer.size(); ++prefix) {
+                if (!longer[prefix].empty()) {
+                    unsigned int subBits = 0;
+                    size_t offset = buildLevel(longer[prefix], depth + bits, subBits);
+                    entries[base + prefix] = SUBTABLE | (subBits << 24) | static_cast<uint32_t>(offset);
+                }
+            }
+            levelBits = bits;
+            return base;
+        }
+    };
+
+    // Band widths in bitstream order: 22 long bands, 13 short bands with their
+    // three windows next to each other, or a mixed block's long bands up to
+    // line 36 followed by the short bands above it
+    struct BandLayout {
+        uint8_t widths[39];
+        unsigned int count;
+        unsigned int longCount;
+    };
+
+    struct Tables {
+        HuffmanLookup bigValues[32];
+        HuffmanLookup count1;
+        float power43[8207];         // |x|^(4/3) for every value big_values can hold
+        BandLayout layouts[9][3];    // Per sample rate: long, short, mixed
+        float imdctLong[18][18];     // Outputs 0-8 and 18-26, the rest follows by symmetry
+        float imdctShort[12][6];
+        float windows[4][36];        // By block type
+        float shortWindow[12];
+        float aliasCs[8];
+        float aliasCa[8];
+        float dctSecants[31];        // 1 / (2 cos((2i + 1) pi / 2N)) for N = 2, 4, 8, 16 and 32
+        float synthesisWindow[512];
+        float intensityLeft[7];      // MPEG-1 intensity stereo, is_ratio / (1 + is_ratio)
+        float intensityLsf[2][16];   // MPEG-2 intensity stereo, by intensity_scale
+
+        Tables() {
+            struct Source {
+                const uint16_t* codes;
+                const uint8_t* lengths;
+                unsigned int size;
+            };
+            const Source sources[32] = {
+                { nullptr, nullptr, 0 }, { CODES_1, LENGTHS_1, 2 }, { CODES_2, LENGTHS_2, 3 }, { CODES_3, LENGTHS_3, 3 },
+                { nullptr, nullptr, 0 }, { CODES_5, LENGTHS_5, 4 }, { CODES_6, LENGTHS_6, 4 }, { CODES_7, LENGTHS_7, 6 },
+                { CODES_8, LENGTHS_8, 6 }, { CODES_9, LENGTHS_9, 6 }, { CODES_10, LENGTHS_10, 8 }, { CODES_11, LENGTHS_11, 8 },
+                { CODES_12, LENGTHS_12, 8 }, { CODES_13, LENGTHS_13, 16 }, { nullptr, nullptr, 0 }, { CODES_15, LENGTHS_15, 16 },
+                { CODES_16, LENGTHS_16, 16 }, { CODES_16, LENGTHS_16, 16 }, { CODES_16, LENGTHS_16, 16 }, { CODES_16, LENGTHS_16, 16 },
+                { CODES_16, LENGTHS_16, 16 }, { CODES_16, LENGTHS_16, 16 }, { CODES_16, LENGTHS_16, 16 }, { CODES_16, LENGTHS_16, 16 },
+                { CODES_24, LENGTHS_24, 16 }, { CODES_24, LENGTHS_24, 16 }, { CODES_24, LENGTHS_24, 16 }, { CODES_24, LENGTHS_24, 16 },
+                { CODES_24, LENGTHS_24, 16 }, { CODES_24, LENGTHS_24, 16 }, { CODES_24, LENGTHS_24, 16 }, { CODES_24, LENGTHS_24, 16 }
+            };
+            for (unsigned int table = 0; table < 32; ++table) {
+                if (sources[table].codes) {
+                    bigValues[table].build(sources[table].codes, sources[table].lengths,
+                                           sources[table].size * sources[table].size, sources[table].size);
+                }
+            }
+            count1.build(CODES_COUNT1_A, LENGTHS_COUNT1_A, 16, 16);
+
+            for (unsigned int i = 0; i < 8207; ++i) {
+                power43[i] = static_cast<float>(std::pow(static_cast<double>(i), 4.0 / 3.0));
+            }
+
+            for (unsigned int rate = 0; rate < 9; ++rate) {
+                BandLayout& longLayout = layouts[rate][LONG_LAYOUT];
+                longLayout.count = longLayout.longCount = 22;
+                for (unsigned int band = 0; band < 22; ++band) {
+                    longLayout.widths[band] = static_cast<uint8_t>(LONG_BANDS[rate][band + 1] - LONG_BANDS[rate][band]);
+                }
+
+                BandLayout& shortLayout = layouts[rate][SHORT_LAYOUT];
+                shortLayout.count = 39;
+                shortLayout.longCount = 0;
+                for (unsigned int band = 0; band < 39; ++band) {
+                    shortLayout.widths[band] = static_cast<uint8_t>(SHORT_BANDS[rate][band / 3 + 1] - SHORT_BANDS[rate][band / 3]);
+                }
+
+                // The long part covers the two lowest subbands, 12 lines of each short window
+                BandLayout& mixed = layouts[rate][MIXED_LAYOUT];
+                mixed.count = 0;
+                for (unsigned int band = 0; LONG_BANDS[rate][band + 1] <= 36; ++band) {
+                    mixed.widths[mixed.count++] = static_cast<uint8_t>(LONG_BANDS[rate][band + 1] - LONG_BANDS[rate][band]);
+                }
+                mixed.longCount = mixed.count;
+                unsigned int previous = 12;
+                for (unsigned int band = 1; band < 14; ++band) {
+                    if (SHORT_BANDS[rate][band] > previous) {
+                        for (unsigned int window = 0; window < 3; ++window) {
+                            mixed.widths[mixed.count++] = static_cast<uint8_t>(SHORT_BANDS[rate][band] - previous);
+                        }
+                        previous = SHORT_BANDS[rate][band];
+                    }
+                }
+            }
+
+            for (unsigned int row = 0; row < 18; ++row) {
+                unsigned int i = row < 9 ? row : row + 9;
+                for (unsigned int k = 0; k < 18; ++k) {
+                    imdctLong[row][k] = static_cast<float>(std::cos(PI / 72.0 * (2 * i + 19) * (2 * k + 1)));
+                }
+            }
+            for (unsigned int i = 0; i < 12; ++i) {
+                for (unsigned int k = 0; k < 6; ++k) {
+                    imdctShort[i][k] = static_cast<float>(std::cos(PI / 24.0 * (2 * i + 7) * (2 * k + 1)));
+                }
+                shortWindow[i] = static_cast<float>(std::sin(PI / 12.0 * (i + 0.5)));
+            }
+
+            for (unsigned int i = 0; i < 36; ++i) {
+                float normal = static_cast<float>(std::sin(PI / 36.0 * (i + 0.5)));
+                windows[0][i] = windows[2][i] = normal;
+                // Start: normal rising half, flat, the falling half of a short window, silent
+                if (i < 18) {
+                    windows[1][i] = normal;
+                } else if (i < 24) {
+                    windows[1][i] = 1.0f;
+                } else if (i < 30) {
+                    windows[1][i] = static_cast<float>(std::sin(PI / 12.0 * (i - 18 + 0.5)));
+                } else {
+                    windows[1][i] = 0.0f;
+                }
+                // Stop: the same, mirrored
+                if (i < 6) {
+                    windows[3][i] = 0.0f;
+                } else if (i < 12) {
+                    windows[3][i] = static_cast<float>(std::sin(PI / 12.0 * (i - 6 + 0.5)));
+                } else if (i < 18) {
+                    windows[3][i] = 1.0f;
+                } else {
+                    windows[3][i] = normal;
+                }
+            }
+
+            for (unsigned int i = 0; i < 8; ++i) {
+                double root = std::sqrt(1.0 + ALIAS_COEFFICIENTS[i] * ALIAS_COEFFICIENTS[i]);
+                aliasCs[i] = static_cast<float>(1.0 / root);
+                aliasCa[i] = static_cast<float>(ALIAS_COEFFICIENTS[i] / root);
+            }
+
+            for (unsigned int size = 2; size <= 32; size *= 2) {
+                for (unsigned int i = 0; i < size / 2; ++i) {
+                    dctSecants[size / 2 - 1 + i] = static_cast<float>(0.5 / std::cos((2 * i + 1) * PI / (2.0 * size)));
+                }
+            }
+
+            for (unsigned int i = 0; i <= 256; ++i) {
+                synthesisWindow[i] = static_cast<float>(SYNTHESIS_WINDOW[i] / 65536.0);
+            }
+            for (unsigned int i = 1; i < 256; ++i) {
+                synthesisWindow[512 - i] = i % 64 == 0 ? synthesisWindow[i] : -synthesisWindow[i];
+            }
+
+            for (unsigned int position = 0; position < 7; ++position) {
+                double s = std::sin(position * PI / 12.0);
+                double c = std::cos(position * PI / 12.0);
+                intensityLeft[position] = static_cast<float>(s / (s + c));
+            }
+            for (unsigned int i = 0; i < 16; ++i) {
+                intensityLsf[0][i] = static_cast<float>(std::pow(2.0, -0.25 * (i + 1)));
+                intensityLsf[1][i] = static_cast<float>(std::pow(2.0, -0.5 * (i + 1)));
+            }
+        }
+    };
+
+    const Tables& tables() {
+        static const Tables instance;
+        return instance;
+    }
+
+    unsigned int rateIndex(unsigned int sampleRate) {
+        switch (sampleRate) {
+            case 48000: return 1;
+            case 32000: return 2;
+            case 22050: return 3;
+            case 24000: return 4;
+            case 16000: return 5;
+            case 11025: return 6;
+            case 12000: return 7;
+            case 8000: return 8;
+            default: return 0;
+        }
+    }
+
+    size_t sideInfoBytes(const Mp3FrameHeader& header) {
+        if (header.version == 1) {
+            return header.channels == 2 ? 32 : 17;
+        }
+        return header.channels == 2 ? 17 : 9;
+    }
+
+    size_t mainDataOffset(const Mp3FrameHeader& header) {
+        return 4 + (header.hasCrc ? 2 : 0) + sideInfoBytes(header);
+    }
+
+    // 2^(exponent / 4)
+    float quarterPower(int exponent) {
+        static const float QUARTERS[4] = { 1.0f, 1.18920712f, 1.41421356f, 1.68179283f };
+        int whole = exponent >= 0 ? exponent / 4 : -((3 - exponent) / 4);
+        return std::ldexp(QUARTERS[exponent - whole * 4], whole);
+    }
+
+    // Unscaled DCT-II, split into even and odd halves at each step (Lee)
+    template <unsigned int N>
+    void dct(const float* input, float* output, const float* secants) {
+        const float* secant = secants + N / 2 - 1;
+        float even[N / 2];
+        float odd[N / 2];
+        for (unsigned int i = 0; i < N / 2; ++i) {
+            even[i] = input[i] + input[N - 1 - i];
+            odd[i] = (input[i] - input[N - 1 - i]) * secant[i];
+        }
+        float evenOut[N / 2];
+        float oddOut[N / 2];
+        dct<N / 2>(even, evenOut, secants);
+        dct<N / 2>(odd, oddOut, secants);
+        for (unsigned int k = 0; k + 1 < N / 2; ++k) {
+            output[2 * k] = evenOut[k];
+            output[2 * k + 1] = oddOut[k] + oddOut[k + 1];
+        }
+        output[N - 2] = evenOut[N / 2 - 1];
+        output[N - 1] = oddOut[N / 2 - 1];
+    }
+
+    template <>
+    void dct<1>(const float* input, float* output, const float*) {
+        output[0] = input[0];
+    }
+
+    struct ChannelInfo {
+        unsigned int part23Length;
+        unsigned int bigValues;
+        int globalGain;
+        unsigned int scalefacCompress;
+        unsigned int blockType;      // 0 normal, 1 start, 2 short, 3 stop
+        bool mixed;
+        unsigned int tableSelect[3];
+        unsigned int subblockGain[3];
+        unsigned int region0Count;
+        unsigned int region1Count;
+        bool preflag;
+        bool scalefacScale;
+        bool count1TableB;
+
+        unsigned int layout() const {
+            if (blockType != SHORT_BLOCK) {
+                return LONG_LAYOUT;
+            }
+            return mixed ? MIXED_LAYOUT : SHORT_LAYOUT;
+        }
+    };
+
+    struct SideInfo {
+        unsigned int mainDataBegin;
+        unsigned int scfsi[2];       // Band groups 0-3, group 0 in the highest bit
+        ChannelInfo channels[2][2];  // [granule][channel]
+    };
+
+    bool readSideInfo(const unsigned char* frame, size_t size, const Mp3FrameHeader& header, SideInfo& side) {
+        if (size < mainDataOffset(header)) {
+            return false;
+        }
+        bool mpeg1 = header.version == 1;
+        BitReader bits(frame + 4 + (header.hasCrc ? 2 : 0), sideInfoBytes(header));
+
+        side.mainDataBegin = bits.read(mpeg1 ? 9 : 8);
+        bits.skip(mpeg1 ? (header.channels == 2 ? 3 : 5) : header.channels); // Private bits
+        side.scfsi[0] = side.scfsi[1] = 0;
+        if (mpeg1) {
+            for (unsigned int channel = 0; channel < header.channels; ++channel) {
+                side.scfsi[channel] = bits.read(4);
+            }
+        }
+
+        for (unsigned int granule = 0; granule < (mpeg1 ? 2u : 1u); ++granule) {
+            for (unsigned int channel = 0; channel < header.channels; ++channel) {
+                ChannelInfo& info = side.channels[granule][channel];
+                info.part23Length = bits.read(12);
+                info.bigValues = bits.read(9);
+                info.globalGain = static_cast<int>(bits.read(8));
+                info.scalefacCompress = bits.read(mpeg1 ? 4 : 9);
+                if (bits.read(1)) {
+                    // Window switching: the block type decides the regions, region 2 is empty
+                    info.blockType = bits.read(2);
+                    info.mixed = bits.read(1) != 0 && info.blockType == SHORT_BLOCK;
+                    info.tableSelect[0] = bits.read(5);
+                    info.tableSelect[1] = bits.read(5);
+                    info.tableSelect[2] = 0;
+                    for (unsigned int window = 0; window < 3; ++window) {
+                        info.subblockGain[window] = bits.read(3);
+                    }
+                    if (info.blockType == 0) {
+                        return false;
+                    }
+                    info.region0Count = info.blockType == SHORT_BLOCK && !info.mixed ? 8 : 7;
+                    info.region1Count = 20 - info.region0Count;
+                } else {
+                    info.blockType = 0;
+                    info.mixed = false;
+                    for (unsigned int region = 0; region < 3; ++region) {
+                        info.tableSelect[region] = bits.read(5);
+                    }
+                    info.subblockGain[0] = info.subblockGain[1] = info.subblockGain[2] = 0;
+                    info.region0Count = bits.read(4);
+                    info.region1Count = bits.read(3);
+                }
+                // MPEG-2 has no preflag bit, it comes with the scalefactors
+                info.preflag = mpeg1 && bits.read(1) != 0;
+                info.scalefacScale = bits.read(1) != 0;
+                info.count1TableB = bits.read(1) != 0;
+                if (info.bigValues > 288) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    void readScalefactors(BitReader& bits, const ChannelInfo& info, unsigned int scfsi, unsigned int granule, uint8_t* scalefactors) {
+        unsigned int slen1 = SLEN[0][info.scalefacCompress];
+        unsigned int slen2 = SLEN[1][info.scalefacCompress];
+        if (info.blockType == SHORT_BLOCK) {
+            unsigned int band = 0;
+            unsigned int lower = info.mixed ? 8 + 9 : 18;
+            for (; band < lower; ++band) {
+                scalefactors[band] = static_cast<uint8_t>(bits.read(slen1));
+            }
+            for (unsigned int i = 0; i < 18; ++i, ++band) {
+                scalefactors[band] = static_cast<uint8_t>(bits.read(slen2));
+            }
+            std::fill(scalefactors + band, scalefactors + 39, 0);
+            return;
+        }
+
+        // The second granule can reuse a group of the first one's scalefactors
+        static const unsigned int GROUPS[5] = { 0, 6, 11, 16, 21 };
+        for (unsigned int group = 0; group < 4; ++group) {
+            if (granule == 1 && (scfsi & (8u >> group))) {
+                continue;
+            }
+            for (unsigned int band = GROUPS[group]; band < GROUPS[group + 1]; ++band) {
+                scalefactors[band] = static_cast<uint8_t>(bits.read(group < 2 ? slen1 : slen2));
+            }
+        }
+        std::fill(scalefactors + 21, scalefactors + 39, 0);
+    }
+
+    // MPEG-2 and 2.5. The right channel of intensity stereo carries positions,
+    // the largest value a band can hold marks it as not intensity coded
+    void readLsfScalefactors(BitReader& bits, const ChannelInfo& info, bool intensityChannel,
+                             uint8_t* scalefactors, bool* illegal, bool& preflag) {
+        unsigned int compress = info.scalefacCompress;
+        unsigned int slen[4] = { 0, 0, 0, 0 };
+        unsigned int row = 0;
+        preflag = false;
+        if (intensityChannel) {
+            compress >>= 1;
+            if (compress < 180) {
+                slen[0] = compress / 36;
+                slen[1] = (compress % 36) / 6;
+                slen[2] = compress % 6;
+                row = 3;
+            } else if (compress < 244) {
+                compress -= 180;
+                slen[0] = (compress % 64) >> 4;
+                slen[1] = (compress % 16) >> 2;
+                slen[2] = compress % 4;
+                row = 4;
+            } else {
+                compress -= 244;
+                slen[0] = compress / 3;
+                slen[1] = compress % 3;
+                row = 5;
+            }
+        } else if (compress < 400) {
+            slen[0] = (compress >> 4) / 5;
+            slen[1] = (compress >> 4) % 5;
+            slen[2] = (compress % 16) >> 2;
+            slen[3] = compress % 4;
+            row = 0;
+        } else if (compress < 500) {
+            compress -= 400;
+            slen[0] = (compress >> 2) / 5;
+            slen[1] = (compress >> 2) % 5;
+            slen[2] = compress % 4;
+            row = 1;
+        } else {
+            compress -= 500;
+            slen[0] = compress / 3;
+            slen[1] = compress % 3;
+            row = 2;
+            preflag = true;
+        }
+
+        const uint8_t* counts = LSF_SCALEFACTORS[row][info.layout()];
+        unsigned int band = 0;
+        for (unsigned int group = 0; group < 4; ++group) {
+            unsigned int largest = (1u << slen[group]) - 1;
+            for (unsigned int i = 0; i < counts[group]; ++i, ++band) {
+                scalefactors[band] = static_cast<uint8_t>(bits.read(slen[group]));
+                illegal[band] = scalefactors[band] == largest;
+            }
+        }
+        for (; band < 39; ++band) {
+            scalefactors[band] = 0;
+            illegal[band] = false;
+        }
+    }
+
+    // Big values and count1 parts of one channel's Huffman data. Returns how
+    // many lines from the bottom can be nonzero
+    size_t readSpectrum(BitReader& bits, size_t endBit, const ChannelInfo& info, const BandLayout& layout, int* values) {
+        const Tables& t = tables();
+        size_t bigLines = (std::min)(static_cast<size_t>(info.bigValues) * 2, static_cast<size_t>(576));
+
+        auto bandsEnd = [&layout](unsigned int bands) {
+            size_t end = 0;
+            for (unsigned int band = 0; band < bands && band < layout.count; ++band) {
+                end += layout.widths[band];
+            }
+            return end;
+        };
+        size_t region1 = bandsEnd(info.region0Count + 1);
+        size_t region2 = info.blockType != 0 ? 576 : bandsEnd(info.region0Count + info.region1Count + 2);
+        region1 = (std::min)(region1, bigLines);
+        region2 = (std::min)((std::max)(region2, region1), bigLines);
+        const size_t starts[4] = { 0, region1, region2, bigLines };
+
+        for (unsigned int region = 0; region < 3; ++region) {
+            unsigned int table = info.tableSelect[region];
+            const HuffmanLookup& lookup = t.bigValues[table];
+            unsigned int linbits = LINBITS[table];
+            for (size_t line = starts[region]; line < starts[region + 1]; line += 2) {
+                if (lookup.empty()) {
+                    values[line] = values[line + 1] = 0;
+                    continue;
+                }
+                unsigned int symbol = lookup.decode(bits);
+                int x = static_cast<int>(symbol >> 4);
+                int y = static_cast<int>(symbol & 15);
+                if (x == 15 && linbits) {
+                    x += static_cast<int>(bits.read(linbits));
+                }
+                if (x && bits.read(1)) {
+                    x = -x;
+                }
+                if (y == 15 && linbits) {
+                    y += static_cast<int>(bits.read(linbits));
+                }
+                if (y && bits.read(1)) {
+                    y = -y;
+                }
+                values[line] = x;
+                values[line + 1] = y;
+            }
+        }
+
+        // Quadruples of -1, 0 and 1 until the channel's bits run out
+        size_t line = bigLines;
+        while (line + 4 <= 576 && bits.tell() < endBit) {
+            unsigned int symbol = info.count1TableB ? 15 - bits.read(4) : t.count1.decode(bits);
+            int quad[4];
+            for (unsigned int i = 0; i < 4; ++i) {
+                quad[i] = (symbol >> (3 - i)) & 1;
+                if (quad[i] && bits.read(1)) {
+                    quad[i] = -1;
+                }
+            }
+            if (bits.tell() > endBit) {
+                break; // Ran into the next channel's data, the quadruple isn't part of this one
+            }
+            std::copy(quad, quad + 4, values + line);
+            line += 4;
+        }
+        std::fill(values + line, values + 576, 0);
+        return line;
+    }
+
+    void requantize(const int* values, size_t nonzero, const ChannelInfo& info, const BandLayout& layout,
+                    const uint8_t* scalefactors, bool preflag, float* spectrum) {
+        const float* power43 = tables().power43;
+        unsigned int shift = info.scalefacScale ? 2 : 1;
+        size_t line = 0;
+        for (unsigned int band = 0; band < layout.count && line < nonzero; ++band) {
+            // Exponents in quarter steps
+            int exponent = info.globalGain - 210;
+            if (band < layout.longCount) {
+                exponent -= static_cast<int>((scalefactors[band] + (preflag ? PRETAB[band] : 0)) << shift);
+            } else {
+                unsigned int window = (band - layout.longCount) % 3;
+                exponent -= static_cast<int>(8 * info.subblockGain[window] + (scalefactors[band] << shift));
+            }
+            float scale = quarterPower(exponent);
+            size_t end = line + layout.widths[band];
+            for (; line < end; ++line) {
+                int value = values[line];
+                spectrum[line] = value >= 0 ? power43[value] * scale : -power43[-value] * scale;
+            }
+        }
+        std::fill(spectrum + line, spectrum + 576, 0.0f);
+    }
+
+    // Joint stereo. Intensity stereo covers the bands above the last nonzero
+    // one of the right channel (per window for short blocks), M/S the rest
+    void processStereo(float (*spectrum)[576], const Mp3FrameHeader& header, const ChannelInfo& right,
+                       const BandLayout& layout, uint8_t* positions, bool* illegal) {
+        const unsigned int INTENSITY = 1;
+        const unsigned int MID_SIDE = 2;
+        unsigned int modes[39];
+        std::fill(modes, modes + layout.count, header.modeExtension);
+
+        if (header.modeExtension & INTENSITY) {
+            const float* rightLines = spectrum[1];
+            auto nonzero = [rightLines](size_t line, size_t width) {
+                for (size_t i = 0; i < width; ++i) {
+                    if (rightLines[line + i] != 0.0f) {
+                        return true;
+                    }
+                }
+                return false;
+            };
+
+            unsigned int band = 0;
+            size_t line = 0;
+            if (right.blockType == SHORT_BLOCK) {
+                unsigned int lower = 0;
+                unsigned int start = 0;
+                unsigned int top = 0;
+                unsigned int bound[3] = { 0, 0, 0 };
+                for (; band < layout.longCount; line += layout.widths[band], ++band) {
+                    if (nonzero(line, layout.widths[band])) {
+                        lower = band + 1;
+                    }
+                }
+                start = band;
+                for (unsigned int window = 0; band < layout.count; line += layout.widths[band], ++band, window = (window + 1) % 3) {
+                    if (nonzero(line, layout.widths[band])) {
+                        top = bound[window] = band + 1;
+                    }
+                }
+                if (top) {
+                    lower = start;
+                }
+                for (unsigned int i = 0; i < lower; ++i) {
+                    modes[i] &= ~INTENSITY;
+                }
+                for (unsigned int i = start, window = 0; i < top; ++i, window = (window + 1) % 3) {
+                    if (i < bound[window]) {
+                        modes[i] &= ~INTENSITY;
+                    }
+                }
+            } else {
+                unsigned int bound = 0;
+                for (; band < layout.count; line += layout.widths[band], ++band) {
+                    if (nonzero(line, layout.widths[band])) {
+                        bound = band + 1;
+                    }
+                }
+                for (unsigned int i = 0; i < bound; ++i) {
+                    modes[i] &= ~INTENSITY;
+                }
+            }
+
+            // The top band has no position of its own, it continues the one below
+            bool mpeg1 = header.version == 1;
+            unsigned int windows = layout.count == 22 ? 1 : 3;
+            for (unsigned int window = 0; window < windows; ++window) {
+                unsigned int top = layout.count - windows + window;
+                unsigned int below = top - windows;
+                bool continues = (modes[below] & INTENSITY) != 0;
+                positions[top] = continues ? positions[below] : (mpeg1 ? 3 : 0);
+                illegal[top] = continues && illegal[below];
+            }
+        }
+
+        const Tables& t = tables();
+        bool lsf = header.version != 1;
+        const float* lsfScale = t.intensityLsf[right.scalefacCompress & 1];
+        const float root = static_cast<float>(1.0 / std::sqrt(2.0));
+        size_t line = 0;
+        for (unsigned int band = 0; band < layout.count; line += layout.widths[band], ++band) {
+            size_t end = line + layout.widths[band];
+            if ((modes[band] & INTENSITY) && !illegal[band]) {
+                unsigned int position = positions[band];
+                for (size_t i = line; i < end; ++i) {
+                    float left = spectrum[0][i];
+                    if (lsf) {
+                        if (position == 0) {
+                            spectrum[1][i] = left;
+                        } else if (position & 1) {
+                            spectrum[0][i] = left * lsfScale[(position - 1) / 2];
+                            spectrum[1][i] = left;
+                        } else {
+                            spectrum[1][i] = left * lsfScale[(position - 1) / 2];
+                        }
+                    } else {
+                        spectrum[0][i] = left * t.intensityLeft[position];
+                        spectrum[1][i] = left * t.intensityLeft[6 - position];
+                    }
+                }
+            } else if (modes[band] & MID_SIDE) {
+                for (size_t i = line; i < end; ++i) {
+                    float mid = spectrum[0][i];
+                    float side = spectrum[1][i];
+                    spectrum[0][i] = (mid + side) * root;
+                    spectrum[1][i] = (mid - side) * root;
+                }
+            }
+        }
+    }
+
+    // Short bands come window by window; the IMDCT wants each subband's six
+    // lines of window 0, then of 1 and 2
+    void reorderShort(float* spectrum, const BandLayout& layout) {
+        float reordered[576];
+        size_t line = 0;
+        for (unsigned int band = 0; band < layout.longCount; ++band) {
+            line += layout.widths[band];
+        }
+        size_t first = line;
+        size_t frequency = line / 3;
+        for (unsigned int band = layout.longCount; band < layout.count; band += 3) {
+            size_t width = layout.widths[band];
+            for (size_t window = 0; window < 3; ++window) {
+                for (size_t i = 0; i < width; ++i) {
+                    size_t f = frequency + i;
+                    reordered[(f / 6) * 18 + window * 6 + f % 6] = spectrum[line + window * width + i];
+                }
+            }
+            line += 3 * width;
+            frequency += width;
+        }
+        std::copy(reordered + first, reordered + 576, spectrum + first);
+    }
+
+    void reduceAliases(float* spectrum, size_t subbands) {
+        const Tables& t = tables();
+        for (size_t subband = 1; subband < subbands; ++subband) {
+            float* upper = spectrum + 18 * subband;
+            for (size_t i = 0; i < 8; ++i) {
+                float a = upper[-1 - static_cast<ptrdiff_t>(i)];
+                float b = upper[i];
+                upper[-1 - static_cast<ptrdiff_t>(i)] = a * t.aliasCs[i] - b * t.aliasCa[i];
+                upper[i] = b * t.aliasCs[i] + a * t.aliasCa[i];
+            }
+        }
+    }
+
+    // One subband: 18 spectral lines to 36 windowed samples, the first half
+    // completed with the overlap, the second half kept as the next overlap
+    void imdctLong(const float* input, const float* window, float* overlap, float* output) {
+        const Tables& t = tables();
+        float samples[36];
+        for (unsigned int row = 0; row < 9; ++row) {
+            float low = 0.0f;
+            float high = 0.0f;
+            for (unsigned int k = 0; k < 18; ++k) {
+                low += input[k] * t.imdctLong[row][k];
+                high += input[k] * t.imdctLong[row + 9][k];
+            }
+            samples[row] = low;
+            samples[17 - row] = -low;
+            samples[18 + row] = high;
+            samples[35 - row] = high;
+        }
+        for (unsigned int i = 0; i < 18; ++i) {
+            output[i] = samples[i] * window[i] + overlap[i];
+            overlap[i] = samples[18 + i] * window[18 + i];
+        }
+    }
+
+    void imdctShort(const float* input, float* overlap, float* output) {
+        const Tables& t = tables();
+        float samples[36] = {};
+        for (unsigned int window = 0; window < 3; ++window) {
+            const float* lines = input + window * 6;
+            for (unsigned int i = 0; i < 12; ++i) {
+                float sum = 0.0f;
+                for (unsigned int k = 0; k < 6; ++k) {
+                    sum += lines[k] * t.imdctShort[i][k];
+                }
+                samples[6 + window * 6 + i] += sum * t.shortWindow[i];
+            }
+        }
+        for (unsigned int i = 0; i < 18; ++i) {
+            output[i] = samples[i] + overlap[i];
+            overlap[i] = samples[18 + i];
+        }
+    }
+}
+
+Layer3Decoder::Layer3Decoder() {
+    reset();
+}
+
+void Layer3Decoder::reset() {
+    reservoir.clear();
+    std::memset(scalefactors, 0, sizeof(scalefactors));
+    std::memset(overlap, 0, sizeof(overlap));
+    std::memset(synthesis, 0, sizeof(synthesis));
+    synthesisSlot[0] = synthesisSlot[1] = 0;
+}
+
+void Layer3Decoder::feedFrame(const unsigned char* frame, size_t size, const Mp3FrameHeader& header) {
+    size_t offset = mainDataOffset(header);
+    if (size > offset) {
+        keepMainData(frame + offset, size - offset);
+    }
+}
+
+void Layer3Decoder::keepMainData(const unsigned char* data, size_t size) {
+    reservoir.insert(reservoir.end(), data, data + size);
+    if (reservoir.size() > MAX_RESERVOIR_BYTES) {
+        reservoir.erase(reservoir.begin(), reservoir.end() - MAX_RESERVOIR_BYTES);
+    }
+}
+
+bool Layer3Decoder::decodeFrame(const unsigned char* frame, size_t size, const Mp3FrameHeader& header, float* output) {
+    const Tables& t = tables();
+    unsigned int channels = header.channels;
+    unsigned int granules = header.version == 1 ? 2 : 1;
+    bool mpeg1 = header.version == 1;
+    size_t offset = mainDataOffset(header);
+
+    SideInfo side;
+    bool valid = readSideInfo(frame, size, header, side);
+    if (valid && side.mainDataBegin > reservoir.size()) {
+        valid = false; // Starts in frames we never saw, right after a seek or damage
+    }
+    if (valid) {
+        mainData.assign(reservoir.end() - side.mainDataBegin, reservoir.end());
+        mainData.insert(mainData.end(), frame + offset, frame + size);
+    }
+    if (size > offset) {
+        keepMainData(frame + offset, size - offset);
+    }
+
+    BitReader bits(mainData.data(), valid ? mainData.size() : 0);
+    const BandLayout* layouts = t.layouts[rateIndex(header.sampleRate)];
+    bool jointStereo = channels == 2 && header.channelMode == 1 && header.modeExtension != 0;
+    for (unsigned int granule = 0; granule < granules; ++granule) {
+        size_t nonzero[2] = { 0, 0 };
+        uint8_t positions[39];
+        bool illegal[39];
+
+        for (unsigned int channel = 0; channel < channels && valid; ++channel) {
+            const ChannelInfo& info = side.channels[granule][channel];
+            const BandLayout& layout = layouts[info.layout()];
+            size_t part2Start = bits.tell();
+            size_t endBit = part2Start + info.part23Length;
+
+            bool preflag = info.preflag;
+            if (mpeg1) {
+                readScalefactors(bits, info, side.scfsi[channel], granule, scalefactors[channel]);
+            } else {
+                readLsfScalefactors(bits, info, jointStereo && (header.modeExtension & 1) && channel == 1,
+                                    scalefactors[channel], illegal, preflag);
+            }
+            nonzero[channel] = readSpectrum(bits, endBit, info, layout, quantized);
+            requantize(quantized, nonzero[channel], info, layout, scalefactors[channel], preflag, spectrum[channel]);
+            bits.seek(endBit);
+        }
+        if (!valid) {
+            std::memset(spectrum, 0, sizeof(spectrum));
+        }
+
+        if (jointStereo && valid) {
+            const ChannelInfo& right = side.channels[granule][1];
+            std::copy(scalefactors[1], scalefactors[1] + 39, positions);
+            if (mpeg1) {
+                for (unsigned int band = 0; band < 39; ++band) {
+                    illegal[band] = positions[band] >= 7;
+                }
+            }
+            processStereo(spectrum, header, right, layouts[right.layout()], positions, illegal);
+            nonzero[0] = nonzero[1] = 576;
+        }
+
+        for (unsigned int channel = 0; channel < channels; ++channel) {
+            const ChannelInfo& info = side.channels[granule][channel];
+            unsigned int blockType = valid ? info.blockType : 0;
+            bool mixed = valid && info.mixed;
+            if (blockType == SHORT_BLOCK) {
+                reorderShort(spectrum[channel], layouts[info.layout()]);
+                if (mixed) {
+                    reduceAliases(spectrum[channel], 2);
+                }
+            } else {
+                reduceAliases(spectrum[channel], (std::min)(static_cast<size_t>(32), (nonzero[channel] + 17) / 18 + 1));
+            }
+            synthesize(channel, blockType, mixed, nonzero[channel], output + granule * 576 * channels, channels);
+        }
+    }
+    return valid;
+}
+
+void Layer3Decoder::synthesize(unsigned int channel, unsigned int blockType, bool mixed, size_t nonzero,
+                               float* output, unsigned int channels) {
+    const Tables& t = tables();
+    const float* lines = spectrum[channel];
+    float subbandSamples[18][32];
+
+    // Subbands above the last nonzero line (and the one alias reduction spills
+    // into) only have their overlap left to hand out
+    size_t active = blockType == SHORT_BLOCK ? 32 : (std::min)(static_cast<size_t>(32), (nonzero + 17) / 18 + 1);
+    for (size_t subband = 0; subband < 32; ++subband) {
+        float* saved = overlap[channel] + subband * 18;
+        float samples[18];
+        if (subband >= active) {
+            std::copy(saved, saved + 18, samples);
+            std::fill(saved, saved + 18, 0.0f);
+        } else if (blockType == SHORT_BLOCK && (!mixed || subband >= 2)) {
+            imdctShort(lines + subband * 18, saved, samples);
+        } else {
+            imdctLong(lines + subband * 18, t.windows[mixed ? 0 : blockType], saved, samples);
+        }
+        // Odd subbands come out frequency inverted
+        for (size_t i = 0; i < 18; ++i) {
+            subbandSamples[i][subband] = (subband & 1) && (i & 1) ? -samples[i] : samples[i];
+        }
+    }
+
+    // Polyphase synthesis, 32 samples per time slot. V keeps the last 16
+    // matrixed slots; U picks alternating halves of them for the window
+    for (size_t slot = 0; slot < 18; ++slot) {
+        float transformed[32];
+        dct<32>(subbandSamples[slot], transformed, t.dctSecants);
+
+        unsigned int newest = synthesisSlot[channel] = (synthesisSlot[channel] + 15) & 15;
+        float* v = synthesis[channel][newest];
+        for (unsigned int i = 0; i < 16; ++i) {
+            v[i] = transformed[i + 16];
+        }
+        v[16] = 0.0f;
+        for (unsigned int i = 17; i < 48; ++i) {
+            v[i] = -transformed[48 - i];
+        }
+        for (unsigned int i = 48; i < 64; ++i) {
+            v[i] = -transformed[i - 48];
+        }
+
+        float* out = output + slot * 32 * channels + channel;
+        for (unsigned int j = 0; j < 32; ++j) {
+            float sum = 0.0f;
+            for (unsigned int i = 0; i < 8; ++i) {
+                sum += synthesis[channel][(newest + 2 * i) & 15][j] * t.synthesisWindow[64 * i + j];
+                sum += synthesis[channel][(newest + 2 * i + 1) & 15][32 + j] * t.synthesisWindow[64 * i + 32 + j];
+            }
+            out[j * channels] = sum;
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,326 @@
+#include "../headers/loudnessLibrary.hpp"
+#include "../headers/loudnessMeter.hpp"
+#include "../headers/audioBackend.hpp"
+#include "../headers/binaryIO.hpp"
+#include <fstream>
+#include <filesystem>
+#include <algorithm>
+#include <cmath>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace fs = std::filesystem;
+using namespace BinaryIO;
+
+namespace {
+    const uint32_t LOUDNESS_MAGIC = 0x4455444C; // "LDUD"
+    const uint32_t LOUDNESS_VERSION = 1;
+    const size_t ANALYSIS_CHUNK_FRAMES = 16384;
+}
+
+LoudnessLibrary::LoudnessLibrary()
+    : dirty(false), stopping(false), analyzedCount(0), queuedCount(0) {}
+
+LoudnessLibrary::~LoudnessLibrary() {
+    stop();
+}
+
+bool LoudnessLibrary::load(const std::string& filename) {
+    std::ifstream file(filename, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    uint32_t magic = 0;
+    uint32_t version = 0;
+    uint32_t count = 0;
+    if (!readValue(file, magic) || !readValue(file, version) || !readValue(file, count) ||
+        magic != LOUDNESS_MAGIC || version != LOUDNESS_VERSION) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    for (uint32_t i = 0; i < count; ++i) {
+        std::string path;
+        Entry entry;
+        uint8_t measured = 0;
+        if (!readString(file, path) || !readValue(file, entry.fileSize) || !readValue(file, entry.modified) ||
+            !readValue(file, entry.info.integratedLufs) || !readValue(file, entry.info.truePeak) ||
+            !readValue(file, entry.info.gatedBlocks) || !readValue(file, measured)) {
+            break;
+        }
+        entry.info.measured = measured != 0;
+        entries[path] = entry;
+    }
+    dirty = false;
+    return true;
+}
+
+bool LoudnessLibrary::save(const std::string& filename) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!dirty) {
+        return true;
+    }
+
+    std::string tempName = filename + ".tmp";
+    {
+        std::ofstream file(tempName, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            return false;
+        }
+
+        writeValue(file, LOUDNESS_MAGIC);
+        writeValue(file, LOUDNESS_VERSION);
+        writeValue(file, static_cast<uint32_t>(entries.size()));
+        for (const auto& pair : entries) {
+            const Entry& entry = pair.second;
+            writeString(file, pair.first);
+            writeValue(file, entry.fileSize);
+            writeValue(file, entry.modified);
+            writeValue(file, entry.info.integratedLufs);
+            writeValue(file, entry.info.truePeak);
+            writeValue(file, entry.info.gatedBlocks);
+            writeValue(file, static_cast<uint8_t>(entry.info.measured ? 1 : 0));
+        }
+
+        if (!file.good()) {
+            return false;
+        }
+    }
+
+    std::error_code error;
+    fs::rename(tempName, filename, error);
+    if (!error) {
+        dirty = false;
+    }
+    return !error;
+}
+
+void LoudnessLibrary::analyze(const std::vector<std::string>& paths) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (stopping) {
+        return;
+    }
+
+    size_t added = 0;
+    for (const std::string& path : paths) {
+        // The stamp is checked again by the worker, this only skips what is known
+        auto it = entries.find(path);
+        uint64_t fileSize = 0;
+        int64_t modified = 0;
+        if (it != entries.end() && fileStamp(path, fileSize, modified) &&
+            it->second.fileSize == fileSize && it->second.modified == modified) {
+            continue;
+        }
+        pending.push_back(path);
+        added++;
+    }
+    if (added == 0) {
+        return;
+    }
+    queuedCount += added;
+
+    if (workers.empty()) {
+        unsigned int cores = std::thread::hardware_concurrency();
+        unsigned int count = (std::max)(1u, (std::min)(MAX_WORKERS, cores / 2));
+        for (unsigned int i = 0; i < count; ++i) {
+            workers.emplace_back(&LoudnessLibrary::workerLoop, this);
+        }
+    }
+    pendingChanged.notify_all();
+}
+
+void LoudnessLibrary::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        pending.clear();
+    }
+    pendingChanged.notify_all();
+    for (auto& worker : workers) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+    workers.clear();
+}
+
+size_t LoudnessLibrary::getAnalyzedCount() const {
+    return analyzedCount.load();
+}
+
+size_t LoudnessLibrary::getQueuedCount() const {
+    return queuedCount.load();
+}
+
+bool LoudnessLibrary::isBusy() const {
+    return analyzedCount.load() < queuedCount.load();
+}
+
+bool LoudnessLibrary::find(const std::string& path, LoudnessInfo& info) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = entries.find(path);
+    if (it == entries.end() || !it->second.info.measured) {
+        return false;
+    }
+    info = it->second.info;
+    return true;
+}
+
+bool LoudnessLibrary::isAnalyzed(const std::string& path) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return entries.find(path) != entries.end();
+}
+
+float LoudnessLibrary::gainFor(const std::string& path, GainMode mode) const {
+    if (mode == GainMode::OFF) {
+        return 1.0f;
+    }
+
+    double lufs = 0.0;
+    double peak = 0.0;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = entries.find(path);
+        if (it == entries.end() || !it->second.info.measured) {
+            return 1.0f;
+        }
+        lufs = it->second.info.integratedLufs;
+        peak = it->second.info.truePeak;
+
+        if (mode == GainMode::ALBUM) {
+            std::string album = albumOf(path);
+            double energy = 0.0;
+            double weight = 0.0;
+            double albumPeak = 0.0;
+            for (const auto& pair : entries) {
+                const LoudnessInfo& info = pair.second.info;
+                if (!info.measured || info.gatedBlocks == 0 || albumOf(pair.first) != album) {
+                    continue;
+                }
+                energy += info.gatedBlocks * std::pow(10.0, info.integratedLufs / 10.0);
+                weight += info.gatedBlocks;
+                albumPeak = (std::max)(albumPeak, static_cast<double>(info.truePeak));
+            }
+            if (weight > 0.0) {
+                lufs = 10.0 * std::log10(energy / weight);
+                peak = albumPeak;
+            }
+        }
+    }
+
+    double gainDb = (std::min)(REFERENCE_LUFS - lufs, MAX_GAIN_DB);
+    double gain = std::pow(10.0, gainDb / 20.0);
+    if (peak > 0.0) {
+        gain = (std::min)(gain, 1.0 / peak);
+    }
+    return static_cast<float>(gain);
+}
+
+std::string LoudnessLibrary::modeName(GainMode mode) {
+    switch (mode) {
+    case GainMode::TRACK:
+        return "track";
+    case GainMode::ALBUM:
+        return "album";
+    default:
+        return "off";
+    }
+}
+
+bool LoudnessLibrary::parseMode(const std::string& name, GainMode& mode) {
+    std::string lower = name;
+    std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+    if (lower == "off") {
+        mode = GainMode::OFF;
+    } else if (lower == "track") {
+        mode = GainMode::TRACK;
+    } else if (lower == "album") {
+        mode = GainMode::ALBUM;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+void LoudnessLibrary::workerLoop() {
+    // Analysis only gets the CPU time playback and the UI leave over
+#ifdef _WIN32
+    SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_IDLE);
+#elif defined(__linux__)
+    sched_param param = {};
+    pthread_setschedparam(pthread_self(), SCHED_IDLE, &param);
+#endif
+
+    while (true) {
+        std::string path;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            pendingChanged.wait(lock, [this] { return stopping || !pending.empty(); });
+            if (stopping) {
+                return;
+            }
+            path = pending.front();
+            pending.pop_front();
+        }
+
+        Entry entry;
+        if (fileStamp(path, entry.fileSize, entry.modified)) {
+            entry.info = measure(path);
+            std::lock_guard<std::mutex> lock(mutex);
+            if (stopping) {
+                return;
+            }
+            entries[path] = entry;
+            dirty = true;
+        }
+        analyzedCount++;
+    }
+}
+
+bool LoudnessLibrary::fileStamp(const std::string& path, uint64_t& fileSize, int64_t& modified) {
+    std::error_code error;
+    fileSize = static_cast<uint64_t>(fs::file_size(path, error));
+    if (error) {
+        return false;
+    }
+    auto time = fs::last_write_time(path, error);
+    modified = error ? 0 : static_cast<int64_t>(time.time_since_epoch().count());
+    return true;
+}
+
+LoudnessInfo LoudnessLibrary::measure(const std::string& path) const {
+    LoudnessInfo info;
+    std::unique_ptr<AudioBackend> decoder = AudioBackend::openFile(path);
+    if (!decoder) {
+        return info;
+    }
+
+    AudioFormat format = decoder->getFormat();
+    LoudnessMeter meter(format);
+    std::vector<float> chunk(ANALYSIS_CHUNK_FRAMES * format.channels);
+    size_t frames = 0;
+    while ((frames = decoder->decode(chunk.data(), ANALYSIS_CHUNK_FRAMES)) > 0) {
+        if (stopping) {
+            return info; // Quitting, don't hold up the exit for the rest of the file
+        }
+        meter.process(chunk.data(), frames);
+    }
+
+    info.integratedLufs = static_cast<float>(meter.getIntegratedLufs());
+    info.truePeak = static_cast<float>(meter.getTruePeak());
+    info.gatedBlocks = static_cast<uint32_t>(meter.getGatedBlocks());
+    // Silence (or nothing decoded) has no loudness to normalize, it plays at unity gain
+    info.measured = info.gatedBlocks > 0;
+    return info;
+}
+
+std::string LoudnessLibrary::albumOf(const std::string& path) {
+    return fs::path(path).parent_path().string();
+}
\ No newline at end of file
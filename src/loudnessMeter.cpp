@@ -0,0 +1,297 @@
+#include "../headers/loudnessMeter.hpp"
+#include <cmath>
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#include <emmintrin.h>
+#define LOUDNESS_SSE2
+#endif
+
+namespace {
+    const double PI = 3.14159265358979323846;
+    const double ABSOLUTE_GATE_LUFS = -70.0;
+    const double RELATIVE_GATE_LU = -10.0;
+
+    double energyToLufs(double energy) {
+        return -0.691 + 10.0 * std::log10(energy);
+    }
+
+    double lufsToEnergy(double lufs) {
+        return std::pow(10.0, (lufs + 0.691) / 10.0);
+    }
+}
+
+LoudnessMeter::LoudnessMeter(const AudioFormat& sourceFormat)
+    : format(sourceFormat), subBlockFill(0), subBlockSum(0.0), peak(0.0) {
+    // K-weighting for any sample rate: the BS.1770 filters are given at 48 kHz,
+    // these are their analog prototypes through the bilinear transform
+    double rate = format.sampleRate;
+
+    // Stage 1, high shelf modelling the head
+    double f0 = 1681.974450955533;
+    double gainDb = 3.999843853973347;
+    double q = 0.7071752369554196;
+    double k = std::tan(PI * f0 / rate);
+    double vh = std::pow(10.0, gainDb / 20.0);
+    double vb = std::pow(vh, 0.4996667741545416);
+    double a0 = 1.0 + k / q + k * k;
+    stages[0].b0 = (vh + vb * k / q + k * k) / a0;
+    stages[0].b1 = 2.0 * (k * k - vh) / a0;
+    stages[0].b2 = (vh - vb * k / q + k * k) / a0;
+    stages[0].a1 = 2.0 * (k * k - 1.0) / a0;
+    stages[0].a2 = (1.0 - k / q + k * k) / a0;
+
+    // Stage 2, the RLB high pass
+    f0 = 38.13547087602444;
+    q = 0.5003270373238773;
+    k = std::tan(PI * f0 / rate);
+    a0 = 1.0 + k / q + k * k;
+    stages[1].b0 = 1.0;
+    stages[1].b1 = -2.0;
+    stages[1].b2 = 1.0;
+    stages[1].a1 = 2.0 * (k * k - 1.0) / a0;
+    stages[1].a2 = (1.0 - k / q + k * k) / a0;
+
+    channels.resize(format.channels);
+    for (auto& channel : channels) {
+        channel.z1[0] = channel.z1[1] = 0.0;
+        channel.z2[0] = channel.z2[1] = 0.0;
+        channel.history.assign(TAPS_PER_PHASE - 1, 0.0f);
+    }
+
+    // Windowed-sinc interpolator split into OVERSAMPLE phases, stored tap-major
+    // and reversed: tap t of all phases sits together and meets input sample t
+    // of the window, so one multiply-add feeds every phase at once
+    const size_t taps = OVERSAMPLE * TAPS_PER_PHASE;
+    std::vector<double> prototype(taps);
+    double center = (taps - 1) / 2.0;
+    double sum = 0.0;
+    for (size_t n = 0; n < taps; ++n) {
+        double x = (n - center) / OVERSAMPLE;
+        double sinc = x == 0.0 ? 1.0 : std::sin(PI * x) / (PI * x);
+        double window = 0.5 - 0.5 * std::cos(2.0 * PI * (n + 0.5) / taps);
+        prototype[n] = sinc * window;
+        sum += prototype[n];
+    }
+    phases.resize(taps);
+    for (size_t p = 0; p < OVERSAMPLE; ++p) {
+        for (size_t t = 0; t < TAPS_PER_PHASE; ++t) {
+            phases[(TAPS_PER_PHASE - 1 - t) * OVERSAMPLE + p] = static_cast<float>(prototype[p + t * OVERSAMPLE] * OVERSAMPLE / sum);
+        }
+    }
+
+    subBlockFrames = (std::max)(1u, format.sampleRate / 10);
+}
+
+void LoudnessMeter::process(const float* frames, size_t frameCount) {
+    if (frameCount == 0 || channels.empty()) {
+        return;
+    }
+
+    const size_t channelCount = channels.size();
+    const size_t historyLength = TAPS_PER_PHASE - 1;
+    planar.resize(historyLength + frameCount);
+    weighted.assign(frameCount, 0.0);
+
+    for (size_t c = 0; c < channelCount; ++c) {
+        ChannelState& channel = channels[c];
+        std::copy(channel.history.begin(), channel.history.end(), planar.begin());
+        float* samples = planar.data() + historyLength;
+        for (size_t i = 0; i < frameCount; ++i) {
+            samples[i] = frames[i * channelCount + c];
+        }
+
+        peak = (std::max)(peak, static_cast<double>(oversampledPeak(planar.data(), frameCount)));
+        std::copy(planar.end() - historyLength, planar.end(), channel.history.begin());
+    }
+
+#ifdef LOUDNESS_SSE2
+    if (channelCount == 2) {
+        kWeightStereo(frames, frameCount);
+    } else
+#endif
+    {
+        for (size_t c = 0; c < channelCount; ++c) {
+            kWeightChannel(c, frames, frameCount);
+        }
+    }
+
+    // Channel weights are 1.0 for left, right and mono
+    size_t offset = 0;
+    while (offset < frameCount) {
+        size_t count = (std::min)(frameCount - offset, subBlockFrames - subBlockFill);
+        double sum = 0.0;
+        for (size_t i = 0; i < count; ++i) {
+            sum += weighted[offset + i];
+        }
+        subBlockSum += sum;
+        subBlockFill += count;
+        offset += count;
+        if (subBlockFill == subBlockFrames) {
+            finishSubBlock();
+        }
+    }
+}
+
+double LoudnessMeter::getIntegratedLufs() const {
+    double energy = 0.0;
+    size_t count = 0;
+    applyGates(energy, count);
+    return count > 0 ? energyToLufs(energy) : ABSOLUTE_GATE_LUFS;
+}
+
+double LoudnessMeter::getTruePeak() const {
+    return peak;
+}
+
+size_t LoudnessMeter::getGatedBlocks() const {
+    double energy = 0.0;
+    size_t count = 0;
+    applyGates(energy, count);
+    return count;
+}
+
+void LoudnessMeter::applyGates(double& energy, size_t& count) const {
+    // 400 ms gating blocks are four consecutive 100 ms steps
+    std::vector<double> blocks;
+    if (subBlocks.size() >= 4) {
+        blocks.reserve(subBlocks.size() - 3);
+        for (size_t i = 3; i < subBlocks.size(); ++i) {
+            blocks.push_back((subBlocks[i - 3] + subBlocks[i - 2] + subBlocks[i - 1] + subBlocks[i]) / 4.0);
+        }
+    }
+
+    double gate = lufsToEnergy(ABSOLUTE_GATE_LUFS);
+    for (int pass = 0; pass < 2; ++pass) {
+        double sum = 0.0;
+        count = 0;
+        for (double block : blocks) {
+            if (block > gate) {
+                sum += block;
+                count++;
+            }
+        }
+        if (count == 0) {
+            energy = 0.0;
+            return;
+        }
+        energy = sum / count;
+        // Second pass: also drop what is more than 10 LU below the first mean
+        gate = (std::max)(gate, lufsToEnergy(energyToLufs(energy) + RELATIVE_GATE_LU));
+    }
+}
+
+void LoudnessMeter::finishSubBlock() {
+    subBlocks.push_back(subBlockSum / subBlockFrames);
+    subBlockSum = 0.0;
+    subBlockFill = 0;
+}
+
+void LoudnessMeter::kWeightChannel(size_t channelIndex, const float* frames, size_t frameCount) {
+    // Both biquads in series, direct form II transposed
+    ChannelState& channel = channels[channelIndex];
+    const size_t channelCount = channels.size();
+    const Biquad& s0 = stages[0];
+    const Biquad& s1 = stages[1];
+    double a1 = channel.z1[0], a2 = channel.z2[0];
+    double b1 = channel.z1[1], b2 = channel.z2[1];
+    for (size_t i = 0; i < frameCount; ++i) {
+        double x = frames[i * channelCount + channelIndex];
+        double y = s0.b0 * x + a1;
+        a1 = s0.b1 * x - s0.a1 * y + a2;
+        a2 = s0.b2 * x - s0.a2 * y;
+
+        double z = s1.b0 * y + b1;
+        b1 = s1.b1 * y - s1.a1 * z + b2;
+        b2 = s1.b2 * y - s1.a2 * z;
+
+        weighted[i] += z * z;
+    }
+    channel.z1[0] = a1;
+    channel.z2[0] = a2;
+    channel.z1[1] = b1;
+    channel.z2[1] = b2;
+}
+
+#ifdef LOUDNESS_SSE2
+void LoudnessMeter::kWeightStereo(const float* frames, size_t frameCount) {
+    // The recursion is serial in time, so the lanes are the two channels:
+    // left and right go through the same filter in one register
+    const Biquad& s0 = stages[0];
+    const Biquad& s1 = stages[1];
+    __m128d b00 = _mm_set1_pd(s0.b0), b01 = _mm_set1_pd(s0.b1), b02 = _mm_set1_pd(s0.b2);
+    __m128d a01 = _mm_set1_pd(s0.a1), a02 = _mm_set1_pd(s0.a2);
+    __m128d b10 = _mm_set1_pd(s1.b0), b11 = _mm_set1_pd(s1.b1), b12 = _mm_set1_pd(s1.b2);
+    __m128d a11 = _mm_set1_pd(s1.a1), a12 = _mm_set1_pd(s1.a2);
+
+    __m128d a1 = _mm_set_pd(channels[1].z1[0], channels[0].z1[0]);
+    __m128d a2 = _mm_set_pd(channels[1].z2[0], channels[0].z2[0]);
+    __m128d b1 = _mm_set_pd(channels[1].z1[1], channels[0].z1[1]);
+    __m128d b2 = _mm_set_pd(channels[1].z2[1], channels[0].z2[1]);
+
+    for (size_t i = 0; i < frameCount; ++i) {
+        __m128d x = _mm_cvtps_pd(_mm_castsi128_ps(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(frames + i * 2))));
+        __m128d y = _mm_add_pd(_mm_mul_pd(b00, x), a1);
+        a1 = _mm_add_pd(_mm_sub_pd(_mm_mul_pd(b01, x), _mm_mul_pd(a01, y)), a2);
+        a2 = _mm_sub_pd(_mm_mul_pd(b02, x), _mm_mul_pd(a02, y));
+
+        __m128d z = _mm_add_pd(_mm_mul_pd(b10, y), b1);
+        b1 = _mm_add_pd(_mm_sub_pd(_mm_mul_pd(b11, y), _mm_mul_pd(a11, z)), b2);
+        b2 = _mm_sub_pd(_mm_mul_pd(b12, y), _mm_mul_pd(a12, z));
+
+        __m128d squared = _mm_mul_pd(z, z);
+        weighted[i] = _mm_cvtsd_f64(_mm_add_sd(squared, _mm_unpackhi_pd(squared, squared)));
+    }
+
+    double lanes[2];
+    _mm_storeu_pd(lanes, a1);
+    channels[0].z1[0] = lanes[0];
+    channels[1].z1[0] = lanes[1];
+    _mm_storeu_pd(lanes, a2);
+    channels[0].z2[0] = lanes[0];
+    channels[1].z2[0] = lanes[1];
+    _mm_storeu_pd(lanes, b1);
+    channels[0].z1[1] = lanes[0];
+    channels[1].z1[1] = lanes[1];
+    _mm_storeu_pd(lanes, b2);
+    channels[0].z2[1] = lanes[0];
+    channels[1].z2[1] = lanes[1];
+}
+#endif
+
+float LoudnessMeter::oversampledPeak(const float* samples, size_t count) const {
+    // samples starts with TAPS_PER_PHASE - 1 samples of history
+    size_t i = 0;
+    float result = 0.0f;
+
+#ifdef LOUDNESS_SSE2
+    static_assert(OVERSAMPLE == 4, "one SSE register holds the four phases");
+    const __m128 signMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+    __m128 best = _mm_setzero_ps();
+    for (; i < count; ++i) {
+        const float* window = samples + i;
+        __m128 y = _mm_setzero_ps();
+        for (size_t t = 0; t < TAPS_PER_PHASE; ++t) {
+            y = _mm_add_ps(y, _mm_mul_ps(_mm_loadu_ps(phases.data() + t * OVERSAMPLE), _mm_set1_ps(window[t])));
+        }
+        best = _mm_max_ps(best, _mm_and_ps(y, signMask));
+        best = _mm_max_ps(best, _mm_and_ps(_mm_set1_ps(window[TAPS_PER_PHASE - 1]), signMask));
+    }
+    float lanes[4];
+    _mm_storeu_ps(lanes, best);
+    result = (std::max)((std::max)(lanes[0], lanes[1]), (std::max)(lanes[2], lanes[3]));
+#endif
+
+    for (; i < count; ++i) {
+        const float* window = samples + i;
+        result = (std::max)(result, std::fabs(window[TAPS_PER_PHASE - 1]));
+        for (size_t p = 0; p < OVERSAMPLE; ++p) {
+            float y = 0.0f;
+            for (size_t t = 0; t < TAPS_PER_PHASE; ++t) {
+                y += phases[t * OVERSAMPLE + p] * window[t];
+            }
+            result = (std::max)(result, std::fabs(y));
+        }
+    }
+    return result;
+}
\ No newline at end of file
@@ -1,7 +1,17 @@
 #include <iostream>
 #include "../headers/musicPlayer.hpp"
 
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#endif
+
 int main() {
+#ifdef _WIN32
+    // Song names and the waveform bars are UTF-8
+    SetConsoleOutputCP(CP_UTF8);
+#endif
+    
     try {
         MusicPlayer player;
         
@@ -0,0 +1,103 @@
+#include "../headers/mappedFile.hpp"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+MappedFile::MappedFile() : file(INVALID_HANDLE_VALUE), mapping(nullptr), view(nullptr), length(0) {}
+#else
+MappedFile::MappedFile() : descriptor(-1), view(nullptr), length(0) {}
+#endif
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+bool MappedFile::open(const std::string& path) {
+    close();
+
+#ifdef _WIN32
+    // Sharing everything, the file can still be renamed over once this is closed
+    file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr,
+                       OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+        close();
+        return false;
+    }
+    mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping) {
+        close();
+        return false;
+    }
+    view = static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    length = static_cast<size_t>(fileSize.QuadPart);
+#else
+    descriptor = ::open(path.c_str(), O_RDONLY);
+    if (descriptor < 0) {
+        return false;
+    }
+    struct stat info;
+    if (fstat(descriptor, &info) != 0 || info.st_size == 0) {
+        close();
+        return false;
+    }
+    void* address = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_SHARED, descriptor, 0);
+    view = address == MAP_FAILED ? nullptr : static_cast<const uint8_t*>(address);
+    length = static_cast<size_t>(info.st_size);
+#endif
+
+    if (!view) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void MappedFile::close() {
+#ifdef _WIN32
+    if (view) {
+        UnmapViewOfFile(view);
+    }
+    if (mapping) {
+        CloseHandle(mapping);
+    }
+    if (file != INVALID_HANDLE_VALUE) {
+        CloseHandle(file);
+    }
+    mapping = nullptr;
+    file = INVALID_HANDLE_VALUE;
+#else
+    if (view) {
+        munmap(const_cast<uint8_t*>(view), length);
+    }
+    if (descriptor >= 0) {
+        ::close(descriptor);
+    }
+    descriptor = -1;
+#endif
+    view = nullptr;
+    length = 0;
+}
+
+bool MappedFile::isOpen() const {
+    return view != nullptr;
+}
+
+const uint8_t* MappedFile::data() const {
+    return view;
+}
+
+size_t MappedFile::size() const {
+    return length;
+}
\ No newline at end of file
@@ -0,0 +1,566 @@
+#include "../headers/mp3Decoder.hpp"
+#include "../headers/layer3Decoder.hpp"
+#include <cstring>
+#include <algorithm>
+#include <vector>
+#include <filesystem>
+#include <cmath>
+
+namespace {
+    // Bitrates in kbit/s, index 0 is free format (unsupported) and 15 is invalid
+    const unsigned short BITRATES_V1[3][16] = {
+        { 0, 32, 64, 96, 128, 160, 192, 224, 256, 288, 320, 352, 384, 416, 448, 0 }, // Layer I
+        { 0, 32, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384, 0 },    // Layer II
+        { 0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 0 }      // Layer III
+    };
+    const unsigned short BITRATES_V2[3][16] = {
+        { 0, 32, 48, 56, 64, 80, 96, 112, 128, 144, 160, 176, 192, 224, 256, 0 },    // Layer I
+        { 0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160, 0 },         // Layer II
+        { 0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160, 0 }          // Layer III
+    };
+    const unsigned int SAMPLE_RATES_V1[3] = { 44100, 48000, 32000 };
+
+    uint32_t readBE32(const unsigned char* p) {
+        return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+               (static_cast<uint32_t>(p[2]) << 8) | static_cast<uint32_t>(p[3]);
+    }
+
+    const uint64_t MAX_RESYNC_BYTES = 1 << 20;
+    const size_t INDEX_READ_BYTES = 256 * 1024;
+
+    // Samples the synthesis filterbank and the IMDCT overlap delay the output by
+    const unsigned int DECODER_DELAY = 529;
+    // Frames decoded and dropped before a seek target, to rebuild the overlap and the filterbank history
+    const uint64_t DECODED_PREROLL_FRAMES = 2;
+    const uint64_t MAX_RESERVOIR_FRAMES = 30;
+}
+
+bool Mp3FrameHeader::parse(const unsigned char* b) {
+    if (b[0] != 0xFF || (b[1] & 0xE0) != 0xE0) {
+        return false;
+    }
+
+    int versionBits = (b[1] >> 3) & 0x03;
+    int layerBits = (b[1] >> 1) & 0x03;
+    int bitrateIndex = (b[2] >> 4) & 0x0F;
+    int rateIndex = (b[2] >> 2) & 0x03;
+    int padding = (b[2] >> 1) & 0x01;
+    int modeBits = (b[3] >> 6) & 0x03;
+
+    if (versionBits == 1 || layerBits == 0 || bitrateIndex == 0 || bitrateIndex == 15 || rateIndex == 3) {
+        return false;
+    }
+
+    version = versionBits == 3 ? 1 : (versionBits == 2 ? 2 : 25);
+    layer = 4 - layerBits;
+    bitrate = (version == 1 ? BITRATES_V1 : BITRATES_V2)[layer - 1][bitrateIndex] * 1000u;
+    sampleRate = SAMPLE_RATES_V1[rateIndex] >> (version == 1 ? 0 : (version == 2 ? 1 : 2));
+    channelMode = static_cast<unsigned int>(modeBits);
+    modeExtension = (b[3] >> 4) & 0x03;
+    hasCrc = (b[1] & 0x01) == 0;
+    channels = channelMode == 3 ? 1 : 2;
+
+    if (layer == 1) {
+        samplesPerFrame = 384;
+        frameBytes = (12 * bitrate / sampleRate + padding) * 4;
+    } else {
+        samplesPerFrame = (layer == 3 && version != 1) ? 576 : 1152;
+        frameBytes = (samplesPerFrame / 8) * bitrate / sampleRate + padding;
+    }
+
+    return frameBytes >= 4;
+}
+
+Mp3Decoder::Mp3Decoder()
+    : fileSize(0), firstFrameOffset(0), audioEndOffset(0), nextFrameOffset(0), lengthFrames(0), positionFrames(0),
+      samplesPerFrame(1152), frameRemaining(0), frameRead(0), encoderDelay(0), encoderPadding(0), startSkip(0),
+      layer3(new Layer3Decoder()), preRollFrames(DECODED_PREROLL_FRAMES), feedFrames(0), discardFrames(0),
+      averageFrameBytes(0.0), tocPresent(false), tocBase(0), tocBytes(0), lengthEstimated(false), modifiedTime(0) {
+    std::memset(toc, 0, sizeof(toc));
+}
+
+Mp3Decoder::~Mp3Decoder() {
+    close();
+}
+
+bool Mp3Decoder::probe(const unsigned char* header, size_t size) {
+    if (size >= 3 && std::memcmp(header, "ID3", 3) == 0) {
+        return true;
+    }
+    Mp3FrameHeader frame;
+    return size >= 4 && frame.parse(header);
+}
+
+uint64_t Mp3Decoder::skipId3v2(const unsigned char* header, size_t size) {
+    if (size < 10 || std::memcmp(header, "ID3", 3) != 0) {
+        return 0;
+    }
+
+    // Tag size is a 28-bit syncsafe integer, plus 10 header bytes and an optional footer
+    uint64_t tagSize = (static_cast<uint64_t>(header[6] & 0x7F) << 21) | (static_cast<uint64_t>(header[7] & 0x7F) << 14) |
+                       (static_cast<uint64_t>(header[8] & 0x7F) << 7) | static_cast<uint64_t>(header[9] & 0x7F);
+    bool hasFooter = (header[5] & 0x10) != 0;
+    return 10 + tagSize + (hasFooter ? 10 : 0);
+}
+
+bool Mp3Decoder::open(const std::string& path) {
+    close();
+    file.open(path, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    file.seekg(0, std::ios::end);
+    fileSize = static_cast<uint64_t>(file.tellg());
+    file.seekg(0);
+
+    std::error_code error;
+    auto modified = std::filesystem::last_write_time(path, error);
+    filePath = path;
+    modifiedTime = error ? 0 : static_cast<int64_t>(modified.time_since_epoch().count());
+
+    unsigned char id3[10] = {};
+    file.read(reinterpret_cast<char*>(id3), sizeof(id3));
+    uint64_t start = skipId3v2(id3, static_cast<size_t>(file.gcount()));
+
+    // ID3v1 tag at the end isn't audio
+    audioEndOffset = fileSize;
+    if (fileSize >= 128) {
+        char tag[3] = {};
+        file.clear();
+        file.seekg(static_cast<std::streamoff>(fileSize - 128));
+        file.read(tag, 3);
+        if (std::memcmp(tag, "TAG", 3) == 0) {
+            audioEndOffset = fileSize - 128;
+        }
+    }
+
+    uint64_t frameOffset = 0;
+    Mp3FrameHeader header;
+    if (!resync(start, frameOffset, header) || header.layer != 3) {
+        close();
+        return false;
+    }
+
+    format = AudioFormat(header.sampleRate, header.channels);
+    samplesPerFrame = header.samplesPerFrame;
+    averageFrameBytes = (samplesPerFrame / 8.0) * header.bitrate / header.sampleRate;
+
+    // The first frame may be a Xing/Info/VBRI frame carrying length and seek table
+    std::vector<unsigned char> firstFrame(header.frameBytes);
+    file.clear();
+    file.seekg(static_cast<std::streamoff>(frameOffset));
+    file.read(reinterpret_cast<char*>(firstFrame.data()), static_cast<std::streamsize>(firstFrame.size()));
+
+    uint64_t totalFrames = 0;
+    parseVbrHeader(firstFrame.data(), static_cast<size_t>(file.gcount()), header, totalFrames);
+
+    if (totalFrames > 0) {
+        tocBase = frameOffset;
+        firstFrameOffset = frameOffset + header.frameBytes;
+        if (tocBytes > 0 && totalFrames > 0) {
+            averageFrameBytes = static_cast<double>(tocBytes) / (totalFrames + 1);
+        }
+    }
+
+    lengthEstimated = totalFrames == 0;
+    if (lengthEstimated) {
+        firstFrameOffset = frameOffset;
+        totalFrames = static_cast<uint64_t>((audioEndOffset - firstFrameOffset) / averageFrameBytes);
+    }
+    setLengthFromFrames(totalFrames);
+
+    // A seek starts early enough for the reservoir the target frame may reach back into
+    double sideInfo = header.version == 1 ? (header.channels == 2 ? 32.0 : 17.0) : (header.channels == 2 ? 17.0 : 9.0);
+    double mainBytes = (std::max)(1.0, averageFrameBytes - 4.0 - sideInfo);
+    double reservoirBytes = header.version == 1 ? 511.0 : 255.0;
+    preRollFrames = static_cast<unsigned int>(DECODED_PREROLL_FRAMES +
+                                              (std::min)(static_cast<double>(MAX_RESERVOIR_FRAMES), std::ceil(reservoirBytes / mainBytes)));
+
+    // An index from an earlier run also knows the exact length of a file without a VBR header
+    seekIndex = SeekIndexCache::getInstance().find(filePath, fileSize, modifiedTime);
+    if (seekIndex && lengthEstimated) {
+        setLengthFromFrames(seekIndex->frameCount);
+    }
+
+    if (!seekToFrameStart(firstFrameOffset, 0)) {
+        return false;
+    }
+    discardFrames = startSkip;
+    return true;
+}
+
+void Mp3Decoder::parseVbrHeader(const unsigned char* frame, size_t size, const Mp3FrameHeader& header, uint64_t& totalFrames) {
+    totalFrames = 0;
+    tocPresent = false;
+    tocBytes = 0;
+    encoderDelay = 0;
+    encoderPadding = 0;
+    startSkip = 0;
+
+    size_t sideInfo = header.version == 1 ? (header.channels == 2 ? 32 : 17) : (header.channels == 2 ? 17 : 9);
+    size_t xing = 4 + sideInfo;
+
+    if (size >= xing + 8 && (std::memcmp(frame + xing, "Xing", 4) == 0 || std::memcmp(frame + xing, "Info", 4) == 0)) {
+        uint32_t flags = readBE32(frame + xing + 4);
+        size_t p = xing + 8;
+
+        if ((flags & 0x1) && p + 4 <= size) {
+            totalFrames = readBE32(frame + p);
+            p += 4;
+        }
+        if ((flags & 0x2) && p + 4 <= size) {
+            tocBytes = readBE32(frame + p);
+            p += 4;
+        }
+        if ((flags & 0x4) && p + 100 <= size) {
+            std::memcpy(toc, frame + p, 100);
+            tocPresent = tocBytes > 0;
+            p += 100;
+        }
+        if (flags & 0x8) {
+            p += 4;
+        }
+
+        // LAME/Lavc extension: 12-bit encoder delay and padding at byte 21
+        if (p + 24 <= size && (std::memcmp(frame + p, "LAME", 4) == 0 || std::memcmp(frame + p, "Lavc", 4) == 0 ||
+                               std::memcmp(frame + p, "Lavf", 4) == 0)) {
+            encoderDelay = (static_cast<unsigned int>(frame[p + 21]) << 4) | (frame[p + 22] >> 4);
+            encoderPadding = (static_cast<unsigned int>(frame[p + 22] & 0x0F) << 8) | frame[p + 23];
+            startSkip = encoderDelay + DECODER_DELAY;
+        }
+        if (totalFrames == 0) {
+            // An Info frame without a count still isn't audio
+            totalFrames = static_cast<uint64_t>((audioEndOffset - header.frameBytes) / averageFrameBytes);
+        }
+    } else if (size >= 36 + 18 && std::memcmp(frame + 36, "VBRI", 4) == 0) {
+        tocBytes = readBE32(frame + 36 + 10);
+        totalFrames = readBE32(frame + 36 + 14);
+    }
+}
+
+size_t Mp3Decoder::decode(float* buffer, size_t frameCount) {
+    size_t produced = 0;
+    size_t channels = format.channels;
+
+    while (produced < frameCount && positionFrames < lengthFrames) {
+        if (frameRemaining == 0 && !decodeNextFrame()) {
+            break;
+        }
+
+        size_t count = (std::min)(static_cast<size_t>(frameRemaining), frameCount - produced);
+        count = static_cast<size_t>((std::min)(static_cast<uint64_t>(count), lengthFrames - positionFrames));
+
+        std::memcpy(buffer + produced * channels, framePcm.data() + static_cast<size_t>(frameRead) * channels,
+                    count * channels * sizeof(float));
+        produced += count;
+        frameRead += static_cast<unsigned int>(count);
+        frameRemaining -= static_cast<unsigned int>(count);
+        positionFrames += count;
+    }
+
+    return produced;
+}
+
+bool Mp3Decoder::decodeNextFrame() {
+    for (;;) {
+        Mp3FrameHeader header;
+        uint64_t frameOffset = 0;
+        if (nextFrameOffset >= audioEndOffset || !resync(nextFrameOffset, frameOffset, header)) {
+            return false;
+        }
+        nextFrameOffset = frameOffset + header.frameBytes;
+        if (header.layer != 3 || header.sampleRate != format.sampleRate) {
+            continue; // Junk that happens to look like a frame of another stream
+        }
+
+        frameData.resize(header.frameBytes);
+        file.clear();
+        file.seekg(static_cast<std::streamoff>(frameOffset));
+        file.read(reinterpret_cast<char*>(frameData.data()), static_cast<std::streamsize>(frameData.size()));
+        size_t size = static_cast<size_t>(file.gcount());
+
+        if (feedFrames > 0) {
+            layer3->feedFrame(frameData.data(), size, header);
+            feedFrames--;
+            continue;
+        }
+
+        unsigned int channels = format.channels;
+        unsigned int samples = header.samplesPerFrame;
+        framePcm.resize(static_cast<size_t>(samples) * channels);
+        if (header.channels == channels) {
+            layer3->decodeFrame(frameData.data(), size, header, framePcm.data());
+        } else {
+            // The channel count changed mid-stream: mono goes to both sides, stereo is averaged
+            decodedPcm.resize(static_cast<size_t>(samples) * header.channels);
+            layer3->decodeFrame(frameData.data(), size, header, decodedPcm.data());
+            for (size_t i = 0; i < samples; ++i) {
+                if (channels == 2) {
+                    framePcm[2 * i] = framePcm[2 * i + 1] = decodedPcm[i];
+                } else {
+                    framePcm[i] = 0.5f * (decodedPcm[2 * i] + decodedPcm[2 * i + 1]);
+                }
+            }
+        }
+
+        frameRead = 0;
+        frameRemaining = samples;
+        if (discardFrames > 0) {
+            unsigned int skip = static_cast<unsigned int>((std::min)(discardFrames, static_cast<uint64_t>(samples)));
+            frameRead = skip;
+            frameRemaining -= skip;
+            discardFrames -= skip;
+        }
+        if (frameRemaining > 0) {
+            return true;
+        }
+    }
+}
+
+bool Mp3Decoder::seek(uint64_t frame) {
+    // Normally done by the decode thread after load, otherwise the first real seek pays for it
+    if (file.is_open() && (std::min)(frame, lengthFrames) >= samplesPerFrame) {
+        prepareSeeking();
+    }
+    return seekNear(frame);
+}
+
+bool Mp3Decoder::seekNear(uint64_t frame) {
+    if (!file.is_open()) {
+        return false;
+    }
+    frame = (std::min)(frame, lengthFrames);
+
+    // The decoded stream runs startSkip samples ahead of the song
+    uint64_t decoded = frame + startSkip;
+    uint64_t mpegFrame = decoded / samplesPerFrame;
+    uint64_t first = mpegFrame > preRollFrames ? mpegFrame - preRollFrames : 0;
+    uint64_t frameOffset = 0;
+    Mp3FrameHeader header;
+    if (!findFrame(first, frameOffset, header) || !seekToFrameStart(frameOffset, frame)) {
+        return false;
+    }
+
+    // The frames just before the target are decoded for the overlap and the
+    // filterbank, the ones before those only refill the bit reservoir
+    uint64_t early = mpegFrame - first;
+    feedFrames = early > DECODED_PREROLL_FRAMES ? early - DECODED_PREROLL_FRAMES : 0;
+    discardFrames = (early - feedFrames) * samplesPerFrame + decoded % samplesPerFrame;
+    return true;
+}
+
+bool Mp3Decoder::findFrame(uint64_t mpegFrame, uint64_t& frameOffset, Mp3FrameHeader& header) {
+    if (seekIndex && !seekIndex->offsets.empty()) {
+        // Start at the nearest indexed frame and step over the headers in between
+        size_t entry = static_cast<size_t>((std::min)(mpegFrame / Mp3SeekIndex::FRAMES_PER_ENTRY,
+                                                      static_cast<uint64_t>(seekIndex->offsets.size() - 1)));
+        uint64_t current = static_cast<uint64_t>(entry) * Mp3SeekIndex::FRAMES_PER_ENTRY;
+        if (!resync(firstFrameOffset + seekIndex->offsets[entry], frameOffset, header)) {
+            return false;
+        }
+        while (current < mpegFrame && frameOffset + header.frameBytes < audioEndOffset) {
+            uint64_t nextOffset = 0;
+            Mp3FrameHeader next;
+            if (!resync(frameOffset + header.frameBytes, nextOffset, next)) {
+                break;
+            }
+            frameOffset = nextOffset;
+            header = next;
+            current++;
+        }
+        return true;
+    }
+
+    uint64_t byteOffset = 0;
+    if (tocPresent && lengthFrames > 0) {
+        // Interpolate in the Xing table (100 entries, 1/256 resolution)
+        double percent = 100.0 * mpegFrame * samplesPerFrame / lengthFrames;
+        int index = (std::min)(99, static_cast<int>(percent));
+        double low = toc[index];
+        double high = index < 99 ? toc[index + 1] : 256.0;
+        double fraction = low + (high - low) * (percent - index);
+        byteOffset = tocBase + static_cast<uint64_t>(fraction / 256.0 * tocBytes);
+    } else {
+        byteOffset = firstFrameOffset + static_cast<uint64_t>(mpegFrame * averageFrameBytes);
+    }
+    byteOffset = (std::max)(byteOffset, firstFrameOffset);
+    return resync(byteOffset, frameOffset, header);
+}
+
+void Mp3Decoder::prepareSeeking() {
+    // Offsets are stored in 32 bits, bigger files keep the estimate
+    if (seekIndex || !file.is_open() || audioEndOffset - firstFrameOffset > 0xFFFFFFFFULL) {
+        return;
+    }
+
+    // One pass over the frame headers, reading big blocks instead of seeking to every frame
+    std::shared_ptr<Mp3SeekIndex> index = std::make_shared<Mp3SeekIndex>();
+    std::vector<unsigned char> block(INDEX_READ_BYTES);
+    uint64_t blockStart = 0;
+    size_t blockSize = 0;
+    uint64_t offset = firstFrameOffset;
+
+    while (offset + 4 <= audioEndOffset) {
+        if (offset < blockStart || offset + 4 > blockStart + blockSize) {
+            file.clear();
+            file.seekg(static_cast<std::streamoff>(offset));
+            file.read(reinterpret_cast<char*>(block.data()),
+                      static_cast<std::streamsize>((std::min)(static_cast<uint64_t>(block.size()), audioEndOffset - offset)));
+            blockStart = offset;
+            blockSize = static_cast<size_t>(file.gcount());
+            if (blockSize < 4) {
+                break;
+            }
+        }
+
+        Mp3FrameHeader header;
+        if (!header.parse(block.data() + (offset - blockStart))) {
+            // Junk between frames, skip it the same way decode() does
+            uint64_t found = 0;
+            if (!resync(offset, found, header)) {
+                break;
+            }
+            offset = found;
+        }
+
+        if (index->frameCount % Mp3SeekIndex::FRAMES_PER_ENTRY == 0) {
+            index->offsets.push_back(static_cast<uint32_t>(offset - firstFrameOffset));
+        }
+        index->frameCount++;
+        offset += header.frameBytes;
+    }
+
+    seekIndex = index;
+    SeekIndexCache::getInstance().store(filePath, fileSize, modifiedTime, seekIndex);
+
+    // The average bitrate of the first frame is a poor guess for VBR, the walk counted every frame
+    if (lengthEstimated) {
+        setLengthFromFrames(index->frameCount);
+    }
+}
+
+void Mp3Decoder::setLengthFromFrames(uint64_t totalFrames) {
+    uint64_t totalSamples = totalFrames * samplesPerFrame;
+    uint64_t trimmed = static_cast<uint64_t>(encoderDelay) + encoderPadding;
+    lengthFrames = totalSamples > trimmed ? totalSamples - trimmed : totalSamples;
+}
+
+bool Mp3Decoder::seekToFrameStart(uint64_t byteOffset, uint64_t frame) {
+    if (!file.is_open()) {
+        return false;
+    }
+    nextFrameOffset = byteOffset;
+    frameRemaining = 0;
+    frameRead = 0;
+    feedFrames = 0;
+    discardFrames = 0;
+    layer3->reset();
+    positionFrames = (std::min)(frame, lengthFrames);
+    return true;
+}
+
+void Mp3Decoder::close() {
+    if (file.is_open()) {
+        file.close();
+    }
+    file.clear();
+    fileSize = 0;
+    lengthFrames = 0;
+    positionFrames = 0;
+    frameRemaining = 0;
+    feedFrames = 0;
+    discardFrames = 0;
+    tocPresent = false;
+    seekIndex.reset();
+    layer3->reset();
+}
+
+AudioFormat Mp3Decoder::getFormat() const {
+    return format;
+}
+
+uint64_t Mp3Decoder::getLengthFrames() const {
+    return lengthFrames;
+}
+
+uint64_t Mp3Decoder::getPositionFrames() const {
+    return positionFrames;
+}
+
+uint64_t Mp3Decoder::getFirstFrameOffset() const {
+    return firstFrameOffset;
+}
+
+uint64_t Mp3Decoder::getAudioEndOffset() const {
+    return audioEndOffset;
+}
+
+unsigned int Mp3Decoder::getSamplesPerFrame() const {
+    return samplesPerFrame;
+}
+
+unsigned int Mp3Decoder::getEncoderDelay() const {
+    return encoderDelay;
+}
+
+bool Mp3Decoder::hasToc() const {
+    return tocPresent;
+}
+
+bool Mp3Decoder::hasSeekIndex() const {
+    return seekIndex != nullptr;
+}
+
+bool Mp3Decoder::readHeaderAt(uint64_t offset, Mp3FrameHeader& header) {
+    unsigned char bytes[4];
+    file.clear();
+    file.seekg(static_cast<std::streamoff>(offset));
+    if (!file.read(reinterpret_cast<char*>(bytes), 4)) {
+        return false;
+    }
+    return header.parse(bytes);
+}
+
+bool Mp3Decoder::resync(uint64_t fromOffset, uint64_t& frameOffset, Mp3FrameHeader& header) {
+    // Fast path: we're already on a frame
+    if (readHeaderAt(fromOffset, header)) {
+        frameOffset = fromOffset;
+        return true;
+    }
+
+    // Scan for a sync word whose successor frame also looks right, so random
+    // 0xFFE bit patterns in tag data aren't taken for a frame
+    const size_t chunkSize = 16384;
+    std::vector<unsigned char> chunk(chunkSize + 4);
+    uint64_t limit = (std::min)(audioEndOffset, fromOffset + MAX_RESYNC_BYTES);
+
+    for (uint64_t base = fromOffset; base < limit; base += chunkSize) {
+        file.clear();
+        file.seekg(static_cast<std::streamoff>(base));
+        file.read(reinterpret_cast<char*>(chunk.data()), static_cast<std::streamsize>(chunk.size()));
+        size_t got = static_cast<size_t>(file.gcount());
+        if (got < 4) {
+            return false;
+        }
+
+        for (size_t i = 0; i + 4 <= got && i < chunkSize; ++i) {
+            Mp3FrameHeader candidate;
+            if (!candidate.parse(chunk.data() + i)) {
+                continue;
+            }
+
+            uint64_t offset = base + i;
+            Mp3FrameHeader following;
+            bool atEnd = offset + candidate.frameBytes + 4 > audioEndOffset;
+            if (atEnd || (readHeaderAt(offset + candidate.frameBytes, following) &&
+                          following.sampleRate == candidate.sampleRate && following.layer == candidate.layer)) {
+                header = candidate;
+                frameOffset = offset;
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
\ No newline at end of file
@@ -0,0 +1,155 @@
+#include "../headers/mp3SeekIndex.hpp"
+#include "../headers/binaryIO.hpp"
+#include <fstream>
+#include <filesystem>
+#include <algorithm>
+
+namespace fs = std::filesystem;
+using namespace BinaryIO;
+
+namespace {
+    const uint32_t SEEK_INDEX_MAGIC = 0x58494B53; // "SKIX"
+    const uint32_t SEEK_INDEX_VERSION = 1;
+    const uint32_t MAX_ENTRIES_PER_FILE = 1 << 22;
+}
+
+SeekIndexCache::SeekIndexCache() : useCounter(0), dirty(false) {}
+
+SeekIndexCache& SeekIndexCache::getInstance() {
+    static SeekIndexCache instance;
+    return instance;
+}
+
+bool SeekIndexCache::load(const std::string& filename) {
+    std::ifstream file(filename, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    uint32_t magic = 0;
+    uint32_t version = 0;
+    uint32_t count = 0;
+    if (!readValue(file, magic) || !readValue(file, version) || !readValue(file, count) ||
+        magic != SEEK_INDEX_MAGIC || version != SEEK_INDEX_VERSION) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    for (uint32_t i = 0; i < count; ++i) {
+        std::string path;
+        Entry entry;
+        uint32_t offsetCount = 0;
+        std::shared_ptr<Mp3SeekIndex> index = std::make_shared<Mp3SeekIndex>();
+        if (!readString(file, path) || !readValue(file, entry.fileSize) || !readValue(file, entry.modified) ||
+            !readValue(file, entry.lastUsed) || !readValue(file, index->frameCount) ||
+            !readValue(file, offsetCount) || offsetCount > MAX_ENTRIES_PER_FILE) {
+            break;
+        }
+        index->offsets.resize(offsetCount);
+        if (offsetCount > 0 && !file.read(reinterpret_cast<char*>(index->offsets.data()), offsetCount * sizeof(uint32_t))) {
+            break;
+        }
+        entry.index = index;
+        useCounter = (std::max)(useCounter, entry.lastUsed);
+        entries[path] = entry;
+    }
+    dirty = false;
+    return true;
+}
+
+bool SeekIndexCache::save(const std::string& filename) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!dirty) {
+        return true;
+    }
+
+    std::string tempName = filename + ".tmp";
+    {
+        std::ofstream file(tempName, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            return false;
+        }
+
+        writeValue(file, SEEK_INDEX_MAGIC);
+        writeValue(file, SEEK_INDEX_VERSION);
+        writeValue(file, static_cast<uint32_t>(entries.size()));
+        for (const auto& pair : entries) {
+            const Entry& entry = pair.second;
+            writeString(file, pair.first);
+            writeValue(file, entry.fileSize);
+            writeValue(file, entry.modified);
+            writeValue(file, entry.lastUsed);
+            writeValue(file, entry.index->frameCount);
+            writeValue(file, static_cast<uint32_t>(entry.index->offsets.size()));
+            file.write(reinterpret_cast<const char*>(entry.index->offsets.data()),
+                       static_cast<std::streamsize>(entry.index->offsets.size() * sizeof(uint32_t)));
+        }
+
+        if (!file.good()) {
+            return false;
+        }
+    }
+
+    std::error_code error;
+    fs::rename(tempName, filename, error);
+    if (!error) {
+        dirty = false;
+    }
+    return !error;
+}
+
+std::shared_ptr<const Mp3SeekIndex> SeekIndexCache::find(const std::string& path, uint64_t fileSize, int64_t modified) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = entries.find(path);
+    if (it == entries.end()) {
+        return nullptr;
+    }
+    if (it->second.fileSize != fileSize || it->second.modified != modified) {
+        // The file changed since it was indexed
+        entries.erase(it);
+        dirty = true;
+        return nullptr;
+    }
+    it->second.lastUsed = ++useCounter;
+    dirty = true;
+    return it->second.index;
+}
+
+void SeekIndexCache::store(const std::string& path, uint64_t fileSize, int64_t modified, std::shared_ptr<const Mp3SeekIndex> index) {
+    if (!index) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    Entry& entry = entries[path];
+    entry.fileSize = fileSize;
+    entry.modified = modified;
+    entry.lastUsed = ++useCounter;
+    entry.index = index;
+    dirty = true;
+    evict();
+}
+
+void SeekIndexCache::evict() {
+    if (entries.size() <= MAX_FILES) {
+        return;
+    }
+
+    // Drop the oldest tenth in one go so this doesn't run on every store
+    std::vector<uint64_t> uses;
+    uses.reserve(entries.size());
+    for (const auto& pair : entries) {
+        uses.push_back(pair.second.lastUsed);
+    }
+    size_t dropCount = entries.size() - MAX_FILES * 9 / 10;
+    std::nth_element(uses.begin(), uses.begin() + (dropCount - 1), uses.end());
+    uint64_t cutoff = uses[dropCount - 1];
+
+    for (auto it = entries.begin(); it != entries.end();) {
+        if (it->second.lastUsed <= cutoff) {
+            it = entries.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
\ No newline at end of file
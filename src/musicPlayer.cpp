@@ -1,16 +1,106 @@
 // Enhanced musicPlayer.cpp with song index display and auto-progression
 #include "../headers/musicPlayer.hpp"
 #include "../headers/songScanner.hpp"
+#include "../headers/mp3SeekIndex.hpp"
+#include "../headers/trackCache.hpp"
+#include "../headers/playlistExport.hpp"
+#include "../headers/audioBackend.hpp"
 #include <iostream>
 #include <algorithm>
 #include <sstream>
-#include <thread>
 #include <chrono>
-#include <random>
 #include <fstream>
+#include <iomanip>
+#include <filesystem>
+#include <cctype>
+#include <cmath>
+#include <random>
+#include <unordered_set>
+
+namespace {
+    // How long before the end of a song the next one gets opened and primed
+    const unsigned int PREROLL_MS = 5000;
+    // Longest crossfade the 'crossfade' command accepts
+    const unsigned int MAX_CROSSFADE_MS = 12000;
+    // Sample rates 'output rate' accepts
+    const unsigned int MIN_OUTPUT_RATE = 8000;
+    const unsigned int MAX_OUTPUT_RATE = 192000;
+    // How often the session snapshot is rewritten while a song plays
+    const std::chrono::seconds SESSION_SAVE_INTERVAL(15);
+    // Redraw rate of the progress timer line
+    const int PROGRESS_REFRESH_MS = 250;
+    // How far off a detected tempo may be for search bpm:<n>
+    const double BPM_TOLERANCE = 2.0;
+    // Radio mode: songs among the last this many plays don't come back
+    const size_t RADIO_RECENT = 50;
+    // It picks at random from this many of the closest songs that are left,
+    // out of the closest RADIO_CANDIDATES
+    const size_t RADIO_CHOICES = 4;
+    const size_t RADIO_CANDIDATES = 32;
+    // Columns of the waveform bar under the playing song
+    const size_t WAVEFORM_COLUMNS = 64;
+    
+    // Presets that are always there, 'eq save' can't overwrite them
+    std::map<std::string, std::vector<EqBand>> builtInEqPresets() {
+        std::map<std::string, std::vector<EqBand>> presets;
+        presets["flat"] = {};
+        presets["bass"] = { EqBand(EqFilter::LOW_SHELF, 105.0f, 6.0f, 0.707f) };
+        presets["treble"] = { EqBand(EqFilter::HIGH_SHELF, 8000.0f, 4.0f, 0.707f) };
+        presets["vocal"] = { EqBand(EqFilter::HIGH_PASS, 80.0f, 0.0f, 0.707f), EqBand(EqFilter::PEAK, 250.0f, -2.0f, 1.0f),
+                             EqBand(EqFilter::PEAK, 3000.0f, 3.0f, 1.0f) };
+        return presets;
+    }
+    
+    // "1:23", "83" or "83s", with a leading + or - for a jump from the current position
+    bool parseSeekTarget(const std::string& text, long long& milliseconds, bool& relative) {
+        std::string value = text;
+        relative = !value.empty() && (value[0] == '+' || value[0] == '-');
+        int sign = !value.empty() && value[0] == '-' ? -1 : 1;
+        if (relative) {
+            value = value.substr(1);
+        }
+        if (!value.empty() && (value.back() == 's' || value.back() == 'S')) {
+            value.pop_back();
+        }
+        if (value.empty() || !std::isdigit(static_cast<unsigned char>(value[0]))) {
+            return false;
+        }
+        
+        double seconds = 0.0;
+        try {
+            size_t used = 0;
+            size_t colon = value.find(':');
+            if (colon != std::string::npos) {
+                std::string rest = value.substr(colon + 1);
+                unsigned long minutes = std::stoul(value.substr(0, colon), &used);
+                if (used != colon || rest.empty() || !std::isdigit(static_cast<unsigned char>(rest[0]))) {
+                    return false;
+                }
+                seconds = std::stod(rest, &used);
+                if (used != rest.size() || seconds >= 60.0) {
+                    return false;
+                }
+                seconds += minutes * 60.0;
+            } else {
+                seconds = std::stod(value, &used);
+                if (used != value.size()) {
+                    return false;
+                }
+            }
+        } catch (...) {
+            return false;
+        }
+        
+        milliseconds = sign * static_cast<long long>(seconds * 1000.0 + 0.5);
+        return true;
+    }
+}
 
-MusicPlayer::MusicPlayer() : currentSongIndex(-1), randomPosition(-1), queueMode(QueueMode::ALL_SONGS), 
-                            savedVolume(1.0f), showProgressTimer(false) {}
+MusicPlayer::MusicPlayer() : visualizer(audioPlayer.getAnalysisTap()), currentSongIndex(-1), randomPosition(-1), hasNowPlaying(false), queueMode(QueueMode::ALL_SONGS), 
+                            savedVolume(1.0f), showProgressTimer(false), loopCurrentSong(false), smartShuffle(false),
+                            hideDuplicates(false), duplicatesCheckedAt(SIZE_MAX), unfingerprinted(0),
+                            similarity(std::make_shared<const SimilarityIndex>()), similarityBuiltAt(SIZE_MAX), similarityBuildAt(SIZE_MAX), radioNext(-1),
+                            previewIndex(-1), gainMode(GainMode::OFF) {}
 
 MusicPlayer::~MusicPlayer() {
     saveSettings();
@@ -30,14 +120,37 @@ bool MusicPlayer::initialize() {
     
     // Load settings
     loadSettings();
+    loadEqPresets();
     audioPlayer.setVolume(savedVolume);
     
     // Load playlists
     PlaylistManager::getInstance().loadPlaylistsFromFile("playlists.txt");
     
+    // Load and compact play statistics
+    playStats.open("play_events.bin", "play_stats.bin");
+    
+    // Frame indexes of MP3s seeked in before
+    SeekIndexCache::getInstance().load("seek_index.bin");
+    
+    // Loudness measured in earlier runs, so the resumed song is normalized too
+    loudness.load("loudness.bin");
+    features.load("features.bin", "waveforms.bin");
+    
+    // Resume the last song right away, the queue around it is rebuilt once the scan is done
+    SessionState session;
+    bool hasSession = SessionSnapshot::load("session.bin", session, playQueue);
+    if (hasSession) {
+        resumeSessionPlayback(session);
+    }
+    
     // Scan for songs
     scanSongs();
     
+    if (hasSession) {
+        restoreSessionQueue(session);
+    }
+    lastSessionSave = std::chrono::steady_clock::now();
+    
     std::cout << "Initialization complete!" << std::endl;
     return true;
 }
@@ -51,30 +164,46 @@ void MusicPlayer::run() {
     while (true) {
         update(); // Update audio system and check for auto-progression
         
-        // Show progress if a song is playing
-        if (showProgressTimer && audioPlayer.isPlaying()) {
+        // Show progress if a song is playing, the visualizer shows its own
+        if (visualizer.isRunning()) {
+            updateVisualizerTitle();
+        } else if (showProgressTimer && audioPlayer.isPlaying()) {
             displayCurrentProgress();
         }
         
         // Check for input without blocking
         if (hasInput()) {
+            // Any line closes the visualizer, and runs as a command if it isn't empty
+            bool closedVisualizer = visualizer.isRunning();
+            visualizer.stop();
+            
             std::cout << "\n> ";
-            std::getline(std::cin, input);
+            if (!std::getline(std::cin, input)) {
+                break; // End of input, stdin would stay readable forever
+            }
             
             if (input == "quit" || input == "exit") {
                 break;
             }
             
-            processCommand(input);
+            if (!closedVisualizer || !input.empty()) {
+                processCommand(input);
+            }
         } else {
-            // Small delay to prevent excessive CPU usage
-            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            // Sleep until a command is typed, the audio side reports something or a timer is due
+            audioPlayer.waitForActivity(nextWakeDelay());
         }
     }
     
-    // Save playlists and settings before exiting
+    // Save playlists, settings, session, seek indexes, loudness and features before exiting
     PlaylistManager::getInstance().savePlaylistsToFile("playlists.txt");
+    SeekIndexCache::getInstance().save("seek_index.bin");
+    loudness.stop();
+    loudness.save("loudness.bin");
+    features.stop();
+    features.save("features.bin", "waveforms.bin");
     saveSettings();
+    saveSession();
     std::cout << "Goodbye!" << std::endl;
 }
 
@@ -85,9 +214,16 @@ void MusicPlayer::displayMenu() {
     std::cout << "  scan - Rescan osu! songs directory" << std::endl;
     std::cout << "  list - Show all songs" << std::endl;
     std::cout << "  search <query> - Search for songs" << std::endl;
+    std::cout << "    add sort:plays|recent|skips|bpm and/or is:played|unplayed to sort and filter" << std::endl;
+    std::cout << "    add bpm:<n> or bpm:<min>-<max> and/or key:<Am|F#|...> to match tempo and key" << std::endl;
+    std::cout << "  stats - Show listening statistics" << std::endl;
+    std::cout << "  stats top [n] [days] - Most played songs, optionally in the last days" << std::endl;
+    std::cout << "  stats recent|never|skips [n] - Recently played, never played, most skipped" << std::endl;
     std::cout << "  queue - Show current queue" << std::endl;
+    std::cout << "  history - Show recently played songs" << std::endl;
     std::cout << "  all - Switch back to all songs mode" << std::endl;
     std::cout << "  timer - Toggle progress timer display" << std::endl;
+    std::cout << "  viz - Live spectrum and level meters, Enter to go back" << std::endl;
     std::cout << "\nPlayback:" << std::endl;
     std::cout << "  play <number> - Play song by index" << std::endl;
     std::cout << "  play - Resume/play current song" << std::endl;
@@ -95,9 +231,28 @@ void MusicPlayer::displayMenu() {
     std::cout << "  stop - Stop playback" << std::endl;
     std::cout << "  next - Next song" << std::endl;
     std::cout << "  prev - Previous song" << std::endl;
+    std::cout << "  playnext <number> - Play song right after the current one" << std::endl;
+    std::cout << "  enqueue <number> - Add song to the end of up next" << std::endl;
     std::cout << "  vol <0-100> - Set volume (persistent)" << std::endl;
+    std::cout << "  seek <mm:ss|seconds> - Jump to a position in the current song" << std::endl;
+    std::cout << "  +10s / -10s - Jump forward or back (any number of seconds)" << std::endl;
     std::cout << "  current - Show current song info" << std::endl;
-    std::cout << "  random - Enable random mode" << std::endl;
+    std::cout << "  random [seed] - Enable random mode (same seed, same order)" << std::endl;
+    std::cout << "  smart - Toggle smart shuffle (spread artists apart in random mode)" << std::endl;
+    std::cout << "  radio [number] - Keep playing songs that sound like the current (or given) one, 'all' to stop" << std::endl;
+    std::cout << "  preview [number|stop] - Play a clip of each listed or found song from its preview point, Enter or 'next' to step" << std::endl;
+    std::cout << "  output [alsa|null|fast|wav <file>] - Show or change the audio output (without FMOD)" << std::endl;
+    std::cout << "  output rate <hz|auto> - Convert every song to one sample rate, or follow each song (persistent)" << std::endl;
+    std::cout << "  crossfade [seconds|off] [linear|equal] - Overlap consecutive songs (persistent)" << std::endl;
+    std::cout << "  cache [mb] - Show the decoded track cache, or set its memory budget (persistent)" << std::endl;
+    std::cout << "  gain [off|track|album] - Loudness normalization and analysis progress (persistent)" << std::endl;
+    std::cout << "  bpm [number] - Tempo and key of the current or a given song, and analysis progress" << std::endl;
+    std::cout << "  dupes [hide|show] - List songs that sound the same, or show only one of each in list and search (persistent)" << std::endl;
+    std::cout << "  rate [0.5-2.0] [keep|pitch] - Playback speed, keeping the pitch or letting it follow (persistent)" << std::endl;
+    std::cout << "  dt / ht / nc - Toggle Double Time (1.5x), Half Time (0.75x) or Nightcore (1.5x, pitch up)" << std::endl;
+    std::cout << "  eq [preset|off] - Show the equalizer or load a preset (persistent)" << std::endl;
+    std::cout << "  eq add <peak|lowshelf|highshelf|lowpass|highpass> <hz> [db] [q] / eq remove <n> - Edit the bands" << std::endl;
+    std::cout << "  eq save <name> / eq delete <name> - Keep the current bands as a preset, or drop one" << std::endl;
     std::cout << "\nPlaylists:" << std::endl;
     std::cout << "  playlists - Show all playlists" << std::endl;
     std::cout << "  create <name> - Create new playlist" << std::endl;
@@ -106,12 +261,19 @@ void MusicPlayer::displayMenu() {
     std::cout << "  add <playlist> <song_index> - Add song to playlist" << std::endl;
     std::cout << "  remove <playlist> <song_index> - Remove song from playlist" << std::endl;
     std::cout << "  playlist <name> - Play entire playlist" << std::endl;
+    std::cout << "  export <playlist> <file> - Render a playlist to one WAV file with the gain, crossfade, rate and EQ in use" << std::endl;
     std::cout << "\nOther:" << std::endl;
     std::cout << "  quit/exit - Exit program" << std::endl;
 }
 
 void MusicPlayer::processCommand(const std::string& command) {
-    if (command.empty()) return;
+    if (command.empty()) {
+        // Enter steps through preview clips
+        if (previewIndex >= 0) {
+            previewStep(1);
+        }
+        return;
+    }
     
     std::vector<std::string> parts = splitCommand(command);
     std::string cmd = parts[0];
@@ -130,19 +292,35 @@ void MusicPlayer::processCommand(const std::string& command) {
         std::string query = command.substr(command.find(' ') + 1);
         searchSongs(query);
     }
+    else if (cmd == "stats") {
+        showStats(parts);
+    }
     else if (cmd == "all") {
         setQueueFromAllSongs();
     }
+    else if (cmd == "viz") {
+        updateVisualizerTitle();
+        visualizer.start();
+    }
     else if (cmd == "timer") {
         showProgressTimer = !showProgressTimer;
         std::cout << "Progress timer " << (showProgressTimer ? "enabled" : "disabled") << std::endl;
     }
     else if (cmd == "random") {
-        setRandomMode();
+        setRandomMode(parts.size() > 1 ? parts[1] : "");
     }
     else if (cmd == "loop") {
         toggleLoop();
     }
+    else if (cmd == "smart") {
+        toggleSmartShuffle();
+    }
+    else if (cmd == "radio") {
+        radioCommand(parts);
+    }
+    else if (cmd == "preview") {
+        previewCommand(parts);
+    }
     else if (cmd == "check" && parts.size() > 1) {
         std::string playlistName = parts[1];
         checkCurrentSongInPlaylist(playlistName);
@@ -164,13 +342,22 @@ void MusicPlayer::processCommand(const std::string& command) {
         pauseResume();
     }
     else if (cmd == "stop") {
+        endPreview();
         stopPlayback();
     }
     else if (cmd == "next") {
-        playNext();
+        if (previewIndex >= 0) {
+            previewStep(1);
+        } else {
+            playNext();
+        }
     }
     else if (cmd == "prev" || cmd == "previous") {
-        playPrevious();
+        if (previewIndex >= 0) {
+            previewStep(-1);
+        } else {
+            playPrevious();
+        }
     }
     else if (cmd == "vol" || cmd == "volume") {
         if (parts.size() > 1) {
@@ -181,9 +368,45 @@ void MusicPlayer::processCommand(const std::string& command) {
     else if (cmd == "current") {
         showCurrentSong();
     }
+    else if (cmd == "output") {
+        outputCommand(parts);
+    }
+    else if (cmd == "crossfade") {
+        crossfadeCommand(parts);
+    }
+    else if (cmd == "cache") {
+        cacheCommand(parts);
+    }
+    else if (cmd == "gain") {
+        gainCommand(parts);
+    }
+    else if (cmd == "bpm") {
+        bpmCommand(parts);
+    }
+    else if (cmd == "dupes") {
+        dupesCommand(parts);
+    }
+    else if (cmd == "rate" || cmd == "dt" || cmd == "ht" || cmd == "nc") {
+        rateCommand(cmd, parts);
+    }
+    else if (cmd == "eq") {
+        eqCommand(parts);
+    }
+    else if (cmd == "seek" && parts.size() > 1) {
+        seekCommand(parts[1]);
+    }
+    else if (cmd.size() > 1 && (cmd[0] == '+' || cmd[0] == '-')) {
+        seekCommand(cmd); // "+10s", "-10s"
+    }
     else if (cmd == "queue") {
         displayQueue();
     }
+    else if ((cmd == "enqueue" || cmd == "playnext") && parts.size() > 1) {
+        enqueueCommand(parseIntCommand(parts[1]), cmd == "playnext");
+    }
+    else if (cmd == "history") {
+        displayHistory();
+    }
     else if (cmd == "playlists") {
         showPlaylists();
     }
@@ -209,6 +432,9 @@ void MusicPlayer::processCommand(const std::string& command) {
         int songIndex = parseIntCommand(parts[2]) - 1;
         removeFromPlaylistCommand(playlistName, songIndex);
     }
+    else if (cmd == "export") {
+        exportCommand(parts);
+    }
     else if (cmd == "playlist" && parts.size() > 1) {
         std::string name = command.substr(command.find(' ') + 1);
         playPlaylist(name);
@@ -223,14 +449,46 @@ void MusicPlayer::scanSongs() {
     allSongs = SongScanner::scanOsuSongs();
     
     // Assign IDs to songs for easier reference
+    size_t previousCount = libraryIdByPath.size();
+    libraryIdByPath.clear();
+    duplicatesCheckedAt = SIZE_MAX; // IDs changed, find the groups again
+    std::vector<std::string> paths;
+    paths.reserve(allSongs.size());
     for (size_t i = 0; i < allSongs.size(); ++i) {
         allSongs[i].id = static_cast<int>(i + 1);
+        libraryIdByPath[allSongs[i].filePath] = allSongs[i].id;
+        paths.push_back(allSongs[i].filePath);
+    }
+    // The radio's index is of the old IDs, a build still running for them is dropped when it is done
+    libraryPaths = std::make_shared<const std::vector<std::string>>(paths);
+    similarity = std::make_shared<const SimilarityIndex>();
+    similarityBuiltAt = SIZE_MAX;
+    
+    libraryIdByKey.clear();
+    for (const auto& song : allSongs) {
+        libraryIdByKey[PlayStats::songKey(song)] = song.id;
+    }
+    
+    // Up-next and history refer to library IDs, which a changed library reshuffles
+    if (previousCount > 0 && previousCount != libraryIdByPath.size()) {
+        playQueue.clear();
+        std::cout << "Library changed, up next and history were cleared." << std::endl;
     }
     
     if (queueMode == QueueMode::ALL_SONGS) {
         setQueueFromAllSongs();
+    } else if (queueMode == QueueMode::RADIO) {
+        // The radio plays from the whole library, follow it
+        currentQueue = allSongs;
+        auto it = hasNowPlaying ? libraryIdByPath.find(nowPlaying.filePath) : libraryIdByPath.end();
+        currentSongIndex = it != libraryIdByPath.end() ? it->second - 1 : -1;
+        pickRadioNext();
     }
     
+    // Measure whatever is new in the background, see 'gain' and 'bpm' for progress
+    loudness.analyze(paths);
+    features.analyze(paths);
+    
     richPresence.setBrowsingState(static_cast<int>(allSongs.size()));
 }
 
@@ -240,36 +498,249 @@ void MusicPlayer::displayAllSongs() {
         return;
     }
     
-    displaySongList(allSongs, true);
+    listedSongs.clear();
+    if (!hideDuplicates) {
+        for (const auto& song : allSongs) {
+            listedSongs.push_back(song.id);
+        }
+        displaySongList(allSongs, true);
+        return;
+    }
+    
+    refreshDuplicates();
+    std::vector<Song> shown;
+    for (const auto& song : allSongs) {
+        if (!isDuplicateCopy(song.id)) {
+            shown.push_back(song);
+            listedSongs.push_back(song.id);
+        }
+    }
+    displaySongList(shown, true);
+    if (shown.size() < allSongs.size()) {
+        size_t hidden = allSongs.size() - shown.size();
+        std::cout << "(" << hidden << " duplicate" << (hidden == 1 ? "" : "s") << " hidden, 'dupes' lists them)" << std::endl;
+    }
 }
 
 void MusicPlayer::searchSongs(const std::string& query) {
-    std::vector<Song> results;
-    std::vector<int> globalIndices;
-    std::string lowerQuery = query;
-    std::transform(lowerQuery.begin(), lowerQuery.end(), lowerQuery.begin(), ::tolower);
+    // Pull out sort:<key>, is:<filter>, bpm:<range> and key:<key> words, the rest is the text to match
+    std::string sortKey;
+    std::string filter;
+    std::string lowerQuery;
+    bool bpmFilter = false;
+    double bpmLow = 0.0;
+    double bpmHigh = 0.0;
+    int keyFilter = -1;
+    for (const auto& word : splitCommand(query)) {
+        std::string lowerWord = word;
+        std::transform(lowerWord.begin(), lowerWord.end(), lowerWord.begin(), ::tolower);
+        
+        if (lowerWord.find("sort:") == 0) {
+            sortKey = lowerWord.substr(5);
+        } else if (lowerWord.find("is:") == 0) {
+            filter = lowerWord.substr(3);
+        } else if (lowerWord.find("bpm:") == 0) {
+            // A single tempo matches within BPM_TOLERANCE, detection isn't exact
+            std::string range = lowerWord.substr(4);
+            size_t dash = range.find('-');
+            try {
+                if (dash == std::string::npos) {
+                    double bpm = std::stod(range);
+                    bpmLow = bpm - BPM_TOLERANCE;
+                    bpmHigh = bpm + BPM_TOLERANCE;
+                } else {
+                    bpmLow = std::stod(range.substr(0, dash));
+                    bpmHigh = std::stod(range.substr(dash + 1));
+                }
+            } catch (...) {
+                bpmLow = bpmHigh = -1.0;
+            }
+            if (bpmLow < 0.0 || bpmHigh < bpmLow) {
+                std::cout << "Usage: bpm:<n> or bpm:<min>-<max>" << std::endl;
+                return;
+            }
+            bpmFilter = true;
+        } else if (lowerWord.find("key:") == 0) {
+            if (!FeatureLibrary::parseKey(lowerWord.substr(4), keyFilter)) {
+                std::cout << "Unknown key '" << word.substr(4) << "' (use e.g. C, Am, F#m, Eb major)" << std::endl;
+                return;
+            }
+        } else {
+            lowerQuery += (lowerQuery.empty() ? "" : " ") + lowerWord;
+        }
+    }
+    
+    if (hideDuplicates) {
+        refreshDuplicates();
+    }
     
+    std::vector<int> globalIndices;
     for (size_t i = 0; i < allSongs.size(); ++i) {
+        if (hideDuplicates && isDuplicateCopy(allSongs[i].id)) {
+            continue;
+        }
+        
         std::string songName = allSongs[i].getDisplayName();
         std::transform(songName.begin(), songName.end(), songName.begin(), ::tolower);
         
-        if (songName.find(lowerQuery) != std::string::npos) {
-            results.push_back(allSongs[i]);
-            globalIndices.push_back(static_cast<int>(i + 1));
+        if (songName.find(lowerQuery) == std::string::npos) {
+            continue;
+        }
+        
+        if (!filter.empty()) {
+            const SongStats* stats = playStats.getStats(PlayStats::songKey(allSongs[i]));
+            bool played = stats && stats->plays > 0;
+            if ((filter == "played" && !played) || (filter == "unplayed" && played)) {
+                continue;
+            }
+        }
+        
+        if (bpmFilter || keyFilter >= 0) {
+            TrackFeatures info;
+            bool known = features.find(allSongs[i].filePath, info);
+            if (bpmFilter && (!known || info.bpm <= 0.0f || info.bpm < bpmLow || info.bpm > bpmHigh)) {
+                continue;
+            }
+            if (keyFilter >= 0 && (!known || info.key != keyFilter)) {
+                continue;
+            }
+        }
+        
+        globalIndices.push_back(static_cast<int>(i + 1));
+    }
+    
+    if (!sortKey.empty()) {
+        auto statsOf = [this](int songId) {
+            const SongStats* stats = playStats.getStats(PlayStats::songKey(allSongs[songId - 1]));
+            return stats ? *stats : SongStats();
+        };
+        
+        if (sortKey == "plays") {
+            std::stable_sort(globalIndices.begin(), globalIndices.end(), [&](int a, int b) {
+                return statsOf(a).plays > statsOf(b).plays;
+            });
+        } else if (sortKey == "recent") {
+            std::stable_sort(globalIndices.begin(), globalIndices.end(), [&](int a, int b) {
+                return statsOf(a).lastPlayedMs > statsOf(b).lastPlayedMs;
+            });
+        } else if (sortKey == "skips") {
+            std::stable_sort(globalIndices.begin(), globalIndices.end(), [&](int a, int b) {
+                return playStats.getSkipRate(PlayStats::songKey(allSongs[a - 1])) >
+                       playStats.getSkipRate(PlayStats::songKey(allSongs[b - 1]));
+            });
+        } else if (sortKey == "bpm") {
+            // Slowest first, songs without a tempo at the end
+            auto bpmOf = [this](int songId) {
+                TrackFeatures info;
+                return features.find(allSongs[songId - 1].filePath, info) && info.bpm > 0.0f ? info.bpm : 1e9f;
+            };
+            std::stable_sort(globalIndices.begin(), globalIndices.end(), [&](int a, int b) {
+                return bpmOf(a) < bpmOf(b);
+            });
+        } else {
+            std::cout << "Unknown sort key '" << sortKey << "' (use plays, recent, skips or bpm)" << std::endl;
         }
     }
     
-    if (results.empty()) {
+    listedSongs = globalIndices;
+    if (globalIndices.empty()) {
         std::cout << "No songs found matching: " << query << std::endl;
     } else {
         std::cout << "Search results for '" << query << "':" << std::endl;
-        for (size_t i = 0; i < results.size(); ++i) {
-            std::cout << globalIndices[i] << ". " << results[i].getDisplayName() << std::endl;
+        bool showFeatures = bpmFilter || keyFilter >= 0 || sortKey == "bpm";
+        for (int songId : globalIndices) {
+            std::cout << songId << ". " << allSongs[songId - 1].getDisplayName();
+            if (showFeatures) {
+                TrackFeatures info;
+                features.find(allSongs[songId - 1].filePath, info);
+                std::cout << " (" << (info.bpm > 0.0f ? std::to_string(static_cast<int>(std::lround(info.bpm))) : "?")
+                          << " BPM, " << FeatureLibrary::keyName(info.key) << ")";
+            } else if (!sortKey.empty()) {
+                const SongStats* stats = playStats.getStats(PlayStats::songKey(allSongs[songId - 1]));
+                std::cout << " (" << (stats ? stats->plays : 0) << " plays)";
+            }
+            std::cout << std::endl;
+        }
+    }
+}
+
+void MusicPlayer::showStats(const std::vector<std::string>& args) {
+    std::string view = args.size() > 1 ? args[1] : "";
+    std::transform(view.begin(), view.end(), view.begin(), ::tolower);
+    int count = args.size() > 2 ? parseIntCommand(args[2], 10) : 10;
+    if (count <= 0) count = 10;
+    
+    if (view.empty()) {
+        std::cout << "\nListening Statistics:" << std::endl;
+        std::cout << "===================" << std::endl;
+        std::cout << "Plays: " << playStats.totalPlays() << " | Skips: " << playStats.totalSkips()
+                  << " | Songs played: " << playStats.songCount() << "/" << allSongs.size() << std::endl;
+        view = "top";
+        count = 5;
+    }
+    
+    if (view == "top") {
+        uint64_t sinceMs = 0;
+        int days = args.size() > 3 ? parseIntCommand(args[3], 0) : 0;
+        if (days > 0) {
+            sinceMs = PlayStats::nowMs() - static_cast<uint64_t>(days) * 24 * 60 * 60 * 1000;
+            if (sinceMs < playStats.retainedSinceMs()) {
+                std::cout << "Note: detailed history only goes back to the retained event log." << std::endl;
+            }
+        }
+        
+        std::cout << "Most played" << (days > 0 ? " in the last " + std::to_string(days) + " days" : "") << ":" << std::endl;
+        for (const auto& entry : playStats.topPlayed(static_cast<size_t>(count), sinceMs)) {
+            const Song* song = findSongByKey(entry.first);
+            if (song) {
+                std::cout << "  " << song->id << ". " << song->getDisplayName() << " (" << entry.second << " plays)" << std::endl;
+            }
+        }
+    } else if (view == "recent") {
+        std::cout << "Recently played:" << std::endl;
+        for (uint64_t key : playStats.recentlyPlayed(static_cast<size_t>(count))) {
+            const Song* song = findSongByKey(key);
+            if (song) {
+                std::cout << "  " << song->id << ". " << song->getDisplayName() << std::endl;
+            }
+        }
+    } else if (view == "never") {
+        std::cout << "Never played:" << std::endl;
+        int shown = 0;
+        int total = 0;
+        for (const auto& song : allSongs) {
+            const SongStats* stats = playStats.getStats(PlayStats::songKey(song));
+            if (!stats || stats->plays == 0) {
+                if (shown < count) {
+                    std::cout << "  " << song.id << ". " << song.getDisplayName() << std::endl;
+                    shown++;
+                }
+                total++;
+            }
+        }
+        if (total > shown) {
+            std::cout << "  ... and " << (total - shown) << " more never played songs" << std::endl;
+        }
+    } else if (view == "skips") {
+        std::cout << "Most skipped (at least 3 plays):" << std::endl;
+        for (const auto& entry : playStats.mostSkipped(static_cast<size_t>(count))) {
+            const Song* song = findSongByKey(entry.first);
+            if (song) {
+                std::cout << "  " << song->id << ". " << song->getDisplayName() << " ("
+                          << static_cast<int>(entry.second * 100) << "% skipped)" << std::endl;
+            }
         }
+    } else {
+        std::cout << "Usage: stats [top [n] [days] | recent [n] | never [n] | skips [n]]" << std::endl;
     }
 }
 
-void MusicPlayer::playCurrentSong() {
+const Song* MusicPlayer::findSongByKey(uint64_t key) const {
+    auto it = libraryIdByKey.find(key);
+    return it != libraryIdByKey.end() ? findSongById(it->second) : nullptr;
+}
+
+void MusicPlayer::playCurrentSong(bool addToHistory) {
     if (currentQueue.empty()) {
         std::cout << "No songs in queue. Add some songs first!" << std::endl;
         return;
@@ -280,16 +751,50 @@ void MusicPlayer::playCurrentSong() {
     }
     
     const Song& song = currentQueue[currentSongIndex];
-    if (audioPlayer.loadSong(song)) {
+    playSong(song, QueueEntry(song.id, currentSongIndex), addToHistory);
+}
+
+void MusicPlayer::playSong(const Song& song, const QueueEntry& entry, bool addToHistory) {
+    endPreview();
+    
+    // Leaving a song that is still playing counts as a skip
+    if (hasNowPlaying && audioPlayer.getState() != PlaybackState::STOPPED) {
+        playStats.recordSkip(nowPlaying, audioPlayer.getPosition());
+    }
+    
+    setNowPlaying(song, entry, addToHistory);
+    
+    if (audioPlayer.loadSong(nowPlaying, songGain(nowPlaying))) {
         audioPlayer.play();
-        displayPlayingMessage();
-        updateDiscordPresence();
+        songStarted();
+    }
+}
+
+void MusicPlayer::setNowPlaying(const Song& song, const QueueEntry& entry, bool addToHistory) {
+    // Remember the song we are leaving so 'prev' can return to it
+    if (addToHistory && hasNowPlaying) {
+        playQueue.pushHistory(nowPlayingEntry);
+    }
+    
+    nowPlaying = song;
+    nowPlayingEntry = entry;
+    hasNowPlaying = true;
+    
+    // Decided right away, so the preload and 'queue' agree with what comes
+    if (queueMode == QueueMode::RADIO) {
+        pickRadioNext();
     }
 }
 
+void MusicPlayer::songStarted() {
+    playStats.recordStart(nowPlaying);
+    displayPlayingMessage();
+    updateDiscordPresence();
+}
+
 void MusicPlayer::displayPlayingMessage() {
-    if (currentSongIndex >= 0 && currentSongIndex < static_cast<int>(currentQueue.size())) {
-        const Song& song = currentQueue[currentSongIndex];
+    if (hasNowPlaying) {
+        const Song& song = nowPlaying;
         
         // Get the song index in the original queue for display
         int displayIndex = getSongDisplayIndex(song);
@@ -299,12 +804,17 @@ void MusicPlayer::displayPlayingMessage() {
             std::cout << displayIndex << ". ";
         }
         std::cout << song.getDisplayName() << " | Length: " << audioPlayer.formatTime(audioPlayer.getLength()) << std::endl;
+        displayWaveform(false);
+        
+        if (queueMode == QueueMode::RADIO && radioNext >= 0 && radioNext < static_cast<int>(currentQueue.size())) {
+            std::cout << "Next on the radio: " << currentQueue[radioNext].id << ". " << currentQueue[radioNext].getDisplayName() << std::endl;
+        }
     }
 }
 
 void MusicPlayer::displayCurrentProgress() {
-    if (currentSongIndex >= 0 && currentSongIndex < static_cast<int>(currentQueue.size())) {
-        const Song& song = currentQueue[currentSongIndex];
+    if (hasNowPlaying) {
+        const Song& song = nowPlaying;
         int displayIndex = getSongDisplayIndex(song);
         
         std::cout << "\r";
@@ -318,7 +828,43 @@ void MusicPlayer::displayCurrentProgress() {
         }
         
         std::cout << std::flush;
+    } else if (previewIndex >= 0) {
+        const Song* song = findSongById(previewList[previewIndex]);
+        std::cout << "\rPreview " << (previewIndex + 1) << "/" << previewList.size() << ": "
+                  << (song ? song->getDisplayName() : "?") << " | " << audioPlayer.getProgressString() << std::flush;
+    }
+}
+
+void MusicPlayer::displayWaveform(bool withPlayhead) {
+    // Nothing until the background analysis got to the song
+    std::vector<WaveformSummary::Bucket> buckets;
+    if (!hasNowPlaying || !features.findWaveform(nowPlaying.filePath, buckets)) {
+        return;
+    }
+    
+    double played = -1.0;
+    unsigned int length = audioPlayer.getLength();
+    if (withPlayhead && length > 0) {
+        played = static_cast<double>(audioPlayer.getPosition()) / static_cast<double>(length);
+    }
+    std::cout << "[" << WaveformSummary::render(buckets, WAVEFORM_COLUMNS, played) << "]" << std::endl;
+}
+
+void MusicPlayer::updateVisualizerTitle() {
+    if (!hasNowPlaying) {
+        visualizer.setTitle("Nothing playing");
+        return;
+    }
+    
+    std::string title = nowPlaying.getDisplayName();
+    int displayIndex = getSongDisplayIndex(nowPlaying);
+    if (displayIndex > 0) {
+        title = std::to_string(displayIndex) + ". " + title;
+    }
+    if (audioPlayer.isPaused()) {
+        title += " (paused)";
     }
+    visualizer.setTitle(title);
 }
 
 int MusicPlayer::getSongDisplayIndex(const Song& song) {
@@ -338,20 +884,60 @@ int MusicPlayer::getSongDisplayIndex(const Song& song) {
 }
 
 void MusicPlayer::playNext() {
+    Song song;
+    QueueEntry entry;
+    if (advanceQueue(song, entry)) {
+        playSong(song, entry);
+    }
+}
+
+bool MusicPlayer::advanceQueue(Song& song, QueueEntry& entry) {
+    // Up next always wins over the base queue
+    while (playQueue.hasUpNext()) {
+        QueueEntry upNext = playQueue.popUpNext();
+        
+        // Songs put back by 'prev' carry their base position, resume the base queue from there
+        if (isCurrentBaseEntry(upNext)) {
+            currentSongIndex = upNext.baseIndex;
+            if (queueMode == QueueMode::RANDOM) {
+                randomPosition = shufflePositionOf(currentSongIndex);
+            }
+            song = currentQueue[currentSongIndex];
+            entry = QueueEntry(song.id, currentSongIndex);
+            return true;
+        }
+        
+        const Song* found = findSongById(upNext.songId);
+        if (found) {
+            song = *found;
+            entry = QueueEntry(upNext.songId, -1);
+            return true;
+        }
+    }
+    
     if (currentQueue.empty()) {
         std::cout << "No songs in queue!" << std::endl;
-        return;
+        return false;
     }
     
     if (queueMode == QueueMode::RANDOM) {
         randomPosition++;
-        if (randomPosition >= static_cast<int>(randomIndices.size())) {
+        if (randomPosition >= shuffleSize()) {
             // Generate new random order and continue
-            generateRandomIndices();
+            generateRandomIndices(ShuffleEngine::randomSeed());
             randomPosition = 0;
             std::cout << "Generated new random order." << std::endl;
         }
-        currentSongIndex = randomIndices[randomPosition];
+        currentSongIndex = shuffleIndexAt(randomPosition);
+    } else if (queueMode == QueueMode::RADIO) {
+        if (radioNext < 0) {
+            pickRadioNext();
+        }
+        if (radioNext < 0) {
+            std::cout << "Radio mode: no analyzed songs left to play" << std::endl;
+            return false;
+        }
+        currentSongIndex = radioNext;
     } else {
         currentSongIndex++;
         if (currentSongIndex >= static_cast<int>(currentQueue.size())) {
@@ -360,10 +946,133 @@ void MusicPlayer::playNext() {
         }
     }
     
-    playCurrentSong();
+    song = currentQueue[currentSongIndex];
+    entry = QueueEntry(song.id, currentSongIndex);
+    return true;
+}
+
+bool MusicPlayer::peekNext(Song& song, QueueEntry& entry) const {
+    // Same choice advanceQueue() will make, without moving anything
+    if (loopCurrentSong && hasNowPlaying) {
+        song = nowPlaying;
+        entry = nowPlayingEntry;
+        return true;
+    }
+    
+    for (const QueueEntry& upNext : playQueue.getUpNext()) {
+        if (isCurrentBaseEntry(upNext)) {
+            song = currentQueue[upNext.baseIndex];
+            entry = QueueEntry(song.id, upNext.baseIndex);
+            return true;
+        }
+        const Song* found = findSongById(upNext.songId);
+        if (found) {
+            song = *found;
+            entry = QueueEntry(upNext.songId, -1);
+            return true;
+        }
+    }
+    
+    if (currentQueue.empty()) {
+        return false;
+    }
+    
+    int index = 0;
+    if (queueMode == QueueMode::RANDOM) {
+        // The order after the last position is only decided when we get there
+        if (randomPosition + 1 >= shuffleSize()) {
+            return false;
+        }
+        index = shuffleIndexAt(randomPosition + 1);
+    } else if (queueMode == QueueMode::RADIO) {
+        index = radioNext;
+    } else {
+        index = (currentSongIndex + 1) % static_cast<int>(currentQueue.size());
+    }
+    if (index < 0 || index >= static_cast<int>(currentQueue.size())) {
+        return false;
+    }
+    
+    song = currentQueue[index];
+    entry = QueueEntry(song.id, index);
+    return true;
+}
+
+void MusicPlayer::updatePreroll() {
+    if (!audioPlayer.isPlaying()) {
+        return;
+    }
+    
+    unsigned int lead = PREROLL_MS + audioPlayer.getCrossfadeMs();
+    if (audioPlayer.getRemainingTime() > lead) {
+        // Wake the loop up again when the window opens (the milestone is in song time)
+        audioPlayer.setMilestone(audioPlayer.getLength() - static_cast<unsigned int>(lead * audioPlayer.getRate()));
+        return;
+    }
+    
+    // Re-checked on every pass of the loop so queue edits in the last seconds still win
+    Song next;
+    QueueEntry entry;
+    if (!peekNext(next, entry)) {
+        audioPlayer.cancelPreload();
+    } else if (audioPlayer.getPreloadedPath() != next.filePath) {
+        audioPlayer.preloadSong(next, songGain(next));
+    }
+}
+
+void MusicPlayer::continueWithPreloaded() {
+    Song song = nowPlaying;
+    QueueEntry entry = nowPlayingEntry;
+    bool addToHistory = !loopCurrentSong;
+    if (!loopCurrentSong && !advanceQueue(song, entry)) {
+        audioPlayer.stop();
+        return;
+    }
+    
+    if (song.filePath != audioPlayer.getPreloadedPath()) {
+        // The queue changed after the switch was made, start the right song the normal way
+        audioPlayer.stop();
+        playSong(song, entry, addToHistory);
+        return;
+    }
+    
+    if (audioPlayer.getCrossfadeMs() > 0) {
+        std::cout << "\n\nCrossfading into next song..." << std::endl;
+    } else {
+        std::cout << "\n\nSong finished, continuing without a gap..." << std::endl;
+    }
+    audioPlayer.acceptPreloaded();
+    setNowPlaying(song, entry, addToHistory);
+    songStarted();
 }
 
 void MusicPlayer::playPrevious() {
+    // Walk back through what was actually played
+    while (playQueue.hasHistory()) {
+        QueueEntry entry = playQueue.popHistory();
+        bool inBase = isCurrentBaseEntry(entry);
+        const Song* song = inBase ? nullptr : findSongById(entry.songId);
+        if (!inBase && !song) {
+            continue;
+        }
+        
+        // The song we leave comes back on 'next'
+        if (hasNowPlaying) {
+            playQueue.playNext(nowPlayingEntry);
+        }
+        
+        if (inBase) {
+            currentSongIndex = entry.baseIndex;
+            if (queueMode == QueueMode::RANDOM) {
+                randomPosition = shufflePositionOf(currentSongIndex);
+            }
+            playCurrentSong(false);
+        } else {
+            playSong(*song, QueueEntry(entry.songId, -1), false);
+        }
+        return;
+    }
+    
     if (currentQueue.empty()) {
         std::cout << "No songs in queue!" << std::endl;
         return;
@@ -372,10 +1081,10 @@ void MusicPlayer::playPrevious() {
     if (queueMode == QueueMode::RANDOM) {
         randomPosition--;
         if (randomPosition < 0) {
-            randomPosition = static_cast<int>(randomIndices.size()) - 1;
+            randomPosition = shuffleSize() - 1;
             std::cout << "Reached beginning of random queue, looping to end." << std::endl;
         }
-        currentSongIndex = randomIndices[randomPosition];
+        currentSongIndex = shuffleIndexAt(randomPosition);
     } else {
         currentSongIndex--;
         if (currentSongIndex < 0) {
@@ -402,6 +1111,9 @@ void MusicPlayer::pauseResume() {
 }
 
 void MusicPlayer::stopPlayback() {
+    if (hasNowPlaying && audioPlayer.getState() != PlaybackState::STOPPED) {
+        playStats.recordSkip(nowPlaying, audioPlayer.getPosition());
+    }
     audioPlayer.stop();
     std::cout << "Stopped" << std::endl;
     richPresence.setIdleState();
@@ -414,8 +1126,8 @@ void MusicPlayer::setVolume(float volume) {
 }
 
 void MusicPlayer::showCurrentSong() {
-    if (currentSongIndex >= 0 && currentSongIndex < static_cast<int>(currentQueue.size())) {
-        const Song& song = currentQueue[currentSongIndex];
+    if (hasNowPlaying) {
+        const Song& song = nowPlaying;
         int displayIndex = getSongDisplayIndex(song);
         
         std::cout << "Current song: ";
@@ -441,6 +1153,7 @@ void MusicPlayer::showCurrentSong() {
         
         if (audioPlayer.getState() != PlaybackState::STOPPED) {
             std::cout << "Progress: " << audioPlayer.getProgressString() << std::endl;
+            displayWaveform(true);
         }
         
         std::string modeStr;
@@ -458,8 +1171,17 @@ void MusicPlayer::showCurrentSong() {
                     modeStr = "Random - All Songs";
                 }
                 break;
+            case QueueMode::RADIO:
+                modeStr = "Radio";
+                break;
         }
         std::cout << "Mode: " << modeStr << std::endl;
+    } else if (previewIndex >= 0) {
+        const Song* song = findSongById(previewList[previewIndex]);
+        std::cout << "Previewing " << (previewIndex + 1) << "/" << previewList.size() << ": "
+                  << (song ? std::to_string(song->id) + ". " + song->getDisplayName() : "?") << std::endl;
+        std::cout << "Clip: " << audioPlayer.getProgressString() << ", from "
+                  << audioPlayer.formatTime(audioPlayer.getPreviewStartMs()) << " in the song" << std::endl;
     } else {
         std::cout << "No song selected." << std::endl;
     }
@@ -475,12 +1197,7 @@ void MusicPlayer::playFromQueue(int index) {
     
     // Update random position if in random mode
     if (queueMode == QueueMode::RANDOM) {
-        for (size_t i = 0; i < randomIndices.size(); ++i) {
-            if (randomIndices[i] == index) {
-                randomPosition = static_cast<int>(i);
-                break;
-            }
-        }
+        randomPosition = shufflePositionOf(index);
     }
     
     playCurrentSong();
@@ -499,6 +1216,7 @@ void MusicPlayer::setQueueFromPlaylist(const std::string& playlistName) {
     Playlist* playlist = PlaylistManager::getInstance().getPlaylist(playlistName);
     if (playlist && !playlist->isEmpty()) {
         currentQueue = playlist->getSongs();
+        resolveSongIds(currentQueue);
         queueMode = QueueMode::PLAYLIST;
         currentPlaylistName = playlistName;
         currentSongIndex = -1;
@@ -508,30 +1226,33 @@ void MusicPlayer::setQueueFromPlaylist(const std::string& playlistName) {
     }
 }
 
-void MusicPlayer::setRandomMode() {
+void MusicPlayer::setRandomMode(const std::string& seedArg) {
     if (currentQueue.empty()) {
         std::cout << "No songs available for random mode!" << std::endl;
         return;
     }
     
+    uint64_t seed = ShuffleEngine::randomSeed();
+    if (!seedArg.empty()) {
+        try {
+            seed = std::stoull(seedArg);
+        } catch (const std::exception&) {
+            std::cout << "Invalid seed '" << seedArg << "', using a random one." << std::endl;
+        }
+    }
+    
     // Keep current queue but switch to random mode
     QueueMode previousMode = queueMode;
     queueMode = QueueMode::RANDOM;
     
-    generateRandomIndices();
+    generateRandomIndices(seed);
     
     // If we have a current song, find its position in the random order
     if (currentSongIndex >= 0 && currentSongIndex < static_cast<int>(currentQueue.size())) {
-        // Find the current song in the random indices
-        for (size_t i = 0; i < randomIndices.size(); ++i) {
-            if (randomIndices[i] == currentSongIndex) {
-                randomPosition = static_cast<int>(i);
-                break;
-            }
-        }
+        randomPosition = shufflePositionOf(currentSongIndex);
     } else {
         // No current song, start from beginning of random order
-        currentSongIndex = randomIndices[0];
+        currentSongIndex = shuffleIndexAt(0);
         randomPosition = 0;
     }
     
@@ -549,15 +1270,41 @@ void MusicPlayer::setRandomMode() {
     }
 }
 
-void MusicPlayer::generateRandomIndices() {
-    randomIndices.clear();
-    for (size_t i = 0; i < currentQueue.size(); ++i) {
-        randomIndices.push_back(static_cast<int>(i));
+void MusicPlayer::generateRandomIndices(uint64_t seed) {
+    if (smartShuffle) {
+        smartOrder.build(currentQueue, seed);
+    } else {
+        // The permutation is computed on demand, so reshuffling is O(1) at any queue size
+        shuffleOrder.reset(currentQueue.size(), seed);
     }
+}
+
+void MusicPlayer::toggleSmartShuffle() {
+    uint64_t seed = shuffleSeed();
+    smartShuffle = !smartShuffle;
+    std::cout << "Smart shuffle " << (smartShuffle ? "enabled" : "disabled") << std::endl;
     
-    std::random_device rd;
-    std::mt19937 g(rd());
-    std::shuffle(randomIndices.begin(), randomIndices.end(), g);
+    // Rebuild the active order with the same seed, keeping the current song in place
+    if (queueMode == QueueMode::RANDOM && !currentQueue.empty()) {
+        generateRandomIndices(seed);
+        randomPosition = shufflePositionOf(currentSongIndex);
+    }
+}
+
+int MusicPlayer::shuffleIndexAt(int position) const {
+    return smartShuffle ? smartOrder.indexAt(position) : shuffleOrder.indexAt(position);
+}
+
+int MusicPlayer::shufflePositionOf(int index) const {
+    return smartShuffle ? smartOrder.positionOf(index) : shuffleOrder.positionOf(index);
+}
+
+int MusicPlayer::shuffleSize() const {
+    return static_cast<int>(smartShuffle ? smartOrder.size() : shuffleOrder.size());
+}
+
+uint64_t MusicPlayer::shuffleSeed() const {
+    return smartShuffle ? smartOrder.getSeed() : shuffleOrder.getSeed();
 }
 
 void MusicPlayer::clearQueue() {
@@ -568,6 +1315,21 @@ void MusicPlayer::clearQueue() {
 }
 
 void MusicPlayer::displayQueue() {
+    const std::deque<QueueEntry>& upNext = playQueue.getUpNext();
+    if (!upNext.empty()) {
+        std::cout << "\nUp Next (" << upNext.size() << " songs):" << std::endl;
+        size_t showCount = (std::min)(size_t(10), upNext.size());
+        for (size_t i = 0; i < showCount; ++i) {
+            const Song* song = findSongById(upNext[i].songId);
+            if (song) {
+                std::cout << "    " << song->id << ". " << song->getDisplayName() << std::endl;
+            }
+        }
+        if (upNext.size() > showCount) {
+            std::cout << "    ... and " << (upNext.size() - showCount) << " more" << std::endl;
+        }
+    }
+    
     if (currentQueue.empty()) {
         std::cout << "Queue is empty." << std::endl;
         return;
@@ -588,16 +1350,20 @@ void MusicPlayer::displayQueue() {
                 std::cout << " (Random - All Songs)";
             }
             break;
+        case QueueMode::RADIO:
+            std::cout << " (Radio)";
+            break;
     }
     std::cout << ":" << std::endl;
     std::cout << "===========================================" << std::endl;
     
     if (queueMode == QueueMode::RANDOM) {
         // Show next few songs in random order
-        int showCount = (std::min)(10, static_cast<int>(randomIndices.size()));
+        int orderSize = shuffleSize();
+        int showCount = (std::min)(10, orderSize);
         for (int i = 0; i < showCount; ++i) {
-            int pos = (randomPosition + i) % static_cast<int>(randomIndices.size());
-            int songIdx = randomIndices[pos];
+            int pos = (randomPosition + i) % orderSize;
+            int songIdx = shuffleIndexAt(pos);
             const Song& song = currentQueue[songIdx];
             std::string marker = (i == 0) ? " -> " : "    ";
             
@@ -610,9 +1376,19 @@ void MusicPlayer::displayQueue() {
                 std::cout << marker << song.id << ". " << song.getDisplayName() << std::endl;
             }
         }
-        if (randomIndices.size() > 10) {
-            std::cout << "    ... and " << (randomIndices.size() - 10) << " more songs in random order" << std::endl;
+        if (orderSize > 10) {
+            std::cout << "    ... and " << (orderSize - 10) << " more songs in random order" << std::endl;
         }
+        std::cout << (smartShuffle ? "Smart shuffle" : "Shuffle") << " seed: " << shuffleSeed() << std::endl;
+    } else if (queueMode == QueueMode::RADIO) {
+        // Only the next song is decided, the one after follows from it
+        if (hasNowPlaying) {
+            std::cout << " -> " << nowPlaying.id << ". " << nowPlaying.getDisplayName() << std::endl;
+        }
+        if (radioNext >= 0 && radioNext < static_cast<int>(currentQueue.size())) {
+            std::cout << "    " << currentQueue[radioNext].id << ". " << currentQueue[radioNext].getDisplayName() << std::endl;
+        }
+        std::cout << "Picked from the songs that sound closest, skipping the last " << RADIO_RECENT << " played" << std::endl;
     } else {
         for (size_t i = 0; i < currentQueue.size(); ++i) {
             std::string marker = (static_cast<int>(i) == currentSongIndex) ? " -> " : "    ";
@@ -622,13 +1398,69 @@ void MusicPlayer::displayQueue() {
     }
 }
 
-void MusicPlayer::updateDiscordPresence() {
-    if (currentSongIndex >= 0 && currentSongIndex < static_cast<int>(currentQueue.size())) {
-        const Song& song = currentQueue[currentSongIndex];
-        bool isPlaying = audioPlayer.isPlaying();
-        
-        // Determine if we're in playlist mode (including random playlist)
-        bool inPlaylist = (queueMode == QueueMode::PLAYLIST || 
+void MusicPlayer::displayHistory() {
+    const HistoryRing& history = playQueue.getHistory();
+    if (history.isEmpty()) {
+        std::cout << "No songs played yet." << std::endl;
+        return;
+    }
+    
+    std::cout << "\nRecently Played (" << history.size() << "/" << history.capacity() << "):" << std::endl;
+    std::cout << "===========================================" << std::endl;
+    
+    size_t showCount = (std::min)(size_t(20), history.size());
+    for (size_t age = 0; age < showCount; ++age) {
+        const Song* song = findSongById(history.at(age).songId);
+        if (song) {
+            std::cout << "    " << song->id << ". " << song->getDisplayName() << std::endl;
+        }
+    }
+}
+
+void MusicPlayer::enqueueCommand(int songId, bool playNextFirst) {
+    const Song* song = findSongById(songId);
+    if (!song) {
+        std::cout << "Invalid song index! Use 'list' to see available songs." << std::endl;
+        return;
+    }
+    
+    if (playNextFirst) {
+        playQueue.playNext(QueueEntry(song->id, -1));
+        std::cout << "Playing next: " << song->getDisplayName() << std::endl;
+    } else {
+        playQueue.enqueue(QueueEntry(song->id, -1));
+        std::cout << "Added to up next (#" << playQueue.getUpNext().size() << "): " << song->getDisplayName() << std::endl;
+    }
+}
+
+const Song* MusicPlayer::findSongById(int songId) const {
+    // IDs are assigned in library order by scanSongs
+    if (songId < 1 || songId > static_cast<int>(allSongs.size())) {
+        return nullptr;
+    }
+    return &allSongs[songId - 1];
+}
+
+void MusicPlayer::resolveSongIds(std::vector<Song>& songs) const {
+    // Playlists are stored without IDs, map them back onto the library by path
+    for (auto& song : songs) {
+        auto it = libraryIdByPath.find(song.filePath);
+        song.id = (it != libraryIdByPath.end()) ? it->second : 0;
+    }
+}
+
+bool MusicPlayer::isCurrentBaseEntry(const QueueEntry& entry) const {
+    return entry.baseIndex >= 0 && entry.baseIndex < static_cast<int>(currentQueue.size()) &&
+           currentQueue[entry.baseIndex].id == entry.songId;
+}
+
+void MusicPlayer::updateDiscordPresence() {
+    if (hasNowPlaying) {
+        const Song& song = nowPlaying;
+        bool isPlaying = audioPlayer.isPlaying();
+        
+        // Determine if we're in playlist mode (including random playlist)
+        bool inPlaylist = (queueMode == QueueMode::PLAYLIST || 
                           (queueMode == QueueMode::RANDOM && !currentPlaylistName.empty()));
         std::string playlistName = inPlaylist ? currentPlaylistName : "";
         
@@ -663,6 +1495,22 @@ void MusicPlayer::addToPlaylistCommand(const std::string& playlistName, int song
     }
     
     PlaylistManager::getInstance().addSongToPlaylist(playlistName, allSongs[songIndex]);
+    
+    // Songs added to the playlist being played join the running queue
+    if (queueMode != QueueMode::ALL_SONGS && playlistName == currentPlaylistName &&
+        PlaylistManager::getInstance().getPlaylist(playlistName)) {
+        currentQueue.push_back(allSongs[songIndex]);
+        
+        if (queueMode == QueueMode::RANDOM) {
+            if (smartShuffle) {
+                // Spread the new song into the unplayed part of the order
+                smartOrder.extend(currentQueue, currentQueue.size() - 1, randomPosition);
+            } else {
+                shuffleOrder.reset(currentQueue.size(), shuffleOrder.getSeed());
+                randomPosition = shufflePositionOf(currentSongIndex);
+            }
+        }
+    }
 }
 
 void MusicPlayer::removeFromPlaylistCommand(const std::string& playlistName, int songIndex) {
@@ -724,6 +1572,852 @@ std::vector<std::string> MusicPlayer::splitCommand(const std::string& command) {
     return parts;
 }
 
+void MusicPlayer::outputCommand(const std::vector<std::string>& args) {
+    if (args.size() > 1) {
+        std::string kind = args[1];
+        std::transform(kind.begin(), kind.end(), kind.begin(), ::tolower);
+        std::string path = args.size() > 2 ? args[2] : "";
+        
+        if (kind == "wav" && path.empty()) {
+            std::cout << "Usage: output wav <file>" << std::endl;
+            return;
+        }
+        if (kind == "rate") {
+            unsigned int sampleRate = 0;
+            if (path != "auto") {
+                try {
+                    sampleRate = static_cast<unsigned int>(std::stoul(path));
+                } catch (...) {
+                    sampleRate = 1;
+                }
+                if (sampleRate < MIN_OUTPUT_RATE || sampleRate > MAX_OUTPUT_RATE) {
+                    std::cout << "Usage: output rate <" << MIN_OUTPUT_RATE << "-" << MAX_OUTPUT_RATE << "|auto>" << std::endl;
+                    return;
+                }
+            }
+            if (!audioPlayer.setOutputRate(sampleRate)) {
+                std::cout << "FMOD converts every song to its mixer rate itself." << std::endl;
+                return;
+            }
+            std::cout << (sampleRate ? "Songs are converted to " + std::to_string(sampleRate) + " Hz" : std::string("The output follows the rate of each song"))
+                      << " from the next song on." << std::endl;
+            saveSettings();
+            return;
+        }
+        if (!audioPlayer.setOutput(kind, path)) {
+            std::cout << "Could not switch output to '" << kind << "'." << std::endl;
+        }
+    }
+    
+    std::cout << "Output: " << audioPlayer.getOutputInfo() << std::endl;
+}
+
+void MusicPlayer::seekCommand(const std::string& target) {
+    if (!hasNowPlaying || audioPlayer.getState() == PlaybackState::STOPPED) {
+        std::cout << "Nothing is playing." << std::endl;
+        return;
+    }
+    
+    long long milliseconds = 0;
+    bool relative = false;
+    if (!parseSeekTarget(target, milliseconds, relative)) {
+        std::cout << "Usage: seek <mm:ss|seconds>, or +10s / -10s" << std::endl;
+        return;
+    }
+    
+    long long length = audioPlayer.getLength();
+    long long position = relative ? audioPlayer.getPosition() + milliseconds : milliseconds;
+    position = (std::max)(0LL, (std::min)(position, length));
+    
+    audioPlayer.setPosition(static_cast<unsigned int>(position));
+    std::cout << "Position: " << audioPlayer.formatTime(static_cast<unsigned int>(position)) << " / " << audioPlayer.formatTime(static_cast<unsigned int>(length)) << std::endl;
+}
+
+void MusicPlayer::crossfadeCommand(const std::vector<std::string>& args) {
+    if (args.size() > 1) {
+        std::string value = args[1];
+        std::transform(value.begin(), value.end(), value.begin(), ::tolower);
+        
+        unsigned int milliseconds = 0;
+        if (value != "off") {
+            try {
+                float seconds = std::stof(value);
+                if (seconds < 0.0f) seconds = 0.0f;
+                milliseconds = (std::min)(static_cast<unsigned int>(seconds * 1000.0f + 0.5f), MAX_CROSSFADE_MS);
+            } catch (...) {
+                std::cout << "Usage: crossfade [seconds|off] [linear|equal]" << std::endl;
+                return;
+            }
+        }
+        
+        FadeCurve curve = audioPlayer.getFadeCurve();
+        if (args.size() > 2 && !Crossfade::parseCurve(args[2], curve)) {
+            std::cout << "Unknown fade curve '" << args[2] << "', use linear or equal." << std::endl;
+            return;
+        }
+        
+        audioPlayer.setCrossfade(milliseconds, curve);
+        saveSettings();
+    }
+    
+    if (audioPlayer.getCrossfadeMs() == 0) {
+        std::cout << "Crossfade: off (gapless)" << std::endl;
+    } else {
+        std::ostringstream seconds;
+        seconds << std::fixed << std::setprecision(1) << audioPlayer.getCrossfadeMs() / 1000.0;
+        std::cout << "Crossfade: " << seconds.str() << "s, " << Crossfade::curveName(audioPlayer.getFadeCurve()) << " curve" << std::endl;
+    }
+}
+
+void MusicPlayer::cacheCommand(const std::vector<std::string>& args) {
+    TrackCache& cache = TrackCache::getInstance();
+    if (args.size() > 1) {
+        try {
+            int megabytes = std::stoi(args[1]);
+            if (megabytes < 0) megabytes = 0;
+            cache.setBudgetMB(static_cast<unsigned int>(megabytes));
+            saveSettings();
+        } catch (...) {
+            std::cout << "Usage: cache [mb]" << std::endl;
+            return;
+        }
+    }
+    
+    uint64_t hits = cache.getHits();
+    uint64_t lookups = hits + cache.getMisses();
+    std::cout << "Track cache: " << cache.getTrackCount() << " songs, " << cache.getUsedBytes() / (1024 * 1024)
+              << " / " << cache.getBudgetMB() << " MB" << std::endl;
+    std::cout << "Hits: " << hits << " | Misses: " << cache.getMisses();
+    if (lookups > 0) {
+        std::cout << " | Hit rate: " << hits * 100 / lookups << "%";
+    }
+    std::cout << std::endl;
+}
+
+void MusicPlayer::gainCommand(const std::vector<std::string>& args) {
+    if (args.size() > 1) {
+        GainMode mode = gainMode;
+        if (!LoudnessLibrary::parseMode(args[1], mode)) {
+            std::cout << "Usage: gain [off|track|album]" << std::endl;
+            return;
+        }
+        gainMode = mode;
+        saveSettings();
+        
+        // Heard once the audio already buffered has played out
+        if (hasNowPlaying) {
+            Song next;
+            QueueEntry entry;
+            float nextGain = peekNext(next, entry) && audioPlayer.getPreloadedPath() == next.filePath ? songGain(next) : 1.0f;
+            audioPlayer.setTrackGains(songGain(nowPlaying), nextGain);
+        }
+    }
+    
+    std::cout << "Loudness normalization: " << LoudnessLibrary::modeName(gainMode)
+              << " (reference " << LoudnessLibrary::REFERENCE_LUFS << " LUFS)" << std::endl;
+    
+    LoudnessInfo info;
+    if (hasNowPlaying && loudness.find(nowPlaying.filePath, info)) {
+        std::ostringstream line;
+        line << std::fixed << std::setprecision(1) << info.integratedLufs << " LUFS, peak "
+             << 20.0 * std::log10((std::max)(info.truePeak, 1e-6f)) << " dBTP, gain "
+             << 20.0 * std::log10(audioPlayer.getTrackGain()) << " dB";
+        std::cout << "Current song: " << line.str() << std::endl;
+    } else if (hasNowPlaying && loudness.isAnalyzed(nowPlaying.filePath)) {
+        std::cout << "Current song: can't be measured (no built-in decoder or silent), played at unity gain" << std::endl;
+    } else if (hasNowPlaying) {
+        std::cout << "Current song: not analyzed yet" << std::endl;
+    }
+    
+    size_t queued = loudness.getQueuedCount();
+    size_t analyzed = loudness.getAnalyzedCount();
+    if (queued == 0) {
+        std::cout << "Analysis: library up to date" << std::endl;
+    } else if (analyzed < queued) {
+        std::cout << "Analysis: " << analyzed << " / " << queued << " songs (" << analyzed * 100 / queued << "%)" << std::endl;
+    } else {
+        std::cout << "Analysis: done (" << analyzed << " songs measured this session)" << std::endl;
+    }
+}
+
+void MusicPlayer::bpmCommand(const std::vector<std::string>& args) {
+    const Song* song = hasNowPlaying ? &nowPlaying : nullptr;
+    if (args.size() > 1) {
+        int songId = parseIntCommand(args[1], 0);
+        if (songId < 1 || songId > static_cast<int>(allSongs.size())) {
+            std::cout << "Usage: bpm [number]" << std::endl;
+            return;
+        }
+        song = &allSongs[songId - 1];
+    }
+    
+    if (song) {
+        TrackFeatures info;
+        std::cout << song->getDisplayName() << std::endl;
+        if (!features.find(song->filePath, info)) {
+            std::cout << "  Not analyzed yet" << std::endl;
+        } else {
+            std::ostringstream line;
+            if (info.bpm > 0.0f) {
+                line << std::fixed << std::setprecision(info.bpmFromBeatmap ? 2 : 1) << info.bpm
+                     << (info.bpmFromBeatmap ? " (from the beatmap)" : " (detected)");
+                // What is heard, the rate speeds the beat up with the song
+                double rate = audioPlayer.getRate();
+                if (song == &nowPlaying && rate != 1.0) {
+                    line << ", " << std::setprecision(1) << info.bpm * rate << " at " << rate << "x";
+                }
+            } else {
+                line << (info.analyzed ? "no steady beat found" : "unknown (no built-in decoder for this file, or it is silent)");
+            }
+            std::cout << "  BPM: " << line.str() << std::endl;
+            std::cout << "  Key: " << FeatureLibrary::keyName(info.key) << std::endl;
+        }
+    }
+    
+    size_t queued = features.getQueuedCount();
+    size_t analyzed = features.getAnalyzedCount();
+    if (queued == 0) {
+        std::cout << "Analysis: library up to date" << std::endl;
+    } else if (analyzed < queued) {
+        std::cout << "Analysis: " << analyzed << " / " << queued << " songs (" << analyzed * 100 / queued << "%)" << std::endl;
+    } else {
+        std::cout << "Analysis: done (" << analyzed << " songs checked this session)" << std::endl;
+    }
+}
+
+void MusicPlayer::dupesCommand(const std::vector<std::string>& args) {
+    if (args.size() > 1) {
+        std::string mode = args[1];
+        std::transform(mode.begin(), mode.end(), mode.begin(), ::tolower);
+        if (mode != "hide" && mode != "show") {
+            std::cout << "Usage: dupes [hide|show]" << std::endl;
+            return;
+        }
+        hideDuplicates = mode == "hide";
+        saveSettings();
+        std::cout << (hideDuplicates ? "List and search show one song of each group of duplicates" : "List and search show every song") << std::endl;
+        return;
+    }
+    
+    refreshDuplicates();
+    if (duplicateGroups.empty()) {
+        std::cout << "No songs that sound the same found" << std::endl;
+    } else {
+        std::cout << duplicateGroups.size() << " group" << (duplicateGroups.size() == 1 ? "" : "s")
+                  << " of songs that sound the same" << (hideDuplicates ? " (only the first is listed)" : "") << ":" << std::endl;
+        for (const auto& group : duplicateGroups) {
+            std::cout << std::endl;
+            for (int songId : group) {
+                const Song& song = allSongs[songId - 1];
+                std::cout << "  " << songId << ". " << song.getDisplayName()
+                          << "  [" << std::filesystem::path(song.filePath).parent_path().filename().string() << "]" << std::endl;
+            }
+        }
+    }
+    
+    if (unfingerprinted > 0) {
+        std::cout << std::endl << unfingerprinted << " song" << (unfingerprinted == 1 ? "" : "s")
+                  << " couldn't be fingerprinted and weren't compared (no built-in decoder reads them, or too little audio)"
+                  << std::endl;
+    }
+    if (features.isBusy()) {
+        std::cout << "Analysis: " << features.getAnalyzedCount() << " / " << features.getQueuedCount()
+                  << " songs, more may turn up" << std::endl;
+    }
+}
+
+void MusicPlayer::refreshDuplicates() {
+    // Only redone once the analysis has moved on
+    size_t analyzed = features.getAnalyzedCount();
+    if (analyzed == duplicatesCheckedAt) {
+        return;
+    }
+    
+    DuplicateIndex index;
+    std::vector<uint32_t> codes;
+    unfingerprinted = 0;
+    for (const auto& song : allSongs) {
+        TrackFeatures info;
+        if (features.findFingerprint(song.filePath, codes)) {
+            index.add(song.id, codes);
+        } else if (features.find(song.filePath, info)) {
+            unfingerprinted++;
+        }
+    }
+    
+    duplicateGroups = index.findClusters();
+    duplicateGroupOf.clear();
+    for (size_t g = 0; g < duplicateGroups.size(); ++g) {
+        for (int songId : duplicateGroups[g]) {
+            duplicateGroupOf[songId] = g;
+        }
+    }
+    duplicatesCheckedAt = analyzed;
+}
+
+bool MusicPlayer::isDuplicateCopy(int songId) const {
+    // All but the first song of a group
+    auto group = duplicateGroupOf.find(songId);
+    return group != duplicateGroupOf.end() && duplicateGroups[group->second][0] != songId;
+}
+
+void MusicPlayer::radioCommand(const std::vector<std::string>& args) {
+    if (allSongs.empty()) {
+        std::cout << "No songs available for radio mode!" << std::endl;
+        return;
+    }
+    
+    int startIndex = -1;
+    if (args.size() > 1) {
+        int songId = parseIntCommand(args[1], 0);
+        if (songId < 1 || songId > static_cast<int>(allSongs.size())) {
+            std::cout << "Usage: radio [number]" << std::endl;
+            return;
+        }
+        startIndex = songId - 1;
+    }
+    
+    // Only songs the analysis could read are on the radio: it can't tell what
+    // the others sound like
+    refreshSimilarity();
+    if (similarity->size() == 0) {
+        std::cout << "Radio mode needs analyzed songs and there are none "
+                  << (features.isBusy() ? "yet, try again once the analysis got going"
+                                        : "(the analysis only reads WAV and MP3 files with audio in them)") << std::endl;
+        return;
+    }
+    auto whyNotAnalyzed = [this](const Song& song) -> std::string {
+        if (!AudioBackend::canDecode(song.filePath)) {
+            return "the built-in decoders don't read it, so it can't be analyzed";
+        }
+        TrackFeatures info;
+        return features.find(song.filePath, info) ? "it is silent" : "it isn't analyzed yet";
+    };
+    if (startIndex >= 0 && !similarity->contains(allSongs[startIndex].id)) {
+        std::cout << "Radio mode can't follow " << allSongs[startIndex].getDisplayName() << ": "
+                  << whyNotAnalyzed(allSongs[startIndex]) << std::endl;
+        return;
+    }
+    
+    // The radio picks from the whole library, the base queue index is the library ID - 1
+    currentQueue = allSongs;
+    queueMode = QueueMode::RADIO;
+    currentPlaylistName.clear();
+    std::cout << "Radio mode: songs that sound like the one playing (" << similarity->size() << " of "
+              << allSongs.size() << " songs analyzed" << (features.isBusy() ? ", more on the way" : "") << ")" << std::endl;
+    if (startIndex < 0 && hasNowPlaying && !similarity->contains(nowPlaying.id)) {
+        std::cout << "The song playing can't be followed, " << whyNotAnalyzed(nowPlaying)
+                  << ". The radio goes on with a random analyzed song" << std::endl;
+    }
+    
+    if (startIndex >= 0) {
+        currentSongIndex = startIndex;
+        playCurrentSong();
+    } else if (hasNowPlaying) {
+        auto it = libraryIdByPath.find(nowPlaying.filePath);
+        currentSongIndex = it != libraryIdByPath.end() ? it->second - 1 : -1;
+        pickRadioNext();
+        if (radioNext >= 0) {
+            std::cout << "Next on the radio: " << currentQueue[radioNext].id << ". " << currentQueue[radioNext].getDisplayName() << std::endl;
+        }
+    } else {
+        pickRadioNext();
+        currentSongIndex = radioNext;
+        playCurrentSong();
+    }
+}
+
+void MusicPlayer::refreshSimilarity() {
+    // Builds run on a thread of their own and the finished index is swapped
+    // in, so a large library never holds up the console; only the lookups
+    // run here. With no index to look in yet, the build is waited for
+    while (true) {
+        if (similarityBuild.valid() &&
+            (similarity->size() == 0 || similarityBuild.wait_for(std::chrono::seconds(0)) == std::future_status::ready)) {
+            takeSimilarityBuild();
+        }
+        
+        // While the analysis runs the index is only rebuilt once it has grown by a tenth
+        size_t analyzed = features.getAnalyzedCount();
+        bool current = similarityBuiltAt != SIZE_MAX &&
+            (analyzed == similarityBuiltAt || (features.isBusy() && analyzed < similarityBuiltAt + similarityBuiltAt / 10 + 16));
+        if (!similarityBuild.valid() && !current && libraryPaths) {
+            similarityBuildPaths = libraryPaths;
+            similarityBuildAt = analyzed;
+            similarityBuild = std::async(std::launch::async, [this, paths = libraryPaths]() {
+                return buildSimilarity(*paths, features, loudness);
+            });
+        }
+        
+        if (similarity->size() > 0 || !similarityBuild.valid()) {
+            return;
+        }
+    }
+}
+
+void MusicPlayer::takeSimilarityBuild() {
+    std::shared_ptr<const SimilarityIndex> built = similarityBuild.get();
+    // Dropped when a scan renumbered the library in the meantime
+    if (similarityBuildPaths == libraryPaths) {
+        similarity = built;
+        similarityBuiltAt = similarityBuildAt;
+    }
+    similarityBuildPaths.reset();
+}
+
+std::shared_ptr<const SimilarityIndex> MusicPlayer::buildSimilarity(const std::vector<std::string>& paths,
+                                                                    const FeatureLibrary& features,
+                                                                    const LoudnessLibrary& loudness) {
+    std::vector<int> songIds;
+    std::vector<SimilarityIndex::Vector> vectors;
+    for (size_t i = 0; i < paths.size(); ++i) {
+        TrackFeatures info;
+        if (!features.find(paths[i], info) || !info.hasTimbre) {
+            continue;
+        }
+        SimilarityIndex::Vector vector;
+        std::copy(info.timbre, info.timbre + FeatureAnalyzer::TIMBRE_SIZE, vector.begin());
+        LoudnessInfo level;
+        vector[FeatureAnalyzer::TIMBRE_SIZE] = info.bpm > 0.0f ? std::log2(info.bpm) : NAN;
+        vector[FeatureAnalyzer::TIMBRE_SIZE + 1] = loudness.find(paths[i], level) ? level.integratedLufs : NAN;
+        songIds.push_back(static_cast<int>(i + 1));
+        vectors.push_back(vector);
+    }
+    std::shared_ptr<SimilarityIndex> index = std::make_shared<SimilarityIndex>();
+    index->build(songIds, vectors, 0);
+    return index;
+}
+
+void MusicPlayer::pickRadioNext() {
+    radioNext = -1;
+    if (currentQueue.empty()) {
+        return;
+    }
+    refreshSimilarity();
+    
+    // Neither the song playing nor anything among the last plays
+    std::unordered_set<int> recent;
+    for (uint64_t key : playStats.recentlyPlayed(RADIO_RECENT)) {
+        auto it = libraryIdByKey.find(key);
+        if (it != libraryIdByKey.end()) {
+            recent.insert(it->second);
+        }
+    }
+    const HistoryRing& history = playQueue.getHistory();
+    for (size_t age = 0; age < history.size() && age < RADIO_RECENT; ++age) {
+        recent.insert(history.at(age).songId);
+    }
+    if (hasNowPlaying) {
+        // Nor another copy of the same song
+        refreshDuplicates();
+        recent.insert(nowPlaying.id);
+        auto group = duplicateGroupOf.find(nowPlaying.id);
+        if (group != duplicateGroupOf.end()) {
+            recent.insert(duplicateGroups[group->second].begin(), duplicateGroups[group->second].end());
+        }
+    }
+    
+    std::mt19937_64 random(ShuffleEngine::randomSeed());
+    std::vector<int> choices;
+    if (hasNowPlaying) {
+        for (int songId : similarity->nearest(nowPlaying.id, RADIO_CANDIDATES)) {
+            if (recent.find(songId) == recent.end()) {
+                choices.push_back(songId);
+                if (choices.size() == RADIO_CHOICES) {
+                    break;
+                }
+            }
+        }
+    }
+    if (!choices.empty()) {
+        radioNext = choices[random() % choices.size()] - 1;
+        return;
+    }
+    
+    // The song isn't analyzed or its neighbours were all just played: any analyzed
+    // song not played lately. The rest can't be placed, so they stay off the radio
+    std::vector<int> analyzed;
+    for (int songId : similarity->getSongIds()) {
+        if (songId >= 1 && songId <= static_cast<int>(currentQueue.size())) {
+            analyzed.push_back(songId);
+        }
+    }
+    if (analyzed.empty()) {
+        return;
+    }
+    for (int attempt = 0; attempt < 64; ++attempt) {
+        int songId = analyzed[random() % analyzed.size()];
+        if (recent.find(songId) == recent.end()) {
+            radioNext = songId - 1;
+            return;
+        }
+    }
+    radioNext = analyzed[random() % analyzed.size()] - 1;
+}
+
+void MusicPlayer::exportCommand(const std::vector<std::string>& args) {
+    if (args.size() < 3) {
+        std::cout << "Usage: export <playlist> <file>" << std::endl;
+        return;
+    }
+    Playlist* playlist = PlaylistManager::getInstance().getPlaylist(args[1]);
+    if (!playlist || playlist->isEmpty()) {
+        std::cout << "Playlist '" << args[1] << "' not found or empty." << std::endl;
+        return;
+    }
+    std::string path = args[2];
+    for (size_t i = 3; i < args.size(); ++i) {
+        path += " " + args[i];
+    }
+    
+    // Rendered the way it would be heard, but at full volume
+    std::vector<Song> songs = playlist->getSongs();
+    std::vector<PlaylistExporter::Track> tracks;
+    for (const Song& song : songs) {
+        tracks.push_back({ song.filePath, songGain(song) });
+    }
+    PlaylistExporter::Settings settings;
+    settings.sampleRate = audioPlayer.getOutputRate();
+    settings.crossfadeMs = audioPlayer.getCrossfadeMs();
+    settings.curve = audioPlayer.getFadeCurve();
+    settings.rate = audioPlayer.getRate();
+    settings.rateMode = audioPlayer.getRateMode();
+    settings.eqBands = audioPlayer.getEqualizer();
+    
+    std::cout << "Exporting " << songs.size() << " songs to " << path << "..." << std::endl;
+    PlaylistExporter exporter(tracks, settings);
+    PlaylistExporter::Report report;
+    bool ok = exporter.run(path, report, [&songs](size_t index) {
+        std::cout << "  " << (index + 1) << "/" << songs.size() << " " << songs[index].getDisplayName() << std::endl;
+    });
+    if (!ok && !report.undecodable.empty()) {
+        std::cout << "Export failed: " << report.undecodable.size() << " of " << songs.size()
+                  << " songs can't be decoded by the built-in decoders (WAV and MP3 only, or the file is damaged):" << std::endl;
+        for (size_t index : report.undecodable) {
+            std::cout << "  " << songs[index].getDisplayName() << " (" << songs[index].filePath << ")" << std::endl;
+        }
+        std::cout << "Take them out of the playlist to export the rest." << std::endl;
+        return;
+    }
+    if (!ok) {
+        std::cout << "Export failed." << std::endl;
+        return;
+    }
+    
+    double audioSeconds = static_cast<double>(report.frames) / report.format.sampleRate;
+    std::ostringstream line;
+    line << std::fixed << std::setprecision(1) << "Exported " << report.tracks << " songs, "
+         << audioPlayer.formatTime(static_cast<unsigned int>(audioSeconds * 1000.0)) << " at " << report.format.sampleRate
+         << " Hz (" << report.bytes / (1024.0 * 1024.0) << " MB) in " << report.seconds << "s: "
+         << (report.seconds > 0.0 ? audioSeconds / report.seconds : 0.0) << "x real time with " << report.workers
+         << " decode thread" << (report.workers == 1 ? "" : "s");
+    std::cout << line.str() << std::endl;
+}
+
+void MusicPlayer::previewCommand(const std::vector<std::string>& args) {
+    if (args.size() > 1 && args[1] == "stop") {
+        if (previewIndex < 0) {
+            std::cout << "Not previewing" << std::endl;
+            return;
+        }
+        endPreview();
+        audioPlayer.stop();
+        return;
+    }
+    
+    // Whatever 'list' or 'search' showed last, the whole library before either ran
+    std::vector<int> songs = listedSongs;
+    if (songs.empty()) {
+        for (const auto& song : allSongs) {
+            songs.push_back(song.id);
+        }
+    }
+    if (songs.empty()) {
+        std::cout << "No songs to preview! Try 'scan', 'list' or 'search' first." << std::endl;
+        return;
+    }
+    
+    size_t first = 0;
+    if (args.size() > 1) {
+        auto it = std::find(songs.begin(), songs.end(), parseIntCommand(args[1]));
+        if (it == songs.end()) {
+            std::cout << "Song " << args[1] << " isn't in the last list or search" << std::endl;
+            return;
+        }
+        const Song* song = findSongById(*it);
+        if (song && !audioPlayer.canPreview(*song)) {
+            std::cout << "Can't preview " << song->getDisplayName()
+                      << ": the built-in decoders don't read it (only WAV and MP3 files)" << std::endl;
+            return;
+        }
+        first = static_cast<size_t>(it - songs.begin());
+    }
+    
+    // Only songs there is a decoder for, the rest would be silence
+    std::vector<int> playable;
+    size_t skipped = 0;
+    for (size_t i = first; i < songs.size(); ++i) {
+        const Song* song = findSongById(songs[i]);
+        if (song && audioPlayer.canPreview(*song)) {
+            playable.push_back(songs[i]);
+        } else {
+            skipped++;
+        }
+    }
+    if (playable.empty()) {
+        std::cout << "None of these songs can be previewed: the built-in decoders only read WAV and MP3 files" << std::endl;
+        return;
+    }
+    
+    // Previewing takes over from the song that was playing
+    if (hasNowPlaying && audioPlayer.getState() != PlaybackState::STOPPED) {
+        stopPlayback();
+    }
+    hasNowPlaying = false;
+    
+    std::cout << "Previewing " << playable.size() << " song" << (playable.size() == 1 ? "" : "s");
+    if (skipped > 0) {
+        std::cout << " (" << skipped << " skipped, no built-in decoder for them)";
+    }
+    std::cout << ", Enter or 'next' for the next one, 'prev' to go back, 'preview stop' to end" << std::endl;
+    previewList = playable;
+    previewIndex = -1;
+    previewStep(1);
+}
+
+void MusicPlayer::previewStep(int direction) {
+    // Songs that fail to open are passed over in the direction we're going
+    int step = direction < 0 ? -1 : 1;
+    int count = static_cast<int>(previewList.size());
+    for (int index = (std::max)(0, previewIndex + direction); index >= 0 && index < count; index += step) {
+        const Song* song = findSongById(previewList[index]);
+        if (!song || !audioPlayer.loadPreview(*song, PreviewClip::DEFAULT_LENGTH_MS, songGain(*song))) {
+            continue;
+        }
+        
+        previewIndex = index;
+        audioPlayer.play();
+        std::cout << "Preview " << (index + 1) << "/" << previewList.size() << ": " << song->id << ". "
+                  << song->getDisplayName() << " from " << audioPlayer.formatTime(audioPlayer.getPreviewStartMs())
+                  << (audioPlayer.isPreviewFromBeatmap() ? " (beatmap preview point)" : "") << std::endl;
+        
+        // The next clip opens while this one plays
+        if (index + 1 < count) {
+            const Song* next = findSongById(previewList[index + 1]);
+            if (next) {
+                audioPlayer.prefetchPreview(*next, PreviewClip::DEFAULT_LENGTH_MS);
+            }
+        }
+        return;
+    }
+    
+    if (direction < 0) {
+        std::cout << "Nothing earlier to preview" << std::endl;
+        return;
+    }
+    std::cout << "End of the preview list" << std::endl;
+    endPreview();
+}
+
+void MusicPlayer::endPreview() {
+    previewIndex = -1;
+    previewList.clear();
+}
+
+void MusicPlayer::rateCommand(const std::string& cmd, const std::vector<std::string>& args) {
+    double rate = audioPlayer.getRate();
+    RateMode mode = audioPlayer.getRateMode();
+    bool changed = true;
+    
+    if (cmd == "dt" || cmd == "ht" || cmd == "nc") {
+        double modRate = cmd == "ht" ? 0.75 : 1.5;
+        RateMode modMode = cmd == "nc" ? RateMode::VARISPEED : RateMode::STRETCH;
+        // Picking the active mod again turns it off, like in osu!
+        bool active = rate == modRate && mode == modMode;
+        rate = active ? 1.0 : modRate;
+        mode = active ? RateMode::STRETCH : modMode;
+    } else if (args.size() > 1) {
+        std::string value = args[1];
+        if (!value.empty() && (value.back() == 'x' || value.back() == 'X')) {
+            value.pop_back(); // "1.5x"
+        }
+        std::string pitch = args.size() > 2 ? args[2] : "keep";
+        std::transform(pitch.begin(), pitch.end(), pitch.begin(), ::tolower);
+        try {
+            rate = std::stod(value);
+        } catch (...) {
+            rate = 0.0;
+        }
+        if (rate <= 0.0 || (pitch != "keep" && pitch != "pitch")) {
+            std::cout << "Usage: rate [0.5-2.0] [keep|pitch]" << std::endl;
+            return;
+        }
+        mode = pitch == "pitch" ? RateMode::VARISPEED : RateMode::STRETCH;
+    } else {
+        changed = false;
+    }
+    
+    if (changed) {
+        audioPlayer.setRate(rate, mode);
+        saveSettings();
+    }
+    
+    rate = audioPlayer.getRate();
+    mode = audioPlayer.getRateMode();
+    if (rate == 1.0) {
+        std::cout << "Playback rate: 1x (normal speed)" << std::endl;
+        return;
+    }
+    
+    std::string mod;
+    if (rate == 1.5) {
+        mod = mode == RateMode::VARISPEED ? " [NC]" : " [DT]";
+    } else if (rate == 0.75 && mode == RateMode::STRETCH) {
+        mod = " [HT]";
+    }
+    std::ostringstream line;
+    line << std::setprecision(3) << rate << "x, "
+         << (mode == RateMode::VARISPEED ? "pitch follows the speed" : "pitch kept") << mod;
+    std::cout << "Playback rate: " << line.str() << std::endl;
+}
+
+void MusicPlayer::eqCommand(const std::vector<std::string>& args) {
+    std::vector<EqBand> bands = audioPlayer.getEqualizer();
+    std::map<std::string, std::vector<EqBand>> builtIn = builtInEqPresets();
+    std::string action = args.size() > 1 ? args[1] : "";
+    std::transform(action.begin(), action.end(), action.begin(), ::tolower);
+    std::string name = args.size() > 2 ? args[2] : "";
+    std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+    bool changed = false;
+    
+    if (action == "add") {
+        EqBand band;
+        bool ok = args.size() > 3 && Equalizer::parseFilter(name, band.type);
+        try {
+            if (ok) {
+                band.frequency = std::stof(args[3]);
+                band.gainDb = args.size() > 4 ? std::stof(args[4]) : 0.0f;
+                band.q = args.size() > 5 ? std::stof(args[5]) : 0.707f;
+            }
+        } catch (...) {
+            ok = false;
+        }
+        if (!ok || band.frequency <= 0.0f || band.q <= 0.0f) {
+            std::cout << "Usage: eq add <peak|lowshelf|highshelf|lowpass|highpass> <hz> [db] [q]" << std::endl;
+            return;
+        }
+        if (bands.size() >= Equalizer::MAX_BANDS) {
+            std::cout << "The equalizer has " << Equalizer::MAX_BANDS << " bands at most." << std::endl;
+            return;
+        }
+        bands.push_back(band);
+        eqPresetName.clear();
+        changed = true;
+    } else if (action == "remove") {
+        int index = parseIntCommand(name);
+        if (index < 1 || index > static_cast<int>(bands.size())) {
+            std::cout << "Usage: eq remove <band number>" << std::endl;
+            return;
+        }
+        bands.erase(bands.begin() + (index - 1));
+        eqPresetName.clear();
+        changed = true;
+    } else if (action == "save") {
+        if (name.empty() || builtIn.count(name) > 0 || name.find_first_of("=,:") != std::string::npos) {
+            std::cout << "Usage: eq save <name> (not a built-in preset name)" << std::endl;
+            return;
+        }
+        eqPresets[name] = bands;
+        eqPresetName = name;
+        saveEqPresets();
+        saveSettings();
+        std::cout << "Saved preset '" << name << "'." << std::endl;
+    } else if (action == "delete") {
+        if (eqPresets.erase(name) == 0) {
+            std::cout << "No saved preset named '" << name << "'." << std::endl;
+            return;
+        }
+        if (eqPresetName == name) {
+            eqPresetName.clear();
+        }
+        saveEqPresets();
+        saveSettings();
+        std::cout << "Deleted preset '" << name << "'." << std::endl;
+        return;
+    } else if (!action.empty()) {
+        std::string preset = action == "off" ? "flat" : action;
+        auto found = eqPresets.find(preset);
+        if (found != eqPresets.end()) {
+            bands = found->second;
+        } else if (builtIn.count(preset) > 0) {
+            bands = builtIn[preset];
+        } else {
+            std::cout << "Unknown preset '" << preset << "'. Type 'eq' to list them." << std::endl;
+            return;
+        }
+        eqPresetName = preset;
+        changed = true;
+    }
+    
+    if (changed) {
+        audioPlayer.setEqualizer(bands);
+        saveSettings();
+    }
+    
+    bands = audioPlayer.getEqualizer();
+    std::cout << "Equalizer: " << (bands.empty() ? "off" : eqPresetName.empty() ? "custom" : eqPresetName) << std::endl;
+    for (size_t i = 0; i < bands.size(); ++i) {
+        const EqBand& band = bands[i];
+        std::cout << "  " << (i + 1) << ". " << Equalizer::filterName(band.type) << " " << band.frequency << " Hz";
+        if (band.type != EqFilter::LOW_PASS && band.type != EqFilter::HIGH_PASS) {
+            std::cout << " " << std::showpos << band.gainDb << std::noshowpos << " dB";
+        }
+        std::cout << " Q " << band.q << std::endl;
+    }
+    
+    std::cout << "Presets:";
+    for (const auto& preset : builtIn) {
+        std::cout << " " << preset.first;
+    }
+    for (const auto& preset : eqPresets) {
+        std::cout << " " << preset.first;
+    }
+    std::cout << std::endl;
+    
+    double cost = audioPlayer.getEqualizerCost();
+    if (cost > 0.0) {
+        std::streamsize precision = std::cout.precision();
+        std::cout << "Cost: " << std::fixed << std::setprecision(1) << cost << std::defaultfloat
+                  << std::setprecision(precision) << " ns per channel, band and frame" << std::endl;
+    }
+}
+
+void MusicPlayer::loadEqPresets() {
+    std::ifstream file("eq_presets.txt");
+    std::string line;
+    while (std::getline(file, line)) {
+        size_t split = line.find('=');
+        std::vector<EqBand> bands;
+        if (split == std::string::npos || split == 0 || !Equalizer::parseBands(line.substr(split + 1), bands)) {
+            continue;
+        }
+        eqPresets[line.substr(0, split)] = bands;
+    }
+}
+
+void MusicPlayer::saveEqPresets() {
+    std::ofstream file("eq_presets.txt");
+    if (file.is_open()) {
+        for (const auto& preset : eqPresets) {
+            file << preset.first << "=" << Equalizer::formatBands(preset.second) << std::endl;
+        }
+    }
+}
+
+float MusicPlayer::songGain(const Song& song) const {
+    return loudness.gainFor(song.filePath, gainMode);
+}
+
 void MusicPlayer::showHelp() {
     displayMenu();
 }
@@ -734,6 +2428,17 @@ void MusicPlayer::saveSettings() {
         file << "volume=" << savedVolume << std::endl;
         file << "show_progress=" << (showProgressTimer ? "1" : "0") << std::endl;
         file << "loop_mode=" << (loopCurrentSong ? "1" : "0") << std::endl;
+        file << "smart_shuffle=" << (smartShuffle ? "1" : "0") << std::endl;
+        file << "hide_duplicates=" << (hideDuplicates ? "1" : "0") << std::endl;
+        file << "crossfade_ms=" << audioPlayer.getCrossfadeMs() << std::endl;
+        file << "crossfade_curve=" << Crossfade::curveName(audioPlayer.getFadeCurve()) << std::endl;
+        file << "track_cache_mb=" << TrackCache::getInstance().getBudgetMB() << std::endl;
+        file << "gain_mode=" << LoudnessLibrary::modeName(gainMode) << std::endl;
+        file << "playback_rate=" << audioPlayer.getRate() << std::endl;
+        file << "rate_mode=" << RateSource::modeName(audioPlayer.getRateMode()) << std::endl;
+        file << "output_rate=" << audioPlayer.getOutputRate() << std::endl;
+        file << "eq_preset=" << eqPresetName << std::endl;
+        file << "eq_bands=" << Equalizer::formatBands(audioPlayer.getEqualizer()) << std::endl;
         file.close();
     }
 }
@@ -763,12 +2468,179 @@ void MusicPlayer::loadSettings() {
                 } catch (...) {
                     loopCurrentSong = false;
                 }
+            } else if (line.find("smart_shuffle=") == 0) {
+                try {
+                    smartShuffle = (std::stoi(line.substr(14)) == 1);
+                } catch (...) {
+                    smartShuffle = false;
+                }
+            } else if (line.find("hide_duplicates=") == 0) {
+                try {
+                    hideDuplicates = (std::stoi(line.substr(16)) == 1);
+                } catch (...) {
+                    hideDuplicates = false;
+                }
+            } else if (line.find("crossfade_ms=") == 0) {
+                try {
+                    unsigned int milliseconds = (std::min)(static_cast<unsigned int>(std::stoul(line.substr(13))), MAX_CROSSFADE_MS);
+                    audioPlayer.setCrossfade(milliseconds, audioPlayer.getFadeCurve());
+                } catch (...) {
+                    audioPlayer.setCrossfade(0, audioPlayer.getFadeCurve());
+                }
+            } else if (line.find("crossfade_curve=") == 0) {
+                FadeCurve curve = audioPlayer.getFadeCurve();
+                if (Crossfade::parseCurve(line.substr(16), curve)) {
+                    audioPlayer.setCrossfade(audioPlayer.getCrossfadeMs(), curve);
+                }
+            } else if (line.find("gain_mode=") == 0) {
+                if (!LoudnessLibrary::parseMode(line.substr(10), gainMode)) {
+                    gainMode = GainMode::OFF;
+                }
+            } else if (line.find("playback_rate=") == 0) {
+                try {
+                    audioPlayer.setRate(std::stod(line.substr(14)), audioPlayer.getRateMode());
+                } catch (...) {
+                    audioPlayer.setRate(1.0, audioPlayer.getRateMode());
+                }
+            } else if (line.find("rate_mode=") == 0) {
+                RateMode mode = line.substr(10) == "varispeed" ? RateMode::VARISPEED : RateMode::STRETCH;
+                audioPlayer.setRate(audioPlayer.getRate(), mode);
+            } else if (line.find("eq_preset=") == 0) {
+                eqPresetName = line.substr(10);
+            } else if (line.find("eq_bands=") == 0) {
+                std::vector<EqBand> bands;
+                if (Equalizer::parseBands(line.substr(9), bands)) {
+                    audioPlayer.setEqualizer(bands);
+                }
+            } else if (line.find("output_rate=") == 0) {
+                try {
+                    unsigned int sampleRate = static_cast<unsigned int>(std::stoul(line.substr(12)));
+                    audioPlayer.setOutputRate(sampleRate >= MIN_OUTPUT_RATE && sampleRate <= MAX_OUTPUT_RATE ? sampleRate : 0);
+                } catch (...) {
+                    audioPlayer.setOutputRate(0);
+                }
+            } else if (line.find("track_cache_mb=") == 0) {
+                try {
+                    TrackCache::getInstance().setBudgetMB(static_cast<unsigned int>(std::stoul(line.substr(15))));
+                } catch (...) {
+                    TrackCache::getInstance().setBudgetMB(TrackCache::DEFAULT_BUDGET_MB);
+                }
             }
         }
         file.close();
     }
 }
 
+void MusicPlayer::saveSession() {
+    SessionState session;
+    session.queueMode = queueMode;
+    session.playlistName = currentPlaylistName;
+    session.shuffleSeed = shuffleSeed();
+    session.smartShuffle = smartShuffle;
+    session.randomPosition = randomPosition;
+    session.currentSongIndex = currentSongIndex;
+    session.librarySize = static_cast<uint32_t>(allSongs.size());
+    
+    session.hasCurrentSong = hasNowPlaying;
+    session.currentSong = nowPlaying;
+    session.positionMs = audioPlayer.getState() != PlaybackState::STOPPED ? audioPlayer.getPosition() : 0;
+    session.wasPlaying = audioPlayer.isPlaying();
+    
+    if (!SessionSnapshot::save("session.bin", session, playQueue)) {
+        std::cout << "Warning: could not save session." << std::endl;
+    }
+    lastSessionSave = std::chrono::steady_clock::now();
+}
+
+void MusicPlayer::resumeSessionPlayback(const SessionState& session) {
+    if (!session.hasCurrentSong || session.currentSong.filePath.empty()) {
+        return;
+    }
+    
+    std::error_code error;
+    if (!std::filesystem::exists(session.currentSong.filePath, error)) {
+        return;
+    }
+    
+    nowPlaying = session.currentSong;
+    nowPlayingEntry = QueueEntry(0, -1); // Resolved against the library after the scan
+    hasNowPlaying = true;
+    
+    // A stopped song is only selected again, not restarted
+    if (!session.wasPlaying && session.positionMs == 0) {
+        return;
+    }
+    
+    if (audioPlayer.loadSong(nowPlaying, songGain(nowPlaying))) {
+        audioPlayer.play();
+        if (session.positionMs > 0 && session.positionMs < audioPlayer.getLength()) {
+            audioPlayer.setPosition(session.positionMs);
+        }
+        if (!session.wasPlaying) {
+            audioPlayer.pause();
+        }
+        std::cout << "Resuming: " << nowPlaying.getDisplayName() << " at " << audioPlayer.formatTime(session.positionMs) << std::endl;
+        updateDiscordPresence();
+    }
+}
+
+void MusicPlayer::restoreSessionQueue(const SessionState& session) {
+    // Up-next and history hold library IDs, which only line up with the same library
+    if (session.librarySize != allSongs.size()) {
+        playQueue.clear();
+    }
+    
+    // Rebuild the base queue the session was using
+    bool fromPlaylist = session.queueMode == QueueMode::PLAYLIST ||
+                        (session.queueMode == QueueMode::RANDOM && !session.playlistName.empty());
+    if (fromPlaylist) {
+        Playlist* playlist = PlaylistManager::getInstance().getPlaylist(session.playlistName);
+        if (playlist && !playlist->isEmpty()) {
+            setQueueFromPlaylist(session.playlistName);
+        }
+    }
+    
+    // Locate the resumed song in the rebuilt queue
+    if (hasNowPlaying) {
+        auto it = libraryIdByPath.find(nowPlaying.filePath);
+        nowPlaying.id = (it != libraryIdByPath.end()) ? it->second : 0;
+        
+        int index = session.currentSongIndex;
+        if (index < 0 || index >= static_cast<int>(currentQueue.size()) ||
+            currentQueue[index].filePath != nowPlaying.filePath) {
+            index = -1;
+            for (size_t i = 0; i < currentQueue.size(); ++i) {
+                if (currentQueue[i].filePath == nowPlaying.filePath) {
+                    index = static_cast<int>(i);
+                    break;
+                }
+            }
+        }
+        currentSongIndex = index;
+        nowPlayingEntry = QueueEntry(nowPlaying.id, index);
+    }
+    
+    // Same queue and seed give back the same shuffle order
+    if (session.queueMode == QueueMode::RANDOM && !currentQueue.empty()) {
+        queueMode = QueueMode::RANDOM;
+        smartShuffle = session.smartShuffle;
+        generateRandomIndices(session.shuffleSeed);
+        if (currentSongIndex >= 0) {
+            randomPosition = shufflePositionOf(currentSongIndex);
+        } else {
+            randomPosition = (std::min)((std::max)(session.randomPosition, 0), shuffleSize() - 1);
+        }
+    }
+    
+    if (session.queueMode == QueueMode::RADIO && !currentQueue.empty()) {
+        queueMode = QueueMode::RADIO;
+        pickRadioNext();
+    }
+    
+    std::cout << "Session restored (" << playQueue.getUpNext().size() << " up next, "
+              << playQueue.getHistory().size() << " in history)" << std::endl;
+}
+
 void MusicPlayer::toggleLoop() {
     loopCurrentSong = !loopCurrentSong;
     std::cout << "Loop mode " << (loopCurrentSong ? "enabled" : "disabled") << std::endl;
@@ -779,12 +2651,12 @@ void MusicPlayer::toggleLoop() {
 
 void MusicPlayer::checkCurrentSongInPlaylist(const std::string& playlistName) {
     // Check if we have a current song
-    if (currentSongIndex < 0 || currentSongIndex >= static_cast<int>(currentQueue.size())) {
+    if (!hasNowPlaying) {
         std::cout << "No song is currently selected." << std::endl;
         return;
     }
     
-    const Song& currentSong = currentQueue[currentSongIndex];
+    const Song& currentSong = nowPlaying;
     
     // Get the playlist
     Playlist* playlist = PlaylistManager::getInstance().getPlaylist(playlistName);
@@ -820,11 +2692,23 @@ void MusicPlayer::checkCurrentSongInPlaylist(const std::string& playlistName) {
 void MusicPlayer::update() {
     audioPlayer.update();
     
+    // Clips play one after the other, without the queue, stats or the session
+    if (previewIndex >= 0) {
+        if (audioPlayer.hasFinished()) {
+            previewStep(1);
+        }
+        return;
+    }
+    
     // Check if song finished naturally (not manually stopped)
-    if (audioPlayer.hasFinished() && currentSongIndex >= 0 && !currentQueue.empty()) {
-        if (loopCurrentSong) {
+    if (audioPlayer.hasFinished() && hasNowPlaying) {
+        playStats.recordFinish(nowPlaying, audioPlayer.getLength());
+        
+        if (audioPlayer.hasAdvancedToPreloaded()) {
+            continueWithPreloaded();
+        } else if (loopCurrentSong) {
             std::cout << "\n\nSong finished, looping current song..." << std::endl;
-            playCurrentSong(); // Replay the same song
+            playSong(nowPlaying, nowPlayingEntry, false); // Replay the same song
         } else {
             std::cout << "\n\nSong finished, auto-advancing to next..." << std::endl;
             playNext();
@@ -832,8 +2716,32 @@ void MusicPlayer::update() {
         return; // Exit early after starting next song
     }
     
-    // Small delay to prevent excessive CPU usage
-    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    updatePreroll();
+    
+    // Keep the session snapshot fresh in case we don't get a clean shutdown
+    if (hasNowPlaying && std::chrono::steady_clock::now() - lastSessionSave >= SESSION_SAVE_INTERVAL) {
+        saveSession();
+        loudness.save("loudness.bin"); // Only writes when the analysis found something new
+        features.save("features.bin", "waveforms.bin");
+    }
+}
+
+int MusicPlayer::nextWakeDelay() const {
+    if (!audioPlayer.isPlaying()) {
+        return -1; // Nothing moves until a command comes in
+    }
+    
+    // The session only needs saving while the position moves
+    auto untilSave = std::chrono::duration_cast<std::chrono::milliseconds>(lastSessionSave + SESSION_SAVE_INTERVAL - std::chrono::steady_clock::now());
+    int delay = -1;
+    if (hasNowPlaying) {
+        delay = untilSave.count() > 0 ? static_cast<int>(untilSave.count()) : 0;
+    }
+    
+    if (showProgressTimer && (delay < 0 || delay > PROGRESS_REFRESH_MS)) {
+        delay = PROGRESS_REFRESH_MS;
+    }
+    return delay;
 }
 
 bool MusicPlayer::hasInput() {
@@ -0,0 +1,151 @@
+#include "../headers/osuBeatmap.hpp"
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+#include <algorithm>
+#include <vector>
+#include <map>
+
+namespace fs = std::filesystem;
+
+namespace {
+    // Gimmick sections use absurd tempos, they don't count towards the range
+    const double MAX_SENSIBLE_BPM = 1000.0;
+
+    std::string trim(const std::string& text) {
+        size_t first = text.find_first_not_of(" \t\r\n\xEF\xBB\xBF");
+        if (first == std::string::npos) {
+            return "";
+        }
+        size_t last = text.find_last_not_of(" \t\r\n");
+        return text.substr(first, last - first + 1);
+    }
+
+    std::string lower(std::string text) {
+        std::transform(text.begin(), text.end(), text.begin(), ::tolower);
+        return text;
+    }
+
+    std::vector<std::string> splitFields(const std::string& line) {
+        std::vector<std::string> fields;
+        std::stringstream stream(line);
+        std::string field;
+        while (std::getline(stream, field, ',')) {
+            fields.push_back(field);
+        }
+        return fields;
+    }
+}
+
+bool OsuBeatmap::load(const std::string& osuPath) {
+    std::ifstream file(osuPath);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    struct TimingPoint {
+        double timeMs;
+        double beatLength;
+    };
+    std::vector<TimingPoint> timing;
+    double lastObjectMs = 0.0;
+
+    std::string section;
+    std::string line;
+    while (std::getline(file, line)) {
+        line = trim(line);
+        if (line.empty() || line.compare(0, 2, "//") == 0) {
+            continue;
+        }
+        if (line.front() == '[' && line.back() == ']') {
+            section = line;
+            continue;
+        }
+
+        try {
+            if (section == "[General]") {
+                size_t colon = line.find(':');
+                if (colon == std::string::npos) {
+                    continue;
+                }
+                std::string key = trim(line.substr(0, colon));
+                std::string value = trim(line.substr(colon + 1));
+                if (key == "AudioFilename") {
+                    audioFilename = value;
+                } else if (key == "PreviewTime") {
+                    previewTimeMs = std::stoi(value);
+                }
+            } else if (section == "[TimingPoints]") {
+                // time,beatLength,meter,sampleSet,sampleIndex,volume,uninherited,effects;
+                // old maps stop after beatLength. Inherited points have a negative one
+                std::vector<std::string> fields = splitFields(line);
+                if (fields.size() < 2) {
+                    continue;
+                }
+                double beatLength = std::stod(fields[1]);
+                bool uninherited = fields.size() < 7 || std::stoi(fields[6]) != 0;
+                if (uninherited && beatLength > 0.0) {
+                    timing.push_back({ std::stod(fields[0]), beatLength });
+                }
+            } else if (section == "[HitObjects]") {
+                std::vector<std::string> fields = splitFields(line);
+                if (fields.size() >= 3) {
+                    lastObjectMs = (std::max)(lastObjectMs, std::stod(fields[2]));
+                }
+            }
+        } catch (...) {
+            continue; // A malformed line doesn't spoil the rest of the file
+        }
+    }
+
+    if (previewTimeMs < 0) {
+        previewTimeMs = -1;
+    }
+    if (timing.empty()) {
+        return true;
+    }
+
+    // The main tempo is the one that lasts longest up to the last object
+    std::sort(timing.begin(), timing.end(), [](const TimingPoint& a, const TimingPoint& b) {
+        return a.timeMs < b.timeMs;
+    });
+    std::map<double, double> durations;
+    double endMs = (std::max)(lastObjectMs, timing.back().timeMs);
+    for (size_t i = 0; i < timing.size(); ++i) {
+        double bpm = 60000.0 / timing[i].beatLength;
+        double until = i + 1 < timing.size() ? timing[i + 1].timeMs : endMs;
+        durations[bpm] += (std::max)(0.0, until - timing[i].timeMs);
+
+        if (bpm <= MAX_SENSIBLE_BPM) {
+            minBpm = minBpm == 0.0 ? bpm : (std::min)(minBpm, bpm);
+            maxBpm = (std::max)(maxBpm, bpm);
+        }
+    }
+
+    double longest = -1.0;
+    for (const auto& entry : durations) {
+        if (entry.second > longest && entry.first <= MAX_SENSIBLE_BPM) {
+            longest = entry.second;
+            mainBpm = entry.first;
+        }
+    }
+    return true;
+}
+
+bool OsuBeatmap::findFor(const std::string& audioPath, OsuBeatmap& beatmap) {
+    fs::path audio(audioPath);
+    std::string audioName = lower(audio.filename().string());
+
+    std::error_code error;
+    for (fs::directory_iterator it(audio.parent_path(), error), end; !error && it != end; it.increment(error)) {
+        if (!it->is_regular_file(error) || lower(it->path().extension().string()) != ".osu") {
+            continue;
+        }
+        OsuBeatmap candidate;
+        if (candidate.load(it->path().string()) && lower(candidate.audioFilename) == audioName) {
+            beatmap = candidate;
+            return true;
+        }
+    }
+    return false;
+}
\ No newline at end of file
@@ -0,0 +1,146 @@
+#include "../headers/playQueue.hpp"
+#include "../headers/binaryIO.hpp"
+
+using BinaryIO::writeValue;
+using BinaryIO::readValue;
+
+// HistoryRing Implementation
+HistoryRing::HistoryRing(size_t capacity) : slots(capacity > 0 ? capacity : 1), head(0), count(0) {}
+
+void HistoryRing::push(const QueueEntry& entry) {
+    slots[head] = entry;
+    head = (head + 1) % slots.size();
+    if (count < slots.size()) {
+        count++;
+    }
+}
+
+QueueEntry HistoryRing::popLatest() {
+    if (count == 0) {
+        return QueueEntry();
+    }
+    head = (head + slots.size() - 1) % slots.size();
+    count--;
+    return slots[head];
+}
+
+const QueueEntry& HistoryRing::at(size_t age) const {
+    return slots[(head + slots.size() - 1 - (age % slots.size())) % slots.size()];
+}
+
+size_t HistoryRing::size() const {
+    return count;
+}
+
+size_t HistoryRing::capacity() const {
+    return slots.size();
+}
+
+bool HistoryRing::isEmpty() const {
+    return count == 0;
+}
+
+void HistoryRing::clear() {
+    head = 0;
+    count = 0;
+}
+
+// PlayQueue Implementation
+PlayQueue::PlayQueue(size_t historyCapacity) : history(historyCapacity) {}
+
+void PlayQueue::enqueue(const QueueEntry& entry) {
+    upNext.push_back(entry);
+}
+
+void PlayQueue::playNext(const QueueEntry& entry) {
+    upNext.push_front(entry);
+}
+
+bool PlayQueue::hasUpNext() const {
+    return !upNext.empty();
+}
+
+QueueEntry PlayQueue::popUpNext() {
+    if (upNext.empty()) {
+        return QueueEntry();
+    }
+    QueueEntry entry = upNext.front();
+    upNext.pop_front();
+    return entry;
+}
+
+const std::deque<QueueEntry>& PlayQueue::getUpNext() const {
+    return upNext;
+}
+
+void PlayQueue::pushHistory(const QueueEntry& entry) {
+    history.push(entry);
+}
+
+bool PlayQueue::hasHistory() const {
+    return !history.isEmpty();
+}
+
+QueueEntry PlayQueue::popHistory() {
+    return history.popLatest();
+}
+
+const HistoryRing& PlayQueue::getHistory() const {
+    return history;
+}
+
+void PlayQueue::clear() {
+    upNext.clear();
+    history.clear();
+}
+
+void PlayQueue::save(std::ostream& out) const {
+    writeValue(out, static_cast<uint32_t>(upNext.size()));
+    for (const QueueEntry& entry : upNext) {
+        writeValue(out, static_cast<int32_t>(entry.songId));
+        writeValue(out, static_cast<int32_t>(entry.baseIndex));
+    }
+
+    // History is written oldest first so loading can simply push
+    writeValue(out, static_cast<uint32_t>(history.size()));
+    for (size_t age = history.size(); age-- > 0;) {
+        const QueueEntry& entry = history.at(age);
+        writeValue(out, static_cast<int32_t>(entry.songId));
+        writeValue(out, static_cast<int32_t>(entry.baseIndex));
+    }
+}
+
+bool PlayQueue::load(std::istream& in) {
+    clear();
+
+    uint32_t upNextCount = 0;
+    if (!readValue(in, upNextCount)) {
+        return false;
+    }
+    for (uint32_t i = 0; i < upNextCount; ++i) {
+        int32_t songId = 0;
+        int32_t baseIndex = -1;
+        if (!readValue(in, songId) || !readValue(in, baseIndex)) {
+            clear();
+            return false;
+        }
+        upNext.push_back(QueueEntry(songId, baseIndex));
+    }
+
+    uint32_t historyCount = 0;
+    if (!readValue(in, historyCount)) {
+        clear();
+        return false;
+    }
+    for (uint32_t i = 0; i < historyCount; ++i) {
+        int32_t songId = 0;
+        int32_t baseIndex = -1;
+        if (!readValue(in, songId) || !readValue(in, baseIndex)) {
+            clear();
+            return false;
+        }
+        history.push(QueueEntry(songId, baseIndex));
+    }
+
+    return true;
+}
\ No newline at end of file
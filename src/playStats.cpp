@@ -0,0 +1,357 @@
+#include "../headers/playStats.hpp"
+#include "../headers/binaryIO.hpp"
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+
+namespace fs = std::filesystem;
+using namespace BinaryIO;
+
+namespace {
+    const uint32_t SUMMARY_MAGIC = 0x53504453; // "SDPS"
+    const uint32_t SUMMARY_VERSION = 1;
+    const uint64_t RETENTION_MS = 90ULL * 24 * 60 * 60 * 1000; // Events kept in the log for window queries
+}
+
+PlayStats::PlayStats() : foldedUntilMs(0), playCount(0), skipCount(0) {}
+
+PlayStats::~PlayStats() {
+    close();
+}
+
+bool PlayStats::open(const std::string& logFileName, const std::string& summaryFileName) {
+    logPath = logFileName;
+    summaryPath = summaryFileName;
+    aggregates.clear();
+    recentEvents.clear();
+    playCount = 0;
+    skipCount = 0;
+
+    loadSummary();
+
+    // Read the log, ignoring a torn record at the end and anything already folded
+    std::vector<PlayEvent> events;
+    {
+        std::ifstream in(logPath, std::ios::binary);
+        PlayEvent event;
+        while (in.read(reinterpret_cast<char*>(&event), sizeof(PlayEvent))) {
+            if (event.timestampMs > foldedUntilMs && event.type <= static_cast<uint8_t>(PlayEventType::SKIP)) {
+                events.push_back(event);
+            }
+        }
+    }
+
+    // Cut the torn record off, or every event appended after it would be read
+    // out of step with the record boundaries
+    bool logIntact = true;
+    std::error_code error;
+    uintmax_t logSize = fs::file_size(logPath, error);
+    if (!error && logSize % sizeof(PlayEvent) != 0) {
+        fs::resize_file(logPath, logSize / sizeof(PlayEvent) * sizeof(PlayEvent), error);
+        logIntact = !error;
+    }
+
+    std::stable_sort(events.begin(), events.end(), [](const PlayEvent& a, const PlayEvent& b) {
+        return a.timestampMs < b.timestampMs;
+    });
+
+    // Compaction: fold everything older than the retention window into the summary
+    uint64_t cutoff = nowMs() > RETENTION_MS ? nowMs() - RETENTION_MS : 0;
+    auto firstRetained = std::lower_bound(events.begin(), events.end(), cutoff, [](const PlayEvent& event, uint64_t time) {
+        return event.timestampMs < time;
+    });
+
+    if (firstRetained != events.begin()) {
+        for (auto it = events.begin(); it != firstRetained; ++it) {
+            apply(*it, false);
+        }
+        foldedUntilMs = (std::max)(foldedUntilMs, (firstRetained - 1)->timestampMs);
+
+        // Summary first: if we stop before the log is rewritten, foldedUntilMs
+        // still keeps the old events from being counted twice
+        if (writeSummary()) {
+            rewriteLog(std::vector<PlayEvent>(firstRetained, events.end()));
+        }
+    }
+
+    for (auto it = firstRetained; it != events.end(); ++it) {
+        apply(*it, false);
+        recentEvents.push_back(*it);
+    }
+    rebuildIndexes();
+
+    if (logIntact) {
+        logFile.open(logPath, std::ios::binary | std::ios::app);
+    }
+    if (!logFile.is_open()) {
+        std::cout << "Warning: could not open " << logPath << ", play statistics won't be recorded." << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void PlayStats::close() {
+    if (logFile.is_open()) {
+        logFile.close();
+    }
+}
+
+void PlayStats::recordStart(const Song& song) {
+    record(PlayEventType::START, song, 0);
+}
+
+void PlayStats::recordFinish(const Song& song, unsigned int positionMs) {
+    record(PlayEventType::FINISH, song, positionMs);
+}
+
+void PlayStats::recordSkip(const Song& song, unsigned int positionMs) {
+    record(PlayEventType::SKIP, song, positionMs);
+}
+
+uint64_t PlayStats::songKey(const Song& song) {
+    // FNV-1a over "artist\ntitle"
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    auto mix = [&hash](const std::string& text) {
+        for (unsigned char c : text) {
+            hash ^= c;
+            hash *= 0x100000001B3ULL;
+        }
+    };
+    mix(song.artist);
+    mix("\n");
+    mix(song.title);
+    return hash;
+}
+
+uint64_t PlayStats::nowMs() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+}
+
+const SongStats* PlayStats::getStats(uint64_t key) const {
+    auto it = aggregates.find(key);
+    return it != aggregates.end() ? &it->second : nullptr;
+}
+
+double PlayStats::getSkipRate(uint64_t key) const {
+    const SongStats* stats = getStats(key);
+    if (!stats || stats->plays == 0) {
+        return 0.0;
+    }
+    return (std::min)(1.0, static_cast<double>(stats->skips) / stats->plays);
+}
+
+std::vector<std::pair<uint64_t, uint32_t>> PlayStats::topPlayed(size_t count, uint64_t sinceMs) const {
+    std::vector<std::pair<uint64_t, uint32_t>> result;
+
+    if (sinceMs == 0) {
+        for (auto it = byPlays.rbegin(); it != byPlays.rend() && result.size() < count; ++it) {
+            result.emplace_back(it->second, it->first);
+        }
+        return result;
+    }
+
+    // Window query: replay the starts inside the window
+    auto first = std::lower_bound(recentEvents.begin(), recentEvents.end(), sinceMs, [](const PlayEvent& event, uint64_t time) {
+        return event.timestampMs < time;
+    });
+    std::unordered_map<uint64_t, uint32_t> counts;
+    for (auto it = first; it != recentEvents.end(); ++it) {
+        if (it->type == static_cast<uint8_t>(PlayEventType::START)) {
+            counts[it->songKey]++;
+        }
+    }
+
+    result.assign(counts.begin(), counts.end());
+    size_t keep = (std::min)(count, result.size());
+    std::partial_sort(result.begin(), result.begin() + keep, result.end(), [](const auto& a, const auto& b) {
+        return a.second != b.second ? a.second > b.second : a.first < b.first;
+    });
+    result.resize(keep);
+    return result;
+}
+
+std::vector<uint64_t> PlayStats::recentlyPlayed(size_t count) const {
+    std::vector<uint64_t> result;
+    for (auto it = byLastPlayed.rbegin(); it != byLastPlayed.rend() && result.size() < count; ++it) {
+        result.push_back(it->second);
+    }
+    return result;
+}
+
+std::vector<std::pair<uint64_t, double>> PlayStats::mostSkipped(size_t count, uint32_t minPlays) const {
+    std::vector<std::pair<uint64_t, double>> result;
+    for (const auto& pair : aggregates) {
+        if (pair.second.plays >= minPlays && pair.second.skips > 0) {
+            result.emplace_back(pair.first, getSkipRate(pair.first));
+        }
+    }
+
+    size_t keep = (std::min)(count, result.size());
+    std::partial_sort(result.begin(), result.begin() + keep, result.end(), [](const auto& a, const auto& b) {
+        return a.second != b.second ? a.second > b.second : a.first < b.first;
+    });
+    result.resize(keep);
+    return result;
+}
+
+size_t PlayStats::songCount() const {
+    return aggregates.size();
+}
+
+uint64_t PlayStats::totalPlays() const {
+    return playCount;
+}
+
+uint64_t PlayStats::totalSkips() const {
+    return skipCount;
+}
+
+uint64_t PlayStats::retainedSinceMs() const {
+    return recentEvents.empty() ? nowMs() : recentEvents.front().timestampMs;
+}
+
+void PlayStats::record(PlayEventType type, const Song& song, unsigned int positionMs) {
+    PlayEvent event = {};
+    event.timestampMs = nowMs();
+    event.songKey = songKey(song);
+    event.positionMs = positionMs;
+    event.type = static_cast<uint8_t>(type);
+
+    if (logFile.is_open()) {
+        logFile.write(reinterpret_cast<const char*>(&event), sizeof(PlayEvent));
+        logFile.flush();
+    }
+
+    apply(event, true);
+    recentEvents.push_back(event);
+}
+
+void PlayStats::apply(const PlayEvent& event, bool updateIndexes) {
+    SongStats& stats = aggregates[event.songKey];
+
+    if (updateIndexes) {
+        byPlays.erase({ stats.plays, event.songKey });
+        byLastPlayed.erase({ stats.lastPlayedMs, event.songKey });
+    }
+
+    switch (static_cast<PlayEventType>(event.type)) {
+        case PlayEventType::START:
+            stats.plays++;
+            stats.lastPlayedMs = (std::max)(stats.lastPlayedMs, event.timestampMs);
+            playCount++;
+            break;
+        case PlayEventType::FINISH:
+            stats.finishes++;
+            stats.listenedMs += event.positionMs;
+            break;
+        case PlayEventType::SKIP:
+            stats.skips++;
+            stats.listenedMs += event.positionMs;
+            skipCount++;
+            break;
+    }
+
+    if (updateIndexes) {
+        byPlays.insert({ stats.plays, event.songKey });
+        byLastPlayed.insert({ stats.lastPlayedMs, event.songKey });
+    }
+}
+
+void PlayStats::rebuildIndexes() {
+    byPlays.clear();
+    byLastPlayed.clear();
+    for (const auto& pair : aggregates) {
+        byPlays.insert({ pair.second.plays, pair.first });
+        byLastPlayed.insert({ pair.second.lastPlayedMs, pair.first });
+    }
+}
+
+bool PlayStats::loadSummary() {
+    foldedUntilMs = 0;
+
+    std::ifstream in(summaryPath, std::ios::binary);
+    if (!in.is_open()) {
+        return false;
+    }
+
+    uint32_t magic = 0;
+    uint32_t version = 0;
+    uint64_t entryCount = 0;
+    uint64_t foldedUntil = 0;
+    if (!readValue(in, magic) || !readValue(in, version) || magic != SUMMARY_MAGIC || version != SUMMARY_VERSION ||
+        !readValue(in, foldedUntil) || !readValue(in, entryCount)) {
+        std::cout << "Ignoring unreadable " << summaryPath << std::endl;
+        return false;
+    }
+
+    for (uint64_t i = 0; i < entryCount; ++i) {
+        uint64_t key = 0;
+        SongStats stats;
+        if (!readValue(in, key) || !readValue(in, stats.plays) || !readValue(in, stats.finishes) ||
+            !readValue(in, stats.skips) || !readValue(in, stats.lastPlayedMs) || !readValue(in, stats.listenedMs)) {
+            std::cout << "Ignoring truncated " << summaryPath << std::endl;
+            aggregates.clear();
+            playCount = 0;
+            skipCount = 0;
+            return false;
+        }
+        aggregates[key] = stats;
+        playCount += stats.plays;
+        skipCount += stats.skips;
+    }
+
+    foldedUntilMs = foldedUntil;
+    return true;
+}
+
+bool PlayStats::writeSummary() const {
+    std::string tempName = summaryPath + ".tmp";
+    {
+        std::ofstream out(tempName, std::ios::binary | std::ios::trunc);
+        if (!out.is_open()) {
+            return false;
+        }
+
+        writeValue(out, SUMMARY_MAGIC);
+        writeValue(out, SUMMARY_VERSION);
+        writeValue(out, foldedUntilMs);
+        writeValue(out, static_cast<uint64_t>(aggregates.size()));
+        for (const auto& pair : aggregates) {
+            writeValue(out, pair.first);
+            writeValue(out, pair.second.plays);
+            writeValue(out, pair.second.finishes);
+            writeValue(out, pair.second.skips);
+            writeValue(out, pair.second.lastPlayedMs);
+            writeValue(out, pair.second.listenedMs);
+        }
+        if (!out.good()) {
+            return false;
+        }
+    }
+
+    std::error_code error;
+    fs::rename(tempName, summaryPath, error);
+    return !error;
+}
+
+bool PlayStats::rewriteLog(const std::vector<PlayEvent>& events) const {
+    std::string tempName = logPath + ".tmp";
+    {
+        std::ofstream out(tempName, std::ios::binary | std::ios::trunc);
+        if (!out.is_open()) {
+            return false;
+        }
+        if (!events.empty()) {
+            out.write(reinterpret_cast<const char*>(events.data()), static_cast<std::streamsize>(events.size() * sizeof(PlayEvent)));
+        }
+        if (!out.good()) {
+            return false;
+        }
+    }
+
+    std::error_code error;
+    fs::rename(tempName, logPath, error);
+    return !error;
+}
\ No newline at end of file
@@ -0,0 +1,994 @@
+#include "../headers/playbackEngine.hpp"
+#include "../headers/trackCache.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+    uint64_t steadyMicros(std::chrono::steady_clock::time_point time) {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(time.time_since_epoch()).count());
+    }
+
+    void applyGain(float* samples, size_t count, float gain) {
+        if (gain == 1.0f) {
+            return;
+        }
+        for (size_t i = 0; i < count; ++i) {
+            samples[i] *= gain;
+        }
+    }
+}
+
+PlaybackEngine::PlaybackEngine(AudioEvents* events, AnalysisTap* tap)
+    : events(events), tap(tap), stopKind(STOP_NONE), stopFrame(0), nextLength(0), jumpTarget(0), playing(false), framesDecoded(0), decodeNanos(0),
+      bufferBytes(0), loaded(false), epoch(0), seenTrackChanges(0), outputRate(0), rate(1.0), rateMode(RateMode::STRETCH), state(RenderState::IDLE), volume(1.0f),
+      milestoneFrame(NO_MILESTONE), halted(false), flushing(false), flushEpoch(0), hasHeldMark(false), awaitingFirstAudio(false),
+      transitionPending(false), sourceGain(1.0f), nextGain(1.0f), outgoingGain(1.0f), sourceEnded(false), endPublished(false), prerollFrames(0), prerollOffset(0),
+      prerollPending(false), seekPrepared(false), hasBoundary(false), switchFrame(0), crossfadeMs(0), fadeCurve(FadeCurve::EQUAL_POWER),
+      decodeRate(1.0), decodeRateMode(RateMode::STRETCH), fading(false),
+      fadeLength(0), fadeDone(0) {
+    renderThread = std::thread(&PlaybackEngine::renderLoop, this);
+    decodeThread = std::thread(&PlaybackEngine::decodeLoop, this);
+}
+
+PlaybackEngine::~PlaybackEngine() {
+    shutdown();
+}
+
+bool PlaybackEngine::setOutput(const std::string& kind, const std::string& path) {
+    std::unique_ptr<AudioSink> newSink = AudioSink::create(kind, path);
+    if (!newSink) {
+        return false;
+    }
+
+    // The render thread has to be off the old sink before it can be swapped
+    haltRender();
+    bool ok = !loaded || newSink->open(format);
+    if (ok) {
+        if (sink) {
+            sink->close();
+        }
+        sink = std::move(newSink);
+    }
+    sendRender(RenderCommand::Type::RELEASE);
+    return ok;
+}
+
+std::string PlaybackEngine::getOutputName() const {
+    return sink ? sink->getName() : "none";
+}
+
+void PlaybackEngine::setOutputRate(unsigned int sampleRate) {
+    outputRate = sampleRate;
+}
+
+unsigned int PlaybackEngine::getOutputRate() const {
+    return outputRate;
+}
+
+unsigned int PlaybackEngine::getDeviceRate() const {
+    return loaded ? format.sampleRate : 0;
+}
+
+void PlaybackEngine::shutdown() {
+    if (renderThread.joinable()) {
+        sendRender(RenderCommand::Type::QUIT);
+        renderThread.join();
+    }
+    if (decodeThread.joinable()) {
+        DecodeCommand command;
+        command.type = DecodeCommand::Type::QUIT;
+        sendDecode(command);
+        decodeThread.join();
+    }
+
+    // Both threads are gone, everything belongs to this one again
+    source.reset();
+    nextSource.reset();
+    outgoingSource.reset();
+    sink.reset();
+    loaded = false;
+}
+
+bool PlaybackEngine::load(std::unique_ptr<AudioBackend> newSource, float gain) {
+    if (!renderThread.joinable()) {
+        return false;
+    }
+
+    // From the acknowledged flush until the decode thread posts its start mark the
+    // render thread leaves the sink, the block buffer and its status alone
+    uint32_t loadEpoch = flush();
+    clearMilestone();
+    waitForAck(loadEpoch);
+
+    loaded = false;
+    std::unique_ptr<RateSource> rated;
+    if (newSource) {
+        // A sink stuck at one rate (a WAV capture) gets songs converted to it
+        unsigned int loadRate = outputRate;
+        if (loadRate == 0 && sink) {
+            loadRate = sink->getRequiredRate();
+        }
+        newSource = ResampleSource::wrap(std::move(newSource), loadRate);
+        rated.reset(new RateSource(std::move(newSource), rate, rateMode));
+    }
+    bool ok = rated && sink;
+    if (ok) {
+        format = rated->getFormat();
+        block.resize(BLOCK_FRAMES * format.channels);
+        ok = sink->open(format);
+        equalizer.setBands(eqBands, format.sampleRate);
+        if (tap) {
+            tap->setSampleRate(format.sampleRate);
+        }
+    }
+
+    state = RenderState::IDLE;
+    published.positionFrames = 0;
+    published.segmentFrames = 0;
+    published.lengthFrames = ok ? rated->getLengthFrames() : 0;
+    published.finished = 0;
+    published.atStart = 1;
+    published.rate = static_cast<float>(rate);
+    publishStatus();
+    seenTrackChanges = published.trackChanges;
+
+    DecodeCommand command;
+    command.type = ok ? DecodeCommand::Type::LOAD : DecodeCommand::Type::UNLOAD;
+    command.source = ok ? rated.release() : nullptr;
+    command.epoch = loadEpoch;
+    command.gain = gain;
+    sendDecode(command);
+    loaded = ok;
+    return ok;
+}
+
+void PlaybackEngine::unload() {
+    playing = false;
+    sendRender(RenderCommand::Type::STOP);
+
+    DecodeCommand command;
+    command.type = DecodeCommand::Type::UNLOAD;
+    command.epoch = flush();
+    sendDecode(command);
+    loaded = false;
+}
+
+void PlaybackEngine::preloadFile(const std::string& path, float gain) {
+    DecodeCommand command;
+    command.type = DecodeCommand::Type::PRELOAD;
+    command.path = path;
+    command.nextGain = gain;
+    sendDecode(command);
+}
+
+void PlaybackEngine::cancelPreload() {
+    DecodeCommand command;
+    command.type = DecodeCommand::Type::CANCEL_PRELOAD;
+    sendDecode(command);
+}
+
+bool PlaybackEngine::takeTrackChange() {
+    uint32_t changes = status.read().trackChanges;
+    if (changes == seenTrackChanges) {
+        return false;
+    }
+    seenTrackChanges = changes;
+    return true;
+}
+
+void PlaybackEngine::setCrossfade(unsigned int milliseconds, FadeCurve curve) {
+    DecodeCommand command;
+    command.type = DecodeCommand::Type::CROSSFADE;
+    command.milliseconds = milliseconds;
+    command.curve = curve;
+    sendDecode(command);
+}
+
+void PlaybackEngine::setMilestone(unsigned int positionMs) {
+    if (!loaded || format.sampleRate == 0) {
+        return;
+    }
+    sendRender(RenderCommand::Type::MILESTONE, 0.0f, toOutputFrames(positionMs));
+}
+
+void PlaybackEngine::clearMilestone() {
+    sendRender(RenderCommand::Type::MILESTONE, 0.0f, NO_MILESTONE);
+}
+
+void PlaybackEngine::play() {
+    if (!loaded || !sink) {
+        return;
+    }
+    if (!status.read().atStart) {
+        DecodeCommand command;
+        command.type = DecodeCommand::Type::REWIND;
+        command.epoch = flush();
+        sendDecode(command);
+    }
+    playing = true;
+    sendRender(RenderCommand::Type::PLAY);
+}
+
+void PlaybackEngine::pause() {
+    playing = false;
+    sendRender(RenderCommand::Type::PAUSE);
+}
+
+void PlaybackEngine::resume() {
+    playing = true;
+    sendRender(RenderCommand::Type::RESUME);
+}
+
+void PlaybackEngine::stop() {
+    playing = false;
+    sendRender(RenderCommand::Type::STOP);
+    if (loaded) {
+        DecodeCommand command;
+        command.type = DecodeCommand::Type::REWIND;
+        command.epoch = flush();
+        sendDecode(command);
+    }
+}
+
+bool PlaybackEngine::seek(unsigned int positionMs) {
+    if (!loaded) {
+        return false;
+    }
+
+    DecodeCommand command;
+    command.type = DecodeCommand::Type::SEEK;
+    command.frame = toOutputFrames(positionMs);
+    command.epoch = flush();
+    return sendDecode(command);
+}
+
+void PlaybackEngine::setVolume(float newVolume) {
+    sendRender(RenderCommand::Type::VOLUME, newVolume);
+}
+
+void PlaybackEngine::setEqualizer(const std::vector<EqBand>& bands) {
+    eqBands = bands;
+    if (loaded) {
+        equalizer.setBands(eqBands, format.sampleRate);
+    }
+}
+
+void PlaybackEngine::setTrackGains(float current, float next) {
+    DecodeCommand command;
+    command.type = DecodeCommand::Type::GAIN;
+    command.gain = current;
+    command.nextGain = next;
+    sendDecode(command);
+}
+
+void PlaybackEngine::setRate(double newRate, RateMode mode) {
+    newRate = (std::max)(RateSource::MIN_RATE, (std::min)(RateSource::MAX_RATE, newRate));
+    if (newRate == rate && mode == rateMode) {
+        return;
+    }
+
+    // The ring holds audio at the old rate: drop it and continue from what is
+    // heard now, on the new timeline
+    unsigned int positionMs = loaded ? getPositionMs() : 0;
+    rate = newRate;
+    rateMode = mode;
+
+    DecodeCommand command;
+    command.type = DecodeCommand::Type::RATE;
+    command.rate = rate;
+    command.rateMode = mode;
+    if (loaded) {
+        clearMilestone();
+        command.frame = toOutputFrames(positionMs);
+        command.epoch = flush();
+    }
+    sendDecode(command);
+}
+
+unsigned int PlaybackEngine::getPositionMs() const {
+    if (format.sampleRate == 0) {
+        return 0;
+    }
+
+    // What the sink took minus what it still holds. Audio queued from before a
+    // seek or switch doesn't count against the new position
+    PlaybackStatus snapshot = status.read();
+    uint64_t queued = queuedFrames(snapshot);
+    uint64_t heard = snapshot.positionFrames > queued ? snapshot.positionFrames - queued : 0;
+    heard = (std::max)(heard, snapshot.segmentFrames);
+    return static_cast<unsigned int>(heard * 1000.0 * snapshot.rate / format.sampleRate);
+}
+
+unsigned int PlaybackEngine::getLengthMs() const {
+    if (format.sampleRate == 0) {
+        return 0;
+    }
+    PlaybackStatus snapshot = status.read();
+    return static_cast<unsigned int>(snapshot.lengthFrames * 1000.0 * snapshot.rate / format.sampleRate);
+}
+
+unsigned int PlaybackEngine::getLatencyMs() const {
+    if (format.sampleRate == 0) {
+        return 0;
+    }
+    return static_cast<unsigned int>(static_cast<uint64_t>(status.read().latencyFrames) * 1000 / format.sampleRate);
+}
+
+bool PlaybackEngine::hasFinished() const {
+    PlaybackStatus snapshot = status.read();
+    return snapshot.finished != 0 && queuedFrames(snapshot) == 0;
+}
+
+unsigned int PlaybackEngine::getDrainMs() const {
+    PlaybackStatus snapshot = status.read();
+    if (snapshot.finished == 0 || format.sampleRate == 0) {
+        return 0;
+    }
+    return static_cast<unsigned int>((queuedFrames(snapshot) * 1000 + format.sampleRate - 1) / format.sampleRate);
+}
+
+uint64_t PlaybackEngine::queuedFrames(const PlaybackStatus& snapshot) const {
+    // The device keeps playing at its own rate after the render thread measured it,
+    // which also covers the tail after the last write of a track or before a pause
+    uint64_t queued = snapshot.latencyFrames;
+    uint64_t now = steadyMicros(std::chrono::steady_clock::now());
+    if (queued > 0 && now > snapshot.writeMicros) {
+        uint64_t drained = (now - snapshot.writeMicros) * format.sampleRate / 1000000;
+        queued = drained >= queued ? 0 : queued - drained;
+    }
+    return queued;
+}
+
+uint64_t PlaybackEngine::toOutputFrames(unsigned int trackMs) const {
+    return static_cast<uint64_t>(static_cast<double>(trackMs) * format.sampleRate / 1000.0 / rate);
+}
+
+double PlaybackEngine::getDecodeSpeed() const {
+    uint64_t nanos = decodeNanos.load(std::memory_order_relaxed);
+    if (nanos == 0 || format.sampleRate == 0) {
+        return 0.0;
+    }
+    double seconds = static_cast<double>(framesDecoded.load(std::memory_order_relaxed)) / format.sampleRate;
+    return seconds / (nanos / 1e9);
+}
+
+double PlaybackEngine::getFirstAudioMs() const {
+    return status.read().firstAudioMicros / 1000.0;
+}
+
+double PlaybackEngine::getEqualizerCost() const {
+    return equalizer.getCostNanos();
+}
+
+size_t PlaybackEngine::getBufferBytes() const {
+    return bufferBytes.load(std::memory_order_relaxed);
+}
+
+unsigned int PlaybackEngine::getUnderruns() const {
+    return status.read().underruns;
+}
+
+double PlaybackEngine::getLastGapMs() const {
+    return status.read().lastGapMicros / 1000.0;
+}
+
+void PlaybackEngine::sendRender(RenderCommand::Type type, float value, uint64_t frame) {
+    if (!renderThread.joinable()) {
+        return;
+    }
+
+    RenderCommand command;
+    command.type = type;
+    command.volume = value;
+    command.frame = frame;
+    command.epoch = epoch;
+    // Only full if the render thread is stuck in the device, the UI can afford to wait
+    while (!renderCommands.push(command)) {
+        std::this_thread::yield();
+    }
+    renderWake.notify();
+    // The decode thread sleeps differently while paused
+    decodeWake.notify();
+}
+
+bool PlaybackEngine::sendDecode(DecodeCommand& command) {
+    if (!decodeThread.joinable()) {
+        delete command.source;
+        return false;
+    }
+
+    while (!decodeCommands.push(command)) {
+        std::this_thread::yield();
+    }
+    decodeWake.notify();
+    return true;
+}
+
+uint32_t PlaybackEngine::flush() {
+    epoch++;
+    sendRender(RenderCommand::Type::FLUSH);
+    return epoch;
+}
+
+void PlaybackEngine::haltRender() {
+    epoch++;
+    sendRender(RenderCommand::Type::HALT);
+    waitForAck(epoch);
+}
+
+void PlaybackEngine::waitForAck(uint32_t ackEpoch) const {
+    // At most one block: the render thread looks at its commands between sink writes
+    while (renderThread.joinable() && status.read().ackEpoch != ackEpoch) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+void PlaybackEngine::renderLoop() {
+    // Nothing in here locks or allocates, the only waits are the sink and
+    // parking on renderWake when there is nothing to play
+    while (true) {
+        RenderCommand command;
+        while (renderCommands.pop(command)) {
+            if (command.type == RenderCommand::Type::QUIT) {
+                return;
+            }
+            applyRenderCommand(command);
+        }
+
+        if (halted || (flushing && !takeStartMark()) || state != RenderState::RUNNING || !sink) {
+            renderWake.wait();
+            continue;
+        }
+
+        // Read the ring before the stop slot: a stop is always posted before the
+        // data behind it, so whatever we see in the ring, its stop is visible too
+        uint64_t readPosition = buffer.readPosition();
+        size_t ready = buffer.available();
+        int kind = stopKind.load(std::memory_order_acquire);
+
+        size_t wanted = BLOCK_FRAMES;
+        if (kind != STOP_NONE) {
+            uint64_t at = stopFrame.load(std::memory_order_acquire);
+            if (at == readPosition) {
+                reachStop(kind);
+                continue;
+            }
+            if (at > readPosition) {
+                wanted = static_cast<size_t>((std::min)(static_cast<uint64_t>(wanted), at - readPosition));
+            }
+        }
+
+        if (ready == 0) {
+            // Decoder fell behind the device (only counts once playback got going)
+            if (!awaitingFirstAudio) {
+                published.underruns++;
+                publishStatus();
+            }
+            // About to park anyway, so this is the one place we may poke the decoder
+            // rather than leave it to its timer (matters for unthrottled sinks)
+            decodeWake.notify();
+            renderWake.wait();
+            continue;
+        }
+
+        size_t frames = buffer.read(block.data(), wanted);
+        published.atStart = 0;
+
+        float gain = volume;
+        size_t samples = frames * format.channels;
+        for (size_t i = 0; i < samples; ++i) {
+            block[i] *= gain;
+        }
+        equalizer.process(block.data(), frames, format.channels);
+
+        auto writeStart = std::chrono::steady_clock::now();
+        if (awaitingFirstAudio) {
+            published.firstAudioMicros = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(writeStart - startRequest).count());
+            awaitingFirstAudio = false;
+        }
+        if (transitionPending) {
+            published.lastGapMicros = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(writeStart - transitionStart).count());
+            transitionPending = false;
+        }
+
+        bool written = sink->write(block.data(), frames);
+        lastWriteEnd = std::chrono::steady_clock::now();
+
+        uint32_t raised = 0;
+        if (!written) {
+            state = RenderState::IDLE;
+            published.finished = 1;
+            raised = AudioEvents::AUDIO_ERROR;
+        } else {
+            published.positionFrames += frames;
+            if (published.positionFrames >= milestoneFrame) {
+                milestoneFrame = NO_MILESTONE;
+                raised = AudioEvents::MILESTONE;
+            }
+        }
+        published.latencyFrames = sink->getLatencyFrames();
+        published.writeMicros = steadyMicros(lastWriteEnd);
+        if (tap && written) {
+            tap->setDelay(published.latencyFrames);
+            tap->write(block.data(), frames, format.channels);
+        }
+        publishStatus();
+        if (raised) {
+            raise(raised);
+        }
+    }
+}
+
+void PlaybackEngine::applyRenderCommand(const RenderCommand& command) {
+    switch (command.type) {
+    case RenderCommand::Type::PLAY:
+        state = RenderState::RUNNING;
+        published.finished = 0;
+        startRequest = std::chrono::steady_clock::now();
+        awaitingFirstAudio = true;
+        break;
+    case RenderCommand::Type::PAUSE:
+        if (state == RenderState::RUNNING) {
+            state = RenderState::PAUSED;
+        }
+        break;
+    case RenderCommand::Type::RESUME:
+        if (state == RenderState::PAUSED) {
+            state = RenderState::RUNNING;
+        }
+        break;
+    case RenderCommand::Type::STOP:
+        state = RenderState::IDLE;
+        published.finished = 0;
+        transitionPending = false;
+        break;
+    case RenderCommand::Type::VOLUME:
+        volume = command.volume;
+        break;
+    case RenderCommand::Type::MILESTONE:
+        milestoneFrame = command.frame;
+        break;
+    case RenderCommand::Type::FLUSH:
+        // Everything in the ring is stale until the decode thread says where the new audio starts
+        flushing = true;
+        flushEpoch = command.epoch;
+        published.ackEpoch = command.epoch;
+        startRequest = std::chrono::steady_clock::now();
+        awaitingFirstAudio = state == RenderState::RUNNING;
+        break;
+    case RenderCommand::Type::HALT:
+        halted = true;
+        published.ackEpoch = command.epoch;
+        break;
+    case RenderCommand::Type::RELEASE:
+        halted = false;
+        break;
+    case RenderCommand::Type::QUIT:
+        break;
+    }
+    publishStatus();
+}
+
+bool PlaybackEngine::takeStartMark() {
+    StartMark mark;
+    while (hasHeldMark || startMarks.pop(mark)) {
+        if (hasHeldMark) {
+            mark = heldMark;
+            hasHeldMark = false;
+        }
+        if (mark.epoch < flushEpoch) {
+            continue;
+        }
+        if (mark.epoch > flushEpoch) {
+            // Posted for a flush whose command we haven't picked up yet
+            heldMark = mark;
+            hasHeldMark = true;
+            return false;
+        }
+
+        // Anything read past the mark before the flush came in was already new audio
+        uint64_t readPosition = buffer.readPosition();
+        buffer.skipTo(mark.ringFrame);
+        published.positionFrames = mark.trackFrame + (readPosition > mark.ringFrame ? readPosition - mark.ringFrame : 0);
+        published.segmentFrames = mark.trackFrame;
+        published.lengthFrames = mark.lengthFrames;
+        published.rate = mark.rate;
+        published.atStart = published.positionFrames == 0 ? 1 : 0;
+        published.finished = 0;
+        flushing = false;
+        publishStatus();
+        return true;
+    }
+    return false;
+}
+
+void PlaybackEngine::reachStop(int kind) {
+    int expected = kind;
+    if (kind == STOP_BOUNDARY) {
+        if (!stopKind.compare_exchange_strong(expected, STOP_NONE)) {
+            return; // The decode thread took the switch back, look again
+        }
+        // Everything of the outgoing track went out, the next one starts on this frame
+        published.positionFrames = 0;
+        published.segmentFrames = 0;
+        published.lengthFrames = nextLength.load(std::memory_order_acquire);
+        published.trackChanges++;
+        transitionPending = true;
+        transitionStart = lastWriteEnd;
+        milestoneFrame = NO_MILESTONE;
+    } else if (kind == STOP_JUMP) {
+        // The switch was undone after it was buffered, skip what was decoded of the next track
+        buffer.skipTo(jumpTarget.load(std::memory_order_acquire));
+        stopKind.compare_exchange_strong(expected, STOP_NONE);
+    } else if (kind == STOP_END) {
+        if (!stopKind.compare_exchange_strong(expected, STOP_NONE)) {
+            return; // Turned into a boundary at the last moment
+        }
+        state = RenderState::IDLE;
+        published.finished = 1;
+        transitionPending = true;
+        transitionStart = lastWriteEnd;
+    }
+    publishStatus();
+    if (kind == STOP_BOUNDARY) {
+        raise(AudioEvents::TRACK_CHANGE);
+    } else if (kind == STOP_END) {
+        raise(AudioEvents::TRACK_END);
+    }
+}
+
+void PlaybackEngine::publishStatus() {
+    published.state = static_cast<uint32_t>(state);
+    status.publish(published);
+}
+
+void PlaybackEngine::raise(uint32_t event) {
+    // Only after publishStatus, so the woken UI already sees what it is told about
+    if (events) {
+        events->notify(event);
+    }
+}
+
+void PlaybackEngine::decodeLoop() {
+    while (true) {
+        DecodeCommand command;
+        while (decodeCommands.pop(command)) {
+            if (command.type == DecodeCommand::Type::QUIT) {
+                while (decodeCommands.pop(command)) {
+                    delete command.source;
+                }
+                return;
+            }
+            applyDecodeCommand(command);
+        }
+
+        // The render thread claims a boundary by clearing the stop slot
+        if (hasBoundary && stopKind.load(std::memory_order_acquire) == STOP_NONE) {
+            hasBoundary = false;
+            if (!fading) {
+                outgoingSource.reset();
+            }
+        }
+
+        // Open and prime the preloaded track. File access can take a while, the
+        // render thread keeps playing from the ring meanwhile
+        if (!preloadPath.empty() && !nextSource && !hasBoundary) {
+            std::unique_ptr<AudioBackend> opened = TrackCache::getInstance().openSource(preloadPath);
+            if (!opened) {
+                // Not something we decode, the player falls back to a normal load
+                preloadPath.clear();
+                continue;
+            }
+            // The device stays at the rate of the current track
+            opened = ResampleSource::wrap(std::move(opened), sourceFormat.sampleRate);
+            nextSource.reset(new RateSource(std::move(opened), decodeRate, decodeRateMode));
+            preroll.resize(CHUNK_FRAMES * nextSource->getFormat().channels);
+            prerollFrames = nextSource->decode(preroll.data(), CHUNK_FRAMES);
+            prerollOffset = 0;
+            continue;
+        }
+
+        if (!source) {
+            decodeWake.wait();
+            continue;
+        }
+
+        trySwitch();
+
+        // The end of the stream goes out once nothing else is waiting in the stop slot
+        if (sourceEnded && !endPublished && !hasBoundary && stopKind.load(std::memory_order_acquire) == STOP_NONE) {
+            stopFrame.store(buffer.writePosition(), std::memory_order_relaxed);
+            stopKind.store(STOP_END, std::memory_order_release);
+            endPublished = true;
+            renderWake.notify();
+        }
+
+        if (sourceEnded || buffer.space() < CHUNK_FRAMES) {
+            // First idle moment with a new source: index it now rather than on the first seek
+            if (!seekPrepared) {
+                seekPrepared = true;
+                source->prepareSeeking();
+                continue;
+            }
+            // The render thread frees space without telling anyone, so while it
+            // plays check back a few times per chunk; paused, only commands matter
+            if (playing) {
+                decodeWake.waitFor(std::chrono::milliseconds(CHUNK_FRAMES * 250 / sourceFormat.sampleRate + 1));
+            } else {
+                decodeWake.wait();
+            }
+            continue;
+        }
+
+        size_t frames = readIncoming(chunk.data(), CHUNK_FRAMES);
+
+        if (fading) {
+            // Overlap the head of the incoming track with the tail of the outgoing one
+            size_t overlap = static_cast<size_t>((std::min)(static_cast<uint64_t>(CHUNK_FRAMES), fadeLength - fadeDone));
+            size_t channels = sourceFormat.channels;
+            if (frames < overlap) {
+                std::fill(chunk.begin() + frames * channels, chunk.begin() + overlap * channels, 0.0f);
+                frames = overlap;
+            }
+            size_t tail = outgoingSource->decode(fadeChunk.data(), overlap);
+            applyGain(fadeChunk.data(), tail * channels, outgoingGain);
+            std::fill(fadeChunk.begin() + tail * channels, fadeChunk.begin() + overlap * channels, 0.0f);
+
+            Crossfade::computeGains(fadeCurve, fadeDone, fadeLength, overlap, gainIn.data(), gainOut.data());
+            Crossfade::mix(fadeChunk.data(), chunk.data(), gainOut.data(), gainIn.data(), chunk.data(), overlap, sourceFormat.channels);
+
+            fadeDone += overlap;
+            if (fadeDone >= fadeLength) {
+                endFade();
+            }
+        }
+
+        if (frames == 0) {
+            sourceEnded = true;
+        } else {
+            buffer.write(chunk.data(), frames);
+            renderWake.notify();
+        }
+    }
+}
+
+void PlaybackEngine::applyDecodeCommand(DecodeCommand& command) {
+    switch (command.type) {
+    case DecodeCommand::Type::LOAD:
+    case DecodeCommand::Type::UNLOAD:
+        // The render thread is halted for a load, so the ring can be rebuilt
+        stopKind.store(STOP_NONE, std::memory_order_release);
+        hasBoundary = false;
+        endPublished = false;
+        sourceEnded = false;
+        fading = false;
+        outgoingSource.reset();
+        nextSource.reset();
+        preloadPath.clear();
+        prerollFrames = 0;
+        prerollOffset = 0;
+        prerollPending = false;
+        source.reset(command.source);
+        command.source = nullptr;
+        sourceGain = command.gain;
+        seekPrepared = false;
+
+        if (source) {
+            sourceFormat = source->getFormat();
+            buffer.reset(CHUNK_FRAMES * BUFFER_CHUNKS, sourceFormat.channels);
+            bufferBytes.store(buffer.memoryBytes(), std::memory_order_relaxed);
+            chunk.resize(CHUNK_FRAMES * sourceFormat.channels);
+            fadeChunk.resize(CHUNK_FRAMES * sourceFormat.channels);
+            gainIn.resize(CHUNK_FRAMES);
+            gainOut.resize(CHUNK_FRAMES);
+        }
+        postStart(command.epoch);
+        break;
+
+    case DecodeCommand::Type::SEEK:
+    case DecodeCommand::Type::REWIND:
+        if (source) {
+            resolveSwitch(false);
+            endFade();
+            source->seek(command.type == DecodeCommand::Type::SEEK ? command.frame : 0);
+            stopKind.store(STOP_NONE, std::memory_order_release);
+            sourceEnded = false;
+            endPublished = false;
+        }
+        postStart(command.epoch);
+        break;
+
+    case DecodeCommand::Type::PRELOAD:
+        if (command.path == preloadPath) {
+            nextGain = command.nextGain;
+            break;
+        }
+        resolveSwitch(true);
+        preloadPath = command.path;
+        nextGain = command.nextGain;
+        nextSource.reset();
+        prerollFrames = 0;
+        break;
+
+    case DecodeCommand::Type::CANCEL_PRELOAD:
+        resolveSwitch(true);
+        preloadPath.clear();
+        nextSource.reset();
+        prerollFrames = 0;
+        break;
+
+    case DecodeCommand::Type::CROSSFADE:
+        crossfadeMs = command.milliseconds;
+        fadeCurve = command.curve;
+        break;
+
+    case DecodeCommand::Type::GAIN:
+        // Past a boundary the decoder already reads the next track while the
+        // listener still hears the outgoing one
+        if (hasBoundary) {
+            outgoingGain = command.gain;
+            sourceGain = command.nextGain;
+        } else {
+            sourceGain = command.gain;
+            nextGain = command.nextGain;
+        }
+        break;
+
+    case DecodeCommand::Type::RATE:
+        decodeRate = command.rate;
+        decodeRateMode = command.rateMode;
+        if (source) {
+            resolveSwitch(false);
+            endFade();
+            source->setRate(decodeRate, decodeRateMode);
+            source->seek(command.frame);
+            stopKind.store(STOP_NONE, std::memory_order_release);
+            sourceEnded = false;
+            endPublished = false;
+        }
+        if (nextSource) {
+            // Its primed chunk was made at the old rate
+            nextSource->setRate(decodeRate, decodeRateMode);
+            nextSource->seek(0);
+            prerollFrames = 0;
+            prerollOffset = 0;
+        }
+        if (command.epoch != 0) {
+            postStart(command.epoch);
+        }
+        break;
+
+    case DecodeCommand::Type::QUIT:
+        break;
+    }
+}
+
+void PlaybackEngine::postStart(uint32_t markEpoch) {
+    StartMark mark;
+    mark.epoch = markEpoch;
+    mark.ringFrame = buffer.writePosition();
+    mark.trackFrame = source ? source->getPositionFrames() : 0;
+    mark.lengthFrames = source ? source->getLengthFrames() : 0;
+    mark.rate = static_cast<float>(source ? source->getRate() : decodeRate);
+    while (!startMarks.push(mark)) {
+        std::this_thread::yield();
+    }
+    renderWake.notify();
+}
+
+void PlaybackEngine::resolveSwitch(bool keepRing) {
+    if (!hasBoundary) {
+        return;
+    }
+
+    // Take the boundary back before the render thread reaches it. When the ring is
+    // kept, the render thread has to skip what was already decoded of the next track
+    int expected = STOP_BOUNDARY;
+    if (keepRing) {
+        jumpTarget.store(buffer.writePosition(), std::memory_order_relaxed);
+    }
+    if (stopKind.compare_exchange_strong(expected, keepRing ? STOP_JUMP : STOP_NONE)) {
+        restoreOutgoing();
+    } else {
+        // Too late, the next track is already playing
+        hasBoundary = false;
+        if (!fading) {
+            outgoingSource.reset();
+        }
+    }
+}
+
+void PlaybackEngine::restoreOutgoing() {
+    // The decoder already moved on to the preloaded track but the listener hasn't
+    // reached it: hand it back and restore the old one
+    nextSource = std::move(source);
+    nextSource->seek(0);
+    nextGain = sourceGain;
+    sourceGain = outgoingGain;
+    prerollFrames = 0;
+    prerollOffset = 0;
+    prerollPending = false;
+    source = std::move(outgoingSource);
+    source->seek(switchFrame);
+    seekPrepared = false;
+    sourceEnded = false;
+    endPublished = false;
+    hasBoundary = false;
+    fading = false;
+}
+
+void PlaybackEngine::endFade() {
+    fading = false;
+    if (!hasBoundary) {
+        outgoingSource.reset();
+    }
+}
+
+void PlaybackEngine::trySwitch() {
+    // Move on to the preloaded track if it fits the open device: at the end of
+    // the current one, or a crossfade length before it
+    if (!nextSource || hasBoundary || fading || nextSource->getFormat() != sourceFormat) {
+        return;
+    }
+
+    uint64_t length = source->getLengthFrames();
+    uint64_t remaining = length - (std::min)(source->getPositionFrames(), length);
+    uint64_t fadeFrames = static_cast<uint64_t>(crossfadeMs) * sourceFormat.sampleRate / 1000;
+    if (!sourceEnded && (fadeFrames == 0 || remaining > fadeFrames)) {
+        return;
+    }
+
+    // The boundary replaces a posted end of stream, or goes into a free stop slot
+    nextLength.store(nextSource->getLengthFrames(), std::memory_order_relaxed);
+    if (endPublished) {
+        int expected = STOP_END;
+        if (!stopKind.compare_exchange_strong(expected, STOP_BOUNDARY)) {
+            return; // The end was already played, the player loads the next track itself
+        }
+        endPublished = false;
+    } else {
+        if (stopKind.load(std::memory_order_acquire) != STOP_NONE) {
+            return;
+        }
+        stopFrame.store(buffer.writePosition(), std::memory_order_relaxed);
+        stopKind.store(STOP_BOUNDARY, std::memory_order_release);
+    }
+
+    switchFrame = source->getPositionFrames();
+    hasBoundary = true;
+    fading = !sourceEnded && remaining > 0;
+    fadeLength = remaining;
+    fadeDone = 0;
+    outgoingSource = std::move(source);
+    source = std::move(nextSource);
+    outgoingGain = sourceGain;
+    sourceGain = nextGain;
+    seekPrepared = false;
+    prerollPending = prerollOffset < prerollFrames;
+    preloadPath.clear();
+    sourceEnded = false;
+}
+
+size_t PlaybackEngine::readIncoming(float* frames, size_t frameCount) {
+    // Right after a switch the primed chunk of the preloaded track goes out first
+    size_t produced = 0;
+    if (prerollPending) {
+        produced = (std::min)(frameCount, prerollFrames - prerollOffset);
+        std::memcpy(frames, preroll.data() + prerollOffset * sourceFormat.channels, produced * sourceFormat.channels * sizeof(float));
+        prerollOffset += produced;
+        prerollPending = prerollOffset < prerollFrames;
+    }
+
+    if (produced < frameCount) {
+        auto decodeStart = std::chrono::steady_clock::now();
+        size_t decoded = source->decode(frames + produced * sourceFormat.channels, frameCount - produced);
+        auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - decodeStart);
+        decodeNanos.fetch_add(static_cast<uint64_t>(elapsed.count()), std::memory_order_relaxed);
+        framesDecoded.fetch_add(decoded, std::memory_order_relaxed);
+        produced += decoded;
+    }
+
+    // The primed chunk is stored as decoded, so a gain change before the switch still applies
+    applyGain(frames, produced * sourceFormat.channels, sourceGain);
+    return produced;
+}
\ No newline at end of file
@@ -0,0 +1,381 @@
+#include "../headers/playlistExport.hpp"
+#include "../headers/resampleSource.hpp"
+#include "../headers/audioSink.hpp"
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <filesystem>
+
+namespace {
+    std::unique_ptr<AudioBackend> openChain(const std::string& path, unsigned int sampleRate, double rate, RateMode mode) {
+        std::unique_ptr<AudioBackend> decoder = AudioBackend::openFile(path);
+        if (!decoder || decoder->getFormat().channels == 0) {
+            return nullptr;
+        }
+        decoder = ResampleSource::wrap(std::move(decoder), sampleRate);
+        return std::unique_ptr<AudioBackend>(new RateSource(std::move(decoder), rate, mode));
+    }
+
+    // Mono goes to every channel, more channels than there are repeat the
+    // ones there are, a mono output gets the average
+    void remapChannels(const float* in, unsigned int inChannels, float* out, unsigned int outChannels, size_t frames) {
+        if (inChannels == outChannels) {
+            std::copy(in, in + frames * inChannels, out);
+            return;
+        }
+        float scale = 1.0f / static_cast<float>(inChannels);
+        for (size_t i = 0; i < frames; ++i) {
+            const float* frame = in + i * inChannels;
+            if (outChannels == 1) {
+                float sum = 0.0f;
+                for (unsigned int c = 0; c < inChannels; ++c) {
+                    sum += frame[c];
+                }
+                out[i] = sum * scale;
+            } else {
+                for (unsigned int c = 0; c < outChannels; ++c) {
+                    out[i * outChannels + c] = frame[c % inChannels];
+                }
+            }
+        }
+    }
+}
+
+PlaylistExporter::PlaylistExporter(const std::vector<Track>& exportTracks, const Settings& exportSettings)
+    : tracks(exportTracks), settings(exportSettings), nextJob(0), mixing(0), bufferedBytes(0), stopping(false),
+      writeFailed(false), writerDone(false) {}
+
+PlaylistExporter::~PlaylistExporter() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    chunksChanged.notify_all();
+    for (auto& worker : workers) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+}
+
+bool PlaylistExporter::run(const std::string& path, Report& report, const std::function<void(size_t)>& onTrack) {
+    auto started = std::chrono::steady_clock::now();
+    report = Report();
+
+    // Everything is converted to the set rate, or to the highest rate and
+    // the most channels (at least stereo) among the songs. A song that
+    // doesn't open stops the export before there is a file
+    format = AudioFormat(0, 2);
+    for (size_t i = 0; i < tracks.size(); ++i) {
+        std::unique_ptr<AudioBackend> decoder = AudioBackend::openFile(tracks[i].path);
+        if (decoder && decoder->getFormat().channels > 0) {
+            format.sampleRate = (std::max)(format.sampleRate, decoder->getFormat().sampleRate);
+            format.channels = (std::max)(format.channels, decoder->getFormat().channels);
+        } else {
+            report.undecodable.push_back(i);
+        }
+    }
+    format.channels = (std::min)(format.channels, static_cast<unsigned int>(Equalizer::MAX_CHANNELS));
+    if (settings.sampleRate > 0) {
+        format.sampleRate = settings.sampleRate;
+    }
+    if (!report.undecodable.empty() || format.sampleRate == 0) {
+        return false;
+    }
+    report.format = format;
+    unsigned int channels = format.channels;
+
+    jobs.assign(tracks.size(), Job());
+    nextJob = 0;
+    mixing = 0;
+    bufferedBytes = 0;
+    stopping = false;
+    unsigned int cores = std::thread::hardware_concurrency();
+    unsigned int workerCount = (std::max)(1u, (std::min)(MAX_WORKERS, cores > 1 ? cores - 1 : 1u));
+    workerCount = (std::min)(workerCount, static_cast<unsigned int>(tracks.size()));
+    report.workers = workerCount;
+    for (unsigned int i = 0; i < workerCount; ++i) {
+        workers.emplace_back(&PlaylistExporter::workerLoop, this);
+    }
+
+    // Whole multiples of the alignment in every write, whatever the channel count
+    size_t alignFrames = WRITE_ALIGNMENT / sizeof(float);
+    size_t bufferFrames = (std::max)(alignFrames, WRITE_BYTES / (channels * sizeof(float)) / alignFrames * alignFrames);
+    fullBuffers.clear();
+    freeBuffers.clear();
+    for (size_t i = 0; i < WRITE_BUFFERS; ++i) {
+        freeBuffers.emplace_back();
+        freeBuffers.back().reserve(bufferFrames * channels);
+    }
+    writeFailed = false;
+    writerDone = false;
+    std::thread writer(&PlaylistExporter::writerLoop, this, path, std::ref(report.bytes));
+
+    Equalizer equalizer;
+    equalizer.setBands(settings.eqBands, format.sampleRate);
+    std::vector<float> out;
+    bool outReady = false;
+
+    // Hands full buffers to the writer, false once writing failed
+    auto handOver = [&]() {
+        std::unique_lock<std::mutex> lock(writeMutex);
+        fullBuffers.push_back(std::move(out));
+        writeChanged.notify_all();
+        writeChanged.wait(lock, [this] { return !freeBuffers.empty() || writeFailed; });
+        if (writeFailed) {
+            return false;
+        }
+        out = std::move(freeBuffers.front());
+        freeBuffers.pop_front();
+        return true;
+    };
+    {
+        std::lock_guard<std::mutex> lock(writeMutex);
+        out = std::move(freeBuffers.front());
+        freeBuffers.pop_front();
+        outReady = true;
+    }
+
+    auto emit = [&](float* samples, size_t frames) {
+        equalizer.process(samples, frames, channels);
+        size_t done = 0;
+        while (done < frames && outReady) {
+            size_t count = (std::min)(frames - done, bufferFrames - out.size() / channels);
+            out.insert(out.end(), samples + done * channels, samples + (done + count) * channels);
+            done += count;
+            report.frames += count;
+            if (out.size() == bufferFrames * channels) {
+                outReady = handOver();
+            }
+        }
+    };
+
+    // The tail of the last song, faded out over the head of the next one
+    uint64_t fadeFrames = static_cast<uint64_t>(settings.crossfadeMs) * format.sampleRate / 1000;
+    std::vector<float> carry;
+    size_t carryFrames = 0;
+    size_t carryDone = 0;
+    std::vector<float> gainIn(CHUNK_FRAMES);
+    std::vector<float> gainOut(CHUNK_FRAMES);
+    std::vector<float> pending;         // Of the song being mixed, not written yet
+    size_t mixed = 0;                   // Frames at the start of 'pending' the fade went over
+    std::vector<float> chunk;
+
+    auto fade = [&](size_t frames) {
+        for (size_t done = 0; done < frames; ) {
+            size_t count = (std::min)(frames - done, CHUNK_FRAMES);
+            float* incoming = pending.data() + mixed * channels;
+            Crossfade::computeGains(settings.curve, carryDone, carryFrames, count, gainIn.data(), gainOut.data());
+            Crossfade::mix(carry.data() + carryDone * channels, incoming, gainOut.data(), gainIn.data(), incoming, count, channels);
+            carryDone += count;
+            mixed += count;
+            done += count;
+        }
+    };
+
+    for (size_t i = 0; i < tracks.size() && outReady; ++i) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            mixing = i;
+        }
+        chunksChanged.notify_all();
+
+        bool started = false;
+        pending.clear();
+        mixed = 0;
+        while (outReady && takeChunk(i, chunk)) {
+            if (!started) {
+                started = true;
+                report.tracks++;
+                if (onTrack) {
+                    onTrack(i);
+                }
+            }
+            pending.insert(pending.end(), chunk.begin(), chunk.end());
+            size_t pendingFrames = pending.size() / channels;
+            if (carryDone < carryFrames) {
+                fade((std::min)(carryFrames - carryDone, pendingFrames - mixed));
+            }
+
+            // The last fadeFrames are held back, they may be the next fade
+            size_t limit = carryDone < carryFrames ? mixed : pendingFrames;
+            size_t ready = pendingFrames > fadeFrames ? (std::min)(limit, static_cast<size_t>(pendingFrames - fadeFrames)) : 0;
+            if (ready > 0) {
+                emit(pending.data(), ready);
+                pending.erase(pending.begin(), pending.begin() + ready * channels);
+                mixed = mixed > ready ? mixed - ready : 0;
+            }
+        }
+        if (!started) {
+            bool failed = false;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                failed = jobs[i].failed;
+            }
+            if (failed) {
+                // Opened for the format but not by its worker, the file would be short of it
+                report.undecodable.push_back(i);
+                break;
+            }
+            continue; // A fade still going carries over to the next song
+        }
+
+        // Shorter than the fade, which runs out over silence
+        if (carryDone < carryFrames) {
+            pending.resize(pending.size() + (carryFrames - carryDone) * channels, 0.0f);
+            fade(carryFrames - carryDone);
+        }
+        size_t pendingFrames = pending.size() / channels;
+        size_t tail = static_cast<size_t>((std::min)(fadeFrames, static_cast<uint64_t>(pendingFrames)));
+        emit(pending.data(), pendingFrames - tail);
+        carry.assign(pending.end() - tail * channels, pending.end());
+        carryFrames = tail;
+        carryDone = 0;
+    }
+
+    // The last song ends as it is
+    bool complete = report.undecodable.empty();
+    if (carryDone < carryFrames && outReady && complete) {
+        emit(carry.data() + carryDone * channels, carryFrames - carryDone);
+    }
+    if (!out.empty() && outReady && complete) {
+        std::lock_guard<std::mutex> lock(writeMutex);
+        fullBuffers.push_back(std::move(out));
+    }
+    {
+        std::lock_guard<std::mutex> lock(writeMutex);
+        writerDone = true;
+    }
+    writeChanged.notify_all();
+    writer.join();
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    chunksChanged.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    workers.clear();
+
+    report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    if (!complete) {
+        std::error_code error;
+        std::filesystem::remove(path, error);
+        return false;
+    }
+    return !writeFailed;
+}
+
+void PlaylistExporter::workerLoop() {
+    while (true) {
+        size_t index = 0;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (stopping || nextJob >= jobs.size()) {
+                return;
+            }
+            index = nextJob++;
+        }
+        decodeTrack(index);
+    }
+}
+
+void PlaylistExporter::decodeTrack(size_t index) {
+    std::unique_ptr<AudioBackend> source = openChain(tracks[index].path, format.sampleRate, settings.rate, settings.rateMode);
+    if (source) {
+        unsigned int sourceChannels = source->getFormat().channels;
+        float gain = tracks[index].gain;
+        std::vector<float> decoded(CHUNK_FRAMES * sourceChannels);
+        size_t frames = 0;
+        while ((frames = source->decode(decoded.data(), CHUNK_FRAMES)) > 0) {
+            std::vector<float> chunk(frames * format.channels);
+            remapChannels(decoded.data(), sourceChannels, chunk.data(), format.channels, frames);
+            if (gain != 1.0f) {
+                for (float& sample : chunk) {
+                    sample *= gain;
+                }
+            }
+
+            size_t bytes = chunk.size() * sizeof(float);
+            std::unique_lock<std::mutex> lock(mutex);
+            Job& job = jobs[index];
+            chunksChanged.wait(lock, [&] {
+                if (stopping) {
+                    return true;
+                }
+                // The song being mixed and the next only run a few chunks ahead
+                // and never wait for songs further on
+                if (index <= mixing + 1) {
+                    return job.chunks.size() < NEAR_CHUNKS;
+                }
+                return bufferedBytes + bytes <= MEMORY_BUDGET_MB << 20;
+            });
+            if (stopping) {
+                return;
+            }
+            job.chunks.push_back(std::move(chunk));
+            bufferedBytes += bytes;
+            lock.unlock();
+            chunksChanged.notify_all();
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        jobs[index].failed = !source;
+        jobs[index].done = true;
+    }
+    chunksChanged.notify_all();
+}
+
+bool PlaylistExporter::takeChunk(size_t index, std::vector<float>& chunk) {
+    std::unique_lock<std::mutex> lock(mutex);
+    Job& job = jobs[index];
+    chunksChanged.wait(lock, [&job] { return !job.chunks.empty() || job.done; });
+    if (job.chunks.empty()) {
+        return false;
+    }
+    chunk = std::move(job.chunks.front());
+    job.chunks.pop_front();
+    bufferedBytes -= chunk.size() * sizeof(float);
+    lock.unlock();
+    chunksChanged.notify_all(); // Room for the workers
+    return true;
+}
+
+void PlaylistExporter::writerLoop(const std::string& path, uint64_t& bytes) {
+    WavFileSink sink(path, WRITE_ALIGNMENT);
+    bool ok = sink.open(format);
+    while (true) {
+        std::vector<float> buffer;
+        {
+            std::unique_lock<std::mutex> lock(writeMutex);
+            if (!ok) {
+                // The mixer stops at its next buffer
+                writeFailed = true;
+                writeChanged.notify_all();
+                break;
+            }
+            writeChanged.wait(lock, [this] { return !fullBuffers.empty() || writerDone; });
+            if (fullBuffers.empty()) {
+                break;
+            }
+            buffer = std::move(fullBuffers.front());
+            fullBuffers.pop_front();
+        }
+
+        ok = sink.write(buffer.data(), buffer.size() / format.channels);
+        if (ok) {
+            bytes += buffer.size() * sizeof(float);
+        }
+        buffer.clear();
+        {
+            std::lock_guard<std::mutex> lock(writeMutex);
+            freeBuffers.push_back(std::move(buffer));
+        }
+        writeChanged.notify_all();
+    }
+    sink.finish();
+}
\ No newline at end of file
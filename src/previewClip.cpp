@@ -0,0 +1,146 @@
+#include "../headers/previewClip.hpp"
+#include "../headers/osuBeatmap.hpp"
+#include "../headers/trackCache.hpp"
+#include <algorithm>
+#include <cstring>
+
+PreviewClip::PreviewClip(unsigned int clipMs, bool exact)
+    : lengthMs(clipMs), exactStart(exact), startMs(0), fromBeatmap(false), startFrame(0), lengthFrames(0), positionFrames(0),
+      fadeInFrames(0), fadeOutFrames(0), primedFrames(0) {}
+
+unsigned int PreviewClip::findStartMs(const std::string& path, unsigned int songLengthMs, unsigned int lengthMs,
+                                      bool& fromBeatmap) {
+    OsuBeatmap beatmap;
+    fromBeatmap = OsuBeatmap::findFor(path, beatmap) && beatmap.previewTimeMs >= 0;
+    unsigned int start = fromBeatmap ? static_cast<unsigned int>(beatmap.previewTimeMs)
+                                     : static_cast<unsigned int>(songLengthMs * FALLBACK_POSITION);
+    if (start + lengthMs > songLengthMs) {
+        start = songLengthMs > lengthMs ? songLengthMs - lengthMs : 0;
+    }
+    return start;
+}
+
+bool PreviewClip::open(const std::string& path) {
+    close();
+
+    // A song the cache holds plays from memory, anything else from the file
+    std::shared_ptr<DecodedTrack> cached = std::dynamic_pointer_cast<DecodedTrack>(TrackCache::getInstance().find(path));
+    if (cached) {
+        source.reset(new MemorySource(cached));
+    } else {
+        source = AudioBackend::openFile(path);
+    }
+    if (!source || source->getFormat().sampleRate == 0) {
+        source.reset();
+        return false;
+    }
+
+    format = source->getFormat();
+    uint64_t songFrames = source->getLengthFrames();
+    unsigned int songLengthMs = static_cast<unsigned int>(songFrames * 1000 / format.sampleRate);
+    startMs = findStartMs(path, songLengthMs, lengthMs, fromBeatmap);
+    startFrame = (std::min)(songFrames, static_cast<uint64_t>(startMs) * format.sampleRate / 1000);
+    if (startFrame > 0 && !(exactStart ? source->seek(startFrame) : source->seekNear(startFrame))) {
+        close();
+        return false;
+    }
+
+    lengthFrames = (std::min)(static_cast<uint64_t>(lengthMs) * format.sampleRate / 1000, songFrames - startFrame);
+    fadeInFrames = (std::min)(static_cast<uint64_t>(FADE_IN_MS) * format.sampleRate / 1000, lengthFrames / 2);
+    fadeOutFrames = (std::min)(static_cast<uint64_t>(FADE_OUT_MS) * format.sampleRate / 1000, lengthFrames / 2);
+
+    primed.resize(PRIME_FRAMES * format.channels);
+    size_t wanted = static_cast<size_t>((std::min)(static_cast<uint64_t>(PRIME_FRAMES), lengthFrames));
+    while (primedFrames < wanted) {
+        size_t got = source->decode(primed.data() + primedFrames * format.channels, wanted - primedFrames);
+        if (got == 0) {
+            break;
+        }
+        primedFrames += got;
+    }
+    return true;
+}
+
+size_t PreviewClip::decode(float* buffer, size_t frameCount) {
+    if (!source || positionFrames >= lengthFrames) {
+        return 0;
+    }
+    frameCount = static_cast<size_t>((std::min)(static_cast<uint64_t>(frameCount), lengthFrames - positionFrames));
+    unsigned int channels = format.channels;
+
+    size_t written = 0;
+    if (positionFrames < primedFrames) {
+        written = (std::min)(frameCount, static_cast<size_t>(primedFrames - positionFrames));
+        std::memcpy(buffer, primed.data() + positionFrames * channels, written * channels * sizeof(float));
+    }
+    while (written < frameCount) {
+        size_t got = source->decode(buffer + written * channels, frameCount - written);
+        if (got == 0) {
+            break;
+        }
+        written += got;
+    }
+
+    // Linear ramps at both ends, so the clip neither clicks in nor cuts off
+    for (size_t i = 0; i < written; ++i) {
+        uint64_t frame = positionFrames + i;
+        float gain = 1.0f;
+        if (frame < fadeInFrames) {
+            gain = static_cast<float>(frame) / fadeInFrames;
+        }
+        if (frame + fadeOutFrames > lengthFrames) {
+            gain = (std::min)(gain, static_cast<float>(lengthFrames - frame) / fadeOutFrames);
+        }
+        if (gain < 1.0f) {
+            for (unsigned int c = 0; c < channels; ++c) {
+                buffer[i * channels + c] *= gain;
+            }
+        }
+    }
+    positionFrames += written;
+    return written;
+}
+
+bool PreviewClip::seek(uint64_t frame) {
+    if (!source) {
+        return false;
+    }
+    frame = (std::min)(frame, lengthFrames);
+
+    // The primed frames stay in memory, the source picks up after them
+    uint64_t resume = (std::max)(frame, static_cast<uint64_t>(primedFrames));
+    if (!source->seekNear(startFrame + resume)) {
+        return false;
+    }
+    positionFrames = frame;
+    return true;
+}
+
+void PreviewClip::close() {
+    source.reset();
+    primed.clear();
+    primedFrames = 0;
+    startFrame = 0;
+    lengthFrames = 0;
+    positionFrames = 0;
+}
+
+AudioFormat PreviewClip::getFormat() const {
+    return format;
+}
+
+uint64_t PreviewClip::getLengthFrames() const {
+    return lengthFrames;
+}
+
+uint64_t PreviewClip::getPositionFrames() const {
+    return positionFrames;
+}
+
+unsigned int PreviewClip::getStartMs() const {
+    return startMs;
+}
+
+bool PreviewClip::isFromBeatmap() const {
+    return fromBeatmap;
+}
\ No newline at end of file
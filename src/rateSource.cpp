@@ -0,0 +1,397 @@
+#include "../headers/rateSource.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#include <emmintrin.h>
+#define RATESOURCE_SSE2
+#endif
+
+namespace {
+    const double HALF_PI = 1.57079632679489661923;
+    const size_t COARSE_STEP = 4;   // The search tries every 4th offset, then the ones around the best
+
+    float dot(const float* a, const float* b, size_t count) {
+        size_t i = 0;
+        float sum = 0.0f;
+#ifdef RATESOURCE_SSE2
+        __m128 acc0 = _mm_setzero_ps();
+        __m128 acc1 = _mm_setzero_ps();
+        for (; i + 8 <= count; i += 8) {
+            acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+            acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+        }
+        acc0 = _mm_add_ps(acc0, acc1);
+        acc0 = _mm_add_ps(acc0, _mm_movehl_ps(acc0, acc0));
+        acc0 = _mm_add_ss(acc0, _mm_shuffle_ps(acc0, acc0, 1));
+        sum = _mm_cvtss_f32(acc0);
+#endif
+        for (; i < count; ++i) {
+            sum += a[i] * b[i];
+        }
+        return sum;
+    }
+
+    // Catmull-Rom weights of frames i-1, i, i+1, i+2 for a read position f past frame i
+    inline void hermite(float f, float* c) {
+        float f2 = f * f;
+        c[0] = ((-0.5f * f + 1.0f) * f - 0.5f) * f;
+        c[1] = (1.5f * f - 2.5f) * f2 + 1.0f;
+        c[2] = ((-1.5f * f + 2.0f) * f + 0.5f) * f;
+        c[3] = (0.5f * f - 0.5f) * f2;
+    }
+}
+
+RateSource::RateSource(std::unique_ptr<AudioBackend> wrapped, double newRate, RateMode newMode)
+    : source(std::move(wrapped)), rate(1.0), mode(newMode), positionFrames(0), inputFrames(0), inputStart(0), sourceEnded(false),
+      endFrame(0), readPosition(0.0), nominalPosition(0.0), previousSegment(0), pendingOffset(0), pendingFrames(0) {
+    format = source->getFormat();
+    setRate(newRate, newMode);
+
+    segmentFrames = (std::max)(static_cast<size_t>(format.sampleRate) * SEGMENT_MS / 1000, static_cast<size_t>(16));
+    searchFrames = static_cast<size_t>(format.sampleRate) * SEARCH_MS / 1000;
+
+    // sin^2 rises as cos^2 falls, so the two halves of a cross-fade always sum to one
+    fadeIn.resize(segmentFrames * format.channels);
+    for (size_t k = 0; k < segmentFrames; ++k) {
+        double s = std::sin(HALF_PI * (k + 0.5) / segmentFrames);
+        for (unsigned int c = 0; c < format.channels; ++c) {
+            fadeIn[k * format.channels + c] = static_cast<float>(s * s);
+        }
+    }
+    pending.resize(segmentFrames * format.channels);
+    energy.reserve(2 * searchFrames + segmentFrames + 2);
+    weights.reserve(READ_FRAMES * 4);
+
+    uint64_t start = source->getPositionFrames();
+    reset(static_cast<int64_t>(start));
+    positionFrames = static_cast<uint64_t>(std::llround(start / rate));
+}
+
+void RateSource::setRate(double newRate, RateMode newMode) {
+    rate = (std::max)(MIN_RATE, (std::min)(MAX_RATE, newRate));
+    mode = newMode;
+}
+
+double RateSource::getRate() const {
+    return rate;
+}
+
+RateMode RateSource::getMode() const {
+    return mode;
+}
+
+bool RateSource::open(const std::string& path) {
+    return source->open(path);
+}
+
+size_t RateSource::decode(float* buffer, size_t frameCount) {
+    size_t frames = 0;
+    if (rate == 1.0) {
+        frames = source->decode(buffer, frameCount);
+    } else if (mode == RateMode::VARISPEED) {
+        frames = decodeVarispeed(buffer, frameCount);
+    } else {
+        frames = decodeStretch(buffer, frameCount);
+    }
+    positionFrames += frames;
+    return frames;
+}
+
+bool RateSource::seek(uint64_t frame) {
+    uint64_t target = rate == 1.0 ? frame : static_cast<uint64_t>(std::llround(frame * rate));
+    bool ok = source->seek(target);
+
+    // Decoders clamp seeks past their end, the timeline follows where they landed
+    uint64_t landed = source->getPositionFrames();
+    reset(static_cast<int64_t>(landed));
+    positionFrames = rate == 1.0 ? landed : static_cast<uint64_t>(std::llround(landed / rate));
+    return ok;
+}
+
+void RateSource::close() {
+    source->close();
+}
+
+void RateSource::prepareSeeking() {
+    source->prepareSeeking();
+}
+
+AudioFormat RateSource::getFormat() const {
+    return format;
+}
+
+uint64_t RateSource::getLengthFrames() const {
+    uint64_t length = source->getLengthFrames();
+    return rate == 1.0 ? length : static_cast<uint64_t>(std::ceil(length / rate));
+}
+
+uint64_t RateSource::getPositionFrames() const {
+    return positionFrames;
+}
+
+std::string RateSource::modeName(RateMode mode) {
+    return mode == RateMode::VARISPEED ? "varispeed" : "stretch";
+}
+
+void RateSource::reset(int64_t sourceFrame) {
+    sourceEnded = false;
+    endFrame = 0;
+    pendingOffset = 0;
+    pendingFrames = 0;
+
+    if (mode == RateMode::VARISPEED) {
+        // One frame of silence in front, the interpolator reads a frame behind its position
+        inputStart = sourceFrame - 1;
+        inputFrames = 1;
+        if (input.size() < format.channels) {
+            input.resize(format.channels);
+            mono.resize(1);
+        }
+        std::fill(input.begin(), input.begin() + format.channels, 0.0f);
+        mono[0] = 0.0f;
+        readPosition = static_cast<double>(sourceFrame);
+    } else {
+        // The first step continues from a virtual segment ending right here, so it
+        // lines up with the source itself and starts on the exact frame
+        inputStart = sourceFrame;
+        inputFrames = 0;
+        nominalPosition = static_cast<double>(sourceFrame);
+        previousSegment = sourceFrame - static_cast<int64_t>(segmentFrames);
+    }
+}
+
+void RateSource::fill(int64_t end) {
+    size_t channels = format.channels;
+    while (inputStart + static_cast<int64_t>(inputFrames) < end) {
+        size_t wanted = static_cast<size_t>(end - inputStart) - inputFrames;
+        if (!sourceEnded) {
+            wanted = (std::min)(wanted, READ_FRAMES);
+        }
+        if (input.size() < (inputFrames + wanted) * channels) {
+            input.resize((inputFrames + wanted) * channels);
+            mono.resize(inputFrames + wanted);
+        }
+
+        float* frames = input.data() + inputFrames * channels;
+        size_t got = wanted;
+        if (sourceEnded) {
+            std::fill(frames, frames + wanted * channels, 0.0f);
+        } else {
+            got = source->decode(frames, wanted);
+            if (got == 0) {
+                sourceEnded = true;
+                endFrame = inputStart + static_cast<int64_t>(inputFrames);
+                continue;
+            }
+        }
+
+        if (mode == RateMode::STRETCH) {
+            float scale = 1.0f / channels;
+            for (size_t f = 0; f < got; ++f) {
+                float sum = 0.0f;
+                for (size_t c = 0; c < channels; ++c) {
+                    sum += frames[f * channels + c];
+                }
+                mono[inputFrames + f] = sum * scale;
+            }
+        }
+        inputFrames += got;
+    }
+}
+
+void RateSource::discardBefore(int64_t frame) {
+    if (frame <= inputStart) {
+        return;
+    }
+    size_t count = (std::min)(static_cast<size_t>(frame - inputStart), inputFrames);
+    size_t channels = format.channels;
+    std::memmove(input.data(), input.data() + count * channels, (inputFrames - count) * channels * sizeof(float));
+    std::memmove(mono.data(), mono.data() + count, (inputFrames - count) * sizeof(float));
+    inputFrames -= count;
+    inputStart += static_cast<int64_t>(count);
+}
+
+size_t RateSource::decodeVarispeed(float* buffer, size_t frameCount) {
+    if (frameCount == 0) {
+        return 0;
+    }
+
+    // Everything this call reads, plus the taps after the last position
+    double last = readPosition + (frameCount - 1) * rate;
+    fill(static_cast<int64_t>(last) + 3);
+
+    size_t frames = frameCount;
+    if (sourceEnded) {
+        double left = static_cast<double>(endFrame) - readPosition;
+        if (left <= 0.0) {
+            return 0;
+        }
+        frames = (std::min)(frameCount, static_cast<size_t>(std::ceil(left / rate)));
+    }
+
+    // Weights for four output frames at a time, stored frame by frame
+    if (weights.size() < frames * 4 + 16) {
+        weights.resize(frames * 4 + 16);
+    }
+    for (size_t j = 0; j < frames; j += 4) {
+        float f[4];
+        for (size_t k = 0; k < 4; ++k) {
+            double position = readPosition + (j + k) * rate;
+            f[k] = static_cast<float>(position - std::floor(position));
+        }
+#ifdef RATESOURCE_SSE2
+        __m128 x = _mm_loadu_ps(f);
+        __m128 x2 = _mm_mul_ps(x, x);
+        __m128 one = _mm_set1_ps(1.0f);
+        __m128 half = _mm_set1_ps(0.5f);
+        __m128 c0 = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(half, x)), x), half), x);
+        __m128 c1 = _mm_add_ps(_mm_mul_ps(_mm_sub_ps(_mm_mul_ps(_mm_set1_ps(1.5f), x), _mm_set1_ps(2.5f)), x2), one);
+        __m128 c2 = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(_mm_sub_ps(_mm_set1_ps(2.0f), _mm_mul_ps(_mm_set1_ps(1.5f), x)), x), half), x);
+        __m128 c3 = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(half, x), half), x2);
+        _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+        _mm_storeu_ps(&weights[j * 4], c0);
+        _mm_storeu_ps(&weights[j * 4 + 4], c1);
+        _mm_storeu_ps(&weights[j * 4 + 8], c2);
+        _mm_storeu_ps(&weights[j * 4 + 12], c3);
+#else
+        for (size_t k = 0; k < 4; ++k) {
+            hermite(f[k], &weights[(j + k) * 4]);
+        }
+#endif
+    }
+
+    size_t channels = format.channels;
+    for (size_t j = 0; j < frames; ++j) {
+        double position = readPosition + j * rate;
+        size_t i = static_cast<size_t>(static_cast<int64_t>(position) - inputStart);
+        const float* taps = input.data() + (i - 1) * channels;
+        const float* w = &weights[j * 4];
+        float* out = buffer + j * channels;
+
+#ifdef RATESOURCE_SSE2
+        if (channels == 2) {
+            // Taps of both channels side by side: (L R L R) of frames i-1, i and i+1, i+2
+            __m128 wv = _mm_loadu_ps(w);
+            __m128 v = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(taps), _mm_unpacklo_ps(wv, wv)),
+                                  _mm_mul_ps(_mm_loadu_ps(taps + 4), _mm_unpackhi_ps(wv, wv)));
+            v = _mm_add_ps(v, _mm_movehl_ps(v, v));
+            _mm_storel_pi(reinterpret_cast<__m64*>(out), v);
+            continue;
+        }
+        if (channels == 1) {
+            __m128 v = _mm_mul_ps(_mm_loadu_ps(taps), _mm_loadu_ps(w));
+            v = _mm_add_ps(v, _mm_movehl_ps(v, v));
+            v = _mm_add_ss(v, _mm_shuffle_ps(v, v, 1));
+            out[0] = _mm_cvtss_f32(v);
+            continue;
+        }
+#endif
+        for (size_t c = 0; c < channels; ++c) {
+            out[c] = taps[c] * w[0] + taps[channels + c] * w[1] + taps[2 * channels + c] * w[2] + taps[3 * channels + c] * w[3];
+        }
+    }
+
+    readPosition += frames * rate;
+    discardBefore(static_cast<int64_t>(readPosition) - 1);
+    return frames;
+}
+
+size_t RateSource::decodeStretch(float* buffer, size_t frameCount) {
+    size_t channels = format.channels;
+    size_t produced = 0;
+    while (produced < frameCount) {
+        if (pendingOffset == pendingFrames && !stretchStep()) {
+            break;
+        }
+        size_t count = (std::min)(frameCount - produced, pendingFrames - pendingOffset);
+        std::memcpy(buffer + produced * channels, pending.data() + pendingOffset * channels, count * channels * sizeof(float));
+        pendingOffset += count;
+        produced += count;
+    }
+    return produced;
+}
+
+bool RateSource::stretchStep() {
+    int64_t segment = static_cast<int64_t>(segmentFrames);
+    int64_t search = static_cast<int64_t>(searchFrames);
+    int64_t nominal = static_cast<int64_t>(std::llround(nominalPosition));
+    int64_t target = previousSegment + segment;
+    int64_t from = (std::max)(nominal - search, inputStart);
+    int64_t to = nominal + search;
+
+    fill((std::max)(to, target) + segment);
+    if (sourceEnded && nominal >= endFrame) {
+        return false;
+    }
+
+    int64_t chosen = bestSegment(target, from, to);
+
+    // Fade from where the last segment would have gone on into the new one
+    size_t channels = format.channels;
+    const float* outgoing = input.data() + static_cast<size_t>(target - inputStart) * channels;
+    const float* incoming = input.data() + static_cast<size_t>(chosen - inputStart) * channels;
+    const float* rise = fadeIn.data();
+    float* out = pending.data();
+    size_t samples = segmentFrames * channels;
+    size_t i = 0;
+#ifdef RATESOURCE_SSE2
+    for (; i + 4 <= samples; i += 4) {
+        __m128 a = _mm_loadu_ps(outgoing + i);
+        __m128 b = _mm_loadu_ps(incoming + i);
+        _mm_storeu_ps(out + i, _mm_add_ps(a, _mm_mul_ps(_mm_loadu_ps(rise + i), _mm_sub_ps(b, a))));
+    }
+#endif
+    for (; i < samples; ++i) {
+        out[i] = outgoing[i] + rise[i] * (incoming[i] - outgoing[i]);
+    }
+    pendingOffset = 0;
+    pendingFrames = segmentFrames;
+
+    previousSegment = chosen;
+    nominalPosition += segmentFrames * rate;
+    discardBefore((std::min)(chosen + segment, static_cast<int64_t>(std::llround(nominalPosition)) - search));
+    return true;
+}
+
+int64_t RateSource::bestSegment(int64_t target, int64_t from, int64_t to) {
+    const float* reference = mono.data() + (target - inputStart);
+    const float* candidates = mono.data() + (from - inputStart);
+    size_t count = static_cast<size_t>(to - from + 1);
+
+    // Energy of every candidate from prefix sums, so each one costs a single dot product
+    energy.resize(count + segmentFrames + 1);
+    energy[0] = 0.0;
+    for (size_t k = 0; k < count + segmentFrames - 1; ++k) {
+        energy[k + 1] = energy[k] + static_cast<double>(candidates[k]) * candidates[k];
+    }
+    auto score = [&](size_t k) {
+        double e = energy[k + segmentFrames] - energy[k];
+        return dot(candidates + k, reference, segmentFrames) / std::sqrt(e + 1e-9);
+    };
+
+    // Silence or anything without a clear match stays on the nominal position
+    int64_t nominal = static_cast<int64_t>(std::llround(nominalPosition));
+    size_t best = static_cast<size_t>((std::min)((std::max)(nominal - from, int64_t(0)), to - from));
+    double bestScore = score(best);
+    for (size_t k = best % COARSE_STEP; k < count; k += COARSE_STEP) {
+        double s = score(k);
+        if (s > bestScore) {
+            bestScore = s;
+            best = k;
+        }
+    }
+
+    size_t coarse = best;
+    size_t first = coarse >= COARSE_STEP ? coarse - COARSE_STEP + 1 : 0;
+    size_t last = (std::min)(coarse + COARSE_STEP - 1, count - 1);
+    for (size_t k = first; k <= last; ++k) {
+        double s = score(k);
+        if (s > bestScore) {
+            bestScore = s;
+            best = k;
+        }
+    }
+    return from + static_cast<int64_t>(best);
+}
\ No newline at end of file
@@ -0,0 +1,197 @@
+#include "../headers/realFft.hpp"
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#include <emmintrin.h>
+#define REALFFT_SSE2
+#endif
+
+namespace {
+    const double PI = 3.14159265358979323846;
+
+#ifdef REALFFT_SSE2
+    // (ar + i ai) * (br + i bi), four at a time
+    inline void multiply(__m128 ar, __m128 ai, __m128 br, __m128 bi, __m128& outRe, __m128& outIm) {
+        outRe = _mm_sub_ps(_mm_mul_ps(ar, br), _mm_mul_ps(ai, bi));
+        outIm = _mm_add_ps(_mm_mul_ps(ar, bi), _mm_mul_ps(ai, br));
+    }
+#endif
+}
+
+RealFft::RealFft(size_t size) : n(16), half(8), radix2First(false) {
+    while (n < size) {
+        n *= 2;
+    }
+    half = n / 2;
+
+    unsigned int bits = 0;
+    while ((size_t(1) << bits) < half) {
+        ++bits;
+    }
+    radix2First = (bits % 2) != 0;
+
+    bitReverse.resize(half);
+    for (size_t i = 0; i < half; ++i) {
+        uint32_t reversed = 0;
+        for (unsigned int b = 0; b < bits; ++b) {
+            reversed |= static_cast<uint32_t>((i >> b) & 1) << (bits - 1 - b);
+        }
+        bitReverse[i] = reversed;
+    }
+
+    // A pass over span m merges the radix-2 stages of span m and 2m, and needs
+    // w^1..w^3 for w = e^(-2*pi*i*j/4m), j < m
+    for (size_t span = radix2First ? 2 : 1; span * 4 <= half; span *= 4) {
+        Pass pass;
+        pass.span = span;
+        pass.twiddles = twiddleRe.size();
+        twiddleRe.resize(pass.twiddles + 3 * span);
+        twiddleIm.resize(pass.twiddles + 3 * span);
+        for (size_t power = 1; power <= 3; ++power) {
+            for (size_t j = 0; j < span; ++j) {
+                double angle = -2.0 * PI * static_cast<double>(j * power) / static_cast<double>(4 * span);
+                twiddleRe[pass.twiddles + (power - 1) * span + j] = static_cast<float>(std::cos(angle));
+                twiddleIm[pass.twiddles + (power - 1) * span + j] = static_cast<float>(std::sin(angle));
+            }
+        }
+        passes.push_back(pass);
+    }
+
+    splitRe.resize(half);
+    splitIm.resize(half);
+    for (size_t k = 0; k < half; ++k) {
+        double angle = -2.0 * PI * static_cast<double>(k) / static_cast<double>(n);
+        splitRe[k] = static_cast<float>(std::cos(angle));
+        splitIm[k] = static_cast<float>(std::sin(angle));
+    }
+
+    re.assign(half, 0.0f);
+    im.assign(half, 0.0f);
+}
+
+size_t RealFft::size() const {
+    return n;
+}
+
+void RealFft::powerSpectrum(const float* input, float* power) {
+    // Even samples are the real parts, odd ones the imaginary parts, stored bit-reversed
+    for (size_t i = 0; i < half; ++i) {
+        uint32_t to = bitReverse[i];
+        re[to] = input[2 * i];
+        im[to] = input[2 * i + 1];
+    }
+
+    if (radix2First) {
+        for (size_t k = 0; k < half; k += 2) {
+            float ar = re[k];
+            float ai = im[k];
+            re[k] = ar + re[k + 1];
+            im[k] = ai + im[k + 1];
+            re[k + 1] = ar - re[k + 1];
+            im[k + 1] = ai - im[k + 1];
+        }
+    }
+    for (const Pass& pass : passes) {
+        radix4(pass);
+    }
+
+    // Z holds E + iO, the transforms of the even and odd samples: pull them
+    // apart with Z[half - k] and combine them as X[k] = E[k] + w^k O[k]
+    power[0] = (re[0] + im[0]) * (re[0] + im[0]);
+    power[half] = (re[0] - im[0]) * (re[0] - im[0]);
+    for (size_t k = 1; k < half; ++k) {
+        float zr = re[k];
+        float zi = im[k];
+        float cr = re[half - k];
+        float ci = -im[half - k];
+        float er = 0.5f * (zr + cr);
+        float ei = 0.5f * (zi + ci);
+        float orr = 0.5f * (zi - ci);
+        float oi = -0.5f * (zr - cr);
+        float xr = er + splitRe[k] * orr - splitIm[k] * oi;
+        float xi = ei + splitRe[k] * oi + splitIm[k] * orr;
+        power[k] = xr * xr + xi * xi;
+    }
+}
+
+void RealFft::radix4(const Pass& pass) {
+    const size_t m = pass.span;
+    const float* w1r = twiddleRe.data() + pass.twiddles;
+    const float* w1i = twiddleIm.data() + pass.twiddles;
+    const float* w2r = w1r + m;
+    const float* w2i = w1i + m;
+    const float* w3r = w1r + 2 * m;
+    const float* w3i = w1i + 2 * m;
+
+    // With a0..a3 at j, j+m, j+2m and j+3m of a group, the outputs are
+    // (a0 + w^2 a1) +- w (a2 + w^2 a3) at j and j+2m, and
+    // (a0 - w^2 a1) -+ i w (a2 - w^2 a3) at j+m and j+3m
+    for (size_t group = 0; group < half; group += 4 * m) {
+        float* r0 = re.data() + group;
+        float* i0 = im.data() + group;
+        float* r1 = r0 + m;
+        float* i1 = i0 + m;
+        float* r2 = r0 + 2 * m;
+        float* i2 = i0 + 2 * m;
+        float* r3 = r0 + 3 * m;
+        float* i3 = i0 + 3 * m;
+
+        size_t j = 0;
+#ifdef REALFFT_SSE2
+        for (; j + 4 <= m; j += 4) {
+            __m128 a0r = _mm_loadu_ps(r0 + j);
+            __m128 a0i = _mm_loadu_ps(i0 + j);
+            __m128 t1r, t1i, t2r, t2i, t3r, t3i;
+            multiply(_mm_loadu_ps(w1r + j), _mm_loadu_ps(w1i + j), _mm_loadu_ps(r2 + j), _mm_loadu_ps(i2 + j), t1r, t1i);
+            multiply(_mm_loadu_ps(w2r + j), _mm_loadu_ps(w2i + j), _mm_loadu_ps(r1 + j), _mm_loadu_ps(i1 + j), t2r, t2i);
+            multiply(_mm_loadu_ps(w3r + j), _mm_loadu_ps(w3i + j), _mm_loadu_ps(r3 + j), _mm_loadu_ps(i3 + j), t3r, t3i);
+
+            __m128 s0r = _mm_add_ps(a0r, t2r);
+            __m128 s0i = _mm_add_ps(a0i, t2i);
+            __m128 d0r = _mm_sub_ps(a0r, t2r);
+            __m128 d0i = _mm_sub_ps(a0i, t2i);
+            __m128 s1r = _mm_add_ps(t1r, t3r);
+            __m128 s1i = _mm_add_ps(t1i, t3i);
+            __m128 d1r = _mm_sub_ps(t1r, t3r);
+            __m128 d1i = _mm_sub_ps(t1i, t3i);
+
+            _mm_storeu_ps(r0 + j, _mm_add_ps(s0r, s1r));
+            _mm_storeu_ps(i0 + j, _mm_add_ps(s0i, s1i));
+            _mm_storeu_ps(r2 + j, _mm_sub_ps(s0r, s1r));
+            _mm_storeu_ps(i2 + j, _mm_sub_ps(s0i, s1i));
+            _mm_storeu_ps(r1 + j, _mm_add_ps(d0r, d1i));
+            _mm_storeu_ps(i1 + j, _mm_sub_ps(d0i, d1r));
+            _mm_storeu_ps(r3 + j, _mm_sub_ps(d0r, d1i));
+            _mm_storeu_ps(i3 + j, _mm_add_ps(d0i, d1r));
+        }
+#endif
+        for (; j < m; ++j) {
+            float a0r = r0[j];
+            float a0i = i0[j];
+            float t1r = w1r[j] * r2[j] - w1i[j] * i2[j];
+            float t1i = w1r[j] * i2[j] + w1i[j] * r2[j];
+            float t2r = w2r[j] * r1[j] - w2i[j] * i1[j];
+            float t2i = w2r[j] * i1[j] + w2i[j] * r1[j];
+            float t3r = w3r[j] * r3[j] - w3i[j] * i3[j];
+            float t3i = w3r[j] * i3[j] + w3i[j] * r3[j];
+
+            float s0r = a0r + t2r;
+            float s0i = a0i + t2i;
+            float d0r = a0r - t2r;
+            float d0i = a0i - t2i;
+            float s1r = t1r + t3r;
+            float s1i = t1i + t3i;
+            float d1r = t1r - t3r;
+            float d1i = t1i - t3i;
+
+            r0[j] = s0r + s1r;
+            i0[j] = s0i + s1i;
+            r2[j] = s0r - s1r;
+            i2[j] = s0i - s1i;
+            r1[j] = d0r + d1i;
+            i1[j] = d0i - d1r;
+            r3[j] = d0r - d1i;
+            i3[j] = d0i + d1r;
+        }
+    }
+}
\ No newline at end of file
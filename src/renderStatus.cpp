@@ -0,0 +1,37 @@
+#include "../headers/renderStatus.hpp"
+#include <cstring>
+
+RenderStatus::RenderStatus() : sequence(0) {
+    publish(PlaybackStatus());
+}
+
+void RenderStatus::publish(const PlaybackStatus& status) {
+    uint64_t raw[WORDS] = {};
+    std::memcpy(raw, &status, sizeof(PlaybackStatus));
+
+    uint32_t current = sequence.load(std::memory_order_relaxed);
+    sequence.store(current + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (size_t i = 0; i < WORDS; ++i) {
+        words[i].store(raw[i], std::memory_order_relaxed);
+    }
+    sequence.store(current + 2, std::memory_order_release);
+}
+
+PlaybackStatus RenderStatus::read() const {
+    uint64_t raw[WORDS];
+    uint32_t before;
+    uint32_t after;
+    do {
+        before = sequence.load(std::memory_order_acquire);
+        for (size_t i = 0; i < WORDS; ++i) {
+            raw[i] = words[i].load(std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        after = sequence.load(std::memory_order_relaxed);
+    } while ((before & 1) != 0 || before != after);
+
+    PlaybackStatus status;
+    std::memcpy(&status, raw, sizeof(PlaybackStatus));
+    return status;
+}
\ No newline at end of file
@@ -0,0 +1,326 @@
+#include "../headers/resampleSource.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <mutex>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define RESAMPLE_AVX
+#elif defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#include <emmintrin.h>
+#define RESAMPLE_SSE2
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define RESAMPLE_NEON
+#endif
+
+namespace {
+    const double PI = 3.14159265358979323846;
+    // Kaiser beta for about 80 dB of stopband, and the cut-off that puts the
+    // transition band of TAPS taps just under Nyquist
+    const double KAISER_BETA = 7.86;
+    const double ROLLOFF = 0.92;
+
+    // count is a multiple of 8
+    float dot(const float* a, const float* b, size_t count) {
+#if defined(RESAMPLE_AVX)
+        __m256 acc = _mm256_setzero_ps();
+        for (size_t i = 0; i < count; i += 8) {
+            acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+        }
+        __m128 sum = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+        sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+        sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+        return _mm_cvtss_f32(sum);
+#elif defined(RESAMPLE_SSE2)
+        __m128 acc0 = _mm_setzero_ps();
+        __m128 acc1 = _mm_setzero_ps();
+        for (size_t i = 0; i < count; i += 8) {
+            acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+            acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+        }
+        acc0 = _mm_add_ps(acc0, acc1);
+        acc0 = _mm_add_ps(acc0, _mm_movehl_ps(acc0, acc0));
+        acc0 = _mm_add_ss(acc0, _mm_shuffle_ps(acc0, acc0, 1));
+        return _mm_cvtss_f32(acc0);
+#elif defined(RESAMPLE_NEON)
+        float32x4_t acc0 = vdupq_n_f32(0.0f);
+        float32x4_t acc1 = vdupq_n_f32(0.0f);
+        for (size_t i = 0; i < count; i += 8) {
+            acc0 = vmlaq_f32(acc0, vld1q_f32(a + i), vld1q_f32(b + i));
+            acc1 = vmlaq_f32(acc1, vld1q_f32(a + i + 4), vld1q_f32(b + i + 4));
+        }
+        float32x4_t acc = vaddq_f32(acc0, acc1);
+        float32x2_t pair = vadd_f32(vget_low_f32(acc), vget_high_f32(acc));
+        return vget_lane_f32(vpadd_f32(pair, pair), 0);
+#else
+        float sum[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+        for (size_t i = 0; i < count; i += 4) {
+            sum[0] += a[i] * b[i];
+            sum[1] += a[i + 1] * b[i + 1];
+            sum[2] += a[i + 2] * b[i + 2];
+            sum[3] += a[i + 3] * b[i + 3];
+        }
+        return (sum[0] + sum[1]) + (sum[2] + sum[3]);
+#endif
+    }
+
+    // Zeroth order modified Bessel function, for the Kaiser window
+    double besselI0(double x) {
+        double sum = 1.0;
+        double term = 1.0;
+        double quarter = x * x / 4.0;
+        for (int k = 1; k < 50 && term > sum * 1e-12; ++k) {
+            term *= quarter / (static_cast<double>(k) * k);
+            sum += term;
+        }
+        return sum;
+    }
+
+    uint64_t gcd(uint64_t a, uint64_t b) {
+        while (b != 0) {
+            uint64_t r = a % b;
+            a = b;
+            b = r;
+        }
+        return a;
+    }
+}
+
+ResampleSource::ResampleSource(std::unique_ptr<AudioBackend> wrapped, unsigned int outputRate)
+    : source(std::move(wrapped)), up(1), down(1), positionFrames(0), inputIndex(0), phase(0), capacity(0), inputFrames(0), inputStart(0),
+      sourceEnded(false), endFrame(0) {
+    inputFormat = source->getFormat();
+    format = AudioFormat(outputRate, inputFormat.channels);
+    uint64_t common = gcd(inputFormat.sampleRate, outputRate);
+    up = outputRate / common;
+    down = inputFormat.sampleRate / common;
+    bank = bankFor(inputFormat.sampleRate, outputRate);
+
+    uint64_t start = source->getPositionFrames();
+    if (start > 0) {
+        seek(start * up / down);
+    } else {
+        reset(1 - static_cast<int64_t>(bank->taps / 2), 0);
+    }
+}
+
+std::unique_ptr<AudioBackend> ResampleSource::wrap(std::unique_ptr<AudioBackend> source, unsigned int outputRate) {
+    if (!source || outputRate == 0 || source->getFormat().sampleRate == outputRate || source->getFormat().sampleRate == 0) {
+        return source;
+    }
+    return std::unique_ptr<AudioBackend>(new ResampleSource(std::move(source), outputRate));
+}
+
+std::shared_ptr<const ResampleSource::Bank> ResampleSource::bankFor(unsigned int inputRate, unsigned int outputRate) {
+    static std::mutex mutex;
+    static std::map<uint64_t, std::shared_ptr<const Bank>> banks;
+
+    uint64_t key = (static_cast<uint64_t>(inputRate) << 32) | outputRate;
+    std::lock_guard<std::mutex> lock(mutex);
+    auto found = banks.find(key);
+    if (found != banks.end()) {
+        return found->second;
+    }
+
+    uint64_t common = gcd(inputRate, outputRate);
+    uint64_t l = outputRate / common;
+    uint64_t m = inputRate / common;
+
+    // Downsampling narrows the passband, so the filter spans more input frames
+    std::shared_ptr<Bank> built = std::make_shared<Bank>();
+    built->phases = static_cast<unsigned int>((std::min)(l, static_cast<uint64_t>(MAX_PHASES)));
+    size_t taps = TAPS;
+    if (m > l) {
+        taps = static_cast<size_t>(std::ceil(static_cast<double>(TAPS) * m / l));
+    }
+    built->taps = (taps + 7) / 8 * 8;
+    built->weights.resize(built->phases * built->taps);
+
+    // Cut-off as a fraction of the input Nyquist frequency
+    double cutoff = ROLLOFF * (m > l ? static_cast<double>(l) / m : 1.0);
+    double half = built->taps / 2.0;
+    double norm = besselI0(KAISER_BETA);
+    for (unsigned int q = 0; q < built->phases; ++q) {
+        // Tap j reads input frame n - taps/2 + 1 + j, the output sits q/phases past frame n
+        double offset = static_cast<double>(q) / built->phases;
+        float* weights = built->weights.data() + q * built->taps;
+        double sum = 0.0;
+        for (size_t j = 0; j < built->taps; ++j) {
+            double distance = static_cast<double>(j) - half + 1.0 - offset;
+            double x = cutoff * distance;
+            double sinc = x == 0.0 ? 1.0 : std::sin(PI * x) / (PI * x);
+            double edge = distance / half;
+            double window = edge * edge < 1.0 ? besselI0(KAISER_BETA * std::sqrt(1.0 - edge * edge)) / norm : 0.0;
+            double weight = cutoff * sinc * window;
+            weights[j] = static_cast<float>(weight);
+            sum += weight;
+        }
+        // Every phase passes DC at exactly unity, otherwise the phases would ripple against each other
+        for (size_t j = 0; j < built->taps; ++j) {
+            weights[j] = static_cast<float>(weights[j] / sum);
+        }
+    }
+
+    banks[key] = built;
+    return built;
+}
+
+bool ResampleSource::open(const std::string& path) {
+    return source->open(path);
+}
+
+size_t ResampleSource::decode(float* buffer, size_t frameCount) {
+    if (frameCount == 0) {
+        return 0;
+    }
+
+    size_t taps = bank->taps;
+    int64_t behind = static_cast<int64_t>(taps / 2) - 1;   // Taps in front of the input frame
+    discardBefore(inputIndex - behind);
+    int64_t lastIndex = inputIndex + static_cast<int64_t>((phase + (frameCount - 1) * down) / up);
+    fill(lastIndex - behind + static_cast<int64_t>(taps));
+
+    size_t channels = format.channels;
+    bool exact = bank->phases == up;
+    size_t frames = 0;
+    for (; frames < frameCount; ++frames) {
+        if (sourceEnded && inputIndex >= endFrame) {
+            break;
+        }
+        uint64_t q = exact ? phase : phase * bank->phases / up;
+        const float* weights = bank->weights.data() + q * taps;
+        size_t offset = static_cast<size_t>(inputIndex - behind - inputStart);
+        for (size_t c = 0; c < channels; ++c) {
+            buffer[frames * channels + c] = dot(weights, planes.data() + c * capacity + offset, taps);
+        }
+
+        phase += down;
+        inputIndex += static_cast<int64_t>(phase / up);
+        phase %= up;
+    }
+    positionFrames += frames;
+    return frames;
+}
+
+bool ResampleSource::seek(uint64_t frame) {
+    int64_t behind = static_cast<int64_t>(bank->taps / 2) - 1;
+    uint64_t index = frame * down / up;
+    uint64_t first = index > static_cast<uint64_t>(behind) ? index - behind : 0;
+    bool ok = source->seek(first);
+
+    // Decoders clamp seeks past their end, the timeline follows where they landed
+    uint64_t landed = source->getPositionFrames();
+    if (landed != first) {
+        frame = landed * up / down;
+        index = frame * down / up;
+    }
+    inputIndex = static_cast<int64_t>(index);
+    phase = frame * down % up;
+    reset(inputIndex - behind, static_cast<int64_t>(landed));
+    positionFrames = frame;
+    return ok;
+}
+
+void ResampleSource::close() {
+    source->close();
+}
+
+void ResampleSource::prepareSeeking() {
+    source->prepareSeeking();
+}
+
+AudioFormat ResampleSource::getFormat() const {
+    return format;
+}
+
+uint64_t ResampleSource::getLengthFrames() const {
+    return (source->getLengthFrames() * up + down - 1) / down;
+}
+
+uint64_t ResampleSource::getPositionFrames() const {
+    return positionFrames;
+}
+
+unsigned int ResampleSource::getInputRate() const {
+    return inputFormat.sampleRate;
+}
+
+void ResampleSource::reset(int64_t first, int64_t sourceFrame) {
+    sourceEnded = false;
+    endFrame = 0;
+    inputStart = first;
+    inputFrames = 0;
+    if (sourceFrame > first) {
+        size_t silent = static_cast<size_t>(sourceFrame - first);
+        if (capacity < silent) {
+            capacity = silent + READ_FRAMES;
+            planes.assign(capacity * format.channels, 0.0f);
+        }
+        for (size_t c = 0; c < format.channels; ++c) {
+            std::fill(planes.begin() + c * capacity, planes.begin() + c * capacity + silent, 0.0f);
+        }
+        inputFrames = silent;
+    }
+}
+
+void ResampleSource::fill(int64_t end) {
+    size_t channels = format.channels;
+    while (inputStart + static_cast<int64_t>(inputFrames) < end) {
+        size_t wanted = static_cast<size_t>(end - inputStart) - inputFrames;
+        if (!sourceEnded) {
+            wanted = (std::min)(wanted, READ_FRAMES);
+        }
+        if (inputFrames + wanted > capacity) {
+            // Grow every plane, keeping what they hold
+            size_t grown = (std::max)(inputFrames + wanted, capacity * 2);
+            std::vector<float> larger(grown * channels, 0.0f);
+            for (size_t c = 0; c < channels; ++c) {
+                std::memcpy(larger.data() + c * grown, planes.data() + c * capacity, inputFrames * sizeof(float));
+            }
+            planes.swap(larger);
+            capacity = grown;
+        }
+
+        if (sourceEnded) {
+            for (size_t c = 0; c < channels; ++c) {
+                float* plane = planes.data() + c * capacity + inputFrames;
+                std::fill(plane, plane + wanted, 0.0f);
+            }
+            inputFrames += wanted;
+            continue;
+        }
+
+        if (scratch.size() < wanted * channels) {
+            scratch.resize(wanted * channels);
+        }
+        size_t got = source->decode(scratch.data(), wanted);
+        if (got == 0) {
+            sourceEnded = true;
+            endFrame = inputStart + static_cast<int64_t>(inputFrames);
+            continue;
+        }
+        for (size_t c = 0; c < channels; ++c) {
+            float* plane = planes.data() + c * capacity + inputFrames;
+            for (size_t f = 0; f < got; ++f) {
+                plane[f] = scratch[f * channels + c];
+            }
+        }
+        inputFrames += got;
+    }
+}
+
+void ResampleSource::discardBefore(int64_t frame) {
+    if (frame <= inputStart) {
+        return;
+    }
+    size_t count = (std::min)(static_cast<size_t>(frame - inputStart), inputFrames);
+    for (size_t c = 0; c < format.channels; ++c) {
+        float* plane = planes.data() + c * capacity;
+        std::memmove(plane, plane + count, (inputFrames - count) * sizeof(float));
+    }
+    inputFrames -= count;
+    inputStart += static_cast<int64_t>(count);
+}
\ No newline at end of file
@@ -0,0 +1,108 @@
+#include "../headers/sessionSnapshot.hpp"
+#include "../headers/binaryIO.hpp"
+#include <fstream>
+#include <filesystem>
+#include <iostream>
+
+namespace fs = std::filesystem;
+using namespace BinaryIO;
+
+namespace {
+    const uint32_t SESSION_MAGIC = 0x53534453; // "SDSS"
+    const uint32_t SESSION_VERSION = 1;
+}
+
+bool SessionSnapshot::save(const std::string& filename, const SessionState& state, const PlayQueue& queue) {
+    std::string tempName = filename + ".tmp";
+    {
+        std::ofstream file(tempName, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            return false;
+        }
+
+        writeValue(file, SESSION_MAGIC);
+        writeValue(file, SESSION_VERSION);
+
+        writeValue(file, static_cast<uint8_t>(state.queueMode));
+        writeString(file, state.playlistName);
+        writeValue(file, state.shuffleSeed);
+        writeValue(file, static_cast<uint8_t>(state.smartShuffle ? 1 : 0));
+        writeValue(file, static_cast<int32_t>(state.randomPosition));
+        writeValue(file, static_cast<int32_t>(state.currentSongIndex));
+        writeValue(file, state.librarySize);
+
+        writeValue(file, static_cast<uint8_t>(state.hasCurrentSong ? 1 : 0));
+        writeString(file, state.currentSong.artist);
+        writeString(file, state.currentSong.title);
+        writeString(file, state.currentSong.filePath);
+        writeValue(file, static_cast<int32_t>(state.currentSong.id));
+        writeValue(file, state.positionMs);
+        writeValue(file, static_cast<uint8_t>(state.wasPlaying ? 1 : 0));
+
+        queue.save(file);
+
+        if (!file.good()) {
+            return false;
+        }
+    }
+
+    std::error_code error;
+    fs::rename(tempName, filename, error);
+    return !error;
+}
+
+bool SessionSnapshot::load(const std::string& filename, SessionState& state, PlayQueue& queue) {
+    std::ifstream file(filename, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    uint32_t magic = 0;
+    uint32_t version = 0;
+    if (!readValue(file, magic) || !readValue(file, version) ||
+        magic != SESSION_MAGIC || version != SESSION_VERSION) {
+        std::cout << "Ignoring unreadable session snapshot." << std::endl;
+        return false;
+    }
+
+    SessionState loaded;
+    uint8_t mode = 0;
+    uint8_t smart = 0;
+    int32_t randomPosition = -1;
+    int32_t currentSongIndex = -1;
+    uint8_t hasCurrent = 0;
+    int32_t songId = 0;
+    uint8_t wasPlaying = 0;
+
+    bool ok = readValue(file, mode) &&
+              readString(file, loaded.playlistName) &&
+              readValue(file, loaded.shuffleSeed) &&
+              readValue(file, smart) &&
+              readValue(file, randomPosition) &&
+              readValue(file, currentSongIndex) &&
+              readValue(file, loaded.librarySize) &&
+              readValue(file, hasCurrent) &&
+              readString(file, loaded.currentSong.artist) &&
+              readString(file, loaded.currentSong.title) &&
+              readString(file, loaded.currentSong.filePath) &&
+              readValue(file, songId) &&
+              readValue(file, loaded.positionMs) &&
+              readValue(file, wasPlaying) &&
+              mode <= static_cast<uint8_t>(QueueMode::RADIO);
+
+    if (!ok || !queue.load(file)) {
+        std::cout << "Ignoring unreadable session snapshot." << std::endl;
+        return false;
+    }
+
+    loaded.queueMode = static_cast<QueueMode>(mode);
+    loaded.smartShuffle = smart != 0;
+    loaded.randomPosition = randomPosition;
+    loaded.currentSongIndex = currentSongIndex;
+    loaded.hasCurrentSong = hasCurrent != 0;
+    loaded.currentSong.id = songId;
+    loaded.wasPlaying = wasPlaying != 0;
+
+    state = loaded;
+    return true;
+}
\ No newline at end of file
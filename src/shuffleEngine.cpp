@@ -0,0 +1,121 @@
+#include "../headers/shuffleEngine.hpp"
+#include <random>
+#include <chrono>
+
+namespace {
+    uint64_t splitMix64(uint64_t& state) {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+}
+
+ShuffleEngine::ShuffleEngine() : seed(0), count(0), halfBits(1), halfMask(1) {
+    for (int i = 0; i < ROUNDS; ++i) {
+        roundKeys[i] = 0;
+    }
+}
+
+void ShuffleEngine::reset(size_t size, uint64_t newSeed) {
+    seed = newSeed;
+    count = static_cast<uint32_t>(size);
+
+    // Smallest even bit width whose domain covers [0, count), so the
+    // cycle walk needs fewer than 4 rounds on average
+    halfBits = 1;
+    while (halfBits < 16 && (uint64_t(1) << (halfBits * 2)) < count) {
+        halfBits++;
+    }
+    halfMask = (uint32_t(1) << halfBits) - 1;
+
+    uint64_t state = seed;
+    for (int i = 0; i < ROUNDS; ++i) {
+        roundKeys[i] = static_cast<uint32_t>(splitMix64(state));
+    }
+}
+
+void ShuffleEngine::reshuffle() {
+    reset(count, randomSeed());
+}
+
+size_t ShuffleEngine::size() const {
+    return count;
+}
+
+bool ShuffleEngine::isEmpty() const {
+    return count == 0;
+}
+
+uint64_t ShuffleEngine::getSeed() const {
+    return seed;
+}
+
+int ShuffleEngine::indexAt(int position) const {
+    if (position < 0 || static_cast<uint32_t>(position) >= count) {
+        return -1;
+    }
+
+    // Cycle-walking: re-encrypt until we land back inside [0, count)
+    uint32_t value = static_cast<uint32_t>(position);
+    do {
+        value = encrypt(value);
+    } while (value >= count);
+
+    return static_cast<int>(value);
+}
+
+int ShuffleEngine::positionOf(int index) const {
+    if (index < 0 || static_cast<uint32_t>(index) >= count) {
+        return -1;
+    }
+
+    uint32_t value = static_cast<uint32_t>(index);
+    do {
+        value = decrypt(value);
+    } while (value >= count);
+
+    return static_cast<int>(value);
+}
+
+uint64_t ShuffleEngine::randomSeed() {
+    std::random_device rd;
+    uint64_t value = (static_cast<uint64_t>(rd()) << 32) ^ rd();
+    return value ^ static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+}
+
+uint32_t ShuffleEngine::roundFunction(uint32_t value, uint32_t key) const {
+    uint32_t x = value ^ key;
+    x ^= x >> 16;
+    x *= 0x7FEB352DU;
+    x ^= x >> 15;
+    x *= 0x846CA68BU;
+    x ^= x >> 16;
+    return x & halfMask;
+}
+
+uint32_t ShuffleEngine::encrypt(uint32_t value) const {
+    uint32_t left = value >> halfBits;
+    uint32_t right = value & halfMask;
+
+    for (int i = 0; i < ROUNDS; ++i) {
+        uint32_t next = left ^ roundFunction(right, roundKeys[i]);
+        left = right;
+        right = next;
+    }
+
+    return (left << halfBits) | right;
+}
+
+uint32_t ShuffleEngine::decrypt(uint32_t value) const {
+    uint32_t left = value >> halfBits;
+    uint32_t right = value & halfMask;
+
+    for (int i = ROUNDS - 1; i >= 0; --i) {
+        uint32_t previous = right ^ roundFunction(left, roundKeys[i]);
+        right = left;
+        left = previous;
+    }
+
+    return (left << halfBits) | right;
+}
\ No newline at end of file
@@ -0,0 +1,187 @@
+#include "../headers/similarityIndex.hpp"
+#include <algorithm>
+#include <random>
+#include <cmath>
+#include <limits>
+
+namespace {
+    // Per dimension: centroid, rolloff, 12 MFCCs, tempo, loudness. The MFCCs
+    // share the timbre between many dimensions, so each of them counts less
+    const float WEIGHTS[SimilarityIndex::DIMENSIONS] = {
+        1.0f, 1.0f,
+        0.6f, 0.6f, 0.6f, 0.6f, 0.6f, 0.6f, 0.6f, 0.6f, 0.6f, 0.6f, 0.6f, 0.6f,
+        1.5f, 1.0f
+    };
+}
+
+void SimilarityIndex::build(const std::vector<int>& songIds, const std::vector<Vector>& vectors, uint64_t seed) {
+    points.clear();
+    ids.clear();
+    rowOf.clear();
+    centres.clear();
+    listStart.assign(1, 0);
+    size_t count = (std::min)(songIds.size(), vectors.size());
+    if (count == 0) {
+        return;
+    }
+
+    // Standardize, unknown values end up at the mean
+    std::vector<float> scaled(count * DIMENSIONS, 0.0f);
+    for (size_t d = 0; d < DIMENSIONS; ++d) {
+        double sum = 0.0;
+        double squares = 0.0;
+        size_t known = 0;
+        for (size_t i = 0; i < count; ++i) {
+            float value = vectors[i][d];
+            if (!std::isnan(value)) {
+                sum += value;
+                squares += static_cast<double>(value) * value;
+                known++;
+            }
+        }
+        if (known == 0) {
+            continue;
+        }
+        double mean = sum / static_cast<double>(known);
+        double deviation = std::sqrt((std::max)(squares / static_cast<double>(known) - mean * mean, 0.0));
+        float scale = deviation > 1e-9 ? static_cast<float>(WEIGHTS[d] / deviation) : 0.0f;
+        for (size_t i = 0; i < count; ++i) {
+            float value = vectors[i][d];
+            scaled[i * DIMENSIONS + d] = std::isnan(value) ? 0.0f : static_cast<float>(value - mean) * scale;
+        }
+    }
+
+    // k-means on a sample, enough to place the centres
+    size_t lists = (std::max)(static_cast<size_t>(1), static_cast<size_t>(std::sqrt(static_cast<double>(count))));
+    std::mt19937_64 random(seed);
+    std::vector<size_t> sample(count);
+    for (size_t i = 0; i < count; ++i) {
+        sample[i] = i;
+    }
+    size_t sampleSize = (std::min)(count, lists * TRAINING_PER_LIST);
+    for (size_t i = 0; i < sampleSize; ++i) {
+        std::uniform_int_distribution<size_t> pick(i, count - 1);
+        std::swap(sample[i], sample[pick(random)]);
+    }
+    sample.resize(sampleSize);
+
+    centres.resize(lists * DIMENSIONS);
+    for (size_t l = 0; l < lists; ++l) {
+        std::copy(&scaled[sample[l] * DIMENSIONS], &scaled[sample[l] * DIMENSIONS] + DIMENSIONS, &centres[l * DIMENSIONS]);
+    }
+
+    auto closestList = [&](const float* point) {
+        size_t best = 0;
+        float bestDistance = std::numeric_limits<float>::max();
+        for (size_t l = 0; l < lists; ++l) {
+            float d = distance(point, &centres[l * DIMENSIONS]);
+            if (d < bestDistance) {
+                bestDistance = d;
+                best = l;
+            }
+        }
+        return best;
+    };
+
+    std::vector<double> sums(lists * DIMENSIONS);
+    std::vector<size_t> members(lists);
+    for (int round = 0; round < KMEANS_ROUNDS; ++round) {
+        std::fill(sums.begin(), sums.end(), 0.0);
+        std::fill(members.begin(), members.end(), 0);
+        for (size_t i : sample) {
+            size_t l = closestList(&scaled[i * DIMENSIONS]);
+            members[l]++;
+            for (size_t d = 0; d < DIMENSIONS; ++d) {
+                sums[l * DIMENSIONS + d] += scaled[i * DIMENSIONS + d];
+            }
+        }
+        for (size_t l = 0; l < lists; ++l) {
+            if (members[l] == 0) {
+                // Lost all its points, start it again somewhere else
+                std::uniform_int_distribution<size_t> pick(0, sampleSize - 1);
+                size_t i = sample[pick(random)];
+                std::copy(&scaled[i * DIMENSIONS], &scaled[i * DIMENSIONS] + DIMENSIONS, &centres[l * DIMENSIONS]);
+                continue;
+            }
+            for (size_t d = 0; d < DIMENSIONS; ++d) {
+                centres[l * DIMENSIONS + d] = static_cast<float>(sums[l * DIMENSIONS + d] / static_cast<double>(members[l]));
+            }
+        }
+    }
+
+    // Every point into its list, the lists laid out one after the other
+    std::vector<size_t> listOf(count);
+    listStart.assign(lists + 1, 0);
+    for (size_t i = 0; i < count; ++i) {
+        listOf[i] = closestList(&scaled[i * DIMENSIONS]);
+        listStart[listOf[i] + 1]++;
+    }
+    for (size_t l = 0; l < lists; ++l) {
+        listStart[l + 1] += listStart[l];
+    }
+    std::vector<size_t> next(listStart.begin(), listStart.end() - 1);
+    points.resize(count * DIMENSIONS);
+    ids.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        size_t row = next[listOf[i]]++;
+        std::copy(&scaled[i * DIMENSIONS], &scaled[i * DIMENSIONS] + DIMENSIONS, &points[row * DIMENSIONS]);
+        ids[row] = songIds[i];
+        rowOf[songIds[i]] = row;
+    }
+}
+
+size_t SimilarityIndex::size() const {
+    return ids.size();
+}
+
+bool SimilarityIndex::contains(int songId) const {
+    return rowOf.find(songId) != rowOf.end();
+}
+
+const std::vector<int>& SimilarityIndex::getSongIds() const {
+    return ids;
+}
+
+std::vector<int> SimilarityIndex::nearest(int songId, size_t count) const {
+    auto found = rowOf.find(songId);
+    if (found == rowOf.end() || count == 0) {
+        return {};
+    }
+    const float* query = &points[found->second * DIMENSIONS];
+
+    // Closest centres first
+    size_t lists = listStart.size() - 1;
+    std::vector<std::pair<float, size_t>> byCentre(lists);
+    for (size_t l = 0; l < lists; ++l) {
+        byCentre[l] = std::make_pair(distance(query, &centres[l * DIMENSIONS]), l);
+    }
+    size_t probes = (std::min)(PROBES, lists);
+    std::partial_sort(byCentre.begin(), byCentre.begin() + probes, byCentre.end());
+
+    std::vector<std::pair<float, int>> candidates;
+    for (size_t p = 0; p < probes; ++p) {
+        size_t l = byCentre[p].second;
+        for (size_t row = listStart[l]; row < listStart[l + 1]; ++row) {
+            if (ids[row] != songId) {
+                candidates.push_back(std::make_pair(distance(query, &points[row * DIMENSIONS]), ids[row]));
+            }
+        }
+    }
+
+    size_t shown = (std::min)(count, candidates.size());
+    std::partial_sort(candidates.begin(), candidates.begin() + shown, candidates.end());
+    std::vector<int> result;
+    for (size_t i = 0; i < shown; ++i) {
+        result.push_back(candidates[i].second);
+    }
+    return result;
+}
+
+float SimilarityIndex::distance(const float* a, const float* b) {
+    float sum = 0.0f;
+    for (size_t d = 0; d < DIMENSIONS; ++d) {
+        float difference = a[d] - b[d];
+        sum += difference * difference;
+    }
+    return sum;
+}
\ No newline at end of file
@@ -0,0 +1,240 @@
+#include "../headers/smartShuffle.hpp"
+#include <algorithm>
+#include <cctype>
+#include <queue>
+#include <random>
+#include <unordered_map>
+#include <functional>
+
+SmartShuffle::SmartShuffle() : seed(0), extendCount(0) {}
+
+void SmartShuffle::build(const std::vector<Song>& songs, uint64_t newSeed) {
+    seed = newSeed;
+    extendCount = 0;
+
+    std::vector<int> indices(songs.size());
+    for (size_t i = 0; i < songs.size(); ++i) {
+        indices[i] = static_cast<int>(i);
+    }
+
+    std::vector<SlotEntry> slots = interleave(songs, indices, seed);
+    order.clear();
+    order.reserve(slots.size());
+    for (const auto& slot : slots) {
+        order.push_back(slot.index);
+    }
+
+    separateTitles(songs, order, 0);
+    rebuildPositions(0);
+}
+
+void SmartShuffle::extend(const std::vector<Song>& songs, size_t firstNew, int afterPosition) {
+    if (firstNew >= songs.size()) {
+        return;
+    }
+
+    size_t start = afterPosition < 0 ? 0 : static_cast<size_t>(afterPosition) + 1;
+    if (start > order.size()) {
+        start = order.size();
+    }
+
+    std::vector<int> newIndices;
+    for (size_t i = firstNew; i < songs.size(); ++i) {
+        newIndices.push_back(static_cast<int>(i));
+    }
+
+    extendCount++;
+    std::vector<SlotEntry> incoming = interleave(songs, newIndices, seed ^ (extendCount * 0x9E3779B97F4A7C15ULL));
+
+    // Existing unplayed songs keep their relative order on an evenly spaced grid,
+    // the new songs are merged into it by their own spread keys
+    size_t tailLength = order.size() - start;
+    std::vector<int> merged;
+    merged.reserve(tailLength + incoming.size());
+
+    size_t t = 0;
+    size_t n = 0;
+    while (t < tailLength || n < incoming.size()) {
+        double tailKey = t < tailLength ? (t + 0.5) / static_cast<double>(tailLength) : 2.0;
+        if (n < incoming.size() && incoming[n].key < tailKey) {
+            merged.push_back(incoming[n++].index);
+        } else {
+            merged.push_back(order[start + t++]);
+        }
+    }
+
+    order.resize(start);
+    order.insert(order.end(), merged.begin(), merged.end());
+
+    separateTitles(songs, order, start);
+    rebuildPositions(start);
+}
+
+size_t SmartShuffle::size() const {
+    return order.size();
+}
+
+bool SmartShuffle::isEmpty() const {
+    return order.empty();
+}
+
+uint64_t SmartShuffle::getSeed() const {
+    return seed;
+}
+
+int SmartShuffle::indexAt(int position) const {
+    if (position < 0 || position >= static_cast<int>(order.size())) {
+        return -1;
+    }
+    return order[position];
+}
+
+int SmartShuffle::positionOf(int index) const {
+    if (index < 0 || index >= static_cast<int>(positions.size())) {
+        return -1;
+    }
+    return positions[index];
+}
+
+std::string SmartShuffle::artistKey(const Song& song) {
+    std::string lower = song.artist;
+    std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+
+    // Collaborations count towards the main artist
+    const char* separators[] = { " feat.", " feat ", " ft.", " ft ", " vs.", " vs ", " & ", " x ", " cv:", "(cv" };
+    size_t cut = lower.size();
+    for (const char* separator : separators) {
+        size_t pos = lower.find(separator);
+        if (pos != std::string::npos && pos > 0) {
+            cut = (std::min)(cut, pos);
+        }
+    }
+
+    std::string key = normalize(lower.substr(0, cut));
+    return key.empty() ? normalize(lower) : key;
+}
+
+std::string SmartShuffle::titleKey(const Song& song) {
+    std::string lower = song.title;
+    std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+
+    // "Song (TV Size)", "Song [Extended Mix]" and "Song feat. X" are all the same song
+    size_t cut = lower.find_first_of("([");
+    size_t feat = lower.find(" feat");
+    if (feat != std::string::npos && (cut == std::string::npos || feat < cut)) {
+        cut = feat;
+    }
+
+    std::string key = normalize(cut == std::string::npos ? lower : lower.substr(0, cut));
+    return key.empty() ? normalize(lower) : key;
+}
+
+std::vector<SmartShuffle::SlotEntry> SmartShuffle::interleave(const std::vector<Song>& songs, const std::vector<int>& indices, uint64_t bucketSeed) {
+    std::mt19937_64 rng(bucketSeed);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    std::uniform_real_distribution<double> jitter(-0.3, 0.3);
+
+    // Bucket by artist
+    std::unordered_map<std::string, int> bucketOf;
+    std::vector<std::vector<int>> buckets;
+    for (int index : indices) {
+        std::string key = artistKey(songs[index]);
+        auto it = bucketOf.find(key);
+        if (it == bucketOf.end()) {
+            it = bucketOf.emplace(key, static_cast<int>(buckets.size())).first;
+            buckets.emplace_back();
+        }
+        buckets[it->second].push_back(index);
+    }
+
+    // Slot j of a bucket of size c sits at (j + offset + jitter) / c. Jitter stays
+    // below half a slot, so keys inside a bucket are increasing and the merge
+    // only needs the head of each bucket
+    std::vector<double> offsets(buckets.size());
+    for (size_t b = 0; b < buckets.size(); ++b) {
+        std::shuffle(buckets[b].begin(), buckets[b].end(), rng);
+        offsets[b] = unit(rng);
+    }
+
+    auto slotKey = [&](size_t bucket, size_t slot) {
+        return (slot + offsets[bucket] + jitter(rng)) / static_cast<double>(buckets[bucket].size());
+    };
+
+    struct Head {
+        double key;
+        size_t bucket;
+        size_t slot;
+        bool operator>(const Head& other) const { return key > other.key; }
+    };
+    std::priority_queue<Head, std::vector<Head>, std::greater<Head>> heads;
+    for (size_t b = 0; b < buckets.size(); ++b) {
+        heads.push({ slotKey(b, 0), b, 0 });
+    }
+
+    std::vector<SlotEntry> result;
+    result.reserve(indices.size());
+    while (!heads.empty()) {
+        Head head = heads.top();
+        heads.pop();
+        result.push_back({ head.key, buckets[head.bucket][head.slot] });
+
+        if (head.slot + 1 < buckets[head.bucket].size()) {
+            heads.push({ slotKey(head.bucket, head.slot + 1), head.bucket, head.slot + 1 });
+        }
+    }
+
+    return result;
+}
+
+void SmartShuffle::separateTitles(const std::vector<Song>& songs, std::vector<int>& sequence, size_t begin) {
+    const size_t window = 16;
+    std::hash<std::string> hasher;
+
+    std::unordered_map<int, std::pair<size_t, size_t>> keyCache;
+    auto keysOf = [&](int index) {
+        auto it = keyCache.find(index);
+        if (it == keyCache.end()) {
+            it = keyCache.emplace(index, std::make_pair(hasher(artistKey(songs[index])), hasher(titleKey(songs[index])))).first;
+        }
+        return it->second;
+    };
+    auto clashes = [&](int a, int b) {
+        auto keysA = keysOf(a);
+        auto keysB = keysOf(b);
+        return keysA.first == keysB.first || keysA.second == keysB.second;
+    };
+
+    for (size_t i = (std::max)(begin, size_t(1)); i < sequence.size(); ++i) {
+        if (!clashes(sequence[i - 1], sequence[i])) {
+            continue;
+        }
+
+        // Pull the nearest later song that fits between its neighbours
+        size_t limit = (std::min)(sequence.size(), i + window);
+        for (size_t j = i + 1; j < limit; ++j) {
+            if (!clashes(sequence[i - 1], sequence[j])) {
+                std::swap(sequence[i], sequence[j]);
+                break;
+            }
+        }
+    }
+}
+
+std::string SmartShuffle::normalize(const std::string& input) {
+    std::string result;
+    result.reserve(input.size());
+    for (unsigned char c : input) {
+        // Keep non-ASCII bytes so Japanese titles still compare meaningfully
+        if (std::isalnum(c) || c >= 0x80) {
+            result.push_back(static_cast<char>(c));
+        }
+    }
+    return result;
+}
+
+void SmartShuffle::rebuildPositions(size_t begin) {
+    positions.resize(order.size(), -1);
+    for (size_t i = begin; i < order.size(); ++i) {
+        positions[order[i]] = static_cast<int>(i);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,87 @@
+#include "../headers/streamBuffer.hpp"
+#include <algorithm>
+#include <cstring>
+
+StreamBuffer::StreamBuffer() : capacityFrames(0), channels(0), readFrame(0), writeFrame(0) {}
+
+void StreamBuffer::reset(size_t frames, unsigned int channelCount) {
+    if (frames != capacityFrames || channelCount != channels) {
+        capacityFrames = frames;
+        channels = channelCount;
+        samples.assign(capacityFrames * channels, 0.0f);
+        samples.shrink_to_fit();
+    }
+    clear();
+}
+
+void StreamBuffer::clear() {
+    readFrame.store(0, std::memory_order_relaxed);
+    writeFrame.store(0, std::memory_order_release);
+}
+
+size_t StreamBuffer::write(const float* frames, size_t frameCount) {
+    uint64_t position = writeFrame.load(std::memory_order_relaxed);
+    size_t used = static_cast<size_t>(position - readFrame.load(std::memory_order_acquire));
+    frameCount = (std::min)(frameCount, capacityFrames - used);
+    if (frameCount == 0) {
+        return 0;
+    }
+
+    // At most two copies: up to the end of the ring, then from its start
+    size_t start = static_cast<size_t>(position % capacityFrames);
+    size_t first = (std::min)(frameCount, capacityFrames - start);
+    std::memcpy(samples.data() + start * channels, frames, first * channels * sizeof(float));
+    std::memcpy(samples.data(), frames + first * channels, (frameCount - first) * channels * sizeof(float));
+
+    writeFrame.store(position + frameCount, std::memory_order_release);
+    return frameCount;
+}
+
+size_t StreamBuffer::read(float* frames, size_t frameCount) {
+    uint64_t position = readFrame.load(std::memory_order_relaxed);
+    size_t ready = static_cast<size_t>(writeFrame.load(std::memory_order_acquire) - position);
+    frameCount = (std::min)(frameCount, ready);
+    if (frameCount == 0) {
+        return 0;
+    }
+
+    size_t start = static_cast<size_t>(position % capacityFrames);
+    size_t first = (std::min)(frameCount, capacityFrames - start);
+    std::memcpy(frames, samples.data() + start * channels, first * channels * sizeof(float));
+    std::memcpy(frames + first * channels, samples.data(), (frameCount - first) * channels * sizeof(float));
+
+    readFrame.store(position + frameCount, std::memory_order_release);
+    return frameCount;
+}
+
+size_t StreamBuffer::available() const {
+    uint64_t position = readFrame.load(std::memory_order_acquire);
+    return static_cast<size_t>(writeFrame.load(std::memory_order_acquire) - position);
+}
+
+size_t StreamBuffer::space() const {
+    return capacityFrames - available();
+}
+
+size_t StreamBuffer::capacity() const {
+    return capacityFrames;
+}
+
+size_t StreamBuffer::memoryBytes() const {
+    return samples.capacity() * sizeof(float);
+}
+
+uint64_t StreamBuffer::readPosition() const {
+    return readFrame.load(std::memory_order_acquire);
+}
+
+uint64_t StreamBuffer::writePosition() const {
+    return writeFrame.load(std::memory_order_acquire);
+}
+
+void StreamBuffer::skipTo(uint64_t position) {
+    uint64_t current = readFrame.load(std::memory_order_relaxed);
+    if (position > current && position <= writeFrame.load(std::memory_order_acquire)) {
+        readFrame.store(position, std::memory_order_release);
+    }
+}
\ No newline at end of file
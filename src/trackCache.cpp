@@ -0,0 +1,222 @@
+#include "../headers/trackCache.hpp"
+#include <algorithm>
+#include <cstring>
+
+TrackCache::TrackCache()
+    : budgetBytes(static_cast<size_t>(DEFAULT_BUDGET_MB) << 20), usedBytes(0), hits(0), misses(0) {}
+
+TrackCache& TrackCache::getInstance() {
+    static TrackCache instance;
+    return instance;
+}
+
+void TrackCache::setBudgetMB(unsigned int megabytes) {
+    std::lock_guard<std::mutex> lock(mutex);
+    budgetBytes = static_cast<size_t>((std::min)(megabytes, MAX_BUDGET_MB)) << 20;
+    evict();
+}
+
+unsigned int TrackCache::getBudgetMB() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return static_cast<unsigned int>(budgetBytes >> 20);
+}
+
+bool TrackCache::fits(uint64_t bytes) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return bytes > 0 && bytes <= budgetBytes;
+}
+
+std::shared_ptr<CachedTrack> TrackCache::find(const std::string& path) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = entries.find(path);
+    if (it == entries.end()) {
+        misses++;
+        return nullptr;
+    }
+
+    hits++;
+    useOrder.splice(useOrder.begin(), useOrder, it->second);
+    return it->second->second;
+}
+
+void TrackCache::store(const std::string& path, std::shared_ptr<CachedTrack> track) {
+    if (!track) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    size_t bytes = track->memoryBytes();
+    if (bytes > budgetBytes) {
+        return;
+    }
+
+    auto it = entries.find(path);
+    if (it != entries.end()) {
+        usedBytes -= it->second->second->memoryBytes();
+        useOrder.erase(it->second);
+        entries.erase(it);
+    }
+
+    useOrder.emplace_front(path, std::move(track));
+    entries[path] = useOrder.begin();
+    usedBytes += bytes;
+    evict();
+}
+
+void TrackCache::clear() {
+    // Released after the lock, freeing every track can take a moment
+    UseList released;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        released.swap(useOrder);
+        entries.clear();
+        usedBytes = 0;
+    }
+}
+
+uint64_t TrackCache::getHits() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return hits;
+}
+
+uint64_t TrackCache::getMisses() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return misses;
+}
+
+size_t TrackCache::getUsedBytes() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return usedBytes;
+}
+
+size_t TrackCache::getTrackCount() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return entries.size();
+}
+
+std::unique_ptr<AudioBackend> TrackCache::openSource(const std::string& path) {
+    std::shared_ptr<DecodedTrack> cached = std::dynamic_pointer_cast<DecodedTrack>(find(path));
+    if (cached) {
+        return std::unique_ptr<AudioBackend>(new MemorySource(cached));
+    }
+
+    std::unique_ptr<AudioBackend> decoder = AudioBackend::openFile(path);
+    if (!decoder) {
+        return nullptr;
+    }
+
+    // Only worth copying if the whole track can stay
+    uint64_t bytes = decoder->getLengthFrames() * decoder->getFormat().channels * sizeof(float);
+    if (!fits(bytes)) {
+        return decoder;
+    }
+    return std::unique_ptr<AudioBackend>(new CapturingSource(path, std::move(decoder)));
+}
+
+void TrackCache::evict() {
+    while (usedBytes > budgetBytes && !useOrder.empty()) {
+        usedBytes -= useOrder.back().second->memoryBytes();
+        entries.erase(useOrder.back().first);
+        useOrder.pop_back();
+    }
+}
+
+MemorySource::MemorySource(std::shared_ptr<const DecodedTrack> cachedTrack)
+    : track(std::move(cachedTrack)), positionFrames(0) {}
+
+bool MemorySource::open(const std::string&) {
+    positionFrames = 0;
+    return track != nullptr;
+}
+
+size_t MemorySource::decode(float* buffer, size_t frameCount) {
+    uint64_t length = track->getLengthFrames();
+    size_t frames = static_cast<size_t>((std::min)(static_cast<uint64_t>(frameCount), length - positionFrames));
+    std::memcpy(buffer, track->samples.data() + positionFrames * track->format.channels,
+                frames * track->format.channels * sizeof(float));
+    positionFrames += frames;
+    return frames;
+}
+
+bool MemorySource::seek(uint64_t frame) {
+    positionFrames = (std::min)(frame, track->getLengthFrames());
+    return true;
+}
+
+void MemorySource::close() {
+    positionFrames = 0;
+}
+
+AudioFormat MemorySource::getFormat() const {
+    return track->format;
+}
+
+uint64_t MemorySource::getLengthFrames() const {
+    return track->getLengthFrames();
+}
+
+uint64_t MemorySource::getPositionFrames() const {
+    return positionFrames;
+}
+
+CapturingSource::CapturingSource(const std::string& trackPath, std::unique_ptr<AudioBackend> source)
+    : path(trackPath), decoder(std::move(source)), capture(std::make_shared<DecodedTrack>()) {
+    capture->format = decoder->getFormat();
+    // The length of a VBR file may still be an estimate, the vector grows past it if needed
+    capture->samples.reserve(static_cast<size_t>(decoder->getLengthFrames() * capture->format.channels));
+}
+
+bool CapturingSource::open(const std::string& newPath) {
+    capture.reset();
+    return decoder->open(newPath);
+}
+
+size_t CapturingSource::decode(float* buffer, size_t frameCount) {
+    size_t frames = decoder->decode(buffer, frameCount);
+    if (!capture) {
+        return frames;
+    }
+
+    capture->samples.insert(capture->samples.end(), buffer, buffer + frames * capture->format.channels);
+
+    // Complete at the end of the stream. A crossfade stops reading the outgoing
+    // track at its last frame without asking for more, so check the position too
+    if (frames == 0 || decoder->getPositionFrames() >= decoder->getLengthFrames()) {
+        capture->samples.shrink_to_fit();
+        TrackCache::getInstance().store(path, std::move(capture));
+        capture.reset();
+    }
+    return frames;
+}
+
+bool CapturingSource::seek(uint64_t frame) {
+    if (capture) {
+        if (frame == 0) {
+            capture->samples.clear();
+        } else {
+            capture.reset();
+        }
+    }
+    return decoder->seek(frame);
+}
+
+void CapturingSource::close() {
+    capture.reset();
+    decoder->close();
+}
+
+void CapturingSource::prepareSeeking() {
+    decoder->prepareSeeking();
+}
+
+AudioFormat CapturingSource::getFormat() const {
+    return decoder->getFormat();
+}
+
+uint64_t CapturingSource::getLengthFrames() const {
+    return decoder->getLengthFrames();
+}
+
+uint64_t CapturingSource::getPositionFrames() const {
+    return decoder->getPositionFrames();
+}
\ No newline at end of file
@@ -0,0 +1,324 @@
+#include "../headers/visualizer.hpp"
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#ifndef ENABLE_VIRTUAL_TERMINAL_PROCESSING
+#define ENABLE_VIRTUAL_TERMINAL_PROCESSING 0x0004
+#endif
+#endif
+
+namespace {
+    const double PI = 3.14159265358979323846;
+    // Frequency range of the bars
+    const float MIN_HZ = 40.0f;
+    const float MAX_HZ = 16000.0f;
+    // Bottom of the bars and of the meters, the tops are full scale
+    const float FLOOR_DB = -72.0f;
+    const float METER_FLOOR_DB = -60.0f;
+    const float FALL_DB_PER_SECOND = 36.0f;
+    const size_t METER_WIDTH = 52;
+
+    const char32_t FULL_BLOCK = 0x2588;
+
+    // Lower eighth blocks for the bars, 1 to 8 eighths
+    char32_t verticalBlock(int eighths) {
+        return eighths <= 0 ? U' ' : static_cast<char32_t>(0x2580 + (std::min)(eighths, 8));
+    }
+
+    // Left eighth blocks for the meters
+    char32_t horizontalBlock(int eighths) {
+        return eighths <= 0 ? U' ' : eighths >= 8 ? FULL_BLOCK : static_cast<char32_t>(0x2590 - eighths);
+    }
+
+    void appendUtf8(std::string& out, char32_t c) {
+        if (c < 0x80) {
+            out += static_cast<char>(c);
+        } else if (c < 0x800) {
+            out += static_cast<char>(0xC0 | (c >> 6));
+            out += static_cast<char>(0x80 | (c & 0x3F));
+        } else {
+            out += static_cast<char>(0xE0 | (c >> 12));
+            out += static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (c & 0x3F));
+        }
+    }
+
+    void putText(std::u32string& row, size_t column, const std::string& text) {
+        for (size_t i = 0; i < text.size() && column + i < row.size(); ++i) {
+            row[column + i] = static_cast<char32_t>(static_cast<unsigned char>(text[i]));
+        }
+    }
+
+    float toDb(float power) {
+        return 10.0f * std::log10(power + 1e-20f);
+    }
+}
+
+Visualizer::Visualizer(const AnalysisTap& source)
+    : tap(source), fft(FFT_SIZE), window(FFT_SIZE), left(FFT_SIZE), right(FFT_SIZE), mono(FFT_SIZE), power(FFT_SIZE / 2 + 1),
+      layoutRate(0), cpuPercent(0.0), running(false) {
+    for (size_t i = 0; i < FFT_SIZE; ++i) {
+        window[i] = static_cast<float>(0.5 - 0.5 * std::cos(2.0 * PI * static_cast<double>(i) / static_cast<double>(FFT_SIZE)));
+    }
+    std::fill(bars, bars + BARS, FLOOR_DB);
+    meters[0] = meters[1] = METER_FLOOR_DB;
+}
+
+Visualizer::~Visualizer() {
+    stop();
+}
+
+void Visualizer::start() {
+    if (running.load()) {
+        return;
+    }
+#ifdef _WIN32
+    // Let the console take escape sequences and the block characters
+    HANDLE console = GetStdHandle(STD_OUTPUT_HANDLE);
+    DWORD mode = 0;
+    if (GetConsoleMode(console, &mode)) {
+        SetConsoleMode(console, mode | ENABLE_VIRTUAL_TERMINAL_PROCESSING);
+    }
+    SetConsoleOutputCP(CP_UTF8);
+#endif
+
+    shown.assign(ROWS, std::u32string(WIDTH, U' '));
+    shownTitle.clear();
+    // Alternate screen without line wrap, the scroll region starts a row below the display
+    std::cout << "\x1b[?1049h\x1b[?7l\x1b[2J\x1b[" << (ROWS + 3) << "r\x1b[" << (ROWS + 3) << ";1H" << std::flush;
+
+    running.store(true);
+    thread = std::thread(&Visualizer::run, this);
+}
+
+void Visualizer::stop() {
+    if (!running.load()) {
+        return;
+    }
+    running.store(false);
+    if (thread.joinable()) {
+        thread.join();
+    }
+    std::cout << "\x1b[r\x1b[?7h\x1b[?1049l" << std::flush;
+}
+
+bool Visualizer::isRunning() const {
+    return running.load();
+}
+
+void Visualizer::setTitle(const std::string& text) {
+    std::lock_guard<std::mutex> lock(titleMutex);
+    title = text;
+}
+
+void Visualizer::run() {
+    const auto framePeriod = std::chrono::microseconds(1000000 / FRAMES_PER_SECOND);
+    const auto idlePeriod = std::chrono::milliseconds(IDLE_FRAME_MS);
+
+    uint64_t lastWritten = tap.getWritten();
+    auto lastFrame = std::chrono::steady_clock::now();
+    auto next = lastFrame;
+    auto cpuWindowStart = lastFrame;
+    std::chrono::steady_clock::duration busy(0);
+
+    while (running.load()) {
+        auto frameStart = std::chrono::steady_clock::now();
+        float seconds = std::chrono::duration<float>(frameStart - lastFrame).count();
+        lastFrame = frameStart;
+
+        uint64_t written = tap.getWritten();
+        bool moving = analyze(written != lastWritten, seconds);
+        lastWritten = written;
+
+        // The title may hold wide characters, so it isn't diffed by cell
+        std::string out;
+        {
+            std::lock_guard<std::mutex> lock(titleMutex);
+            if (title != shownTitle) {
+                out += "\x1b[1;1H" + title + "\x1b[K";
+                shownTitle = title;
+            }
+        }
+        out += diff(compose());
+        if (!out.empty()) {
+            // One write between saving and restoring the cursor, so typing goes on where it was
+            std::string frame = "\x1b" "7" + out + "\x1b" "8";
+            std::cout.write(frame.data(), static_cast<std::streamsize>(frame.size()));
+            std::cout.flush();
+        }
+
+        auto frameEnd = std::chrono::steady_clock::now();
+        busy += frameEnd - frameStart;
+        if (frameEnd - cpuWindowStart >= std::chrono::seconds(1)) {
+            cpuPercent = 100.0 * std::chrono::duration<double>(busy).count() / std::chrono::duration<double>(frameEnd - cpuWindowStart).count();
+            busy = std::chrono::steady_clock::duration(0);
+            cpuWindowStart = frameEnd;
+        }
+
+        next += moving ? std::chrono::duration_cast<std::chrono::steady_clock::duration>(framePeriod)
+                       : std::chrono::duration_cast<std::chrono::steady_clock::duration>(idlePeriod);
+        if (next < frameEnd) {
+            next = frameEnd; // Fell behind, don't try to catch up with a burst
+        }
+        std::this_thread::sleep_until(next);
+    }
+}
+
+void Visualizer::layout(unsigned int sampleRate) {
+    layoutRate = sampleRate;
+    float binHz = static_cast<float>(sampleRate) / static_cast<float>(FFT_SIZE);
+    float top = (std::min)(MAX_HZ, 0.45f * static_cast<float>(sampleRate));
+    size_t lastBin = FFT_SIZE / 2;
+
+    // Log-spaced edges, every bar gets at least one bin
+    barBins.assign(BARS + 1, 0);
+    for (size_t b = 0; b <= BARS; ++b) {
+        float hz = MIN_HZ * std::pow(top / MIN_HZ, static_cast<float>(b) / static_cast<float>(BARS));
+        barBins[b] = (std::min)(static_cast<size_t>(hz / binHz + 0.5f), lastBin);
+        if (b > 0 && barBins[b] <= barBins[b - 1]) {
+            barBins[b] = (std::min)(barBins[b - 1] + 1, lastBin + 1);
+        }
+    }
+
+    labels.assign(WIDTH, U' ');
+    const float marks[] = { 50.0f, 100.0f, 200.0f, 500.0f, 1000.0f, 2000.0f, 5000.0f, 10000.0f };
+    const char* names[] = { "50", "100", "200", "500", "1k", "2k", "5k", "10k" };
+    size_t freeColumn = 0;
+    for (size_t i = 0; i < sizeof(marks) / sizeof(marks[0]); ++i) {
+        if (marks[i] > top) {
+            break;
+        }
+        size_t bar = static_cast<size_t>(std::log(marks[i] / MIN_HZ) / std::log(top / MIN_HZ) * BARS);
+        size_t column = bar * 2;
+        std::string name = names[i];
+        if (column >= freeColumn && column + name.size() <= WIDTH) {
+            for (size_t c = 0; c < name.size(); ++c) {
+                labels[column + c] = static_cast<char32_t>(name[c]);
+            }
+            freeColumn = column + name.size() + 1;
+        }
+    }
+}
+
+bool Visualizer::analyze(bool fresh, float seconds) {
+    unsigned int sampleRate = tap.getSampleRate();
+    if (sampleRate != layoutRate && sampleRate > 0) {
+        layout(sampleRate);
+    }
+
+    float barLevels[BARS];
+    float meterLevels[2] = { METER_FLOOR_DB, METER_FLOOR_DB };
+    std::fill(barLevels, barLevels + BARS, FLOOR_DB);
+
+    if (fresh) {
+        if (!tap.read(left.data(), right.data(), FFT_SIZE)) {
+            return true; // Overtaken by the writer, keep what is shown
+        }
+
+        double sumLeft = 0.0;
+        double sumRight = 0.0;
+        for (size_t i = 0; i < FFT_SIZE; ++i) {
+            sumLeft += left[i] * left[i];
+            sumRight += right[i] * right[i];
+            mono[i] = 0.5f * (left[i] + right[i]) * window[i];
+        }
+        meterLevels[0] = toDb(static_cast<float>(sumLeft / FFT_SIZE));
+        meterLevels[1] = toDb(static_cast<float>(sumRight / FFT_SIZE));
+
+        // A full-scale sine peaks at N/4 through the Hann window: that is 0 dB
+        fft.powerSpectrum(mono.data(), power.data());
+        const float scale = 16.0f / (static_cast<float>(FFT_SIZE) * static_cast<float>(FFT_SIZE));
+        for (size_t b = 0; b < BARS; ++b) {
+            float loudest = 0.0f;
+            for (size_t k = barBins[b]; k < barBins[b + 1]; ++k) {
+                loudest = (std::max)(loudest, power[k]);
+            }
+            barLevels[b] = toDb(loudest * scale);
+        }
+    }
+
+    // Up at once, down at FALL_DB_PER_SECOND
+    float fall = FALL_DB_PER_SECOND * seconds;
+    bool moving = fresh;
+    for (size_t b = 0; b < BARS; ++b) {
+        bars[b] = (std::max)((std::max)(barLevels[b], bars[b] - fall), FLOOR_DB);
+        moving = moving || bars[b] > FLOOR_DB;
+    }
+    for (int c = 0; c < 2; ++c) {
+        meters[c] = (std::max)((std::max)(meterLevels[c], meters[c] - fall), METER_FLOOR_DB);
+        moving = moving || meters[c] > METER_FLOOR_DB;
+    }
+    return moving;
+}
+
+std::vector<std::u32string> Visualizer::compose() const {
+    std::vector<std::u32string> frame(ROWS, std::u32string(WIDTH, U' '));
+
+    // Rows 1 to HEIGHT: the bars, row 0 stays empty under the title
+    for (size_t b = 0; b < BARS; ++b) {
+        float height = (std::min)(1.0f, (bars[b] - FLOOR_DB) / -FLOOR_DB);
+        int steps = static_cast<int>(height * HEIGHT * 8 + 0.5f);
+        for (size_t row = 0; row < HEIGHT; ++row) {
+            int below = static_cast<int>(HEIGHT - 1 - row) * 8;
+            frame[1 + row][b * 2] = verticalBlock(steps - below);
+        }
+    }
+    frame[HEIGHT + 1] = labels.empty() ? std::u32string(WIDTH, U' ') : labels;
+
+    const char* names[] = { "L ", "R " };
+    for (int c = 0; c < 2; ++c) {
+        std::u32string& row = frame[HEIGHT + 3 + c];
+        putText(row, 0, names[c]);
+        float fill = (std::min)(1.0f, (meters[c] - METER_FLOOR_DB) / -METER_FLOOR_DB);
+        int steps = static_cast<int>(fill * METER_WIDTH * 8 + 0.5f);
+        for (size_t cell = 0; cell < METER_WIDTH; ++cell) {
+            row[2 + cell] = horizontalBlock(steps - static_cast<int>(cell) * 8);
+        }
+        char level[16];
+        if (meters[c] > METER_FLOOR_DB) {
+            std::snprintf(level, sizeof(level), "%6.1f dB", meters[c]);
+        } else {
+            std::snprintf(level, sizeof(level), "   -inf");
+        }
+        putText(row, 3 + METER_WIDTH, level);
+    }
+
+    char status[96];
+    std::snprintf(status, sizeof(status), "Enter: back to the player | FFT %u, %d fps, CPU %.1f%%",
+                  static_cast<unsigned int>(FFT_SIZE), FRAMES_PER_SECOND, cpuPercent);
+    putText(frame[HEIGHT + 6], 0, status);
+    return frame;
+}
+
+std::string Visualizer::diff(const std::vector<std::u32string>& frame) {
+    // Rewrite the span from the first to the last changed cell of each row
+    std::string out;
+    for (size_t row = 0; row < frame.size(); ++row) {
+        const std::u32string& now = frame[row];
+        std::u32string& was = shown[row];
+        size_t first = 0;
+        while (first < WIDTH && now[first] == was[first]) {
+            ++first;
+        }
+        if (first == WIDTH) {
+            continue;
+        }
+        size_t last = WIDTH - 1;
+        while (now[last] == was[last]) {
+            --last;
+        }
+
+        out += "\x1b[" + std::to_string(row + 2) + ";" + std::to_string(first + 1) + "H";
+        for (size_t cell = first; cell <= last; ++cell) {
+            appendUtf8(out, now[cell]);
+        }
+        was = now;
+    }
+    return out;
+}
\ No newline at end of file
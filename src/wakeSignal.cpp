@@ -0,0 +1,24 @@
+#include "../headers/wakeSignal.hpp"
+
+WakeSignal::WakeSignal() : signaled(false) {}
+
+void WakeSignal::notify() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        signaled = true;
+    }
+    condition.notify_one();
+}
+
+void WakeSignal::wait() {
+    std::unique_lock<std::mutex> lock(mutex);
+    condition.wait(lock, [this] { return signaled; });
+    signaled = false;
+}
+
+bool WakeSignal::waitFor(std::chrono::milliseconds timeout) {
+    std::unique_lock<std::mutex> lock(mutex);
+    bool woken = condition.wait_for(lock, timeout, [this] { return signaled; });
+    signaled = false;
+    return woken;
+}
\ No newline at end of file
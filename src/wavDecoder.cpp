@@ -0,0 +1,187 @@
+#include "../headers/wavDecoder.hpp"
+#include <cstring>
+#include <algorithm>
+
+namespace {
+    const uint16_t WAVE_FORMAT_PCM = 0x0001;
+    const uint16_t WAVE_FORMAT_IEEE_FLOAT = 0x0003;
+    const uint16_t WAVE_FORMAT_EXTENSIBLE = 0xFFFE;
+
+    uint16_t readLE16(const unsigned char* p) {
+        return static_cast<uint16_t>(p[0] | (p[1] << 8));
+    }
+
+    uint32_t readLE32(const unsigned char* p) {
+        return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+               (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+    }
+}
+
+WavDecoder::WavDecoder()
+    : formatTag(0), bitsPerSample(0), blockAlign(0), dataOffset(0), lengthFrames(0), positionFrames(0) {}
+
+WavDecoder::~WavDecoder() {
+    close();
+}
+
+bool WavDecoder::probe(const unsigned char* header, size_t size) {
+    return size >= 12 && std::memcmp(header, "RIFF", 4) == 0 && std::memcmp(header + 8, "WAVE", 4) == 0;
+}
+
+bool WavDecoder::open(const std::string& path) {
+    close();
+    file.open(path, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    unsigned char riff[12];
+    if (!file.read(reinterpret_cast<char*>(riff), sizeof(riff)) || !probe(riff, sizeof(riff))) {
+        close();
+        return false;
+    }
+
+    // Walk the chunks until both fmt and data have been seen
+    bool haveFormat = false;
+    uint64_t dataBytes = 0;
+    unsigned char chunkHeader[8];
+    while (file.read(reinterpret_cast<char*>(chunkHeader), sizeof(chunkHeader))) {
+        uint32_t chunkSize = readLE32(chunkHeader + 4);
+        uint64_t chunkStart = static_cast<uint64_t>(file.tellg());
+
+        if (std::memcmp(chunkHeader, "fmt ", 4) == 0 && chunkSize >= 16) {
+            unsigned char fmt[40] = {};
+            file.read(reinterpret_cast<char*>(fmt), (std::min)(chunkSize, uint32_t(sizeof(fmt))));
+
+            formatTag = readLE16(fmt);
+            format.channels = readLE16(fmt + 2);
+            format.sampleRate = readLE32(fmt + 4);
+            blockAlign = readLE16(fmt + 12);
+            bitsPerSample = readLE16(fmt + 14);
+
+            // The real format of an extensible file is the first two bytes of the sub-format GUID
+            if (formatTag == WAVE_FORMAT_EXTENSIBLE && chunkSize >= 26) {
+                formatTag = readLE16(fmt + 24);
+            }
+            haveFormat = true;
+        } else if (std::memcmp(chunkHeader, "data", 4) == 0 && haveFormat) {
+            dataOffset = chunkStart;
+            dataBytes = chunkSize;
+
+            // Streams written without a final size report 0 or 0xFFFFFFFF, use the file size instead
+            file.seekg(0, std::ios::end);
+            uint64_t fileSize = static_cast<uint64_t>(file.tellg());
+            if (dataBytes == 0 || dataBytes == 0xFFFFFFFF || dataOffset + dataBytes > fileSize) {
+                dataBytes = fileSize - dataOffset;
+            }
+            break;
+        }
+
+        // Chunks are word aligned
+        file.clear();
+        file.seekg(static_cast<std::streamoff>(chunkStart + chunkSize + (chunkSize & 1)));
+    }
+
+    bool supported = haveFormat && dataOffset > 0 && format.channels > 0 && format.sampleRate > 0 &&
+                     blockAlign == format.channels * (bitsPerSample / 8) &&
+                     ((formatTag == WAVE_FORMAT_PCM && (bitsPerSample == 8 || bitsPerSample == 16 || bitsPerSample == 24 || bitsPerSample == 32)) ||
+                      (formatTag == WAVE_FORMAT_IEEE_FLOAT && (bitsPerSample == 32 || bitsPerSample == 64)));
+    if (!supported) {
+        close();
+        return false;
+    }
+
+    file.clear();
+    lengthFrames = dataBytes / blockAlign;
+    file.seekg(static_cast<std::streamoff>(dataOffset));
+    positionFrames = 0;
+    return true;
+}
+
+size_t WavDecoder::decode(float* buffer, size_t frameCount) {
+    if (!file.is_open() || positionFrames >= lengthFrames) {
+        return 0;
+    }
+
+    frameCount = static_cast<size_t>((std::min)(static_cast<uint64_t>(frameCount), lengthFrames - positionFrames));
+    size_t bytes = frameCount * blockAlign;
+    if (scratch.size() < bytes) {
+        scratch.resize(bytes);
+    }
+
+    file.read(reinterpret_cast<char*>(scratch.data()), static_cast<std::streamsize>(bytes));
+    size_t frames = static_cast<size_t>(file.gcount()) / blockAlign;
+    size_t samples = frames * format.channels;
+    const unsigned char* in = scratch.data();
+
+    switch (bitsPerSample) {
+        case 8:
+            for (size_t i = 0; i < samples; ++i) {
+                buffer[i] = (static_cast<int>(in[i]) - 128) * (1.0f / 128.0f);
+            }
+            break;
+        case 16:
+            for (size_t i = 0; i < samples; ++i) {
+                buffer[i] = static_cast<int16_t>(readLE16(in + i * 2)) * (1.0f / 32768.0f);
+            }
+            break;
+        case 24:
+            for (size_t i = 0; i < samples; ++i) {
+                const unsigned char* p = in + i * 3;
+                int32_t value = static_cast<int32_t>((static_cast<uint32_t>(p[0]) << 8) | (static_cast<uint32_t>(p[1]) << 16) | (static_cast<uint32_t>(p[2]) << 24)) >> 8;
+                buffer[i] = value * (1.0f / 8388608.0f);
+            }
+            break;
+        case 32:
+            if (formatTag == WAVE_FORMAT_IEEE_FLOAT) {
+                std::memcpy(buffer, in, samples * sizeof(float));
+            } else {
+                for (size_t i = 0; i < samples; ++i) {
+                    buffer[i] = static_cast<float>(static_cast<int32_t>(readLE32(in + i * 4)) * (1.0 / 2147483648.0));
+                }
+            }
+            break;
+        case 64:
+            for (size_t i = 0; i < samples; ++i) {
+                double value;
+                std::memcpy(&value, in + i * 8, sizeof(double));
+                buffer[i] = static_cast<float>(value);
+            }
+            break;
+    }
+
+    positionFrames += frames;
+    return frames;
+}
+
+bool WavDecoder::seek(uint64_t frame) {
+    if (!file.is_open()) {
+        return false;
+    }
+    positionFrames = (std::min)(frame, lengthFrames);
+    file.clear();
+    file.seekg(static_cast<std::streamoff>(dataOffset + positionFrames * blockAlign));
+    return static_cast<bool>(file);
+}
+
+void WavDecoder::close() {
+    if (file.is_open()) {
+        file.close();
+    }
+    file.clear();
+    lengthFrames = 0;
+    positionFrames = 0;
+    dataOffset = 0;
+}
+
+AudioFormat WavDecoder::getFormat() const {
+    return format;
+}
+
+uint64_t WavDecoder::getLengthFrames() const {
+    return lengthFrames;
+}
+
+uint64_t WavDecoder::getPositionFrames() const {
+    return positionFrames;
+}
\ No newline at end of file
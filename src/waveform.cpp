@@ -0,0 +1,102 @@
+#include "../headers/waveform.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    const char* const LOWER_BLOCKS[8] = {
+        "\xE2\x96\x81", "\xE2\x96\x82", "\xE2\x96\x83", "\xE2\x96\x84",
+        "\xE2\x96\x85", "\xE2\x96\x86", "\xE2\x96\x87", "\xE2\x96\x88"
+    };
+    const char* const PLAYHEAD = "\xE2\x94\x82";   // Box drawing vertical line
+
+    int8_t toPeak(float value) {
+        return static_cast<int8_t>(std::lround((std::max)(-1.0f, (std::min)(1.0f, value)) * 127.0f));
+    }
+}
+
+WaveformSummary::WaveformSummary(const AudioFormat& audioFormat)
+    : format(audioFormat), sliceFrames((std::max)(static_cast<size_t>(1), static_cast<size_t>(audioFormat.sampleRate * FINE_SECONDS))),
+      framesInSlice(0) {}
+
+void WaveformSummary::process(const float* frames, size_t frameCount) {
+    if (format.channels == 0) {
+        return;
+    }
+
+    for (size_t i = 0; i < frameCount; ++i) {
+        if (slices.empty() || framesInSlice == sliceFrames) {
+            slices.push_back({ 0.0f, 0.0f, 0.0, 0 });
+            framesInSlice = 0;
+        }
+        Slice& slice = slices.back();
+        for (unsigned int c = 0; c < format.channels; ++c) {
+            float sample = frames[i * format.channels + c];
+            slice.min = (std::min)(slice.min, sample);
+            slice.max = (std::max)(slice.max, sample);
+            slice.squares += static_cast<double>(sample) * sample;
+        }
+        slice.samples += format.channels;
+        framesInSlice++;
+    }
+}
+
+std::vector<WaveformSummary::Bucket> WaveformSummary::getBuckets() const {
+    std::vector<Bucket> buckets;
+    if (slices.empty()) {
+        return buckets;
+    }
+
+    // Short streams repeat slices rather than leave buckets empty
+    size_t count = slices.size();
+    buckets.resize(BUCKETS);
+    for (size_t b = 0; b < BUCKETS; ++b) {
+        size_t first = b * count / BUCKETS;
+        size_t last = (std::max)(first + 1, (b + 1) * count / BUCKETS);
+        float low = 0.0f;
+        float high = 0.0f;
+        double squares = 0.0;
+        size_t samples = 0;
+        for (size_t s = first; s < last; ++s) {
+            low = (std::min)(low, slices[s].min);
+            high = (std::max)(high, slices[s].max);
+            squares += slices[s].squares;
+            samples += slices[s].samples;
+        }
+        double rms = samples > 0 ? std::sqrt(squares / static_cast<double>(samples)) : 0.0;
+        buckets[b].min = toPeak(low);
+        buckets[b].max = toPeak(high);
+        buckets[b].rms = static_cast<uint8_t>(std::lround((std::min)(1.0, rms) * 255.0));
+    }
+    return buckets;
+}
+
+std::string WaveformSummary::render(const std::vector<Bucket>& buckets, size_t width, double played) {
+    std::string out;
+    if (buckets.empty() || width == 0) {
+        return out;
+    }
+
+    std::vector<double> levels(width, 0.0);
+    double loudest = 0.0;
+    for (size_t column = 0; column < width; ++column) {
+        size_t first = column * buckets.size() / width;
+        size_t last = (std::max)(first + 1, (column + 1) * buckets.size() / width);
+        double squares = 0.0;
+        for (size_t b = first; b < last; ++b) {
+            squares += static_cast<double>(buckets[b].rms) * buckets[b].rms;
+        }
+        levels[column] = std::sqrt(squares / static_cast<double>(last - first));
+        loudest = (std::max)(loudest, levels[column]);
+    }
+
+    size_t playhead = played < 0.0 ? width : (std::min)(width - 1, static_cast<size_t>(played * static_cast<double>(width)));
+    for (size_t column = 0; column < width; ++column) {
+        if (column == playhead) {
+            out += PLAYHEAD;
+            continue;
+        }
+        int eighths = loudest > 0.0 ? static_cast<int>(std::lround(levels[column] / loudest * 8.0)) : 0;
+        out += eighths > 0 ? LOWER_BLOCKS[(std::min)(eighths, 8) - 1] : " ";
+    }
+    return out;
+}
\ No newline at end of file
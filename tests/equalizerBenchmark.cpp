@@ -0,0 +1,71 @@
+// CPU the equalizer costs per channel and band: a few seconds of noise per
+// setup, processed in the render thread's 1024-frame blocks, for the channel
+// counts songs come in and one to MAX_BANDS bands. Fails only if the largest
+// setup can't keep up with real time.
+#include "testAudio.hpp"
+#include "../headers/equalizer.hpp"
+#include <chrono>
+#include <iomanip>
+#include <random>
+#include <cmath>
+
+namespace {
+    const unsigned int SAMPLE_RATE = 48000;
+    const unsigned int SECONDS = 4;
+    const size_t BLOCK_FRAMES = 1024;   // What the render thread hands over
+
+    std::vector<EqBand> makeBands(size_t count) {
+        const EqFilter types[] = { EqFilter::LOW_SHELF, EqFilter::PEAK, EqFilter::PEAK, EqFilter::HIGH_SHELF, EqFilter::HIGH_PASS };
+        std::vector<EqBand> bands;
+        for (size_t i = 0; i < count; ++i) {
+            float hz = 40.0f * std::pow(2.0f, static_cast<float>(i));
+            bands.push_back(EqBand(types[i % 5], hz, i % 2 == 0 ? 3.0f : -4.0f, 0.9f));
+        }
+        return bands;
+    }
+
+    // Nanoseconds per channel, band and frame
+    double benchmark(unsigned int channels, size_t bandCount) {
+        std::mt19937 random(1234);
+        std::uniform_real_distribution<float> noise(-0.5f, 0.5f);
+        std::vector<float> samples(static_cast<size_t>(SAMPLE_RATE) * SECONDS * channels);
+        for (float& sample : samples) {
+            sample = noise(random);
+        }
+
+        Equalizer equalizer;
+        equalizer.setBands(makeBands(bandCount), SAMPLE_RATE);
+        // Past the glide to the new bands, so only the steady state is timed
+        std::vector<float> warmup(BLOCK_FRAMES * channels * 4);
+        equalizer.process(warmup.data(), BLOCK_FRAMES * 4, channels);
+
+        size_t frames = samples.size() / channels;
+        auto start = std::chrono::steady_clock::now();
+        for (size_t done = 0; done < frames; done += BLOCK_FRAMES) {
+            equalizer.process(samples.data() + done * channels, (std::min)(BLOCK_FRAMES, frames - done), channels);
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        double perUnit = seconds * 1e9 / (static_cast<double>(frames) * channels * bandCount);
+        double realtime = frames / seconds / SAMPLE_RATE;
+        std::cout << std::setw(2) << channels << " channels, " << std::setw(2) << bandCount << " bands: "
+                  << std::fixed << std::setprecision(2) << perUnit << " ns per channel, band and frame ("
+                  << equalizer.getCostNanos() << " measured by the equalizer), "
+                  << std::setprecision(0) << realtime << "x real time" << std::endl;
+        return realtime;
+    }
+}
+
+int main() {
+    std::cout << "Equalizing " << SECONDS << " s at " << SAMPLE_RATE << " Hz per setup" << std::endl;
+    const unsigned int channelCounts[] = { 1, 2, 6, 8 };
+    const size_t bandCounts[] = { 1, 5, Equalizer::MAX_BANDS };
+    double slowest = 0.0;
+    for (unsigned int channels : channelCounts) {
+        for (size_t bands : bandCounts) {
+            slowest = benchmark(channels, bands);
+        }
+    }
+    testAudio::check(slowest > 1.0, "the equalizer keeps up with real time at 8 channels and 10 bands");
+    return testAudio::failures == 0 ? 0 : 1;
+}
\ No newline at end of file
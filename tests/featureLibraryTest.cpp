@@ -0,0 +1,68 @@
+// Tempo and key analysis of an MP3 next to a WAV of the same piece: A minor
+// chords struck at 128 BPM. The MP3 is analyzed through its decoder and
+// comes out with the tempo and key of the WAV.
+#include "testAudio.hpp"
+#include "mp3TestEncoder.hpp"
+#include "../headers/featureLibrary.hpp"
+#include <thread>
+#include <chrono>
+
+namespace {
+    const AudioFormat FORMAT(44100, 2);
+    const double BPM = 128.0;
+
+    // A3, C4, E4 and A4, each beat a plucked chord over a quiet drone
+    std::vector<float> chords(double seconds) {
+        const double notes[4] = { 220.0, 261.63, 329.63, 440.0 };
+        size_t frames = static_cast<size_t>(seconds * FORMAT.sampleRate);
+        double beatFrames = FORMAT.sampleRate * 60.0 / BPM;
+        std::vector<float> samples(frames * FORMAT.channels);
+        for (size_t i = 0; i < frames; ++i) {
+            double t = static_cast<double>(i) / FORMAT.sampleRate;
+            double sinceBeat = std::fmod(static_cast<double>(i), beatFrames) / FORMAT.sampleRate;
+            double pluck = std::exp(-sinceBeat * 12.0);
+            double value = 0.0;
+            for (double hz : notes) {
+                value += (0.15 * pluck + 0.02) * std::sin(2.0 * testAudio::ToneSource::PI * hz * t);
+            }
+            for (unsigned int c = 0; c < FORMAT.channels; ++c) {
+                samples[i * FORMAT.channels + c] = static_cast<float>(value);
+            }
+        }
+        return samples;
+    }
+}
+
+int main() {
+    using testAudio::check;
+    std::filesystem::path dir = testAudio::scratchDirectory("feature_library_test");
+    std::string mp3Path = (dir / "chords.mp3").string();
+    std::string wavPath = (dir / "chords.wav").string();
+
+    std::vector<float> samples = chords(12.0);
+    if (!mp3TestEncoder::encode(mp3Path, FORMAT, samples) || !testAudio::writeWav(wavPath, FORMAT, samples)) {
+        std::cout << "Could not write the test songs in " << dir.string() << std::endl;
+        return 1;
+    }
+
+    FeatureLibrary library;
+    library.analyze({ mp3Path, wavPath });
+    while (library.isBusy()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    TrackFeatures mp3;
+    TrackFeatures wav;
+    check(library.find(mp3Path, mp3) && mp3.analyzed, "MP3 is analyzed");
+    check(library.find(wavPath, wav) && wav.analyzed, "WAV is analyzed");
+    std::cout << "MP3 " << mp3.bpm << " BPM, " << FeatureLibrary::keyName(mp3.key)
+              << "; WAV " << wav.bpm << " BPM, " << FeatureLibrary::keyName(wav.key) << std::endl;
+    check(!mp3.bpmFromBeatmap && std::fabs(mp3.bpm - BPM) < 2.0, "MP3 tempo is detected");
+    check(std::fabs(mp3.bpm - wav.bpm) < 0.5f, "MP3 tempo matches the WAV's");
+    check(mp3.key == 12 + 9, "MP3 is in A minor");
+    check(mp3.key == wav.key, "MP3 key matches the WAV's");
+
+    library.stop();
+    std::filesystem::remove_all(dir);
+    return testAudio::failures == 0 ? 0 : 1;
+}
\ No newline at end of file
@@ -0,0 +1,87 @@
+// Fingerprints of MP3s: a melody as WAV, as a 128 kbit/s MP3 and as a
+// 64 kbit/s mono MP3 without an Info frame (so it starts late), and a
+// different melody as MP3. The MP3s are fingerprinted through their decoder
+// and the three copies end up in one group, the other melody in none.
+#include "testAudio.hpp"
+#include "mp3TestEncoder.hpp"
+#include "../headers/featureLibrary.hpp"
+#include "../headers/fingerprint.hpp"
+#include "../headers/duplicateIndex.hpp"
+#include <thread>
+#include <chrono>
+
+namespace {
+    const AudioFormat FORMAT(44100, 2);
+    const AudioFormat MONO(44100, 1);
+
+    // Eight notes a second drawn from two octaves of a pentatonic scale, each
+    // with a couple of harmonics and a decay
+    std::vector<float> melody(uint32_t seed, double seconds, unsigned int channels) {
+        const int steps[5] = { 0, 2, 4, 7, 9 };
+        size_t frames = static_cast<size_t>(seconds * FORMAT.sampleRate);
+        size_t noteFrames = FORMAT.sampleRate / 8;
+        std::vector<float> samples(frames * channels);
+        double hz = 0.0;
+        double phase = 0.0;
+        for (size_t i = 0; i < frames; ++i) {
+            if (i % noteFrames == 0) {
+                seed = seed * 1664525u + 1013904223u;
+                int step = steps[(seed >> 16) % 5] + 12 * static_cast<int>((seed >> 24) % 2);
+                hz = 330.0 * std::pow(2.0, step / 12.0);
+            }
+            phase += 2.0 * testAudio::ToneSource::PI * hz / FORMAT.sampleRate;
+            double decay = std::exp(-static_cast<double>(i % noteFrames) / noteFrames * 3.0);
+            float value = static_cast<float>(0.3 * decay * (std::sin(phase) + 0.5 * std::sin(2.0 * phase) + 0.25 * std::sin(3.0 * phase)));
+            for (unsigned int c = 0; c < channels; ++c) {
+                samples[i * channels + c] = value;
+            }
+        }
+        return samples;
+    }
+}
+
+int main() {
+    using testAudio::check;
+    std::filesystem::path dir = testAudio::scratchDirectory("fingerprint_test");
+    std::vector<std::string> paths = {
+        (dir / "song.wav").string(),
+        (dir / "song.mp3").string(),
+        (dir / "song_mono.mp3").string(),
+        (dir / "other.mp3").string()
+    };
+
+    mp3TestEncoder::Options small;
+    small.bitrate = 64;
+    small.infoFrame = false;
+    if (!testAudio::writeWav(paths[0], FORMAT, melody(1, 15.0, 2)) ||
+        !mp3TestEncoder::encode(paths[1], FORMAT, melody(1, 15.0, 2)) ||
+        !mp3TestEncoder::encode(paths[2], MONO, melody(1, 15.0, 1), small) ||
+        !mp3TestEncoder::encode(paths[3], FORMAT, melody(2, 15.0, 2))) {
+        std::cout << "Could not write the test songs in " << dir.string() << std::endl;
+        return 1;
+    }
+
+    FeatureLibrary library;
+    library.analyze(paths);
+    while (library.isBusy()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    DuplicateIndex index;
+    std::vector<std::vector<uint32_t>> fingerprints(paths.size());
+    for (size_t i = 0; i < paths.size(); ++i) {
+        check(library.findFingerprint(paths[i], fingerprints[i]), paths[i] + " is fingerprinted");
+        index.add(static_cast<int>(i + 1), fingerprints[i]);
+    }
+    std::cout << "Bit error rate against the WAV: " << Fingerprinter::bitErrorRate(fingerprints[0], fingerprints[1], 0)
+              << " (MP3), " << Fingerprinter::bitErrorRate(fingerprints[0], fingerprints[3], 0) << " (other MP3)" << std::endl;
+
+    std::vector<std::vector<int>> clusters = index.findClusters();
+    check(clusters.size() == 1, "one group of copies");
+    check(!clusters.empty() && clusters[0] == std::vector<int>({ 1, 2, 3 }), "the WAV and both MP3s of it are one group");
+    check(index.findMatches(fingerprints[3], 4).empty(), "the other melody matches nothing");
+
+    library.stop();
+    std::filesystem::remove_all(dir);
+    return testAudio::failures == 0 ? 0 : 1;
+}
\ No newline at end of file
@@ -0,0 +1,119 @@
+// Two tracks played back to back through the built-in engine must join
+// without a single frame in between: the output is captured unthrottled and
+// has to be exactly the first track followed by the second.
+#include "testAudio.hpp"
+#include "../headers/playbackEngine.hpp"
+#include <thread>
+#include <chrono>
+#include <cmath>
+
+namespace {
+    const AudioFormat FORMAT(44100, 2);
+    const size_t FIRST_FRAMES = 88200 + 123;    // Neither ends on a block or chunk boundary
+    const size_t SECOND_FRAMES = 44100 + 77;
+
+    // Never silent, so a gap of zeros can't hide in the signal
+    std::vector<float> tone(size_t frames, float level, double hz) {
+        std::vector<float> samples(frames * FORMAT.channels);
+        for (size_t i = 0; i < frames; ++i) {
+            float value = level * (1.5f + static_cast<float>(std::sin(2.0 * 3.14159265358979 * hz * i / FORMAT.sampleRate))) / 2.5f;
+            for (unsigned int c = 0; c < FORMAT.channels; ++c) {
+                samples[i * FORMAT.channels + c] = c == 0 ? value : -value;
+            }
+        }
+        return samples;
+    }
+
+    bool waitUntilFinished(PlaybackEngine& engine, bool& switched) {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(20);
+        while (std::chrono::steady_clock::now() < deadline) {
+            switched = engine.takeTrackChange() || switched;
+            if (engine.hasFinished()) {
+                return true;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        return false;
+    }
+}
+
+int main() {
+    using testAudio::check;
+    std::filesystem::path dir = testAudio::scratchDirectory("gapless_test");
+    std::string first = (dir / "first.wav").string();
+    std::string second = (dir / "second.wav").string();
+    std::string capture = (dir / "capture.wav").string();
+
+    std::vector<float> firstSamples = tone(FIRST_FRAMES, 0.5f, 441.0);
+    std::vector<float> secondSamples = tone(SECOND_FRAMES, 0.8f, 1000.0);
+    if (!testAudio::writeWav(first, FORMAT, firstSamples) || !testAudio::writeWav(second, FORMAT, secondSamples)) {
+        std::cout << "Could not write the test tracks in " << dir.string() << std::endl;
+        return 1;
+    }
+
+    // The fast null sink: the switch happens as fast as the engine can go
+    {
+        PlaybackEngine engine;
+        check(engine.setOutput("fast"), "fast null output opens");
+        check(engine.load(AudioBackend::openFile(first)), "first track loads");
+        engine.preloadFile(second);
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        engine.play();
+        bool switched = false;
+        check(waitUntilFinished(engine, switched), "fast null output plays both tracks to the end");
+        check(switched, "fast null output switches to the preloaded track");
+        engine.shutdown();
+    }
+
+    // Same run into an unthrottled capture, to look at every frame of the join
+    {
+        PlaybackEngine engine;
+        check(engine.setOutput("wav", capture), "capture output opens");
+        check(engine.load(AudioBackend::openFile(first)), "first track loads");
+        engine.preloadFile(second);
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        engine.play();
+        bool switched = false;
+        check(waitUntilFinished(engine, switched), "capture plays both tracks to the end");
+        check(switched, "capture switches to the preloaded track");
+        engine.shutdown();
+    }
+
+    AudioFormat captured;
+    std::vector<float> output = testAudio::readWav(capture, captured);
+    check(captured == FORMAT, "capture keeps the tracks' format");
+
+    std::vector<float> expected = firstSamples;
+    expected.insert(expected.end(), secondSamples.begin(), secondSamples.end());
+    size_t outputFrames = output.size() / FORMAT.channels;
+    check(outputFrames >= FIRST_FRAMES + SECOND_FRAMES, "capture holds both tracks");
+
+    // The first frame that differs is where a gap (or anything else) went in
+    size_t mismatch = 0;
+    while (mismatch < expected.size() && mismatch < output.size() && output[mismatch] == expected[mismatch]) {
+        mismatch++;
+    }
+    size_t gapFrames = 0;
+    if (mismatch < expected.size()) {
+        size_t frame = mismatch / FORMAT.channels;
+        while (frame + gapFrames < outputFrames && output[(frame + gapFrames) * FORMAT.channels] == 0.0f) {
+            gapFrames++;
+        }
+        std::cout << "Output differs from the two tracks at frame " << frame << " (first track ends at " << FIRST_FRAMES
+                  << "), " << gapFrames << " silent frames there" << std::endl;
+    }
+    check(mismatch == expected.size(), "output is the first track followed by the second, 0 frames apart");
+
+    // Whatever the sink got after the end has to be silence
+    bool silentTail = true;
+    for (size_t i = expected.size(); i < output.size(); ++i) {
+        silentTail = silentTail && output[i] == 0.0f;
+    }
+    check(silentTail, "nothing but silence after the second track");
+
+    std::filesystem::remove_all(dir);
+    if (testAudio::failures == 0) {
+        std::cout << "Gapless: " << FIRST_FRAMES << " + " << SECOND_FRAMES << " frames joined with a gap of 0 frames" << std::endl;
+    }
+    return testAudio::failures == 0 ? 0 : 1;
+}
\ No newline at end of file
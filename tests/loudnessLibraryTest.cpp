@@ -0,0 +1,62 @@
+// Loudness analysis of an MP3 next to a WAV of the same tone: the MP3 is
+// measured through its decoder, lands within a fraction of a dB of the WAV
+// and gets the same gain, also after a save and load of loudness.bin.
+#include "testAudio.hpp"
+#include "mp3TestEncoder.hpp"
+#include "../headers/loudnessLibrary.hpp"
+#include <thread>
+#include <chrono>
+
+namespace {
+    const AudioFormat FORMAT(44100, 2);
+
+    void waitFor(const LoudnessLibrary& library) {
+        while (library.isBusy()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    }
+}
+
+int main() {
+    using testAudio::check;
+    std::filesystem::path dir = testAudio::scratchDirectory("loudness_library_test");
+    std::string mp3Path = (dir / "tone.mp3").string();
+    std::string wavPath = (dir / "tone.wav").string();
+    std::string libraryPath = (dir / "loudness.bin").string();
+
+    testAudio::ToneSource tone(FORMAT, 1000.0, 0.25f, FORMAT.sampleRate * 4);
+    std::vector<float> toneSamples = testAudio::decodeAll(tone);
+    if (!mp3TestEncoder::encode(mp3Path, FORMAT, toneSamples) || !testAudio::writeWav(wavPath, FORMAT, toneSamples)) {
+        std::cout << "Could not write the test songs in " << dir.string() << std::endl;
+        return 1;
+    }
+
+    LoudnessInfo mp3Info;
+    LoudnessInfo wavInfo;
+    {
+        LoudnessLibrary library;
+        library.analyze({ mp3Path, wavPath });
+        waitFor(library);
+        check(library.isAnalyzed(mp3Path), "MP3 is analyzed");
+        check(library.find(mp3Path, mp3Info) && mp3Info.measured, "MP3 is measured");
+        check(library.find(wavPath, wavInfo) && wavInfo.measured, "WAV is measured");
+        std::cout << "MP3 " << mp3Info.integratedLufs << " LUFS, peak " << mp3Info.truePeak
+                  << "; WAV " << wavInfo.integratedLufs << " LUFS, peak " << wavInfo.truePeak << std::endl;
+        check(std::fabs(mp3Info.integratedLufs - wavInfo.integratedLufs) < 0.2f, "MP3 is as loud as the WAV");
+        check(std::fabs(mp3Info.truePeak - wavInfo.truePeak) < 0.02f, "MP3 peaks like the WAV");
+        check(std::fabs(library.gainFor(mp3Path, GainMode::TRACK) / library.gainFor(wavPath, GainMode::TRACK) - 1.0f) < 0.03f,
+              "MP3 gets the WAV's track gain");
+        check(library.save(libraryPath), "loudness.bin saves");
+    }
+
+    LoudnessLibrary reloaded;
+    check(reloaded.load(libraryPath), "loudness.bin loads");
+    LoudnessInfo loaded;
+    check(reloaded.find(mp3Path, loaded) && loaded.measured && loaded.integratedLufs == mp3Info.integratedLufs,
+          "MP3 measurement survives a reload");
+    reloaded.analyze({ mp3Path });
+    check(!reloaded.isBusy(), "a current MP3 isn't measured again");
+
+    std::filesystem::remove_all(dir);
+    return testAudio::failures == 0 ? 0 : 1;
+}
\ No newline at end of file
@@ -0,0 +1,120 @@
+// The built-in MP3 decoder against the WAV an MP3 was encoded from. The
+// tests' own encoder writes the files: joint stereo with short blocks and
+// the bit reservoir, plain stereo without the reservoir, and MPEG-2 mono.
+// Decoded with the encoder delay and padding trimmed, a file has to be as
+// long as its reference and line up with it sample for sample, within what
+// the quantization costs; a seek has to give exactly what decoding from the
+// start gives at that position.
+#include "testAudio.hpp"
+#include "mp3TestEncoder.hpp"
+#include "../headers/mp3Decoder.hpp"
+
+namespace {
+    const double PI = 3.14159265358979323846;
+    const size_t SEEK_CHECK_FRAMES = 4096;
+
+    // A different chord on each channel, a high partial and a little noise
+    std::vector<float> makeSignal(const AudioFormat& format, size_t frames) {
+        std::vector<float> samples(frames * format.channels);
+        uint32_t seed = 1;
+        for (size_t i = 0; i < frames; ++i) {
+            double t = static_cast<double>(i) / format.sampleRate;
+            for (unsigned int c = 0; c < format.channels; ++c) {
+                seed = seed * 1103515245u + 12345u;
+                double noise = static_cast<double>(seed >> 16) / 32768.0 - 1.0;
+                samples[i * format.channels + c] = static_cast<float>(0.3 * std::sin(2.0 * PI * (440.0 + 110.0 * c) * t) +
+                                                                      0.1 * std::sin(2.0 * PI * 3000.0 * t) + 0.02 * noise);
+            }
+        }
+        return samples;
+    }
+
+    double snrDb(const std::vector<float>& reference, const std::vector<float>& decoded) {
+        double signal = 0.0;
+        double error = 0.0;
+        for (size_t i = 0; i < reference.size() && i < decoded.size(); ++i) {
+            double difference = static_cast<double>(reference[i]) - decoded[i];
+            signal += static_cast<double>(reference[i]) * reference[i];
+            error += difference * difference;
+        }
+        return 10.0 * std::log10(signal / (error + 1e-30));
+    }
+
+    void checkFile(const std::filesystem::path& dir, const std::string& name, const AudioFormat& format,
+                   const mp3TestEncoder::Options& options, double minimumSnr) {
+        using testAudio::check;
+        std::string wavPath = (dir / (name + ".wav")).string();
+        std::string mp3Path = (dir / (name + ".mp3")).string();
+
+        size_t frames = format.sampleRate * 3 + 321;
+        AudioFormat referenceFormat;
+        if (!testAudio::writeWav(wavPath, format, makeSignal(format, frames))) {
+            check(false, name + ": reference WAV is written");
+            return;
+        }
+        std::vector<float> reference = testAudio::readWav(wavPath, referenceFormat);
+        if (!mp3TestEncoder::encode(mp3Path, referenceFormat, reference, options)) {
+            check(false, name + ": MP3 is encoded");
+            return;
+        }
+
+        check(AudioBackend::canDecode(mp3Path), name + ": MP3 is something the built-in path decodes");
+        std::unique_ptr<AudioBackend> decoder = AudioBackend::openFile(mp3Path);
+        if (!decoder) {
+            check(false, name + ": MP3 opens");
+            return;
+        }
+        check(decoder->getFormat().sampleRate == format.sampleRate && decoder->getFormat().channels == format.channels,
+              name + ": format is the reference's");
+        check(decoder->getLengthFrames() == frames, name + ": length is the reference's");
+
+        std::vector<float> decoded = testAudio::decodeAll(*decoder);
+        double snr = snrDb(reference, decoded);
+        std::cout << name << ": " << decoded.size() / format.channels << " of " << frames << " frames, "
+                  << snr << " dB" << std::endl;
+        check(decoded.size() == reference.size(), name + ": decodes to exactly the reference's length");
+        check(snr >= minimumSnr, name + ": close to the reference");
+
+        // Seeks decode the frames before the target again, the samples have to be the same
+        const uint64_t targets[] = { frames / 2, 1, 0, 3 * 1152 + 17, 575, frames - 10, frames / 3 };
+        std::vector<float> chunk(SEEK_CHECK_FRAMES * format.channels);
+        for (uint64_t target : targets) {
+            std::string what = name + ": seek to " + std::to_string(target);
+            check(decoder->seek(target) && decoder->getPositionFrames() == target, what);
+            size_t expected = static_cast<size_t>((std::min)(static_cast<uint64_t>(SEEK_CHECK_FRAMES), frames - target));
+            size_t got = decoder->decode(chunk.data(), SEEK_CHECK_FRAMES);
+            check(got == expected, what + " decodes to the end or a full chunk");
+            check(std::equal(chunk.begin(), chunk.begin() + got * format.channels,
+                             decoded.begin() + target * format.channels), what + " gives the samples decoding from the start did");
+        }
+
+        // Before there is a seek index a seek lands on the estimate from the Info frame's table
+        Mp3Decoder estimated;
+        check(estimated.open(mp3Path) && estimated.hasToc(), name + ": Info frame seek table is read");
+        check(estimated.seekNear(frames / 2) && estimated.getPositionFrames() == frames / 2, name + ": estimated seek");
+        check(estimated.decode(chunk.data(), SEEK_CHECK_FRAMES) == SEEK_CHECK_FRAMES, name + ": decodes after the estimated seek");
+    }
+}
+
+int main() {
+    std::filesystem::path dir = testAudio::scratchDirectory("mp3_decode_test");
+
+    mp3TestEncoder::Options jointStereo;
+    jointStereo.bitrate = 128;
+    jointStereo.midSide = true;
+    jointStereo.shortBlocks = true;
+    checkFile(dir, "joint_stereo", AudioFormat(44100, 2), jointStereo, 25.0);
+
+    mp3TestEncoder::Options stereo;
+    stereo.bitrate = 192;
+    stereo.reservoir = false;
+    checkFile(dir, "stereo", AudioFormat(48000, 2), stereo, 28.0);
+
+    mp3TestEncoder::Options mono;
+    mono.bitrate = 64;
+    mono.shortBlocks = true;
+    checkFile(dir, "mpeg2_mono", AudioFormat(22050, 1), mono, 30.0);
+
+    std::filesystem::remove_all(dir);
+    return testAudio::failures == 0 ? 0 : 1;
+}
\ No newline at end of file
@@ -0,0 +1,84 @@
+// MP3 seek indexes on the decode path. A file without an Info frame only
+// has an estimated length and no seek table: prepareSeeking walks its frame
+// headers, after which the length is exact and seeks through the index give
+// exactly what decoding from the start gives. The walk goes to the
+// SeekIndexCache, so the next open of the file has the index at once, the
+// cache survives a save and load through seek_index.bin, and a file that
+// changed since is walked again.
+#include "testAudio.hpp"
+#include "mp3TestEncoder.hpp"
+#include "../headers/mp3Decoder.hpp"
+#include <chrono>
+
+namespace {
+    const AudioFormat FORMAT(44100, 2);
+    const size_t SAMPLES_PER_FRAME = 1152;
+    const size_t CHECK_FRAMES = 2048;
+
+    void checkSeeks(Mp3Decoder& decoder, const std::vector<float>& decoded, const std::string& what) {
+        const uint64_t targets[] = { 200000, 5, 1152 * 40 + 3, 1152 * 33, 123456, 0 };
+        std::vector<float> chunk(CHECK_FRAMES * FORMAT.channels);
+        for (uint64_t target : targets) {
+            std::string seek = what + ", seek to " + std::to_string(target);
+            testAudio::check(decoder.seek(target) && decoder.getPositionFrames() == target, seek);
+            size_t got = decoder.decode(chunk.data(), CHECK_FRAMES);
+            testAudio::check(got == CHECK_FRAMES && std::equal(chunk.begin(), chunk.end(), decoded.begin() + target * FORMAT.channels),
+                             seek + " gives the samples decoding from the start did");
+        }
+    }
+}
+
+int main() {
+    using testAudio::check;
+    std::filesystem::path dir = testAudio::scratchDirectory("mp3_seek_index_test");
+    std::string path = (dir / "no_info.mp3").string();
+    std::string cachePath = (dir / "seek_index.bin").string();
+
+    std::vector<float> samples(FORMAT.sampleRate * 6 * FORMAT.channels);
+    for (size_t i = 0; i < samples.size(); ++i) {
+        samples[i] = 0.25f * static_cast<float>(std::sin(0.03 * static_cast<double>(i / FORMAT.channels) + (i % 2)));
+    }
+    mp3TestEncoder::Options options;
+    options.infoFrame = false;
+    if (!mp3TestEncoder::encode(path, FORMAT, samples, options)) {
+        std::cout << "Could not write the test file in " << dir.string() << std::endl;
+        return 1;
+    }
+    size_t frames = samples.size() / FORMAT.channels + mp3TestEncoder::ENCODER_DELAY + mp3TestEncoder::DECODER_DELAY;
+    uint64_t exactLength = (frames + SAMPLES_PER_FRAME - 1) / SAMPLES_PER_FRAME * SAMPLES_PER_FRAME;
+
+    // The walk on the first open
+    Mp3Decoder first;
+    check(first.open(path) && !first.hasToc() && !first.hasSeekIndex(), "opens without a seek table or index");
+    first.prepareSeeking();
+    check(first.hasSeekIndex(), "prepareSeeking builds the index");
+    check(first.getLengthFrames() == exactLength, "the walk gives the exact length");
+    std::vector<float> decoded = testAudio::decodeAll(first);
+    check(decoded.size() == exactLength * FORMAT.channels, "decodes to the exact length");
+    checkSeeks(first, decoded, "indexed");
+
+    // The next open finds it in the cache
+    Mp3Decoder second;
+    check(second.open(path) && second.hasSeekIndex(), "the next open has the index from the cache");
+    check(second.getLengthFrames() == exactLength, "and the exact length with it");
+    checkSeeks(second, decoded, "cached");
+
+    // Through seek_index.bin, as from one run to the next
+    check(SeekIndexCache::getInstance().save(cachePath) && std::filesystem::exists(cachePath), "cache is saved");
+    check(SeekIndexCache::getInstance().load(cachePath), "cache is loaded");
+    Mp3Decoder loaded;
+    check(loaded.open(path) && loaded.hasSeekIndex(), "the index survives a save and load");
+
+    // A file that changed since it was indexed is walked again
+    std::filesystem::last_write_time(path, std::filesystem::last_write_time(path) + std::chrono::hours(1));
+    Mp3Decoder changed;
+    check(changed.open(path) && !changed.hasSeekIndex(), "a changed file's index is dropped");
+    check(changed.seek(123456) && changed.hasSeekIndex(), "a seek indexes the changed file again");
+
+    first.close();
+    second.close();
+    loaded.close();
+    changed.close();
+    std::filesystem::remove_all(dir);
+    return testAudio::failures == 0 ? 0 : 1;
+}
\ No newline at end of file
@@ -0,0 +1,940 @@
+#ifndef MP3TESTENCODER_HPP
+#define MP3TESTENCODER_HPP
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include "../headers/audioBackend.hpp"
+
+// A small constant-bitrate Layer III encoder, so the MP3 tests decode files
+// whose source they know. There is no psychoacoustic model: every granule
+// gets the lowest global gain its share of the bits allows and no
+// scalefactors. What it does cover is what the decoder has to get right:
+// every Huffman table and both count1 tables, the bit reservoir, M/S stereo,
+// start, short and stop blocks, MPEG-1 and MPEG-2 frames, and an Info frame
+// with a LAME tag for the gapless trimming.
+namespace mp3TestEncoder {
+    struct Options {
+        unsigned int bitrate;        // kbit/s, one of the Layer III rates of the MPEG version
+        bool midSide;                // Joint stereo with M/S on every frame
+        bool shortBlocks;            // Every eighth granule starts a run of two short blocks
+        bool reservoir;              // Leave unused bytes for the frames after
+        bool infoFrame;              // Frame count, seek table and LAME tag in front of the audio
+
+        Options() : bitrate(128), midSide(false), shortBlocks(false), reservoir(true), infoFrame(true) {}
+    };
+
+    // Samples a decoder outputs before the first one of the song, with the Info frame's delay
+    const unsigned int ENCODER_DELAY = 576;
+    const unsigned int DECODER_DELAY = 529;
+    // Analysis plus synthesis filterbank (481) and one granule of MDCT overlap
+    const unsigned int CODEC_DELAY = 481 + 576;
+
+    const uint16_t CODES_1[4] = {
+        1, 1, 1, 0
+    };
+    const uint8_t LENGTHS_1[4] = {
+        1, 3, 2, 3
+    };
+    const uint16_t CODES_2[9] = {
+        1, 2, 1, 3, 1, 1, 3, 2, 0
+    };
+    const uint8_t LENGTHS_2[9] = {
+        1, 3, 6, 3, 3, 5, 5, 5, 6
+    };
+    const uint16_t CODES_3[9] = {
+        3, 2, 1, 1, 1, 1, 3, 2, 0
+    };
+    const uint8_t LENGTHS_3[9] = {
+        2, 2, 6, 3, 2, 5, 5, 5, 6
+    };
+    const uint16_t CODES_5[16] = {
+        1, 2, 6, 5, 3, 1, 4, 4, 7, 5, 7, 1, 6, 1, 1, 0
+    };
+    const uint8_t LENGTHS_5[16] = {
+        1, 3, 6, 7, 3, 3, 6, 7, 6, 6, 7, 8, 7, 6, 7, 8
+    };
+    const uint16_t CODES_6[16] = {
+        7, 3, 5, 1, 6, 2, 3, 2, 5, 4, 4, 1, 3, 3, 2, 0
+    };
+    const uint8_t LENGTHS_6[16] = {
+        3, 3, 5, 7, 3, 2, 4, 5, 4, 4, 5, 6, 6, 5, 6, 7
+    };
+    const uint16_t CODES_7[36] = {
+        1, 2, 10, 19, 16, 10, 3, 3, 7, 10, 5, 3, 11, 4, 13, 17,
+        8, 4, 12, 11, 18, 15, 11, 2, 7, 6, 9, 14, 3, 1, 6, 4,
+        5, 3, 2, 0
+    };
+    const uint8_t LENGTHS_7[36] = {
+        1, 3, 6, 8, 8, 9, 3, 4, 6, 7, 7, 8, 6, 5, 7, 8,
+        8, 9, 7, 7, 8, 9, 9, 9, 7, 7, 8, 9, 9, 10, 8, 8,
+        9, 10, 10, 10
+    };
+    const uint16_t CODES_8[36] = {
+        3, 4, 6, 18, 12, 5, 5, 1, 2, 16, 9, 3, 7, 3, 5, 14,
+        7, 3, 19, 17, 15, 13, 10, 4, 13, 5, 8, 11, 5, 1, 12, 4,
+        4, 1, 1, 0
+    };
+    const uint8_t LENGTHS_8[36] = {
+        2, 3, 6, 8, 8, 9, 3, 2, 4, 8, 8, 8, 6, 4, 6, 8,
+        8, 9, 8, 8, 8, 9, 9, 10, 8, 7, 8, 9, 10, 10, 9, 8,
+        9, 9, 11, 11
+    };
+    const uint16_t CODES_9[36] = {
+        7, 5, 9, 14, 15, 7, 6, 4, 5, 5, 6, 7, 7, 6, 8, 8,
+        8, 5, 15, 6, 9, 10, 5, 1, 11, 7, 9, 6, 4, 1, 14, 4,
+        6, 2, 6, 0
+    };
+    const uint8_t LENGTHS_9[36] = {
+        3, 3, 5, 6, 8, 9, 3, 3, 4, 5, 6, 8, 4, 4, 5, 6,
+        7, 8, 6, 5, 6, 7, 7, 8, 7, 6, 7, 7, 8, 9, 8, 7,
+        8, 8, 9, 9
+    };
+    const uint16_t CODES_10[64] = {
+        1, 2, 10, 23, 35, 30, 12, 17, 3, 3, 8, 12, 18, 21, 12, 7,
+        11, 9, 15, 21, 32, 40, 19, 6, 14, 13, 22, 34, 46, 23, 18, 7,
+        20, 19, 33, 47, 27, 22, 9, 3, 31, 22, 41, 26, 21, 20, 5, 3,
+        14, 13, 10, 11, 16, 6, 5, 1, 9, 8, 7, 8, 4, 4, 2, 0
+    };
+    const uint8_t LENGTHS_10[64] = {
+        1, 3, 6, 8, 9, 9, 9, 10, 3, 4, 6, 7, 8, 9, 8, 8,
+        6, 6, 7, 8, 9, 10, 9, 9, 7, 7, 8, 9, 10, 10, 9, 10,
+        8, 8, 9, 10, 10, 10, 10, 10, 9, 9, 10, 10, 11, 11, 10, 11,
+        8, 8, 9, 10, 10, 10, 11, 11, 9, 8, 9, 10, 10, 11, 11, 11
+    };
+    const uint16_t CODES_11[64] = {
+        3, 4, 10, 24, 34, 33, 21, 15, 5, 3, 4, 10, 32, 17, 11, 10,
+        11, 7, 13, 18, 30, 31, 20, 5, 25, 11, 19, 59, 27, 18, 12, 5,
+        35, 33, 31, 58, 30, 16, 7, 5, 28, 26, 32, 19, 17, 15, 8, 14,
+        14, 12, 9, 13, 14, 9, 4, 1, 11, 4, 6, 6, 6, 3, 2, 0
+    };
+    const uint8_t LENGTHS_11[64] = {
+        2, 3, 5, 7, 8, 9, 8, 9, 3, 3, 4, 6, 8, 8, 7, 8,
+        5, 5, 6, 7, 8, 9, 8, 8, 7, 6, 7, 9, 8, 10, 8, 9,
+        8, 8, 8, 9, 9, 10, 9, 10, 8, 8, 9, 10, 10, 11, 10, 11,
+        8, 7, 7, 8, 9, 10, 10, 10, 8, 7, 8, 9, 10, 10, 10, 10
+    };
+    const uint16_t CODES_12[64] = {
+        9, 6, 16, 33, 41, 39, 38, 26, 7, 5, 6, 9, 23, 16, 26, 11,
+        17, 7, 11, 14, 21, 30, 10, 7, 17, 10, 15, 12, 18, 28, 14, 5,
+        32, 13, 22, 19, 18, 16, 9, 5, 40, 17, 31, 29, 17, 13, 4, 2,
+        27, 12, 11, 15, 10, 7, 4, 1, 27, 12, 8, 12, 6, 3, 1, 0
+    };
+    const uint8_t LENGTHS_12[64] = {
+        4, 3, 5, 7, 8, 9, 9, 9, 3, 3, 4, 5, 7, 7, 8, 8,
+        5, 4, 5, 6, 7, 8, 7, 8, 6, 5, 6, 6, 7, 8, 8, 8,
+        7, 6, 7, 7, 8, 8, 8, 9, 8, 7, 8, 8, 8, 9, 8, 9,
+        8, 7, 7, 8, 8, 9, 9, 10, 9, 8, 8, 9, 9, 9, 9, 10
+    };
+    const uint16_t CODES_13[256] = {
+        1, 5, 14, 21, 34, 51, 46, 71, 42, 52, 68, 52, 67, 44, 43, 19,
+        3, 4, 12, 19, 31, 26, 44, 33, 31, 24, 32, 24, 31, 35, 22, 14,
+        15, 13, 23, 36, 59, 49, 77, 65, 29, 40, 30, 40, 27, 33, 42, 16,
+        22, 20, 37, 61, 56, 79, 73, 64, 43, 76, 56, 37, 26, 31, 25, 14,
+        35, 16, 60, 57, 97, 75, 114, 91, 54, 73, 55, 41, 48, 53, 23, 24,
+        58, 27, 50, 96, 76, 70, 93, 84, 77, 58, 79, 29, 74, 49, 41, 17,
+        47, 45, 78, 74, 115, 94, 90, 79, 69, 83, 71, 50, 59, 38, 36, 15,
+        72, 34, 56, 95, 92, 85, 91, 90, 86, 73, 77, 65, 51, 44, 43, 42,
+        43, 20, 30, 44, 55, 78, 72, 87, 78, 61, 46, 54, 37, 30, 20, 16,
+        53, 25, 41, 37, 44, 59, 54, 81, 66, 76, 57, 54, 37, 18, 39, 11,
+        35, 33, 31, 57, 42, 82, 72, 80, 47, 58, 55, 21, 22, 26, 38, 22,
+        53, 25, 23, 38, 70, 60, 51, 36, 55, 26, 34, 23, 27, 14, 9, 7,
+        34, 32, 28, 39, 49, 75, 30, 52, 48, 40, 52, 28, 18, 17, 9, 5,
+        45, 21, 34, 64, 56, 50, 49, 45, 31, 19, 12, 15, 10, 7, 6, 3,
+        48, 23, 20, 39, 36, 35, 53, 21, 16, 23, 13, 10, 6, 1, 4, 2,
+        16, 15, 17, 27, 25, 20, 29, 11, 17, 12, 16, 8, 1, 1, 0, 1
+    };
+    const uint8_t LENGTHS_13[256] = {
+        1, 4, 6, 7, 8, 9, 9, 10, 9, 10, 11, 11, 12, 12, 13, 13,
+        3, 4, 6, 7, 8, 8, 9, 9, 9, 9, 10, 10, 11, 12, 12, 12,
+        6, 6, 7, 8, 9, 9, 10, 10, 9, 10, 10, 11, 11, 12, 13, 13,
+        7, 7, 8, 9, 9, 10, 10, 10, 10, 11, 11, 11, 11, 12, 13, 13,
+        8, 7, 9, 9, 10, 10, 11, 11, 10, 11, 11, 12, 12, 13, 13, 14,
+        9, 8, 9, 10, 10, 10, 11, 11, 11, 11, 12, 11, 13, 13, 14, 14,
+        9, 9, 10, 10, 11, 11, 11, 11, 11, 12, 12, 12, 13, 13, 14, 14,
+        10, 9, 10, 11, 11, 11, 12, 12, 12, 12, 13, 13, 13, 14, 16, 16,
+        9, 8, 9, 10, 10, 11, 11, 12, 12, 12, 12, 13, 13, 14, 15, 15,
+        10, 9, 10, 10, 11, 11, 11, 13, 12, 13, 13, 14, 14, 14, 16, 15,
+        10, 10, 10, 11, 11, 12, 12, 13, 12, 13, 14, 13, 14, 15, 16, 17,
+        11, 10, 10, 11, 12, 12, 12, 12, 13, 13, 13, 14, 15, 15, 15, 16,
+        11, 11, 11, 12, 12, 13, 12, 13, 14, 14, 15, 15, 15, 16, 16, 16,
+        12, 11, 12, 13, 13, 13, 14, 14, 14, 14, 14, 15, 16, 15, 16, 16,
+        13, 12, 12, 13, 13, 13, 15, 14, 14, 17, 15, 15, 15, 17, 16, 16,
+        12, 12, 13, 14, 14, 14, 15, 14, 15, 15, 16, 16, 19, 18, 19, 16
+    };
+    const uint16_t CODES_15[256] = {
+        7, 12, 18, 53, 47, 76, 124, 108, 89, 123, 108, 119, 107, 81, 122, 63,
+        13, 5, 16, 27, 46, 36, 61, 51, 42, 70, 52, 83, 65, 41, 59, 36,
+        19, 17, 15, 24, 41, 34, 59, 48, 40, 64, 50, 78, 62, 80, 56, 33,
+        29, 28, 25, 43, 39, 63, 55, 93, 76, 59, 93, 72, 54, 75, 50, 29,
+        52, 22, 42, 40, 67, 57, 95, 79, 72, 57, 89, 69, 49, 66, 46, 27,
+        77, 37, 35, 66, 58, 52, 91, 74, 62, 48, 79, 63, 90, 62, 40, 38,
+        125, 32, 60, 56, 50, 92, 78, 65, 55, 87, 71, 51, 73, 51, 70, 30,
+        109, 53, 49, 94, 88, 75, 66, 122, 91, 73, 56, 42, 64, 44, 21, 25,
+        90, 43, 41, 77, 73, 63, 56, 92, 77, 66, 47, 67, 48, 53, 36, 20,
+        71, 34, 67, 60, 58, 49, 88, 76, 67, 106, 71, 54, 38, 39, 23, 15,
+        109, 53, 51, 47, 90, 82, 58, 57, 48, 72, 57, 41, 23, 27, 62, 9,
+        86, 42, 40, 37, 70, 64, 52, 43, 70, 55, 42, 25, 29, 18, 11, 11,
+        118, 68, 30, 55, 50, 46, 74, 65, 49, 39, 24, 16, 22, 13, 14, 7,
+        91, 44, 39, 38, 34, 63, 52, 45, 31, 52, 28, 19, 14, 8, 9, 3,
+        123, 60, 58, 53, 47, 43, 32, 22, 37, 24, 17, 12, 15, 10, 2, 1,
+        71, 37, 34, 30, 28, 20, 17, 26, 21, 16, 10, 6, 8, 6, 2, 0
+    };
+    const uint8_t LENGTHS_15[256] = {
+        3, 4, 5, 7, 7, 8, 9, 9, 9, 10, 10, 11, 11, 11, 12, 13,
+        4, 3, 5, 6, 7, 7, 8, 8, 8, 9, 9, 10, 10, 10, 11, 11,
+        5, 5, 5, 6, 7, 7, 8, 8, 8, 9, 9, 10, 10, 11, 11, 11,
+        6, 6, 6, 7, 7, 8, 8, 9, 9, 9, 10, 10, 10, 11, 11, 11,
+        7, 6, 7, 7, 8, 8, 9, 9, 9, 9, 10, 10, 10, 11, 11, 11,
+        8, 7, 7, 8, 8, 8, 9, 9, 9, 9, 10, 10, 11, 11, 11, 12,
+        9, 7, 8, 8, 8, 9, 9, 9, 9, 10, 10, 10, 11, 11, 12, 12,
+        9, 8, 8, 9, 9, 9, 9, 10, 10, 10, 10, 10, 11, 11, 11, 12,
+        9, 8, 8, 9, 9, 9, 9, 10, 10, 10, 10, 11, 11, 12, 12, 12,
+        9, 8, 9, 9, 9, 9, 10, 10, 10, 11, 11, 11, 11, 12, 12, 12,
+        10, 9, 9, 9, 10, 10, 10, 10, 10, 11, 11, 11, 11, 12, 13, 12,
+        10, 9, 9, 9, 10, 10, 10, 10, 11, 11, 11, 11, 12, 12, 12, 13,
+        11, 10, 9, 10, 10, 10, 11, 11, 11, 11, 11, 11, 12, 12, 13, 13,
+        11, 10, 10, 10, 10, 11, 11, 11, 11, 12, 12, 12, 12, 12, 13, 13,
+        12, 11, 11, 11, 11, 11, 11, 11, 12, 12, 12, 12, 13, 13, 12, 13,
+        12, 11, 11, 11, 11, 11, 11, 12, 12, 12, 12, 12, 13, 13, 13, 13
+    };
+    const uint16_t CODES_16[256] = {
+        1, 5, 14, 44, 74, 63, 110, 93, 172, 149, 138, 242, 225, 195, 376, 17,
+        3, 4, 12, 20, 35, 62, 53, 47, 83, 75, 68, 119, 201, 107, 207, 9,
+        15, 13, 23, 38, 67, 58, 103, 90, 161, 72, 127, 117, 110, 209, 206, 16,
+        45, 21, 39, 69, 64, 114, 99, 87, 158, 140, 252, 212, 199, 387, 365, 26,
+        75, 36, 68, 65, 115, 101, 179, 164, 155, 264, 246, 226, 395, 382, 362, 9,
+        66, 30, 59, 56, 102, 185, 173, 265, 142, 253, 232, 400, 388, 378, 445, 16,
+        111, 54, 52, 100, 184, 178, 160, 133, 257, 244, 228, 217, 385, 366, 715, 10,
+        98, 48, 91, 88, 165, 157, 148, 261, 248, 407, 397, 372, 380, 889, 884, 8,
+        85, 84, 81, 159, 156, 143, 260, 249, 427, 401, 392, 383, 727, 713, 708, 7,
+        154, 76, 73, 141, 131, 256, 245, 426, 406, 394, 384, 735, 359, 710, 352, 11,
+        139, 129, 67, 125, 247, 233, 229, 219, 393, 743, 737, 720, 885, 882, 439, 4,
+        243, 120, 118, 115, 227, 223, 396, 746, 742, 736, 721, 712, 706, 223, 436, 6,
+        202, 224, 222, 218, 216, 389, 386, 381, 364, 888, 443, 707, 440, 437, 1728, 4,
+        747, 211, 210, 208, 370, 379, 734, 723, 714, 1735, 883, 877, 876, 3459, 865, 2,
+        377, 369, 102, 187, 726, 722, 358, 711, 709, 866, 1734, 871, 3458, 870, 434, 0,
+        12, 10, 7, 11, 10, 17, 11, 9, 13, 12, 10, 7, 5, 3, 1, 3
+    };
+    const uint8_t LENGTHS_16[256] = {
+        1, 4, 6, 8, 9, 9, 10, 10, 11, 11, 11, 12, 12, 12, 13, 9,
+        3, 4, 6, 7, 8, 9, 9, 9, 10, 10, 10, 11, 12, 11, 12, 8,
+        6, 6, 7, 8, 9, 9, 10, 10, 11, 10, 11, 11, 11, 12, 12, 9,
+        8, 7, 8, 9, 9, 10, 10, 10, 11, 11, 12, 12, 12, 13, 13, 10,
+        9, 8, 9, 9, 10, 10, 11, 11, 11, 12, 12, 12, 13, 13, 13, 9,
+        9, 8, 9, 9, 10, 11, 11, 12, 11, 12, 12, 13, 13, 13, 14, 10,
+        10, 9, 9, 10, 11, 11, 11, 11, 12, 12, 12, 12, 13, 13, 14, 10,
+        10, 9, 10, 10, 11, 11, 11, 12, 12, 13, 13, 13, 13, 15, 15, 10,
+        10, 10, 10, 11, 11, 11, 12, 12, 13, 13, 13, 13, 14, 14, 14, 10,
+        11, 10, 10, 11, 11, 12, 12, 13, 13, 13, 13, 14, 13, 14, 13, 11,
+        11, 11, 10, 11, 12, 12, 12, 12, 13, 14, 14, 14, 15, 15, 14, 10,
+        12, 11, 11, 11, 12, 12, 13, 14, 14, 14, 14, 14, 14, 13, 14, 11,
+        12, 12, 12, 12, 12, 13, 13, 13, 13, 15, 14, 14, 14, 14, 16, 11,
+        14, 12, 12, 12, 13, 13, 14, 14, 14, 16, 15, 15, 15, 17, 15, 11,
+        13, 13, 11, 12, 14, 14, 13, 14, 14, 15, 16, 15, 17, 15, 14, 11,
+        9, 8, 8, 9, 9, 10, 10, 10, 11, 11, 11, 11, 11, 11, 11, 8
+    };
+    const uint16_t CODES_24[256] = {
+        15, 13, 46, 80, 146, 262, 248, 434, 426, 669, 653, 649, 621, 517, 1032, 88,
+        14, 12, 21, 38, 71, 130, 122, 216, 209, 198, 327, 345, 319, 297, 279, 42,
+        47, 22, 41, 74, 68, 128, 120, 221, 207, 194, 182, 340, 315, 295, 541, 18,
+        81, 39, 75, 70, 134, 125, 116, 220, 204, 190, 178, 325, 311, 293, 271, 16,
+        147, 72, 69, 135, 127, 118, 112, 210, 200, 188, 352, 323, 306, 285, 540, 14,
+        263, 66, 129, 126, 119, 114, 214, 202, 192, 180, 341, 317, 301, 281, 262, 12,
+        249, 123, 121, 117, 113, 215, 206, 195, 185, 347, 330, 308, 291, 272, 520, 10,
+        435, 115, 111, 109, 211, 203, 196, 187, 353, 332, 313, 298, 283, 531, 381, 17,
+        427, 212, 208, 205, 201, 193, 186, 177, 169, 320, 303, 286, 268, 514, 377, 16,
+        335, 199, 197, 191, 189, 181, 174, 333, 321, 305, 289, 275, 521, 379, 371, 11,
+        668, 184, 183, 179, 175, 344, 331, 314, 304, 290, 277, 530, 383, 373, 366, 10,
+        652, 346, 171, 168, 164, 318, 309, 299, 287, 276, 263, 513, 375, 368, 362, 6,
+        648, 322, 316, 312, 307, 302, 292, 284, 269, 261, 512, 376, 370, 364, 359, 4,
+        620, 300, 296, 294, 288, 282, 273, 266, 515, 380, 374, 369, 365, 361, 357, 2,
+        1033, 280, 278, 274, 267, 264, 259, 382, 378, 372, 367, 363, 360, 358, 356, 0,
+        43, 20, 19, 17, 15, 13, 11, 9, 7, 6, 4, 7, 5, 3, 1, 3
+    };
+    const uint8_t LENGTHS_24[256] = {
+        4, 4, 6, 7, 8, 9, 9, 10, 10, 11, 11, 11, 11, 11, 12, 9,
+        4, 4, 5, 6, 7, 8, 8, 9, 9, 9, 10, 10, 10, 10, 10, 8,
+        6, 5, 6, 7, 7, 8, 8, 9, 9, 9, 9, 10, 10, 10, 11, 7,
+        7, 6, 7, 7, 8, 8, 8, 9, 9, 9, 9, 10, 10, 10, 10, 7,
+        8, 7, 7, 8, 8, 8, 8, 9, 9, 9, 10, 10, 10, 10, 11, 7,
+        9, 7, 8, 8, 8, 8, 9, 9, 9, 9, 10, 10, 10, 10, 10, 7,
+        9, 8, 8, 8, 8, 9, 9, 9, 9, 10, 10, 10, 10, 10, 11, 7,
+        10, 8, 8, 8, 9, 9, 9, 9, 10, 10, 10, 10, 10, 11, 11, 8,
+        10, 9, 9, 9, 9, 9, 9, 9, 9, 10, 10, 10, 10, 11, 11, 8,
+        10, 9, 9, 9, 9, 9, 9, 10, 10, 10, 10, 10, 11, 11, 11, 8,
+        11, 9, 9, 9, 9, 10, 10, 10, 10, 10, 10, 11, 11, 11, 11, 8,
+        11, 10, 9, 9, 9, 10, 10, 10, 10, 10, 10, 11, 11, 11, 11, 8,
+        11, 10, 10, 10, 10, 10, 10, 10, 10, 10, 11, 11, 11, 11, 11, 8,
+        11, 10, 10, 10, 10, 10, 10, 10, 11, 11, 11, 11, 11, 11, 11, 8,
+        12, 10, 10, 10, 10, 10, 10, 11, 11, 11, 11, 11, 11, 11, 11, 8,
+        8, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 8, 8, 8, 8, 4
+    };
+    const uint16_t CODES_COUNT1_A[16] = {
+        1, 5, 4, 5, 6, 5, 4, 4, 7, 3, 6, 0, 7, 2, 3, 1
+    };
+    const uint8_t LENGTHS_COUNT1_A[16] = {
+        1, 4, 4, 5, 4, 6, 5, 6, 4, 5, 5, 6, 5, 6, 6, 6
+    };
+    const unsigned int LINBITS[32] = {
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        1, 2, 3, 4, 6, 8, 10, 13, 4, 5, 6, 7, 8, 9, 11, 13
+    };
+
+    // Synthesis window D[0..256] of Annex B in 1/65536, the rest of it mirrors
+    const int32_t SYNTHESIS_WINDOW[257] = {
+        0, -1, -1, -1, -1, -1, -1, -2, -2, -2,
+        -2, -3, -3, -4, -4, -5, -5, -6, -7, -7,
+        -8, -9, -10, -11, -13, -14, -16, -17, -19, -21,
+        -24, -26, -29, -31, -35, -38, -41, -45, -49, -53,
+        -58, -63, -68, -73, -79, -85, -91, -97, -104, -111,
+        -117, -125, -132, -139, -147, -154, -161, -169, -176, -183,
+        -190, -196, -202, -208, 213, 218, 222, 225, 227, 228,
+        228, 227, 224, 221, 215, 208, 200, 189, 177, 163,
+        146, 127, 106, 83, 57, 29, -2, -36, -72, -111,
+        -153, -197, -244, -294, -347, -401, -459, -519, -581, -645,
+        -711, -779, -848, -919, -991, -1064, -1137, -1210, -1283, -1356,
+        -1428, -1498, -1567, -1634, -1698, -1759, -1817, -1870, -1919, -1962,
+        -2001, -2032, -2057, -2075, -2085, -2087, -2080, -2063, 2037, 2000,
+        1952, 1893, 1822, 1739, 1644, 1535, 1414, 1280, 1131, 970,
+        794, 605, 402, 185, -45, -288, -545, -814, -1095, -1388,
+        -1692, -2006, -2330, -2663, -3004, -3351, -3705, -4063, -4425, -4788,
+        -5153, -5517, -5879, -6237, -6589, -6935, -7271, -7597, -7910, -8209,
+        -8491, -8755, -8998, -9219, -9416, -9585, -9727, -9838, -9916, -9959,
+        -9966, -9935, -9863, -9750, -9592, -9389, -9139, -8840, -8492, -8092,
+        -7640, -7134, 6574, 5959, 5288, 4561, 3776, 2935, 2037, 1082,
+        70, -998, -2122, -3300, -4533, -5818, -7154, -8540, -9975, -11455,
+        -12980, -14548, -16155, -17799, -19478, -21189, -22929, -24694, -26482, -28289,
+        -30112, -31947, -33791, -35640, -37489, -39336, -41176, -43006, -44821, -46617,
+        -48390, -50137, -51853, -53534, -55178, -56778, -58333, -59838, -61289, -62684,
+        -64019, -65290, -66494, -67629, -68692, -69679, -70590, -71420, -72169, -72835,
+        -73415, -73908, -74313, -74630, -74856, -74992, 75038
+    };
+
+    // Scalefactor band boundaries at 44.1, 48, 32, 22.05, 24, 16, 11.025, 12 and 8 kHz
+    const uint16_t LONG_BANDS[9][23] = {
+        { 0, 4, 8, 12, 16, 20, 24, 30, 36, 44, 52, 62, 74, 90, 110, 134, 162, 196, 238, 288, 342, 418, 576 },
+        { 0, 4, 8, 12, 16, 20, 24, 30, 36, 42, 50, 60, 72, 88, 106, 128, 156, 190, 230, 276, 330, 384, 576 },
+        { 0, 4, 8, 12, 16, 20, 24, 30, 36, 44, 54, 66, 82, 102, 126, 156, 194, 240, 296, 364, 448, 550, 576 },
+        { 0, 6, 12, 18, 24, 30, 36, 44, 54, 66, 80, 96, 116, 140, 168, 200, 238, 284, 336, 396, 464, 522, 576 },
+        { 0, 6, 12, 18, 24, 30, 36, 44, 54, 66, 80, 96, 114, 136, 162, 194, 232, 278, 332, 394, 464, 540, 576 },
+        { 0, 6, 12, 18, 24, 30, 36, 44, 54, 66, 80, 96, 116, 140, 168, 200, 238, 284, 336, 396, 464, 522, 576 },
+        { 0, 6, 12, 18, 24, 30, 36, 44, 54, 66, 80, 96, 116, 140, 168, 200, 238, 284, 336, 396, 464, 522, 576 },
+        { 0, 6, 12, 18, 24, 30, 36, 44, 54, 66, 80, 96, 116, 140, 168, 200, 238, 284, 336, 396, 464, 522, 576 },
+        { 0, 12, 24, 36, 48, 60, 72, 88, 108, 132, 160, 192, 232, 280, 336, 400, 476, 566, 568, 570, 572, 574, 576 }
+    };
+    const uint8_t SHORT_BANDS[9][14] = {
+        { 0, 4, 8, 12, 16, 22, 30, 40, 52, 66, 84, 106, 136, 192 },
+        { 0, 4, 8, 12, 16, 22, 28, 38, 50, 64, 80, 100, 126, 192 },
+        { 0, 4, 8, 12, 16, 22, 30, 42, 58, 78, 104, 138, 180, 192 },
+        { 0, 4, 8, 12, 18, 24, 32, 42, 56, 74, 100, 132, 174, 192 },
+        { 0, 4, 8, 12, 18, 26, 36, 48, 62, 80, 104, 136, 180, 192 },
+        { 0, 4, 8, 12, 18, 26, 36, 48, 62, 80, 104, 134, 174, 192 },
+        { 0, 4, 8, 12, 18, 26, 36, 48, 62, 80, 104, 134, 174, 192 },
+        { 0, 4, 8, 12, 18, 26, 36, 48, 62, 80, 104, 134, 174, 192 },
+        { 0, 8, 16, 24, 36, 52, 72, 96, 124, 160, 162, 164, 166, 192 }
+    };
+
+
+    const unsigned short BITRATES_MPEG1[15] = { 0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320 };
+    const unsigned short BITRATES_MPEG2[15] = { 0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160 };
+    // Same order as the band tables, the first three are MPEG-1
+    const unsigned int SAMPLE_RATES[6] = { 44100, 48000, 32000, 22050, 24000, 16000 };
+    const unsigned int SHORT_BLOCK = 2;
+
+    struct HuffmanTable {
+        const uint16_t* codes;
+        const uint8_t* lengths;
+        unsigned int size;
+    };
+    const HuffmanTable HUFFMAN_TABLES[32] = {
+        { nullptr, nullptr, 0 }, { CODES_1, LENGTHS_1, 2 }, { CODES_2, LENGTHS_2, 3 }, { CODES_3, LENGTHS_3, 3 },
+        { nullptr, nullptr, 0 }, { CODES_5, LENGTHS_5, 4 }, { CODES_6, LENGTHS_6, 4 }, { CODES_7, LENGTHS_7, 6 },
+        { CODES_8, LENGTHS_8, 6 }, { CODES_9, LENGTHS_9, 6 }, { CODES_10, LENGTHS_10, 8 }, { CODES_11, LENGTHS_11, 8 },
+        { CODES_12, LENGTHS_12, 8 }, { CODES_13, LENGTHS_13, 16 }, { nullptr, nullptr, 0 }, { CODES_15, LENGTHS_15, 16 },
+        { CODES_16, LENGTHS_16, 16 }, { CODES_16, LENGTHS_16, 16 }, { CODES_16, LENGTHS_16, 16 }, { CODES_16, LENGTHS_16, 16 },
+        { CODES_16, LENGTHS_16, 16 }, { CODES_16, LENGTHS_16, 16 }, { CODES_16, LENGTHS_16, 16 }, { CODES_16, LENGTHS_16, 16 },
+        { CODES_24, LENGTHS_24, 16 }, { CODES_24, LENGTHS_24, 16 }, { CODES_24, LENGTHS_24, 16 }, { CODES_24, LENGTHS_24, 16 },
+        { CODES_24, LENGTHS_24, 16 }, { CODES_24, LENGTHS_24, 16 }, { CODES_24, LENGTHS_24, 16 }, { CODES_24, LENGTHS_24, 16 }
+    };
+
+    // MSB-first
+    class BitWriter {
+    public:
+        BitWriter() : count(0) {}
+
+        void write(uint32_t value, unsigned int bits) {
+            for (unsigned int i = bits; i-- > 0;) {
+                if (count % 8 == 0) {
+                    bytes.push_back(0);
+                }
+                if ((value >> i) & 1) {
+                    bytes.back() |= static_cast<unsigned char>(0x80 >> (count % 8));
+                }
+                count++;
+            }
+        }
+        size_t size() const { return count; }
+        const std::vector<unsigned char>& data() const { return bytes; }
+
+    private:
+        std::vector<unsigned char> bytes;
+        size_t count;
+    };
+
+    // The inverses of what the decoder does, in double precision
+    struct Transforms {
+        double analysisWindow[512];
+        double analysisMatrix[32][64];
+        double mdctLong[18][36];     // Scaled so the decoder's IMDCT and overlap give the input back
+        double mdctShort[6][12];
+        double windows[4][36];
+        double shortWindow[12];
+        double aliasCs[8];
+        double aliasCa[8];
+
+        Transforms() {
+            const double PI = 3.14159265358979323846;
+            static const double ALIAS_COEFFICIENTS[8] = { -0.6, -0.535, -0.33, -0.185, -0.095, -0.041, -0.0142, -0.0037 };
+
+            // The analysis window is the synthesis window over 32
+            for (unsigned int i = 0; i <= 256; ++i) {
+                analysisWindow[i] = SYNTHESIS_WINDOW[i] / 65536.0 / 32.0;
+            }
+            for (unsigned int i = 1; i < 256; ++i) {
+                analysisWindow[512 - i] = i % 64 == 0 ? analysisWindow[i] : -analysisWindow[i];
+            }
+            for (unsigned int k = 0; k < 32; ++k) {
+                for (unsigned int i = 0; i < 64; ++i) {
+                    analysisMatrix[k][i] = std::cos((2.0 * k + 1.0) * (static_cast<double>(i) - 16.0) * PI / 64.0);
+                }
+            }
+
+            for (unsigned int k = 0; k < 18; ++k) {
+                for (unsigned int i = 0; i < 36; ++i) {
+                    mdctLong[k][i] = std::cos(PI / 72.0 * (2 * i + 19) * (2 * k + 1)) / 9.0;
+                }
+            }
+            for (unsigned int k = 0; k < 6; ++k) {
+                for (unsigned int i = 0; i < 12; ++i) {
+                    mdctShort[k][i] = std::cos(PI / 24.0 * (2 * i + 7) * (2 * k + 1)) / 3.0;
+                }
+            }
+
+            for (unsigned int i = 0; i < 12; ++i) {
+                shortWindow[i] = std::sin(PI / 12.0 * (i + 0.5));
+            }
+            for (unsigned int i = 0; i < 36; ++i) {
+                double normal = std::sin(PI / 36.0 * (i + 0.5));
+                windows[0][i] = windows[2][i] = normal;
+                windows[1][i] = i < 18 ? normal : (i < 24 ? 1.0 : (i < 30 ? shortWindow[i - 18] : 0.0));
+                windows[3][i] = i < 6 ? 0.0 : (i < 12 ? shortWindow[i - 6] : (i < 18 ? 1.0 : normal));
+            }
+
+            for (unsigned int i = 0; i < 8; ++i) {
+                double root = std::sqrt(1.0 + ALIAS_COEFFICIENTS[i] * ALIAS_COEFFICIENTS[i]);
+                aliasCs[i] = 1.0 / root;
+                aliasCa[i] = ALIAS_COEFFICIENTS[i] / root;
+            }
+        }
+    };
+
+    inline const Transforms& transforms() {
+        static const Transforms instance;
+        return instance;
+    }
+
+    struct ChannelState {
+        double history[512];         // Analysis input, newest first
+        double previous[32][18];     // Last granule's subband samples, the first half of the MDCT input
+
+        ChannelState() {
+            std::memset(history, 0, sizeof(history));
+            std::memset(previous, 0, sizeof(previous));
+        }
+    };
+
+    struct GranuleInfo {
+        unsigned int part23Length;
+        unsigned int bigValues;
+        unsigned int globalGain;
+        unsigned int blockType;
+        unsigned int tableSelect[3];
+        bool count1TableB;
+    };
+
+    // One granule of one channel (every stride-th input sample) to 576 lines
+    // in bitstream order: filterbank, MDCT and the butterflies the decoder's
+    // alias reduction undoes, or the short block reordering
+    inline void analyse(ChannelState& state, const float* input, unsigned int stride, unsigned int rate,
+                        unsigned int blockType, double* lines) {
+        const Transforms& t = transforms();
+        double current[32][18];
+        for (unsigned int slot = 0; slot < 18; ++slot) {
+            std::memmove(state.history + 32, state.history, 480 * sizeof(double));
+            for (unsigned int i = 0; i < 32; ++i) {
+                state.history[31 - i] = input[(slot * 32 + i) * stride];
+            }
+            double y[64];
+            for (unsigned int i = 0; i < 64; ++i) {
+                double sum = 0.0;
+                for (unsigned int j = 0; j < 8; ++j) {
+                    sum += t.analysisWindow[i + 64 * j] * state.history[i + 64 * j];
+                }
+                y[i] = sum;
+            }
+            for (unsigned int k = 0; k < 32; ++k) {
+                double sum = 0.0;
+                for (unsigned int i = 0; i < 64; ++i) {
+                    sum += t.analysisMatrix[k][i] * y[i];
+                }
+                // Odd subbands go out frequency inverted, the decoder turns them back
+                current[k][slot] = (k & 1) && (slot & 1) ? -sum : sum;
+            }
+        }
+
+        double transformed[576];
+        for (unsigned int subband = 0; subband < 32; ++subband) {
+            double z[36];
+            std::copy(state.previous[subband], state.previous[subband] + 18, z);
+            std::copy(current[subband], current[subband] + 18, z + 18);
+            std::copy(current[subband], current[subband] + 18, state.previous[subband]);
+
+            double* out = transformed + subband * 18;
+            if (blockType == SHORT_BLOCK) {
+                for (unsigned int window = 0; window < 3; ++window) {
+                    for (unsigned int k = 0; k < 6; ++k) {
+                        double sum = 0.0;
+                        for (unsigned int i = 0; i < 12; ++i) {
+                            sum += t.mdctShort[k][i] * t.shortWindow[i] * z[6 + 6 * window + i];
+                        }
+                        out[window * 6 + k] = sum;
+                    }
+                }
+            } else {
+                for (unsigned int k = 0; k < 18; ++k) {
+                    double sum = 0.0;
+                    for (unsigned int i = 0; i < 36; ++i) {
+                        sum += t.mdctLong[k][i] * t.windows[blockType][i] * z[i];
+                    }
+                    out[k] = sum;
+                }
+            }
+        }
+
+        if (blockType == SHORT_BLOCK) {
+            // Band by band, each band's three windows one after the other
+            for (unsigned int band = 0; band < 13; ++band) {
+                unsigned int first = SHORT_BANDS[rate][band];
+                unsigned int width = SHORT_BANDS[rate][band + 1] - first;
+                for (unsigned int window = 0; window < 3; ++window) {
+                    for (unsigned int i = 0; i < width; ++i) {
+                        unsigned int f = first + i;
+                        lines[3 * first + window * width + i] = transformed[(f / 6) * 18 + window * 6 + f % 6];
+                    }
+                }
+            }
+            return;
+        }
+
+        for (unsigned int subband = 1; subband < 32; ++subband) {
+            double* upper = transformed + 18 * subband;
+            for (unsigned int i = 0; i < 8; ++i) {
+                double a = upper[-1 - static_cast<int>(i)];
+                double b = upper[i];
+                upper[-1 - static_cast<int>(i)] = a * t.aliasCs[i] + b * t.aliasCa[i];
+                upper[i] = b * t.aliasCs[i] - a * t.aliasCa[i];
+            }
+        }
+        std::copy(transformed, transformed + 576, lines);
+    }
+
+    // False when a value is too big for the escape tables
+    inline bool quantize(const double* lines, unsigned int gain, int* values) {
+        double step = std::pow(2.0, (210.0 - gain) / 4.0);
+        for (unsigned int i = 0; i < 576; ++i) {
+            double value = std::pow(std::fabs(lines[i]) * step, 0.75) + 0.4054;
+            if (value > 8206.0) {
+                return false;
+            }
+            values[i] = lines[i] < 0.0 ? -static_cast<int>(value) : static_cast<int>(value);
+        }
+        return true;
+    }
+
+    // Where the big values regions and count1 end, and where regions 1 and 2
+    // start as the decoder works them out
+    struct Regions {
+        unsigned int starts[4];
+        unsigned int count1End;
+    };
+
+    inline Regions findRegions(const int* values, unsigned int rate, unsigned int blockType) {
+        Regions regions;
+        unsigned int end = 576;
+        while (end > 0 && values[end - 1] == 0) {
+            end--;
+        }
+        end = (end + 1) & ~1u;
+        unsigned int big = end;
+        while (big >= 4 && std::abs(values[big - 1]) <= 1 && std::abs(values[big - 2]) <= 1 &&
+               std::abs(values[big - 3]) <= 1 && std::abs(values[big - 4]) <= 1) {
+            big -= 4;
+        }
+        regions.count1End = end;
+
+        unsigned int region1 = blockType == SHORT_BLOCK ? 3u * SHORT_BANDS[rate][3] : LONG_BANDS[rate][8];
+        unsigned int region2 = blockType != 0 ? 576u : LONG_BANDS[rate][16];
+        region1 = (std::min)(region1, big);
+        region2 = (std::min)((std::max)(region2, region1), big);
+        regions.starts[0] = 0;
+        regions.starts[1] = region1;
+        regions.starts[2] = region2;
+        regions.starts[3] = big;
+        return regions;
+    }
+
+    // A big values pair: the code, then each value's linbits and sign
+    inline unsigned int writePair(unsigned int table, int x, int y, BitWriter* out) {
+        const HuffmanTable& huffman = HUFFMAN_TABLES[table];
+        unsigned int linbits = LINBITS[table];
+        const int pair[2] = { x, y };
+        unsigned int magnitudes[2] = { static_cast<unsigned int>(std::abs(x)), static_cast<unsigned int>(std::abs(y)) };
+        unsigned int clipped[2] = { (std::min)(magnitudes[0], 15u), (std::min)(magnitudes[1], 15u) };
+        unsigned int index = clipped[0] * huffman.size + clipped[1];
+        unsigned int bits = huffman.lengths[index];
+        if (out) {
+            out->write(huffman.codes[index], huffman.lengths[index]);
+        }
+        for (unsigned int i = 0; i < 2; ++i) {
+            if (linbits && clipped[i] == 15) {
+                bits += linbits;
+                if (out) {
+                    out->write(magnitudes[i] - 15, linbits);
+                }
+            }
+            if (magnitudes[i]) {
+                bits++;
+                if (out) {
+                    out->write(pair[i] < 0 ? 1 : 0, 1);
+                }
+            }
+        }
+        return bits;
+    }
+
+    inline unsigned int writeQuad(bool tableB, const int* values, BitWriter* out) {
+        unsigned int symbol = 0;
+        unsigned int bits = 0;
+        for (unsigned int i = 0; i < 4; ++i) {
+            symbol = (symbol << 1) | (values[i] != 0 ? 1u : 0u);
+        }
+        unsigned int length = tableB ? 4 : LENGTHS_COUNT1_A[symbol];
+        if (out) {
+            out->write(tableB ? 15 - symbol : CODES_COUNT1_A[symbol], length);
+        }
+        bits += length;
+        for (unsigned int i = 0; i < 4; ++i) {
+            if (values[i]) {
+                bits++;
+                if (out) {
+                    out->write(values[i] < 0 ? 1 : 0, 1);
+                }
+            }
+        }
+        return bits;
+    }
+
+    inline bool tableFits(unsigned int table, unsigned int largest) {
+        if (!HUFFMAN_TABLES[table].codes) {
+            return false;
+        }
+        if (LINBITS[table]) {
+            return largest <= 15 + ((1u << LINBITS[table]) - 1);
+        }
+        return largest < HUFFMAN_TABLES[table].size;
+    }
+
+    // Picks the cheapest tables and returns the Huffman bits, or writes them
+    // with the tables already picked
+    inline unsigned int codeSpectrum(const int* values, unsigned int rate, GranuleInfo& info, BitWriter* out) {
+        Regions regions = findRegions(values, rate, info.blockType);
+        info.bigValues = regions.starts[3] / 2;
+        unsigned int bits = 0;
+        unsigned int regionCount = info.blockType != 0 ? 2 : 3;
+        for (unsigned int region = 0; region < 3; ++region) {
+            unsigned int start = regions.starts[region];
+            unsigned int end = regions.starts[region + 1];
+            if (!out) {
+                unsigned int largest = 0;
+                for (unsigned int line = start; line < end; ++line) {
+                    largest = (std::max)(largest, static_cast<unsigned int>(std::abs(values[line])));
+                }
+                info.tableSelect[region] = 0;
+                if (largest > 0 && region < regionCount) {
+                    unsigned int cheapest = ~0u;
+                    for (unsigned int table = 1; table < 32; ++table) {
+                        if (!tableFits(table, largest)) {
+                            continue;
+                        }
+                        unsigned int cost = 0;
+                        for (unsigned int line = start; line < end; line += 2) {
+                            cost += writePair(table, values[line], values[line + 1], nullptr);
+                        }
+                        if (cost < cheapest) {
+                            cheapest = cost;
+                            info.tableSelect[region] = table;
+                        }
+                    }
+                }
+            }
+            if (info.tableSelect[region] != 0) {
+                for (unsigned int line = start; line < end; line += 2) {
+                    bits += writePair(info.tableSelect[region], values[line], values[line + 1], out);
+                }
+            }
+        }
+
+        if (!out) {
+            unsigned int costA = 0;
+            unsigned int costB = 0;
+            for (unsigned int line = regions.starts[3]; line < regions.count1End; line += 4) {
+                costA += writeQuad(false, values + line, nullptr);
+                costB += writeQuad(true, values + line, nullptr);
+            }
+            info.count1TableB = costB < costA;
+        }
+        for (unsigned int line = regions.starts[3]; line < regions.count1End; line += 4) {
+            bits += writeQuad(info.count1TableB, values + line, out);
+        }
+        info.part23Length = bits;
+        return bits;
+    }
+
+    // The lowest global gain whose Huffman data fits in budget bits
+    inline void chooseGain(const double* lines, unsigned int rate, unsigned int budget, GranuleInfo& info, int* values) {
+        auto fits = [&](unsigned int gain) {
+            return quantize(lines, gain, values) && codeSpectrum(values, rate, info, nullptr) <= budget;
+        };
+        unsigned int low = 0;
+        unsigned int high = 255;
+        while (low < high) {
+            unsigned int middle = (low + high) / 2;
+            if (fits(middle)) {
+                high = middle;
+            } else {
+                low = middle + 1;
+            }
+        }
+        while (!fits(high) && high < 255) {
+            high++;
+        }
+        info.globalGain = high;
+    }
+
+    inline void writeHeader(unsigned char* out, bool mpeg1, unsigned int bitrateIndex, unsigned int rateIndex,
+                            bool padded, unsigned int channels, bool midSide) {
+        out[0] = 0xFF;
+        out[1] = static_cast<unsigned char>(0xE0 | ((mpeg1 ? 3 : 2) << 3) | (1 << 1) | 1); // Layer III, no CRC
+        out[2] = static_cast<unsigned char>((bitrateIndex << 4) | (rateIndex << 2) | (padded ? 2 : 0));
+        unsigned int mode = channels == 1 ? 3 : (midSide ? 1 : 0);
+        out[3] = static_cast<unsigned char>((mode << 6) | (midSide ? 2 << 4 : 0));
+    }
+
+    inline void writeBE32(unsigned char* out, uint32_t value) {
+        out[0] = static_cast<unsigned char>(value >> 24);
+        out[1] = static_cast<unsigned char>(value >> 16);
+        out[2] = static_cast<unsigned char>(value >> 8);
+        out[3] = static_cast<unsigned char>(value);
+    }
+
+    // Writes samples (interleaved, 44.1, 48, 32, 22.05, 24 or 16 kHz, mono or
+    // stereo) as an MP3. With the Info frame's delay and padding trimmed the
+    // decoded file is as long as the input and lines up with it; without an
+    // Info frame it starts ENCODER_DELAY + DECODER_DELAY samples late and
+    // runs to the end of the last frame
+    inline bool encode(const std::string& path, const AudioFormat& format, const std::vector<float>& samples,
+                       const Options& options = Options()) {
+        unsigned int rate = 0;
+        while (rate < 6 && SAMPLE_RATES[rate] != format.sampleRate) {
+            rate++;
+        }
+        if (rate == 6 || format.channels < 1 || format.channels > 2) {
+            return false;
+        }
+        bool mpeg1 = rate < 3;
+        const unsigned short* bitrates = mpeg1 ? BITRATES_MPEG1 : BITRATES_MPEG2;
+        unsigned int bitrateIndex = 1;
+        while (bitrateIndex < 15 && bitrates[bitrateIndex] != options.bitrate) {
+            bitrateIndex++;
+        }
+        if (bitrateIndex == 15) {
+            return false;
+        }
+
+        unsigned int channels = format.channels;
+        unsigned int granules = mpeg1 ? 2 : 1;
+        unsigned int samplesPerFrame = 576 * granules;
+        unsigned int sideInfoBytes = mpeg1 ? (channels == 2 ? 32 : 17) : (channels == 2 ? 17 : 9);
+        size_t maxBegin = mpeg1 ? 511 : 255;
+        bool midSide = options.midSide && channels == 2;
+        unsigned int frameScale = (mpeg1 ? 144 : 72) * options.bitrate * 1000;
+
+        // Zeros in front, so that the delay comes out as ENCODER_DELAY plus the decoder's
+        size_t length = samples.size() / channels;
+        size_t lead = ENCODER_DELAY + DECODER_DELAY - CODEC_DELAY;
+        size_t frameCount = (lead + length + CODEC_DELAY + samplesPerFrame - 1) / samplesPerFrame;
+        size_t padding = frameCount * samplesPerFrame - ENCODER_DELAY - length;
+        std::vector<float> input(frameCount * samplesPerFrame * channels, 0.0f);
+        std::copy(samples.begin(), samples.begin() + length * channels, input.begin() + lead * channels);
+
+        struct Frame {
+            unsigned char header[4];
+            std::vector<unsigned char> sideInfo;
+            size_t slotStart;        // Main data space of the frame in slots
+            size_t slotBytes;
+        };
+        std::vector<Frame> frames(frameCount);
+        std::vector<unsigned char> slots;
+        std::vector<ChannelState> states(channels);
+        size_t dataEnd = 0;
+        unsigned int remainder = 0;
+        unsigned int granuleCount = 0;
+
+        for (size_t index = 0; index < frameCount; ++index) {
+            Frame& frame = frames[index];
+            unsigned int frameBytes = frameScale / format.sampleRate;
+            remainder += frameScale % format.sampleRate;
+            bool padded = remainder >= format.sampleRate;
+            if (padded) {
+                remainder -= format.sampleRate;
+                frameBytes++;
+            }
+            writeHeader(frame.header, mpeg1, bitrateIndex, rate % 3, padded, channels, midSide);
+            frame.slotStart = slots.size();
+            frame.slotBytes = frameBytes - 4 - sideInfoBytes;
+            slots.resize(slots.size() + frame.slotBytes, 0);
+
+            // Main data starts right after the previous frame's, as far back as main_data_begin reaches
+            size_t start = frame.slotStart;
+            if (options.reservoir) {
+                start = (std::max)(dataEnd, frame.slotStart - (std::min)(frame.slotStart, maxBegin));
+            }
+            size_t mainDataBegin = frame.slotStart - start;
+            // Spend half of what the reservoir holds
+            size_t budgetBytes = frame.slotBytes + mainDataBegin / 2;
+            unsigned int budget = static_cast<unsigned int>((std::min)(static_cast<size_t>(4095), budgetBytes * 8 / (granules * channels)));
+
+            GranuleInfo infos[2][2];
+            BitWriter mainData;
+            for (unsigned int granule = 0; granule < granules; ++granule, ++granuleCount) {
+                unsigned int blockType = 0;
+                if (options.shortBlocks) {
+                    static const unsigned int PATTERN[8] = { 0, 0, 0, 1, 2, 2, 3, 0 };
+                    blockType = PATTERN[granuleCount % 8];
+                }
+
+                double lines[2][576];
+                const float* granuleInput = input.data() + (index * samplesPerFrame + granule * 576) * channels;
+                for (unsigned int channel = 0; channel < channels; ++channel) {
+                    analyse(states[channel], granuleInput + channel, channels, rate, blockType, lines[channel]);
+                }
+                if (midSide) {
+                    const double root = 1.0 / std::sqrt(2.0);
+                    for (unsigned int i = 0; i < 576; ++i) {
+                        double left = lines[0][i];
+                        double right = lines[1][i];
+                        lines[0][i] = (left + right) * root;
+                        lines[1][i] = (left - right) * root;
+                    }
+                }
+                for (unsigned int channel = 0; channel < channels; ++channel) {
+                    GranuleInfo& info = infos[granule][channel];
+                    info.blockType = blockType;
+                    int values[576];
+                    chooseGain(lines[channel], rate, budget, info, values);
+                    codeSpectrum(values, rate, info, &mainData);
+                }
+            }
+
+            const std::vector<unsigned char>& data = mainData.data();
+            std::copy(data.begin(), data.end(), slots.begin() + start);
+            dataEnd = start + data.size();
+
+            BitWriter side;
+            side.write(static_cast<uint32_t>(mainDataBegin), mpeg1 ? 9 : 8);
+            side.write(0, mpeg1 ? (channels == 2 ? 3 : 5) : channels);
+            if (mpeg1) {
+                side.write(0, 4 * channels);
+            }
+            for (unsigned int granule = 0; granule < granules; ++granule) {
+                for (unsigned int channel = 0; channel < channels; ++channel) {
+                    const GranuleInfo& info = infos[granule][channel];
+                    side.write(info.part23Length, 12);
+                    side.write(info.bigValues, 9);
+                    side.write(info.globalGain, 8);
+                    side.write(0, mpeg1 ? 4 : 9);
+                    if (info.blockType != 0) {
+                        side.write(1, 1);
+                        side.write(info.blockType, 2);
+                        side.write(0, 1);
+                        side.write(info.tableSelect[0], 5);
+                        side.write(info.tableSelect[1], 5);
+                        side.write(0, 9);
+                    } else {
+                        side.write(0, 1);
+                        for (unsigned int region = 0; region < 3; ++region) {
+                            side.write(info.tableSelect[region], 5);
+                        }
+                        side.write(7, 4);
+                        side.write(7, 3);
+                    }
+                    if (mpeg1) {
+                        side.write(0, 1);
+                    }
+                    side.write(0, 1);
+                    side.write(info.count1TableB ? 1 : 0, 1);
+                }
+            }
+            frame.sideInfo = side.data();
+        }
+
+        // Info frame: frame count, byte count, an even seek table and the LAME tag
+        std::vector<unsigned char> info(frameScale / format.sampleRate, 0);
+        writeHeader(info.data(), mpeg1, bitrateIndex, rate % 3, false, channels, midSide);
+        size_t totalBytes = info.size() + slots.size() + frameCount * (4 + sideInfoBytes);
+        unsigned char* tag = info.data() + 4 + sideInfoBytes;
+        std::memcpy(tag, "Info", 4);
+        writeBE32(tag + 4, 0x7);
+        writeBE32(tag + 8, static_cast<uint32_t>(frameCount));
+        writeBE32(tag + 12, static_cast<uint32_t>(totalBytes));
+        for (unsigned int i = 0; i < 100; ++i) {
+            tag[16 + i] = static_cast<unsigned char>(i * 256 / 100);
+        }
+        unsigned char* lame = tag + 116;
+        std::memcpy(lame, "LAME3.100", 9);
+        lame[21] = static_cast<unsigned char>(ENCODER_DELAY >> 4);
+        lame[22] = static_cast<unsigned char>(((ENCODER_DELAY & 0x0F) << 4) | (padding >> 8));
+        lame[23] = static_cast<unsigned char>(padding & 0xFF);
+
+        std::ofstream file(path, std::ios::binary);
+        if (!file.is_open()) {
+            return false;
+        }
+        if (options.infoFrame) {
+            file.write(reinterpret_cast<const char*>(info.data()), static_cast<std::streamsize>(info.size()));
+        }
+        for (const Frame& frame : frames) {
+            file.write(reinterpret_cast<const char*>(frame.header), 4);
+            file.write(reinterpret_cast<const char*>(frame.sideInfo.data()), static_cast<std::streamsize>(frame.sideInfo.size()));
+            file.write(reinterpret_cast<const char*>(slots.data() + frame.slotStart), static_cast<std::streamsize>(frame.slotBytes));
+        }
+        return file.good();
+    }
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,51 @@
+// The play event log after a crash mid-write: a partial record at the end
+// is cut off when the log is opened, so the events appended afterwards stay
+// on record boundaries and are all read back on the next start.
+#include "testAudio.hpp"
+#include "../headers/playStats.hpp"
+#include <fstream>
+
+int main() {
+    using testAudio::check;
+    std::filesystem::path dir = testAudio::scratchDirectory("play_stats_test");
+    std::string logPath = (dir / "play_events.bin").string();
+    std::string summaryPath = (dir / "play_stats.bin").string();
+    Song first("Artist", "First", "first.wav", 1);
+    Song second("Artist", "Second", "second.wav", 2);
+
+    {
+        PlayStats stats;
+        check(stats.open(logPath, summaryPath), "a new log opens");
+        stats.recordStart(first);
+        stats.recordFinish(first, 90000);
+        stats.recordStart(second);
+    }
+    check(std::filesystem::file_size(logPath) == 3 * sizeof(PlayEvent), "three events are logged");
+
+    // Torn write: part of a record made it to disk
+    {
+        std::ofstream log(logPath, std::ios::binary | std::ios::app);
+        const char partial[10] = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10 };
+        log.write(partial, sizeof(partial));
+    }
+
+    {
+        PlayStats stats;
+        check(stats.open(logPath, summaryPath), "a torn log opens");
+        check(std::filesystem::file_size(logPath) == 3 * sizeof(PlayEvent), "the partial record is cut off");
+        check(stats.totalPlays() == 2 && stats.songCount() == 2, "the whole events are kept");
+        stats.recordSkip(second, 5000);
+    }
+    check(std::filesystem::file_size(logPath) == 4 * sizeof(PlayEvent), "the next event is appended on a record boundary");
+
+    PlayStats reopened;
+    check(reopened.open(logPath, summaryPath), "the repaired log opens");
+    check(reopened.totalPlays() == 2, "plays are read back");
+    check(reopened.totalSkips() == 1, "the event after the repair is read back");
+    const SongStats* secondStats = reopened.getStats(PlayStats::songKey(second));
+    check(secondStats && secondStats->skips == 1, "the skip belongs to the right song");
+    reopened.close();
+
+    std::filesystem::remove_all(dir);
+    return testAudio::failures == 0 ? 0 : 1;
+}
\ No newline at end of file
@@ -0,0 +1,60 @@
+// Exporting a playlist of an MP3 and a WAV through the built-in chain: the
+// file holds both songs back to back, the MP3 as its decoder gives it. A
+// playlist with a file no decoder reads fails and leaves nothing behind.
+#include "testAudio.hpp"
+#include "mp3TestEncoder.hpp"
+#include "../headers/playlistExport.hpp"
+#include <fstream>
+
+namespace {
+    const AudioFormat FORMAT(44100, 2);
+}
+
+int main() {
+    using testAudio::check;
+    std::filesystem::path dir = testAudio::scratchDirectory("playlist_export_test");
+    std::string mp3Path = (dir / "song.mp3").string();
+    std::string wavPath = (dir / "song.wav").string();
+    std::string junkPath = (dir / "junk.mp3").string();
+    std::string outPath = (dir / "export.wav").string();
+
+    testAudio::ToneSource tone(FORMAT, 660.0, 0.4f, FORMAT.sampleRate * 2);
+    std::vector<float> toneSamples = testAudio::decodeAll(tone);
+    std::vector<float> wavSamples(FORMAT.sampleRate * FORMAT.channels, 0.2f);
+    if (!mp3TestEncoder::encode(mp3Path, FORMAT, toneSamples) || !testAudio::writeWav(wavPath, FORMAT, wavSamples)) {
+        std::cout << "Could not write the test songs in " << dir.string() << std::endl;
+        return 1;
+    }
+    std::ofstream(junkPath) << "not audio";
+
+    std::unique_ptr<AudioBackend> mp3 = AudioBackend::openFile(mp3Path);
+    check(mp3 != nullptr, "MP3 opens");
+    std::vector<float> mp3Samples = mp3 ? testAudio::decodeAll(*mp3) : std::vector<float>();
+
+    PlaylistExporter::Settings settings;
+    settings.sampleRate = FORMAT.sampleRate;
+    std::vector<PlaylistExporter::Track> tracks = { { mp3Path, 1.0f }, { wavPath, 1.0f } };
+    PlaylistExporter::Report report;
+    check(PlaylistExporter(tracks, settings).run(outPath, report), "playlist with an MP3 exports");
+    check(report.tracks == 2 && report.undecodable.empty(), "both songs are rendered");
+
+    AudioFormat outFormat;
+    std::vector<float> exported = testAudio::readWav(outPath, outFormat);
+    check(exported.size() == mp3Samples.size() + wavSamples.size(), "export is both songs long");
+    double largest = 0.0;
+    for (size_t i = 0; i < mp3Samples.size() && i < exported.size(); ++i) {
+        largest = (std::max)(largest, std::fabs(static_cast<double>(exported[i]) - mp3Samples[i]));
+    }
+    std::cout << "MP3 part differs from its decode by at most " << largest << std::endl;
+    check(largest < 1e-4, "the MP3 part is the decoded MP3");
+
+    tracks.push_back({ junkPath, 1.0f });
+    std::filesystem::remove(outPath);
+    PlaylistExporter::Report failed;
+    check(!PlaylistExporter(tracks, settings).run(outPath, failed), "playlist with an undecodable file fails");
+    check(failed.undecodable.size() == 1 && failed.undecodable[0] == 2, "the undecodable file is named");
+    check(!std::filesystem::exists(outPath), "nothing is left at the export path");
+
+    std::filesystem::remove_all(dir);
+    return testAudio::failures == 0 ? 0 : 1;
+}
\ No newline at end of file
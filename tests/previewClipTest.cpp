@@ -0,0 +1,74 @@
+// Preview clips of an MP3 from the PreviewTime of a beatmap next to it. A
+// clip opened for a prefetch starts on the exact sample, so between its fades
+// it is the decoded song from that point, and its seek index is cached; an
+// ordinary clip only lands near the point but is as long.
+#include "testAudio.hpp"
+#include "mp3TestEncoder.hpp"
+#include "../headers/previewClip.hpp"
+#include "../headers/mp3SeekIndex.hpp"
+#include <fstream>
+
+namespace {
+    const AudioFormat FORMAT(44100, 2);
+    const unsigned int PREVIEW_MS = 7300;
+    const unsigned int CLIP_MS = 4000;
+
+    // A rising tone, so every point of the song sounds different
+    std::vector<float> sweep(double seconds) {
+        size_t frames = static_cast<size_t>(seconds * FORMAT.sampleRate);
+        std::vector<float> samples(frames * FORMAT.channels);
+        double phase = 0.0;
+        for (size_t i = 0; i < frames; ++i) {
+            phase += 2.0 * testAudio::ToneSource::PI * (200.0 + 100.0 * i / FORMAT.sampleRate) / FORMAT.sampleRate;
+            for (unsigned int c = 0; c < FORMAT.channels; ++c) {
+                samples[i * FORMAT.channels + c] = static_cast<float>(0.4 * std::sin(phase + c));
+            }
+        }
+        return samples;
+    }
+}
+
+int main() {
+    using testAudio::check;
+    std::filesystem::path dir = testAudio::scratchDirectory("preview_clip_test");
+    std::string mp3Path = (dir / "audio.mp3").string();
+    if (!mp3TestEncoder::encode(mp3Path, FORMAT, sweep(20.0))) {
+        std::cout << "Could not write the test song in " << dir.string() << std::endl;
+        return 1;
+    }
+    std::ofstream((dir / "map.osu").string()) << "osu file format v14\n\n[General]\nAudioFilename: audio.mp3\nPreviewTime: "
+                                              << PREVIEW_MS << "\n";
+
+    std::unique_ptr<AudioBackend> song = AudioBackend::openFile(mp3Path);
+    std::vector<float> decoded = song ? testAudio::decodeAll(*song) : std::vector<float>();
+    check(!decoded.empty(), "MP3 decodes");
+    uint64_t startFrame = static_cast<uint64_t>(PREVIEW_MS) * FORMAT.sampleRate / 1000;
+    uint64_t clipFrames = static_cast<uint64_t>(CLIP_MS) * FORMAT.sampleRate / 1000;
+
+    PreviewClip exact(CLIP_MS, true);
+    check(exact.open(mp3Path), "prefetch clip opens");
+    check(exact.isFromBeatmap() && exact.getStartMs() == PREVIEW_MS, "clip starts at the beatmap's PreviewTime");
+    check(exact.getLengthFrames() == clipFrames, "clip is as long as asked");
+    std::vector<float> clip = testAudio::decodeAll(exact);
+    check(clip.size() == clipFrames * FORMAT.channels, "clip decodes to its length");
+
+    // 250 ms fade in, 1 s fade out
+    size_t from = static_cast<size_t>(FORMAT.sampleRate / 4) * FORMAT.channels;
+    size_t to = static_cast<size_t>(clipFrames - FORMAT.sampleRate) * FORMAT.channels;
+    bool same = clip.size() >= to && decoded.size() >= startFrame * FORMAT.channels + to;
+    for (size_t i = from; same && i < to; ++i) {
+        same = clip[i] == decoded[startFrame * FORMAT.channels + i];
+    }
+    check(same, "prefetch clip is the song from the exact start point");
+
+    uint64_t fileSize = std::filesystem::file_size(mp3Path);
+    int64_t modified = static_cast<int64_t>(std::filesystem::last_write_time(mp3Path).time_since_epoch().count());
+    check(SeekIndexCache::getInstance().find(mp3Path, fileSize, modified) != nullptr, "prefetch leaves the seek index cached");
+
+    PreviewClip near(CLIP_MS);
+    check(near.open(mp3Path) && near.getStartMs() == PREVIEW_MS, "ordinary clip opens at the same point");
+    check(testAudio::decodeAll(near).size() == clipFrames * FORMAT.channels, "ordinary clip decodes to its length");
+
+    std::filesystem::remove_all(dir);
+    return testAudio::failures == 0 ? 0 : 1;
+}
\ No newline at end of file
@@ -0,0 +1,92 @@
+// Radio on MP3s: a few songs of clearly different sound, one of them as both
+// WAV and MP3, analyzed and put in a SimilarityIndex the way the player does.
+// The MP3s get a timbre through their decoder, and the closest song to the
+// MP3 copy is its WAV and the other way round.
+#include "testAudio.hpp"
+#include "mp3TestEncoder.hpp"
+#include "../headers/featureLibrary.hpp"
+#include "../headers/loudnessLibrary.hpp"
+#include "../headers/similarityIndex.hpp"
+#include <thread>
+#include <chrono>
+
+namespace {
+    const AudioFormat FORMAT(44100, 2);
+
+    // Tones over decaying noise bursts, 'hz' sets the colour, 'beat' the pace
+    std::vector<float> song(double hz, double beatSeconds, float noise, double seconds) {
+        size_t frames = static_cast<size_t>(seconds * FORMAT.sampleRate);
+        size_t beatFrames = static_cast<size_t>(beatSeconds * FORMAT.sampleRate);
+        std::vector<float> samples(frames * FORMAT.channels);
+        uint32_t seed = 12345;
+        for (size_t i = 0; i < frames; ++i) {
+            seed = seed * 1664525u + 1013904223u;
+            double t = static_cast<double>(i) / FORMAT.sampleRate;
+            double decay = std::exp(-static_cast<double>(i % beatFrames) / beatFrames * 4.0);
+            double white = static_cast<double>(seed >> 8) / (1 << 24) * 2.0 - 1.0;
+            double value = 0.2 * std::sin(2.0 * testAudio::ToneSource::PI * hz * t) * (0.5 + 0.5 * decay) + noise * decay * white;
+            for (unsigned int c = 0; c < FORMAT.channels; ++c) {
+                samples[i * FORMAT.channels + c] = static_cast<float>(value);
+            }
+        }
+        return samples;
+    }
+}
+
+int main() {
+    using testAudio::check;
+    std::filesystem::path dir = testAudio::scratchDirectory("radio_test");
+    std::vector<std::string> paths = {
+        (dir / "warm.wav").string(),
+        (dir / "warm.mp3").string(),
+        (dir / "bright.mp3").string(),
+        (dir / "deep.wav").string(),
+        (dir / "noisy.mp3").string()
+    };
+
+    std::vector<float> warm = song(220.0, 0.5, 0.02f, 10.0);
+    if (!testAudio::writeWav(paths[0], FORMAT, warm) ||
+        !mp3TestEncoder::encode(paths[1], FORMAT, warm) ||
+        !mp3TestEncoder::encode(paths[2], FORMAT, song(3520.0, 0.35, 0.02f, 10.0)) ||
+        !testAudio::writeWav(paths[3], FORMAT, song(65.0, 0.8, 0.01f, 10.0)) ||
+        !mp3TestEncoder::encode(paths[4], FORMAT, song(440.0, 0.25, 0.3f, 10.0))) {
+        std::cout << "Could not write the test songs in " << dir.string() << std::endl;
+        return 1;
+    }
+
+    FeatureLibrary features;
+    LoudnessLibrary loudness;
+    features.analyze(paths);
+    loudness.analyze(paths);
+    while (features.isBusy() || loudness.isBusy()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    std::vector<int> songIds;
+    std::vector<SimilarityIndex::Vector> vectors;
+    for (size_t i = 0; i < paths.size(); ++i) {
+        TrackFeatures info;
+        LoudnessInfo level;
+        check(features.find(paths[i], info) && info.hasTimbre, paths[i] + " has a timbre");
+        check(loudness.find(paths[i], level) && level.measured, paths[i] + " is measured");
+        SimilarityIndex::Vector vector;
+        std::copy(info.timbre, info.timbre + FeatureAnalyzer::TIMBRE_SIZE, vector.begin());
+        vector[FeatureAnalyzer::TIMBRE_SIZE] = info.bpm > 0.0f ? std::log2(info.bpm) : NAN;
+        vector[FeatureAnalyzer::TIMBRE_SIZE + 1] = level.measured ? level.integratedLufs : NAN;
+        songIds.push_back(static_cast<int>(i + 1));
+        vectors.push_back(vector);
+    }
+
+    SimilarityIndex index;
+    index.build(songIds, vectors, 0);
+    check(index.size() == paths.size(), "every song is on the radio");
+    std::vector<int> afterMp3 = index.nearest(2, 1);
+    std::vector<int> afterWav = index.nearest(1, 1);
+    check(afterMp3.size() == 1 && afterMp3[0] == 1, "the MP3's closest song is its WAV");
+    check(afterWav.size() == 1 && afterWav[0] == 2, "the WAV's closest song is its MP3");
+
+    features.stop();
+    loudness.stop();
+    std::filesystem::remove_all(dir);
+    return testAudio::failures == 0 ? 0 : 1;
+}
\ No newline at end of file
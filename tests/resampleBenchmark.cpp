@@ -0,0 +1,48 @@
+// Throughput of ResampleSource per rate pair, in output samples per second
+// and as a multiple of real time. The source is a generated tone, so this is
+// the resampler alone. Fails only if a pair can't keep up with real time.
+#include "testAudio.hpp"
+#include "../headers/resampleSource.hpp"
+#include <chrono>
+#include <iomanip>
+
+namespace {
+    const unsigned int SECONDS = 20;
+    const unsigned int CHANNELS = 2;
+    const size_t CHUNK_FRAMES = 4096;   // What the engine's decode thread asks for
+
+    double benchmark(unsigned int inputRate, unsigned int outputRate) {
+        std::unique_ptr<AudioBackend> tone(new testAudio::ToneSource(AudioFormat(inputRate, CHANNELS), 1000.0, 0.5f,
+                                                                     static_cast<uint64_t>(inputRate) * SECONDS));
+        // The tone costs more than the resampling, have it all generated up front
+        std::vector<float> input = testAudio::decodeAll(*tone);
+
+        ResampleSource resampler(std::unique_ptr<AudioBackend>(new testAudio::BufferSource(input, AudioFormat(inputRate, CHANNELS))), outputRate);
+        std::vector<float> chunk(CHUNK_FRAMES * CHANNELS);
+        uint64_t frames = 0;
+        size_t got = 0;
+        auto start = std::chrono::steady_clock::now();
+        while ((got = resampler.decode(chunk.data(), CHUNK_FRAMES)) > 0) {
+            frames += got;
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        double samplesPerSecond = frames * CHANNELS / seconds;
+        double realtime = frames / seconds / outputRate;
+        std::cout << std::setw(5) << inputRate << " -> " << std::setw(5) << outputRate << ": "
+                  << std::fixed << std::setprecision(1) << samplesPerSecond / 1e6 << "M samples/s, "
+                  << std::setprecision(0) << realtime << "x real time" << std::endl;
+        return realtime;
+    }
+}
+
+int main() {
+    const unsigned int pairs[][2] = {
+        { 44100, 48000 }, { 48000, 44100 }, { 22050, 44100 }, { 22050, 48000 }, { 44100, 22050 }, { 48000, 22050 }
+    };
+    std::cout << "Resampling " << SECONDS << " s of " << CHANNELS << "-channel audio per pair" << std::endl;
+    for (const auto& pair : pairs) {
+        testAudio::check(benchmark(pair[0], pair[1]) > 1.0, "resampling keeps up with real time");
+    }
+    return testAudio::failures == 0 ? 0 : 1;
+}
\ No newline at end of file
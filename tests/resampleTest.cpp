@@ -0,0 +1,110 @@
+// Frequency response of ResampleSource for the rate pairs osu! and GD songs
+// come in: sines across the passband have to come out at the level they went
+// in, tones the output rate can't hold must not alias back into it, and an
+// upsampled tone must come out without images.
+#include "testAudio.hpp"
+#include "../headers/resampleSource.hpp"
+#include <cmath>
+
+namespace {
+    const double PASSBAND_RIPPLE_DB = 0.01;
+    const double ALIASING_DB = -80.0;    // The stopband the filter is designed for
+    const double IMAGES_DB = -80.0;
+    const float AMPLITUDE = 0.5f;
+
+    struct Tone {
+        double amplitude;   // Of the tone itself, at the frequency that went in
+        double residual;    // RMS of everything else
+    };
+
+    // Resample two seconds of an integer-Hz sine and look at one second from the
+    // middle, a whole number of cycles, so the fit needs no window
+    Tone resampleTone(unsigned int inputRate, unsigned int outputRate, double hz) {
+        std::unique_ptr<AudioBackend> tone(new testAudio::ToneSource(AudioFormat(inputRate, 2), hz, AMPLITUDE, inputRate * 2));
+        ResampleSource resampler(std::move(tone), outputRate);
+        std::vector<float> output = testAudio::decodeAll(resampler);
+
+        size_t start = outputRate / 2;
+        size_t count = outputRate;
+        if (output.size() < (start + count) * 2) {
+            return { 0.0, 1.0 };
+        }
+        double omega = 2.0 * testAudio::ToneSource::PI * hz / outputRate;
+        double sine = 0.0;
+        double cosine = 0.0;
+        for (size_t i = start; i < start + count; ++i) {
+            sine += output[i * 2] * std::sin(omega * i);
+            cosine += output[i * 2] * std::cos(omega * i);
+        }
+        sine *= 2.0 / count;
+        cosine *= 2.0 / count;
+
+        double error = 0.0;
+        for (size_t i = start; i < start + count; ++i) {
+            double fitted = sine * std::sin(omega * i) + cosine * std::cos(omega * i);
+            error += (output[i * 2] - fitted) * (output[i * 2] - fitted);
+        }
+        return { std::sqrt(sine * sine + cosine * cosine), std::sqrt(error / count) };
+    }
+
+    double decibels(double ratio) {
+        return 20.0 * std::log10((std::max)(ratio, 1e-12));
+    }
+
+    std::string pairName(unsigned int inputRate, unsigned int outputRate) {
+        return std::to_string(inputRate) + " -> " + std::to_string(outputRate);
+    }
+
+    // Up to 80% of the lower Nyquist frequency, where the transition band starts
+    void checkPassband(unsigned int inputRate, unsigned int outputRate) {
+        double edge = 0.8 * (std::min)(inputRate, outputRate) / 2.0;
+        double lowest = 0.0;
+        double highest = -1000.0;
+        double worstImages = -1000.0;
+        for (double hz = 100.0; hz <= edge; hz += std::floor(edge / 12.0)) {
+            Tone tone = resampleTone(inputRate, outputRate, std::floor(hz));
+            double level = decibels(tone.amplitude / AMPLITUDE);
+            lowest = (std::min)(lowest == 0.0 ? level : lowest, level);
+            highest = (std::max)(highest, level);
+            worstImages = (std::max)(worstImages, decibels(tone.residual / (AMPLITUDE / std::sqrt(2.0))));
+        }
+        double ripple = highest - lowest;
+        std::cout << pairName(inputRate, outputRate) << ": passband to " << static_cast<int>(edge) << " Hz within "
+                  << ripple << " dB (" << lowest << " to " << highest << " dB), everything else at " << worstImages << " dB" << std::endl;
+        testAudio::check(ripple < PASSBAND_RIPPLE_DB && std::fabs(highest) < PASSBAND_RIPPLE_DB,
+                         pairName(inputRate, outputRate) + " passband ripple under " + std::to_string(PASSBAND_RIPPLE_DB) + " dB");
+        if (outputRate > inputRate) {
+            testAudio::check(worstImages < IMAGES_DB, pairName(inputRate, outputRate) + " images under " + std::to_string(IMAGES_DB) + " dB");
+        }
+    }
+
+    // Tones between the output and the input Nyquist frequency have nowhere to go
+    void checkAliasing(unsigned int inputRate, unsigned int outputRate) {
+        double outputNyquist = outputRate / 2.0;
+        double inputNyquist = inputRate / 2.0;
+        double worst = -1000.0;
+        for (int step = 1; step <= 8; ++step) {
+            double hz = std::floor(outputNyquist + (inputNyquist - outputNyquist) * step / 9.0);
+            Tone tone = resampleTone(inputRate, outputRate, hz);
+            // Whatever comes out is aliasing, the tone itself can't be represented
+            double rms = std::sqrt(tone.residual * tone.residual + tone.amplitude * tone.amplitude / 2.0);
+            worst = (std::max)(worst, decibels(rms / (AMPLITUDE / std::sqrt(2.0))));
+        }
+        std::cout << pairName(inputRate, outputRate) << ": tones from " << static_cast<int>(outputNyquist) << " to "
+                  << static_cast<int>(inputNyquist) << " Hz alias at " << worst << " dB" << std::endl;
+        testAudio::check(worst < ALIASING_DB, pairName(inputRate, outputRate) + " aliasing under " + std::to_string(ALIASING_DB) + " dB");
+    }
+}
+
+int main() {
+    const unsigned int pairs[][2] = {
+        { 44100, 48000 }, { 48000, 44100 }, { 22050, 44100 }, { 22050, 48000 }, { 44100, 22050 }, { 48000, 22050 }
+    };
+    for (const auto& pair : pairs) {
+        checkPassband(pair[0], pair[1]);
+        if (pair[0] > pair[1]) {
+            checkAliasing(pair[0], pair[1]);
+        }
+    }
+    return testAudio::failures == 0 ? 0 : 1;
+}
\ No newline at end of file
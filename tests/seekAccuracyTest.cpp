@@ -0,0 +1,97 @@
+// After a seek the playback clock has to say where the listener is: through
+// the real-time null sink, which plays at the device rate, the position must
+// be the seek target plus the time audio has been playing since, to within
+// one buffer period.
+#include "testAudio.hpp"
+#include "../headers/playbackEngine.hpp"
+#include <thread>
+#include <chrono>
+#include <cstdlib>
+
+namespace {
+    const AudioFormat FORMAT(44100, 2);
+    const unsigned int LENGTH_MS = 20000;
+    const double BUFFER_PERIOD_MS = 1024 * 1000.0 / FORMAT.sampleRate;    // One render block
+    const double ROUNDING_MS = 2.0;
+
+    double millisecondsSince(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // The clock may be early by up to 'earlyMs' or late by up to 'lateMs'
+    void checkPosition(PlaybackEngine& engine, double expectedMs, const std::string& what,
+                       double earlyMs = BUFFER_PERIOD_MS, double lateMs = BUFFER_PERIOD_MS) {
+        double position = engine.getPositionMs();
+        double error = position - expectedMs;
+        std::cout << what << ": at " << position << " ms, expected " << static_cast<unsigned int>(expectedMs)
+                  << " ms (" << (error >= 0 ? "+" : "") << error << " ms)" << std::endl;
+        testAudio::check(error >= -lateMs && error <= earlyMs, what + " is within one buffer period");
+    }
+
+    // Seek while playing, let it play for a while and compare with the wall clock.
+    // What the output holds from before the seek plays out first: the latency
+    // the engine reports, and the block the render thread was writing when the
+    // seek came in. That block is up to one buffer period the clock may lag by,
+    // it must never run ahead (but for the rounding of the millisecond readouts)
+    void seekAndPlay(PlaybackEngine& engine, unsigned int targetMs, unsigned int playMs) {
+        testAudio::check(engine.seek(targetMs), "seek to " + std::to_string(targetMs) + " ms");
+        auto seekTime = std::chrono::steady_clock::now();
+        std::this_thread::sleep_for(std::chrono::milliseconds(playMs));
+        double played = millisecondsSince(seekTime) - engine.getLatencyMs();
+        checkPosition(engine, targetMs + played, std::to_string(playMs) + " ms after seeking to " + std::to_string(targetMs) + " ms",
+                      ROUNDING_MS, BUFFER_PERIOD_MS + ROUNDING_MS);
+    }
+}
+
+int main() {
+    using testAudio::check;
+    std::filesystem::path dir = testAudio::scratchDirectory("seek_accuracy_test");
+    std::string path = (dir / "track.wav").string();
+
+    size_t frames = static_cast<size_t>(LENGTH_MS) * FORMAT.sampleRate / 1000;
+    if (!testAudio::writeWav(path, FORMAT, std::vector<float>(frames * FORMAT.channels, 0.25f))) {
+        std::cout << "Could not write the test track in " << dir.string() << std::endl;
+        return 1;
+    }
+
+    PlaybackEngine engine;
+    check(engine.setOutput("null"), "real-time null output opens");
+    check(engine.load(AudioBackend::openFile(path)), "track loads");
+    check(engine.getLengthMs() == LENGTH_MS, "length is the track's");
+
+    engine.play();
+    auto playTime = std::chrono::steady_clock::now();
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    checkPosition(engine, millisecondsSince(playTime) - engine.getFirstAudioMs(), "500 ms after play");
+
+    // Paused, the clock stands exactly where the seek put it and carries on from there
+    engine.pause();
+    check(engine.seek(7000), "seek while paused");
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    checkPosition(engine, 7000, "paused after seeking to 7000 ms");
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    checkPosition(engine, 7000, "still paused");
+    engine.resume();
+    auto resumeTime = std::chrono::steady_clock::now();
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    checkPosition(engine, 7000 + millisecondsSince(resumeTime), "500 ms after resuming");
+
+    // Forward, backward and to the last second, each from a different spot
+    seekAndPlay(engine, 15000, 400);
+    seekAndPlay(engine, 2000, 400);
+    seekAndPlay(engine, 2500, 300);
+    seekAndPlay(engine, 300, 600);
+
+    // Into the last half second: the end is reported when the clock reaches the length
+    check(engine.seek(LENGTH_MS - 500), "seek near the end");
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (!engine.hasFinished() && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    check(engine.hasFinished(), "playback finishes after the last half second");
+    checkPosition(engine, LENGTH_MS, "finished");
+
+    engine.shutdown();
+    std::filesystem::remove_all(dir);
+    return testAudio::failures == 0 ? 0 : 1;
+}
\ No newline at end of file
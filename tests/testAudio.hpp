@@ -0,0 +1,135 @@
+#ifndef TESTAUDIO_HPP
+#define TESTAUDIO_HPP
+
+#include <string>
+#include <vector>
+#include <iostream>
+#include <filesystem>
+#include <cmath>
+#include <algorithm>
+#include "../headers/audioSink.hpp"
+#include "../headers/wavDecoder.hpp"
+#include "../headers/audioBackend.hpp"
+
+// Helpers shared by the test programs: scratch files and WAV input/output
+// through the player's own float WAV writer and decoder. Each test is its
+// own executable that prints what failed and returns non-zero for ctest.
+namespace testAudio {
+    inline int failures = 0;
+
+    inline void check(bool condition, const std::string& what) {
+        if (!condition) {
+            std::cout << "FAILED: " << what << std::endl;
+            failures++;
+        }
+    }
+
+    // Empty directory under the system temp directory, removed by the next run
+    inline std::filesystem::path scratchDirectory(const std::string& name) {
+        std::filesystem::path dir = std::filesystem::temp_directory_path() / ("stardust_" + name);
+        std::filesystem::remove_all(dir);
+        std::filesystem::create_directories(dir);
+        return dir;
+    }
+
+    // A sine of the same phase on every channel, generated as it is decoded
+    class ToneSource : public AudioBackend {
+    public:
+        ToneSource(const AudioFormat& toneFormat, double toneHz, float toneAmplitude, uint64_t toneFrames)
+            : format(toneFormat), hz(toneHz), amplitude(toneAmplitude), lengthFrames(toneFrames), positionFrames(0) {}
+
+        bool open(const std::string&) override { return true; }
+        size_t decode(float* buffer, size_t frameCount) override {
+            size_t frames = static_cast<size_t>((std::min)(static_cast<uint64_t>(frameCount), lengthFrames - positionFrames));
+            for (size_t i = 0; i < frames; ++i) {
+                double t = static_cast<double>(positionFrames + i) / format.sampleRate;
+                float value = amplitude * static_cast<float>(std::sin(2.0 * PI * hz * t));
+                for (unsigned int c = 0; c < format.channels; ++c) {
+                    buffer[i * format.channels + c] = value;
+                }
+            }
+            positionFrames += frames;
+            return frames;
+        }
+        bool seek(uint64_t frame) override {
+            positionFrames = (std::min)(frame, lengthFrames);
+            return true;
+        }
+        void close() override {}
+
+        AudioFormat getFormat() const override { return format; }
+        uint64_t getLengthFrames() const override { return lengthFrames; }
+        uint64_t getPositionFrames() const override { return positionFrames; }
+
+        static constexpr double PI = 3.14159265358979323846;
+
+    private:
+        AudioFormat format;
+        double hz;
+        float amplitude;
+        uint64_t lengthFrames;
+        uint64_t positionFrames;
+    };
+
+    // Plays interleaved samples someone else holds in memory
+    class BufferSource : public AudioBackend {
+    public:
+        BufferSource(const std::vector<float>& bufferSamples, const AudioFormat& bufferFormat)
+            : samples(bufferSamples), format(bufferFormat), positionFrames(0) {}
+
+        bool open(const std::string&) override { return true; }
+        size_t decode(float* buffer, size_t frameCount) override {
+            size_t frames = static_cast<size_t>((std::min)(static_cast<uint64_t>(frameCount), getLengthFrames() - positionFrames));
+            std::copy(samples.begin() + positionFrames * format.channels,
+                      samples.begin() + (positionFrames + frames) * format.channels, buffer);
+            positionFrames += frames;
+            return frames;
+        }
+        bool seek(uint64_t frame) override {
+            positionFrames = (std::min)(frame, getLengthFrames());
+            return true;
+        }
+        void close() override {}
+
+        AudioFormat getFormat() const override { return format; }
+        uint64_t getLengthFrames() const override { return samples.size() / format.channels; }
+        uint64_t getPositionFrames() const override { return positionFrames; }
+
+    private:
+        const std::vector<float>& samples;
+        AudioFormat format;
+        uint64_t positionFrames;
+    };
+
+    // Everything a source decodes, interleaved
+    inline std::vector<float> decodeAll(AudioBackend& source) {
+        unsigned int channels = source.getFormat().channels;
+        std::vector<float> samples;
+        std::vector<float> chunk(4096 * channels);
+        size_t frames = 0;
+        while ((frames = source.decode(chunk.data(), 4096)) > 0) {
+            samples.insert(samples.end(), chunk.begin(), chunk.begin() + frames * channels);
+        }
+        return samples;
+    }
+
+    inline bool writeWav(const std::string& path, const AudioFormat& format, const std::vector<float>& samples) {
+        WavFileSink sink(path);
+        if (!sink.open(format) || !sink.write(samples.data(), samples.size() / format.channels)) {
+            return false;
+        }
+        sink.finish();
+        return true;
+    }
+
+    inline std::vector<float> readWav(const std::string& path, AudioFormat& format) {
+        WavDecoder decoder;
+        if (!decoder.open(path)) {
+            return std::vector<float>();
+        }
+        format = decoder.getFormat();
+        return decodeAll(decoder);
+    }
+}
+
+#endif
\ No newline at end of file
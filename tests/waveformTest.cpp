@@ -0,0 +1,82 @@
+// Waveform overviews of an MP3: a tone that swells from silence to near full
+// scale, as WAV and as MP3. The MP3's buckets follow the WAV's, are still
+// there after a save and a load through the mapped waveforms.bin, and a file
+// that only looks like an MP3 gets none.
+#include "testAudio.hpp"
+#include "mp3TestEncoder.hpp"
+#include "../headers/featureLibrary.hpp"
+#include <fstream>
+#include <thread>
+#include <chrono>
+
+namespace {
+    const AudioFormat FORMAT(44100, 2);
+
+    std::vector<float> swell(double seconds) {
+        size_t frames = static_cast<size_t>(seconds * FORMAT.sampleRate);
+        std::vector<float> samples(frames * FORMAT.channels);
+        for (size_t i = 0; i < frames; ++i) {
+            double t = static_cast<double>(i) / FORMAT.sampleRate;
+            float value = static_cast<float>(0.9 * i / frames * std::sin(2.0 * testAudio::ToneSource::PI * 330.0 * t));
+            for (unsigned int c = 0; c < FORMAT.channels; ++c) {
+                samples[i * FORMAT.channels + c] = value;
+            }
+        }
+        return samples;
+    }
+}
+
+int main() {
+    using testAudio::check;
+    std::filesystem::path dir = testAudio::scratchDirectory("waveform_test");
+    std::string mp3Path = (dir / "swell.mp3").string();
+    std::string wavPath = (dir / "swell.wav").string();
+    std::string junkPath = (dir / "junk.mp3").string();
+    std::string libraryPath = (dir / "features.bin").string();
+    std::string waveformPath = (dir / "waveforms.bin").string();
+
+    std::vector<float> samples = swell(8.0);
+    if (!mp3TestEncoder::encode(mp3Path, FORMAT, samples) || !testAudio::writeWav(wavPath, FORMAT, samples)) {
+        std::cout << "Could not write the test songs in " << dir.string() << std::endl;
+        return 1;
+    }
+    std::ofstream(junkPath) << "not audio";
+
+    std::vector<WaveformSummary::Bucket> mp3;
+    std::vector<WaveformSummary::Bucket> wav;
+    std::vector<WaveformSummary::Bucket> junk;
+    {
+        FeatureLibrary library;
+        library.analyze({ mp3Path, wavPath, junkPath });
+        while (library.isBusy()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        check(library.findWaveform(mp3Path, mp3) && mp3.size() == WaveformSummary::BUCKETS, "MP3 has a waveform");
+        check(library.findWaveform(wavPath, wav) && wav.size() == WaveformSummary::BUCKETS, "WAV has a waveform");
+        check(!library.findWaveform(junkPath, junk), "a file no decoder reads has none");
+        check(library.save(libraryPath, waveformPath), "features.bin and waveforms.bin save");
+    }
+
+    int largest = 0;
+    for (size_t i = 0; i < mp3.size() && i < wav.size(); ++i) {
+        largest = (std::max)(largest, std::abs(mp3[i].rms - wav[i].rms));
+        largest = (std::max)(largest, std::abs(mp3[i].max - wav[i].max));
+        largest = (std::max)(largest, std::abs(mp3[i].min - wav[i].min));
+    }
+    std::cout << "MP3 buckets differ from the WAV's by at most " << largest << " steps" << std::endl;
+    check(largest <= 3, "MP3 waveform follows the WAV's");
+    check(!mp3.empty() && mp3.back().rms > 100 && mp3.front().rms < 5, "MP3 waveform swells");
+
+    FeatureLibrary reloaded;
+    check(reloaded.load(libraryPath, waveformPath), "features.bin and waveforms.bin load");
+    std::vector<WaveformSummary::Bucket> loaded;
+    check(reloaded.findWaveform(mp3Path, loaded) && loaded.size() == mp3.size(), "MP3 waveform survives a reload");
+    bool same = loaded.size() == mp3.size();
+    for (size_t i = 0; same && i < mp3.size(); ++i) {
+        same = loaded[i].min == mp3[i].min && loaded[i].max == mp3[i].max && loaded[i].rms == mp3[i].rms;
+    }
+    check(same, "reloaded MP3 waveform is the one saved");
+
+    std::filesystem::remove_all(dir);
+    return testAudio::failures == 0 ? 0 : 1;
+}
\ No newline at end of file